@@ -0,0 +1,159 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define ENABLE_ZENTIMER
+#include "zentimer.h"
+
+/* Measures the throughput of decoding rfc2047 encoded headers and of
+ * converting message bodies to UTF-8 for common single-byte charsets,
+ * with plain iconv as the baseline for the latter.
+ *
+ * Usage: bench-charset [MiB] [iterations] */
+
+static const char *header = "=?iso-8859-1?q?Caf=E9_cr=E8me?= =?windows-1252?q?=93quoted=94_text?= "
+	"=?koi8-r?b?8NLJ18XULCDNydI=?= =?iso-8859-15?q?co=FBt_=A4?=";
+
+static const char *charsets[] = { "iso-8859-1", "windows-1252", "koi8-r" };
+
+static void
+report (const char *what, const char *charset, size_t nbytes, int iterations)
+{
+	bench_report (what, charset, ZenTimerElapsed (NULL, NULL), (guint64) nbytes * iterations, 0, NULL);
+}
+
+static void
+bench_headers (int iterations)
+{
+	char *decoded;
+	int i;
+	
+	iterations *= 100000;
+	
+	ZenTimerStart (NULL);
+	for (i = 0; i < iterations; i++) {
+		decoded = g_mime_utils_header_decode_text (NULL, header);
+		g_free (decoded);
+	}
+	ZenTimerStop (NULL);
+	
+	bench_report ("g_mime_utils_header_decode_text", "mixed charsets", ZenTimerElapsed (NULL, NULL),
+		      (guint64) strlen (header) * iterations, iterations, "headers");
+}
+
+static void
+bench_body (const char *charset, const char *text, size_t size, int iterations)
+{
+	GMimeStream *stream, *filtered;
+	char *outbuf, *inbuf, *out;
+	size_t inleft, outleft;
+	GMimeFilter *filter;
+	iconv_t cd;
+	int i;
+	
+	out = g_malloc (size * 3);
+	
+	ZenTimerStart (NULL);
+	for (i = 0; i < iterations; i++) {
+		cd = g_mime_iconv_open ("UTF-8", charset);
+		inbuf = (char *) text;
+		inleft = size;
+		outbuf = out;
+		outleft = size * 3;
+		
+		while (inleft > 0 && iconv (cd, &inbuf, &inleft, &outbuf, &outleft) == (size_t) -1) {
+			inbuf++;
+			inleft--;
+		}
+		
+		g_mime_iconv_close (cd);
+	}
+	ZenTimerStop (NULL);
+	
+	report ("iconv", charset, size, iterations);
+	
+	g_free (out);
+	
+	ZenTimerStart (NULL);
+	for (i = 0; i < iterations; i++) {
+		stream = g_mime_stream_null_new ();
+		filtered = g_mime_stream_filter_new (stream);
+		filter = g_mime_filter_charset_new (charset, "UTF-8");
+		g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
+		g_object_unref (filter);
+		
+		g_mime_stream_write (filtered, text, size);
+		g_mime_stream_flush (filtered);
+		
+		g_object_unref (filtered);
+		g_object_unref (stream);
+	}
+	ZenTimerStop (NULL);
+	
+	report ("GMimeFilterCharset", charset, size, iterations);
+}
+
+int main (int argc, char **argv)
+{
+	size_t size = 16 * 1024 * 1024;
+	int iterations = 10;
+	char *text;
+	size_t n;
+	guint i;
+	
+	if (argc > 1)
+		size = (size_t) strtoul (argv[1], NULL, 10) * 1024 * 1024;
+	
+	if (argc > 2)
+		iterations = atoi (argv[2]);
+	
+	g_mime_init ();
+	
+	bench_headers (iterations);
+	
+	/* mostly ASCII text with the occasional 8bit character, one line every 72 bytes */
+	text = g_malloc (size);
+	for (n = 0; n < size; n++) {
+		if ((n % 72) == 71)
+			text[n] = '\n';
+		else if ((rand () % 20) == 0)
+			text[n] = (char) (0xc0 + (rand () % 64));
+		else
+			text[n] = 'a' + (rand () % 26);
+	}
+	
+	for (i = 0; i < G_N_ELEMENTS (charsets); i++)
+		bench_body (charsets[i], text, size, iterations);
+	
+	g_free (text);
+	
+	g_mime_shutdown ();
+	
+	return 0;
+}
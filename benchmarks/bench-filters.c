@@ -0,0 +1,227 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define ENABLE_ZENTIMER
+#include "zentimer.h"
+
+/* Measures the throughput of each of the GMimeFilters by pushing a
+ * buffer through g_mime_filter_filter() and g_mime_filter_complete()
+ * in 4K blocks, which is what GMimeStreamFilter does.
+ *
+ * Usage: bench-filters [MiB] [iterations] */
+
+#define BLOCK_SIZE 4096
+
+enum {
+	INPUT_TEXT,      /* 7bit text, LF line endings */
+	INPUT_LATIN1,    /* 8bit iso-8859-1 text */
+	INPUT_CRLF,      /* 7bit text, CRLF line endings */
+	INPUT_BINARY,    /* random bytes */
+	INPUT_BASE64,    /* base64 encoded binary */
+	INPUT_QP,        /* quoted-printable encoded latin1 text */
+	INPUT_UU,        /* uuencoded binary */
+	INPUT_YENC,      /* yEnc encoded binary */
+	INPUT_GZIP,      /* gzip compressed text */
+	N_INPUTS
+};
+
+static GByteArray *inputs[N_INPUTS];
+
+static GByteArray *
+run_filter (GMimeFilter *filter, GByteArray *input, gboolean capture)
+{
+	size_t outlen, outprespace, n;
+	GByteArray *output = NULL;
+	char *outbuf, *inbuf;
+	size_t i = 0;
+	
+	if (capture)
+		output = g_byte_array_new ();
+	
+	g_mime_filter_reset (filter);
+	
+	do {
+		n = MIN (BLOCK_SIZE, input->len - i);
+		inbuf = (char *) input->data + i;
+		i += n;
+		
+		if (i < input->len)
+			g_mime_filter_filter (filter, inbuf, n, 0, &outbuf, &outlen, &outprespace);
+		else
+			g_mime_filter_complete (filter, inbuf, n, 0, &outbuf, &outlen, &outprespace);
+		
+		if (capture)
+			g_byte_array_append (output, (unsigned char *) outbuf, outlen);
+	} while (i < input->len);
+	
+	return output;
+}
+
+static GByteArray *
+encode (GMimeFilter *filter, int input)
+{
+	GByteArray *output;
+	
+	output = run_filter (filter, inputs[input], TRUE);
+	g_object_unref (filter);
+	
+	return output;
+}
+
+static void
+generate_inputs (size_t size)
+{
+	GByteArray *text, *latin1, *crlf, *binary;
+	size_t n, col = 0;
+	unsigned char c;
+	
+	text = g_byte_array_sized_new (size);
+	latin1 = g_byte_array_sized_new (size);
+	crlf = g_byte_array_sized_new (size + size / 36);
+	binary = g_byte_array_sized_new (size);
+	
+	/* text with an occasional url and a "From " line now and then */
+	for (n = 0; n < size; n++) {
+		if (col == 71) {
+			c = '\n';
+			col = 0;
+		} else if ((rand () % 6) == 0) {
+			c = ' ';
+			col++;
+		} else {
+			c = 'a' + (rand () % 26);
+			col++;
+		}
+		
+		g_byte_array_append (text, &c, 1);
+		
+		if (c == '\n') {
+			g_byte_array_append (crlf, (unsigned char *) "\r\n", 2);
+			
+			if ((rand () % 50) == 0) {
+				g_byte_array_append (text, (unsigned char *) "From http://www.example.com/ ", 29);
+				col += 29;
+			}
+		} else {
+			g_byte_array_append (crlf, &c, 1);
+		}
+		
+		if (c != '\n' && (rand () % 20) == 0)
+			c = (unsigned char) (0xc0 + (rand () % 64));
+		
+		g_byte_array_append (latin1, &c, 1);
+		
+		c = (unsigned char) (rand () & 0xff);
+		g_byte_array_append (binary, &c, 1);
+	}
+	
+	inputs[INPUT_TEXT] = text;
+	inputs[INPUT_LATIN1] = latin1;
+	inputs[INPUT_CRLF] = crlf;
+	inputs[INPUT_BINARY] = binary;
+	
+	inputs[INPUT_BASE64] = encode (g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_BASE64, TRUE), INPUT_BINARY);
+	inputs[INPUT_QP] = encode (g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, TRUE), INPUT_LATIN1);
+	inputs[INPUT_UU] = encode (g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_UUENCODE, TRUE), INPUT_BINARY);
+	inputs[INPUT_YENC] = encode (g_mime_filter_yenc_new (TRUE), INPUT_BINARY);
+	inputs[INPUT_GZIP] = encode (g_mime_filter_gzip_new (GMIME_FILTER_GZIP_MODE_ZIP, 6), INPUT_TEXT);
+}
+
+static void
+bench_filter (const char *name, const char *variant, GMimeFilter *filter, int input, int iterations)
+{
+	int i;
+	
+	ZenTimerStart (NULL);
+	for (i = 0; i < iterations; i++)
+		run_filter (filter, inputs[input], FALSE);
+	ZenTimerStop (NULL);
+	
+	bench_report (name, variant, ZenTimerElapsed (NULL, NULL), (guint64) inputs[input]->len * iterations, 0, NULL);
+	
+	g_object_unref (filter);
+}
+
+int main (int argc, char **argv)
+{
+	size_t size = 16 * 1024 * 1024;
+	int iterations = 5;
+	int i;
+	
+	if (argc > 1)
+		size = (size_t) strtoul (argv[1], NULL, 10) * 1024 * 1024;
+	
+	if (argc > 2)
+		iterations = atoi (argv[2]);
+	
+	g_mime_init ();
+	
+	generate_inputs (size);
+	
+	bench_filter ("GMimeFilterBasic", "base64 encode",
+		      g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_BASE64, TRUE), INPUT_BINARY, iterations);
+	bench_filter ("GMimeFilterBasic", "base64 decode",
+		      g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_BASE64, FALSE), INPUT_BASE64, iterations);
+	bench_filter ("GMimeFilterBasic", "quoted-printable encode",
+		      g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, TRUE), INPUT_LATIN1, iterations);
+	bench_filter ("GMimeFilterBasic", "quoted-printable decode",
+		      g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, FALSE), INPUT_QP, iterations);
+	bench_filter ("GMimeFilterBasic", "uuencode",
+		      g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_UUENCODE, TRUE), INPUT_BINARY, iterations);
+	bench_filter ("GMimeFilterBasic", "uudecode",
+		      g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_UUENCODE, FALSE), INPUT_UU, iterations);
+	bench_filter ("GMimeFilterYenc", "encode", g_mime_filter_yenc_new (TRUE), INPUT_BINARY, iterations);
+	bench_filter ("GMimeFilterYenc", "decode", g_mime_filter_yenc_new (FALSE), INPUT_YENC, iterations);
+	bench_filter ("GMimeFilterGZip", "zip", g_mime_filter_gzip_new (GMIME_FILTER_GZIP_MODE_ZIP, 6), INPUT_TEXT, iterations);
+	bench_filter ("GMimeFilterGZip", "unzip", g_mime_filter_gzip_new (GMIME_FILTER_GZIP_MODE_UNZIP, 6), INPUT_GZIP, iterations);
+	bench_filter ("GMimeFilterCharset", "iso-8859-1 to UTF-8",
+		      g_mime_filter_charset_new ("iso-8859-1", "UTF-8"), INPUT_LATIN1, iterations);
+	bench_filter ("GMimeFilterWindows", "iso-8859-1", g_mime_filter_windows_new ("iso-8859-1"), INPUT_LATIN1, iterations);
+	bench_filter ("GMimeFilterBest", "charset+encoding",
+		      g_mime_filter_best_new (GMIME_FILTER_BEST_CHARSET | GMIME_FILTER_BEST_ENCODING), INPUT_LATIN1, iterations);
+	bench_filter ("GMimeFilterChecksum", "md5", g_mime_filter_checksum_new (G_CHECKSUM_MD5), INPUT_BINARY, iterations);
+	bench_filter ("GMimeFilterDos2Unix", NULL, g_mime_filter_dos2unix_new (FALSE), INPUT_CRLF, iterations);
+	bench_filter ("GMimeFilterUnix2Dos", NULL, g_mime_filter_unix2dos_new (FALSE), INPUT_TEXT, iterations);
+	bench_filter ("GMimeFilterSmtpData", NULL, g_mime_filter_smtp_data_new (), INPUT_TEXT, iterations);
+	bench_filter ("GMimeFilterFrom", "escape", g_mime_filter_from_new (GMIME_FILTER_FROM_MODE_ESCAPE), INPUT_TEXT, iterations);
+	bench_filter ("GMimeFilterFrom", "armor", g_mime_filter_from_new (GMIME_FILTER_FROM_MODE_ARMOR), INPUT_TEXT, iterations);
+	bench_filter ("GMimeFilterStrip", NULL, g_mime_filter_strip_new (), INPUT_TEXT, iterations);
+	bench_filter ("GMimeFilterOpenPGP", NULL, g_mime_filter_openpgp_new (), INPUT_TEXT, iterations);
+	bench_filter ("GMimeFilterHTML", "convert-nl+urls",
+		      g_mime_filter_html_new (GMIME_FILTER_HTML_CONVERT_NL | GMIME_FILTER_HTML_CONVERT_URLS, 0), INPUT_TEXT, iterations);
+	bench_filter ("GMimeFilterEnriched", NULL, g_mime_filter_enriched_new (0), INPUT_TEXT, iterations);
+	
+	for (i = 0; i < N_INPUTS; i++)
+		g_byte_array_free (inputs[i], TRUE);
+	
+	g_mime_shutdown ();
+	
+	return 0;
+}
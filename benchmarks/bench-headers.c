@@ -0,0 +1,237 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define ENABLE_ZENTIMER
+#include "zentimer.h"
+
+/* Measures the throughput of decoding the headers found in the
+ * synthetic corpus: rfc2047 text, address lists, dates and
+ * message-ids.
+ *
+ * Usage: bench-headers [messages] [iterations] */
+
+enum {
+	HEADER_TEXT,
+	HEADER_ADDRESSES,
+	HEADER_DATE,
+	HEADER_MESSAGE_ID,
+	N_HEADER_KINDS
+};
+
+static GPtrArray *values[N_HEADER_KINDS];
+static guint64 nbytes[N_HEADER_KINDS];
+
+static void
+add_value (int kind, const char *value)
+{
+	g_ptr_array_add (values[kind], g_strdup (value));
+	nbytes[kind] += strlen (value);
+}
+
+static void
+collect_headers (GMimeStream *corpus)
+{
+	GMimeHeaderList *headers;
+	GMimeMessage *message;
+	GMimeParser *parser;
+	GMimeHeader *header;
+	const char *name;
+	int count, i;
+	
+	parser = g_mime_parser_new_with_stream (corpus);
+	g_mime_parser_set_format (parser, GMIME_FORMAT_MBOX);
+	
+	while (!g_mime_parser_eos (parser)) {
+		if (!(message = g_mime_parser_construct_message (parser, NULL)))
+			break;
+		
+		headers = g_mime_object_get_header_list ((GMimeObject *) message);
+		count = g_mime_header_list_get_count (headers);
+		
+		for (i = 0; i < count; i++) {
+			header = g_mime_header_list_get_header_at (headers, i);
+			name = g_mime_header_get_name (header);
+			
+			if (!g_ascii_strcasecmp (name, "Subject"))
+				add_value (HEADER_TEXT, g_mime_header_get_raw_value (header));
+			else if (!g_ascii_strcasecmp (name, "From") || !g_ascii_strcasecmp (name, "To") ||
+				 !g_ascii_strcasecmp (name, "Cc"))
+				add_value (HEADER_ADDRESSES, g_mime_header_get_raw_value (header));
+			else if (!g_ascii_strcasecmp (name, "Date"))
+				add_value (HEADER_DATE, g_mime_header_get_raw_value (header));
+			else if (!g_ascii_strcasecmp (name, "Message-Id"))
+				add_value (HEADER_MESSAGE_ID, g_mime_header_get_raw_value (header));
+		}
+		
+		g_object_unref (message);
+	}
+	
+	g_object_unref (parser);
+}
+
+static void
+bench_text (int iterations)
+{
+	GPtrArray *array = values[HEADER_TEXT];
+	char *decoded;
+	guint i;
+	int j;
+	
+	ZenTimerStart (NULL);
+	for (j = 0; j < iterations; j++) {
+		for (i = 0; i < array->len; i++) {
+			decoded = g_mime_utils_header_decode_text (NULL, array->pdata[i]);
+			g_free (decoded);
+		}
+	}
+	ZenTimerStop (NULL);
+	
+	bench_report ("g_mime_utils_header_decode_text", "Subject", ZenTimerElapsed (NULL, NULL),
+		      nbytes[HEADER_TEXT] * iterations, (guint64) array->len * iterations, "headers");
+}
+
+static void
+bench_addresses (int iterations)
+{
+	GPtrArray *array = values[HEADER_ADDRESSES];
+	InternetAddressList *list;
+	guint i;
+	int j;
+	
+	ZenTimerStart (NULL);
+	for (j = 0; j < iterations; j++) {
+		for (i = 0; i < array->len; i++) {
+			if ((list = internet_address_list_parse (NULL, array->pdata[i])))
+				g_object_unref (list);
+		}
+	}
+	ZenTimerStop (NULL);
+	
+	bench_report ("internet_address_list_parse", "From/To/Cc", ZenTimerElapsed (NULL, NULL),
+		      nbytes[HEADER_ADDRESSES] * iterations, (guint64) array->len * iterations, "headers");
+}
+
+static void
+bench_dates (int iterations)
+{
+	GPtrArray *array = values[HEADER_DATE];
+	GDateTime *date;
+	guint i;
+	int j;
+	
+	ZenTimerStart (NULL);
+	for (j = 0; j < iterations; j++) {
+		for (i = 0; i < array->len; i++) {
+			if ((date = g_mime_utils_header_decode_date (array->pdata[i])))
+				g_date_time_unref (date);
+		}
+	}
+	ZenTimerStop (NULL);
+	
+	bench_report ("g_mime_utils_header_decode_date", "Date", ZenTimerElapsed (NULL, NULL),
+		      nbytes[HEADER_DATE] * iterations, (guint64) array->len * iterations, "headers");
+}
+
+static void
+bench_dates_unix (int iterations)
+{
+	GPtrArray *array = values[HEADER_DATE];
+	gint64 unix_time;
+	int tz_offset;
+	guint i;
+	int j;
+	
+	ZenTimerStart (NULL);
+	for (j = 0; j < iterations; j++) {
+		for (i = 0; i < array->len; i++)
+			g_mime_utils_header_decode_date_unix (array->pdata[i], &unix_time, &tz_offset);
+	}
+	ZenTimerStop (NULL);
+	
+	bench_report ("g_mime_utils_header_decode_date_unix", "Date", ZenTimerElapsed (NULL, NULL),
+		      nbytes[HEADER_DATE] * iterations, (guint64) array->len * iterations, "headers");
+}
+
+static void
+bench_message_ids (int iterations)
+{
+	GPtrArray *array = values[HEADER_MESSAGE_ID];
+	char *msgid;
+	guint i;
+	int j;
+	
+	ZenTimerStart (NULL);
+	for (j = 0; j < iterations; j++) {
+		for (i = 0; i < array->len; i++) {
+			msgid = g_mime_utils_decode_message_id (array->pdata[i]);
+			g_free (msgid);
+		}
+	}
+	ZenTimerStop (NULL);
+	
+	bench_report ("g_mime_utils_decode_message_id", "Message-Id", ZenTimerElapsed (NULL, NULL),
+		      nbytes[HEADER_MESSAGE_ID] * iterations, (guint64) array->len * iterations, "headers");
+}
+
+int main (int argc, char **argv)
+{
+	guint nmessages = 1000;
+	GMimeStream *corpus;
+	int iterations = 50;
+	int i;
+	
+	if (argc > 1)
+		nmessages = (guint) strtoul (argv[1], NULL, 10);
+	
+	if (argc > 2)
+		iterations = atoi (argv[2]);
+	
+	g_mime_init ();
+	
+	for (i = 0; i < N_HEADER_KINDS; i++)
+		values[i] = g_ptr_array_new_with_free_func (g_free);
+	
+	corpus = bench_corpus_new (nmessages, 0);
+	collect_headers (corpus);
+	g_object_unref (corpus);
+	
+	bench_text (iterations);
+	bench_addresses (iterations);
+	bench_dates (iterations);
+	bench_dates_unix (iterations);
+	bench_message_ids (iterations);
+	
+	for (i = 0; i < N_HEADER_KINDS; i++)
+		g_ptr_array_free (values[i], TRUE);
+	
+	g_mime_shutdown ();
+	
+	return 0;
+}
@@ -0,0 +1,159 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define ENABLE_ZENTIMER
+#include "zentimer.h"
+
+/* Measures the throughput of g_mime_parser_construct_message() on an
+ * mbox and of g_mime_object_write_to_stream() on the parsed messages.
+ *
+ * Usage: bench-mbox [-f mbox] [messages] [iterations]
+ *
+ * Without -f, a synthetic corpus of the requested number of messages
+ * is generated (see gen-corpus). */
+
+static GMimeStream *
+load_corpus (const char *filename)
+{
+	GMimeStream *stream, *corpus;
+	FILE *fp;
+	
+	if (!(fp = fopen (filename, "rb"))) {
+		fprintf (stderr, "bench-mbox: failed to open %s\n", filename);
+		exit (EXIT_FAILURE);
+	}
+	
+	/* load the whole thing into memory so that we don't measure the disk */
+	stream = g_mime_stream_file_new (fp);
+	corpus = g_mime_stream_mem_new ();
+	g_mime_stream_write_to_stream (stream, corpus);
+	g_mime_stream_reset (corpus);
+	g_object_unref (stream);
+	
+	return corpus;
+}
+
+static guint
+parse_corpus (GMimeStream *corpus, GPtrArray *messages)
+{
+	GMimeMessage *message;
+	GMimeParser *parser;
+	guint count = 0;
+	
+	g_mime_stream_reset (corpus);
+	parser = g_mime_parser_new_with_stream (corpus);
+	g_mime_parser_set_format (parser, GMIME_FORMAT_MBOX);
+	
+	while (!g_mime_parser_eos (parser)) {
+		if (!(message = g_mime_parser_construct_message (parser, NULL)))
+			break;
+		
+		if (messages != NULL)
+			g_ptr_array_add (messages, message);
+		else
+			g_object_unref (message);
+		
+		count++;
+	}
+	
+	g_object_unref (parser);
+	
+	return count;
+}
+
+int main (int argc, char **argv)
+{
+	const char *filename = NULL;
+	GMimeFormatOptions *format;
+	guint nmessages = 1000;
+	GMimeStream *corpus;
+	GPtrArray *messages;
+	GMimeStream *null;
+	int iterations = 5;
+	guint64 nbytes;
+	guint count = 0;
+	int i = 1;
+	guint j;
+	
+	if (argc > 2 && !strcmp (argv[1], "-f")) {
+		filename = argv[2];
+		i += 2;
+	}
+	
+	if (i < argc)
+		nmessages = (guint) strtoul (argv[i++], NULL, 10);
+	
+	if (i < argc)
+		iterations = atoi (argv[i++]);
+	
+	g_mime_init ();
+	
+	if (filename != NULL)
+		corpus = load_corpus (filename);
+	else
+		corpus = bench_corpus_new (nmessages, 0);
+	
+	nbytes = (guint64) g_mime_stream_length (corpus);
+	
+	ZenTimerStart (NULL);
+	for (i = 0; i < iterations; i++)
+		count = parse_corpus (corpus, NULL);
+	ZenTimerStop (NULL);
+	
+	bench_report ("g_mime_parser_construct_message", filename ? filename : "corpus",
+		      ZenTimerElapsed (NULL, NULL), nbytes * iterations, (guint64) count * iterations, "msgs");
+	
+	messages = g_ptr_array_new ();
+	parse_corpus (corpus, messages);
+	format = g_mime_format_options_get_default ();
+	null = g_mime_stream_null_new ();
+	
+	ZenTimerStart (NULL);
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < messages->len; j++)
+			g_mime_object_write_to_stream (messages->pdata[j], format, null);
+	}
+	ZenTimerStop (NULL);
+	
+	bench_report ("g_mime_object_write_to_stream", filename ? filename : "corpus",
+		      ZenTimerElapsed (NULL, NULL), ((GMimeStreamNull *) null)->written,
+		      (guint64) messages->len * iterations, "msgs");
+	
+	for (j = 0; j < messages->len; j++)
+		g_object_unref (messages->pdata[j]);
+	g_ptr_array_free (messages, TRUE);
+	
+	g_object_unref (corpus);
+	g_object_unref (null);
+	
+	g_mime_shutdown ();
+	
+	return 0;
+}
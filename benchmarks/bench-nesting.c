@@ -0,0 +1,120 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define ENABLE_ZENTIMER
+#include "zentimer.h"
+
+/* Measures how the parser copes with pathologically deep multipart
+ * nesting, where every line starting with "--" has to be checked
+ * against every boundary on the stack.
+ *
+ * Usage: bench-nesting [depth] [iterations] */
+
+static GMimeStream *
+generate_message (int depth)
+{
+	GMimeStream *stream;
+	int i, j;
+	
+	stream = g_mime_stream_mem_new ();
+	g_mime_stream_printf (stream, "From: Sender <sender@example.com>\n"
+			      "To: Receiver <receiver@example.com>\n"
+			      "Subject: nesting benchmark\n"
+			      "MIME-Version: 1.0\n");
+	
+	for (i = 0; i < depth; i++) {
+		g_mime_stream_printf (stream, "Content-Type: multipart/mixed; boundary=\"=-level-%d\"\n\n", i);
+		
+		/* a preface full of lines that look like they might be boundaries */
+		for (j = 0; j < 8; j++)
+			g_mime_stream_printf (stream, "--=-level-%d-not-quite\n", i);
+		
+		g_mime_stream_printf (stream, "\n--=-level-%d\n", i);
+		g_mime_stream_printf (stream, "Content-Type: text/plain\n\n");
+		
+		for (j = 0; j < 16; j++)
+			g_mime_stream_printf (stream, "-- \nsignature-like line %d\n", j);
+		
+		g_mime_stream_printf (stream, "\n--=-level-%d\n", i);
+	}
+	
+	g_mime_stream_printf (stream, "Content-Type: text/plain\n\ninnermost part\n");
+	
+	for (i = depth - 1; i >= 0; i--)
+		g_mime_stream_printf (stream, "\n--=-level-%d--\n", i);
+	
+	g_mime_stream_reset (stream);
+	
+	return stream;
+}
+
+int main (int argc, char **argv)
+{
+	GMimeMessage *message;
+	GMimeParser *parser;
+	GMimeStream *stream;
+	int iterations = 10;
+	int depth = 1000;
+	char *variant;
+	int i;
+	
+	if (argc > 1)
+		depth = atoi (argv[1]);
+	
+	if (argc > 2)
+		iterations = atoi (argv[2]);
+	
+	g_mime_init ();
+	
+	stream = generate_message (depth);
+	
+	ZenTimerStart (NULL);
+	for (i = 0; i < iterations; i++) {
+		g_mime_stream_reset (stream);
+		parser = g_mime_parser_new_with_stream (stream);
+		message = g_mime_parser_construct_message (parser, NULL);
+		g_object_unref (parser);
+		
+		g_assert (message != NULL);
+		g_object_unref (message);
+	}
+	ZenTimerStop (NULL);
+	
+	variant = g_strdup_printf ("nested multiparts, depth=%d", depth);
+	bench_report ("g_mime_parser_construct_message", variant, ZenTimerElapsed (NULL, NULL),
+		      (guint64) g_mime_stream_length (stream) * iterations, iterations, "msgs");
+	g_free (variant);
+	
+	g_object_unref (stream);
+	
+	g_mime_shutdown ();
+	
+	return 0;
+}
@@ -0,0 +1,126 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define ENABLE_ZENTIMER
+#include "zentimer.h"
+
+/* Measures the throughput of the parser's content scanner on a
+ * message with a large base64 attachment.
+ *
+ * Usage: bench-parser [-s none|sse2|sse4.1|avx2] [MiB] [iterations]
+ *
+ * Run it once with `-s none` (the scalar line scanner) and once
+ * without (the best code path the CPU supports) to compare. */
+
+static GMimeStream *
+generate_message (size_t size)
+{
+	static const char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	GMimeStream *stream;
+	char line[78];
+	size_t n = 0;
+	int i;
+	
+	stream = g_mime_stream_mem_new ();
+	g_mime_stream_printf (stream, "From: Sender <sender@example.com>\n"
+			      "To: Receiver <receiver@example.com>\n"
+			      "Subject: scan benchmark\n"
+			      "MIME-Version: 1.0\n"
+			      "Content-Type: multipart/mixed; boundary=\"=-bench-boundary\"\n\n"
+			      "--=-bench-boundary\n"
+			      "Content-Type: text/plain\n\n"
+			      "See the attachment.\n\n"
+			      "--=-bench-boundary\n"
+			      "Content-Type: application/octet-stream\n"
+			      "Content-Transfer-Encoding: base64\n\n");
+	
+	line[76] = '\n';
+	while (n < size) {
+		for (i = 0; i < 76; i++)
+			line[i] = b64[rand () % 64];
+		
+		g_mime_stream_write (stream, line, 77);
+		n += 77;
+	}
+	
+	g_mime_stream_printf (stream, "\n--=-bench-boundary--\n");
+	g_mime_stream_reset (stream);
+	
+	return stream;
+}
+
+int main (int argc, char **argv)
+{
+	size_t size = 64 * 1024 * 1024;
+	GMimeMessage *message;
+	GMimeParser *parser;
+	GMimeStream *stream;
+	int iterations = 10;
+	int i = 1;
+	
+	if (argc > 2 && !strcmp (argv[1], "-s")) {
+		g_setenv ("GMIME_SIMD", argv[2], TRUE);
+		i += 2;
+	}
+	
+	if (i < argc)
+		size = (size_t) strtoul (argv[i++], NULL, 10) * 1024 * 1024;
+	
+	if (i < argc)
+		iterations = atoi (argv[i++]);
+	
+	g_mime_init ();
+	
+	stream = generate_message (size);
+	
+	ZenTimerStart (NULL);
+	for (i = 0; i < iterations; i++) {
+		/* persisting the stream means the content never gets copied,
+		 * so this measures the scanner rather than memcpy */
+		g_mime_stream_reset (stream);
+		parser = g_mime_parser_new_with_stream (stream);
+		g_mime_parser_set_persist_stream (parser, TRUE);
+		message = g_mime_parser_construct_message (parser, NULL);
+		g_object_unref (parser);
+		
+		g_assert (message != NULL);
+		g_object_unref (message);
+	}
+	ZenTimerStop (NULL);
+	
+	bench_report ("parser_scan_content", bench_simd_variant (), ZenTimerElapsed (NULL, NULL),
+		      (guint64) g_mime_stream_length (stream) * iterations, iterations, "msgs");
+	
+	g_object_unref (stream);
+	
+	g_mime_shutdown ();
+	
+	return 0;
+}
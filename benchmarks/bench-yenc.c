@@ -0,0 +1,113 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define ENABLE_ZENTIMER
+#include "zentimer.h"
+
+/* Measures the throughput of the yEnc encoder and decoder, including
+ * the crc32 computation.
+ *
+ * Usage: bench-yenc [-s none|sse2|sse4.1|avx2] [MiB] [iterations]
+ *
+ * Run it once with `-s none` (the scalar codec) and once without
+ * (the best code path the CPU supports) to compare. */
+
+static void
+report (const char *what, size_t nbytes, int iterations)
+{
+	bench_report (what, bench_simd_variant (), ZenTimerElapsed (NULL, NULL),
+		      (guint64) nbytes * iterations, 0, NULL);
+}
+
+int main (int argc, char **argv)
+{
+	size_t size = 64 * 1024 * 1024;
+	unsigned char *raw, *encoded, *decoded;
+	size_t enclen = 0, declen = 0;
+	guint32 pcrc, crc, expected;
+	int iterations = 10;
+	size_t n;
+	int state;
+	int i = 1;
+	
+	if (argc > 2 && !strcmp (argv[1], "-s")) {
+		g_setenv ("GMIME_SIMD", argv[2], TRUE);
+		i += 2;
+	}
+	
+	if (i < argc)
+		size = (size_t) strtoul (argv[i++], NULL, 10) * 1024 * 1024;
+	
+	if (i < argc)
+		iterations = atoi (argv[i++]);
+	
+	g_mime_init ();
+	
+	raw = g_malloc (size);
+	for (n = 0; n < size; n++)
+		raw[n] = rand () & 0xff;
+	
+	encoded = g_malloc ((size + 2) * 2 + 62);
+	decoded = g_malloc (size);
+	
+	ZenTimerStart (NULL);
+	for (i = 0; i < iterations; i++) {
+		state = GMIME_YENCODE_STATE_INIT;
+		pcrc = crc = GMIME_YENCODE_CRC_INIT;
+		
+		enclen = g_mime_yencode_close (raw, size, encoded, &state, &pcrc, &crc);
+	}
+	ZenTimerStop (NULL);
+	
+	report ("yencode", size, iterations);
+	
+	expected = pcrc;
+	
+	ZenTimerStart (NULL);
+	for (i = 0; i < iterations; i++) {
+		state = GMIME_YDECODE_STATE_INIT;
+		pcrc = crc = GMIME_YENCODE_CRC_INIT;
+		
+		declen = g_mime_ydecode_step (encoded, enclen, decoded, &state, &pcrc, &crc);
+	}
+	ZenTimerStop (NULL);
+	
+	report ("ydecode", enclen, iterations);
+	
+	g_assert (declen == size && memcmp (raw, decoded, size) == 0 && pcrc == expected);
+	
+	g_free (decoded);
+	g_free (encoded);
+	g_free (raw);
+	
+	g_mime_shutdown ();
+	
+	return 0;
+}
@@ -0,0 +1,358 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+
+/**
+ * bench_report:
+ * @benchmark: the name of the thing being measured
+ * @variant: the input or code path that was measured (or %NULL)
+ * @elapsed: the number of seconds it took
+ * @nbytes: the number of bytes that were processed
+ * @nitems: the number of items (messages, headers, ...) that were processed
+ * @unit: the name of the items (e.g. "msgs") or %NULL if @nitems is meaningless
+ *
+ * Reports the throughput of a single benchmark run.
+ **/
+void
+bench_report (const char *benchmark, const char *variant, double elapsed,
+	      guint64 nbytes, guint64 nitems, const char *unit)
+{
+	double mbps = elapsed > 0.0 ? ((double) nbytes / (elapsed * 1000000.0)) : 0.0;
+	double ips = elapsed > 0.0 ? ((double) nitems / elapsed) : 0.0;
+	const char *format = g_getenv ("GMIME_BENCH_FORMAT");
+	
+	if (variant == NULL)
+		variant = "default";
+	
+	if (format != NULL && !g_ascii_strcasecmp (format, "json")) {
+		fprintf (stdout, "{ \"benchmark\": \"%s\", \"variant\": \"%s\", \"version\": \"%u.%u.%u\", "
+			 "\"seconds\": %.6f, \"bytes\": %" G_GUINT64_FORMAT ", \"MB/s\": %.3f",
+			 benchmark, variant, gmime_major_version, gmime_minor_version, gmime_micro_version,
+			 elapsed, nbytes, mbps);
+		
+		if (unit != NULL)
+			fprintf (stdout, ", \"unit\": \"%s\", \"items\": %" G_GUINT64_FORMAT ", \"items/s\": %.3f",
+				 unit, nitems, ips);
+		
+		fputs (" }\n", stdout);
+	} else if (unit != NULL) {
+		fprintf (stdout, "%s (%s): %.1f MB/s, %.0f %s/s\n", benchmark, variant, mbps, ips, unit);
+	} else {
+		fprintf (stdout, "%s (%s): %.1f MB/s\n", benchmark, variant, mbps);
+	}
+	
+	fflush (stdout);
+}
+
+
+/**
+ * bench_simd_variant:
+ *
+ * Gets the name of the SIMD code path that was requested via the
+ * GMIME_SIMD environment variable.
+ *
+ * Returns: the requested SIMD code path or "auto".
+ **/
+const char *
+bench_simd_variant (void)
+{
+	const char *simd = g_getenv ("GMIME_SIMD");
+	
+	return simd ? simd : "auto";
+}
+
+
+/* Synthetic corpus generation.
+ *
+ * The corpus is an mbox where every message carries a realistic set of
+ * rfc2047-heavy headers (encoded display names, groups, multi-word
+ * encoded subjects, References) and cycles through four body shapes:
+ *
+ *   0. a quoted-printable iso-8859-1 text/plain body
+ *   1. a multipart/mixed with a base64 application/octet-stream attachment
+ *   2. a multipart/mixed > multipart/alternative > multipart/related tree
+ *      with an attached message/rfc822
+ *   3. a text/plain body with an inline yEnc payload
+ *
+ * The output is fully determined by the number of messages and the seed. */
+
+static const char *display_names[] = {
+	"=?iso-8859-1?q?Fran=E7ois_Pr=E9vost?=",
+	"=?utf-8?b?w4lsb8Ovc2UgTcO8bGxlcg==?=",
+	"=?koi8-r?b?8MXU0s/X?=",
+	"=?windows-1252?q?J=F6rg_=93Joe=94_Smith?=",
+	"\"Doe, Jane\"",
+	"Plain Name"
+};
+
+static const char *subjects[] = {
+	"Re: =?utf-8?q?caf=C3=A9_cr=C3=A8me?= =?utf-8?b?5pel5pys6Kqe44Gu5Lu25ZCN?= notes",
+	"=?iso-8859-1?q?R=E9union_d=27=E9quipe?= =?iso-8859-1?q?_pr=E9vue?= pour demain",
+	"Fwd: =?windows-1252?q?=93quarterly=94_report?= (draft)",
+	"plain ascii subject for the status update"
+};
+
+static const char *words[] = {
+	"the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "message",
+	"parser", "header", "boundary", "attachment", "encoding", "content", "stream",
+	"filter", "address", "mailbox", "report", "quarterly", "meeting", "notes"
+};
+
+static void
+generate_text (GRand *rand, GString *text, size_t size, gboolean latin1)
+{
+	size_t linelen = 0;
+	const char *word;
+	
+	g_string_truncate (text, 0);
+	
+	while (text->len < size) {
+		word = words[g_rand_int_range (rand, 0, G_N_ELEMENTS (words))];
+		
+		if (linelen + strlen (word) + 1 > 72) {
+			g_string_append_c (text, '\n');
+			linelen = 0;
+		} else if (linelen > 0) {
+			g_string_append_c (text, ' ');
+			linelen++;
+		}
+		
+		g_string_append (text, word);
+		linelen += strlen (word);
+		
+		if (latin1 && g_rand_int_range (rand, 0, 8) == 0) {
+			/* sprinkle in an accented character */
+			g_string_append_c (text, (char) g_rand_int_range (rand, 0xe0, 0xff));
+			linelen++;
+		}
+	}
+	
+	g_string_append_c (text, '\n');
+}
+
+static void
+generate_binary (GRand *rand, GByteArray *data, size_t size)
+{
+	size_t i;
+	
+	g_byte_array_set_size (data, size);
+	
+	for (i = 0; i < size; i++)
+		data->data[i] = (unsigned char) g_rand_int_range (rand, 0, 256);
+}
+
+static void
+write_base64 (GMimeStream *stream, const unsigned char *data, size_t len)
+{
+	unsigned char *encoded;
+	guint32 save = 0;
+	int state = 0;
+	size_t n;
+	
+	encoded = g_malloc (GMIME_BASE64_ENCODE_LEN (len));
+	n = g_mime_encoding_base64_encode_close (data, len, encoded, &state, &save);
+	g_mime_stream_write (stream, (char *) encoded, n);
+	g_free (encoded);
+}
+
+static void
+write_quoted (GMimeStream *stream, const char *text, size_t len)
+{
+	unsigned char *encoded;
+	guint32 save = 0;
+	int state = -1;
+	size_t n;
+	
+	encoded = g_malloc (GMIME_QP_ENCODE_LEN (len));
+	n = g_mime_encoding_quoted_encode_close ((const unsigned char *) text, len, encoded, &state, &save);
+	g_mime_stream_write (stream, (char *) encoded, n);
+	g_free (encoded);
+}
+
+static void
+write_yenc (GMimeStream *stream, const unsigned char *data, size_t len, const char *name)
+{
+	guint32 pcrc = GMIME_YENCODE_CRC_INIT, crc = GMIME_YENCODE_CRC_INIT;
+	int state = GMIME_YENCODE_STATE_INIT;
+	unsigned char *encoded;
+	size_t n;
+	
+	encoded = g_malloc ((len + 2) * 2 + 62);
+	n = g_mime_yencode_close (data, len, encoded, &state, &pcrc, &crc);
+	
+	g_mime_stream_printf (stream, "=ybegin line=128 size=%lu name=%s\n", (unsigned long) len, name);
+	g_mime_stream_write (stream, (char *) encoded, n);
+	g_mime_stream_printf (stream, "=yend size=%lu crc32=%08x\n", (unsigned long) len,
+			      GMIME_YENCODE_CRC_FINAL (pcrc));
+	g_free (encoded);
+}
+
+static void
+write_headers (GMimeStream *stream, GRand *rand, guint index)
+{
+	const char *name = display_names[index % G_N_ELEMENTS (display_names)];
+	
+	g_mime_stream_printf (stream, "From user%u@example.com Tue Oct 17 10:%02u:%02u 2017\n",
+			      index, (index / 60) % 60, index % 60);
+	g_mime_stream_printf (stream, "Return-Path: <user%u@example.com>\n", index);
+	g_mime_stream_printf (stream, "Received: from mail%u.example.com (mail%u.example.com [192.0.2.%u])\n"
+			      "\tby mx.example.org with ESMTPS id %08x\n"
+			      "\tfor <list@example.org>; Tue, 17 Oct 2017 10:%02u:%02u +0200\n",
+			      index % 8, index % 8, index % 250, g_rand_int (rand),
+			      (index / 60) % 60, index % 60);
+	g_mime_stream_printf (stream, "From: %s <user%u@example.com>\n", name, index);
+	g_mime_stream_printf (stream, "To: %s <list@example.org>, =?utf-8?q?Z=C3=BCrich_Office?= <zurich@example.org>\n",
+			      display_names[(index + 1) % G_N_ELEMENTS (display_names)]);
+	g_mime_stream_printf (stream, "Cc: Team: %s <a@example.net>, b@example.net,\n"
+			      "\t%s <c@example.net>;\n",
+			      display_names[(index + 2) % G_N_ELEMENTS (display_names)],
+			      display_names[(index + 3) % G_N_ELEMENTS (display_names)]);
+	g_mime_stream_printf (stream, "Subject: %s #%u\n", subjects[index % G_N_ELEMENTS (subjects)], index);
+	g_mime_stream_printf (stream, "Date: Tue, 17 Oct 2017 10:%02u:%02u +0200\n", (index / 60) % 60, index % 60);
+	g_mime_stream_printf (stream, "Message-Id: <%u.%08x@example.com>\n", index, g_rand_int (rand));
+	
+	if (index > 0)
+		g_mime_stream_printf (stream, "In-Reply-To: <%u.thread@example.com>\n"
+				      "References: <0.thread@example.com> <%u.thread@example.com>\n",
+				      index - 1, index - 1);
+	
+	g_mime_stream_printf (stream, "MIME-Version: 1.0\n");
+}
+
+static void
+write_message (GMimeStream *stream, GRand *rand, GString *text, GByteArray *data, guint index)
+{
+	write_headers (stream, rand, index);
+	
+	switch (index % 4) {
+	case 0:
+		g_mime_stream_printf (stream, "Content-Type: text/plain; charset=iso-8859-1\n"
+				      "Content-Transfer-Encoding: quoted-printable\n\n");
+		generate_text (rand, text, 4096, TRUE);
+		write_quoted (stream, text->str, text->len);
+		break;
+	case 1:
+		g_mime_stream_printf (stream, "Content-Type: multipart/mixed; boundary=\"=-mixed-%u\"\n\n"
+				      "This is a multi-part message in MIME format.\n\n"
+				      "--=-mixed-%u\n"
+				      "Content-Type: text/plain; charset=us-ascii\n\n", index, index);
+		generate_text (rand, text, 1024, FALSE);
+		g_mime_stream_write (stream, text->str, text->len);
+		g_mime_stream_printf (stream, "\n--=-mixed-%u\n"
+				      "Content-Type: application/octet-stream; name=\"data%u.bin\"\n"
+				      "Content-Disposition: attachment; filename=\"data%u.bin\"\n"
+				      "Content-Transfer-Encoding: base64\n\n", index, index, index);
+		generate_binary (rand, data, 16384);
+		write_base64 (stream, data->data, data->len);
+		g_mime_stream_printf (stream, "\n--=-mixed-%u--\n", index);
+		break;
+	case 2:
+		g_mime_stream_printf (stream, "Content-Type: multipart/mixed; boundary=\"=-mixed-%u\"\n\n"
+				      "--=-mixed-%u\n"
+				      "Content-Type: multipart/alternative; boundary=\"=-alt-%u\"\n\n"
+				      "--=-alt-%u\n"
+				      "Content-Type: text/plain; charset=us-ascii\n\n",
+				      index, index, index, index);
+		generate_text (rand, text, 2048, FALSE);
+		g_mime_stream_write (stream, text->str, text->len);
+		g_mime_stream_printf (stream, "\n--=-alt-%u\n"
+				      "Content-Type: multipart/related; boundary=\"=-rel-%u\"; type=\"text/html\"\n\n"
+				      "--=-rel-%u\n"
+				      "Content-Type: text/html; charset=us-ascii\n\n"
+				      "<html><body><p>\n", index, index, index);
+		g_mime_stream_write (stream, text->str, text->len);
+		g_mime_stream_printf (stream, "</p><img src=\"cid:logo%u@example.com\"></body></html>\n"
+				      "\n--=-rel-%u\n"
+				      "Content-Type: image/png\n"
+				      "Content-Id: <logo%u@example.com>\n"
+				      "Content-Transfer-Encoding: base64\n\n", index, index, index);
+		generate_binary (rand, data, 2048);
+		write_base64 (stream, data->data, data->len);
+		g_mime_stream_printf (stream, "\n--=-rel-%u--\n"
+				      "\n--=-alt-%u--\n"
+				      "\n--=-mixed-%u\n"
+				      "Content-Type: message/rfc822\n\n"
+				      "From: %s <forwarded@example.com>\n"
+				      "Subject: %s\n"
+				      "Date: Mon, 16 Oct 2017 09:00:00 -0400\n"
+				      "Content-Type: text/plain\n\n"
+				      "forwarded message body\n"
+				      "\n--=-mixed-%u--\n",
+				      index, index, index,
+				      display_names[index % G_N_ELEMENTS (display_names)],
+				      subjects[(index + 1) % G_N_ELEMENTS (subjects)],
+				      index);
+		break;
+	default:
+		g_mime_stream_printf (stream, "Content-Type: text/plain; charset=us-ascii\n\n"
+				      "Here is the file you asked for.\n\n");
+		generate_binary (rand, data, 8192);
+		write_yenc (stream, data->data, data->len, "file.bin");
+		break;
+	}
+	
+	g_mime_stream_write (stream, "\n", 1);
+}
+
+
+/**
+ * bench_corpus_new:
+ * @nmessages: the number of messages to generate
+ * @seed: the seed for the random number generator
+ *
+ * Generates a synthetic mbox corpus.
+ *
+ * Returns: a new memory stream containing the corpus.
+ **/
+GMimeStream *
+bench_corpus_new (guint nmessages, guint32 seed)
+{
+	GMimeStream *stream;
+	GByteArray *data;
+	GString *text;
+	GRand *rand;
+	guint i;
+	
+	rand = g_rand_new_with_seed (seed);
+	stream = g_mime_stream_mem_new ();
+	data = g_byte_array_new ();
+	text = g_string_new ("");
+	
+	for (i = 0; i < nmessages; i++)
+		write_message (stream, rand, text, data, i);
+	
+	g_mime_stream_reset (stream);
+	
+	g_byte_array_free (data, TRUE);
+	g_string_free (text, TRUE);
+	g_rand_free (rand);
+	
+	return stream;
+}
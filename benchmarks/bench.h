@@ -0,0 +1,44 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <gmime/gmime.h>
+
+G_BEGIN_DECLS
+
+/* Every benchmark reports its results through bench_report() so that
+ * the output can be tracked over time.
+ *
+ * By default a human-readable line is printed. If GMIME_BENCH_FORMAT
+ * is set to "json" in the environment, each result is instead printed
+ * as a single JSON object per line (this is what `make bench` does). */
+
+void bench_report (const char *benchmark, const char *variant, double elapsed,
+		   guint64 nbytes, guint64 nitems, const char *unit);
+
+const char *bench_simd_variant (void);
+
+GMimeStream *bench_corpus_new (guint nmessages, guint32 seed);
+
+G_END_DECLS
+
+#endif /* __BENCH_H__ */
@@ -0,0 +1,72 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+/* Writes the synthetic benchmark corpus to a file so that it can be
+ * inspected, or fed to other tools for comparison.
+ *
+ * Usage: gen-corpus [-n messages] [-s seed] [output.mbox] */
+
+int main (int argc, char **argv)
+{
+	GMimeStream *corpus, *output;
+	guint nmessages = 1000;
+	guint32 seed = 0;
+	FILE *fp = stdout;
+	int i;
+	
+	for (i = 1; i < argc; i++) {
+		if (!strcmp (argv[i], "-n") && i + 1 < argc) {
+			nmessages = (guint) strtoul (argv[++i], NULL, 10);
+		} else if (!strcmp (argv[i], "-s") && i + 1 < argc) {
+			seed = (guint32) strtoul (argv[++i], NULL, 10);
+		} else if (!(fp = fopen (argv[i], "wb"))) {
+			fprintf (stderr, "gen-corpus: failed to open %s\n", argv[i]);
+			return EXIT_FAILURE;
+		}
+	}
+	
+	g_mime_init ();
+	
+	corpus = bench_corpus_new (nmessages, seed);
+	output = g_mime_stream_file_new (fp);
+	
+	if (fp == stdout)
+		g_mime_stream_file_set_owner ((GMimeStreamFile *) output, FALSE);
+	
+	g_mime_stream_write_to_stream (corpus, output);
+	g_mime_stream_flush (output);
+	
+	g_object_unref (output);
+	g_object_unref (corpus);
+	
+	g_mime_shutdown ();
+	
+	return EXIT_SUCCESS;
+}
@@ -945,6 +945,7 @@ int main (int argc, char **argv)
 	GMimeMessage *message;
 	GMimeParser *parser;
 	GMimeStream *stream;
+	const char *msgid;
 	int fd, i = 1;
 	char *uid;
 	
@@ -971,7 +972,8 @@ int main (int argc, char **argv)
 	g_object_unref (parser);
 	
 	if (message) {
-		uid = g_strdup (message->message_id ? message->message_id : basename (argv[i]));
+		msgid = g_mime_message_get_message_id (message);
+		uid = g_strdup (msgid ? msgid : basename (argv[i]));
 		g_mkdir (uid, 0777);
 		write_message (message, uid);
 		g_object_unref (message);
@@ -0,0 +1,156 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+
+/* Generates a case-insensitive perfect hash mapping the well-known
+ * header field names onto the GMimeHeaderId enum (gmime-internal.h).
+ *
+ * The hash is FNV-1a over the ASCII-folded name followed by a final
+ * xor-shift. All we need to find is a seed for which none of the
+ * names collide in a table of HEADER_ID_SLOTS entries; a lookup then
+ * costs one pass over the name plus a single strcasecmp to confirm. */
+
+#define HEADER_ID_SLOTS 128
+
+static const struct {
+	const char *name;
+	const char *id;
+} known_headers[] = {
+	{ "Return-Path",                 "GMIME_HEADER_ID_RETURN_PATH"                 },
+	{ "Received",                    "GMIME_HEADER_ID_RECEIVED"                    },
+	{ "Resent-Date",                 "GMIME_HEADER_ID_RESENT_DATE"                 },
+	{ "Resent-From",                 "GMIME_HEADER_ID_RESENT_FROM"                 },
+	{ "Resent-Sender",               "GMIME_HEADER_ID_RESENT_SENDER"               },
+	{ "Resent-Reply-To",             "GMIME_HEADER_ID_RESENT_REPLY_TO"             },
+	{ "Resent-To",                   "GMIME_HEADER_ID_RESENT_TO"                   },
+	{ "Resent-Cc",                   "GMIME_HEADER_ID_RESENT_CC"                   },
+	{ "Resent-Bcc",                  "GMIME_HEADER_ID_RESENT_BCC"                  },
+	{ "Resent-Message-Id",           "GMIME_HEADER_ID_RESENT_MESSAGE_ID"           },
+	{ "Date",                        "GMIME_HEADER_ID_DATE"                        },
+	{ "From",                        "GMIME_HEADER_ID_FROM"                        },
+	{ "Sender",                      "GMIME_HEADER_ID_SENDER"                      },
+	{ "Reply-To",                    "GMIME_HEADER_ID_REPLY_TO"                    },
+	{ "To",                          "GMIME_HEADER_ID_TO"                          },
+	{ "Cc",                          "GMIME_HEADER_ID_CC"                          },
+	{ "Bcc",                         "GMIME_HEADER_ID_BCC"                         },
+	{ "Message-Id",                  "GMIME_HEADER_ID_MESSAGE_ID"                  },
+	{ "In-Reply-To",                 "GMIME_HEADER_ID_IN_REPLY_TO"                 },
+	{ "References",                  "GMIME_HEADER_ID_REFERENCES"                  },
+	{ "Subject",                     "GMIME_HEADER_ID_SUBJECT"                     },
+	{ "Comments",                    "GMIME_HEADER_ID_COMMENTS"                    },
+	{ "Keywords",                    "GMIME_HEADER_ID_KEYWORDS"                    },
+	{ "MIME-Version",                "GMIME_HEADER_ID_MIME_VERSION"                },
+	{ "Content-Type",                "GMIME_HEADER_ID_CONTENT_TYPE"                },
+	{ "Content-Transfer-Encoding",   "GMIME_HEADER_ID_CONTENT_TRANSFER_ENCODING"   },
+	{ "Content-Disposition",         "GMIME_HEADER_ID_CONTENT_DISPOSITION"         },
+	{ "Content-Id",                  "GMIME_HEADER_ID_CONTENT_ID"                  },
+	{ "Content-Description",         "GMIME_HEADER_ID_CONTENT_DESCRIPTION"         },
+	{ "Content-Location",            "GMIME_HEADER_ID_CONTENT_LOCATION"            },
+	{ "Content-Md5",                 "GMIME_HEADER_ID_CONTENT_MD5"                 },
+	{ "Content-Length",              "GMIME_HEADER_ID_CONTENT_LENGTH"              },
+	{ "Content-Base",                "GMIME_HEADER_ID_CONTENT_BASE"                },
+	{ "Disposition-Notification-To", "GMIME_HEADER_ID_DISPOSITION_NOTIFICATION_TO" },
+};
+
+#define N_KNOWN_HEADERS (sizeof (known_headers) / sizeof (known_headers[0]))
+
+/* keep in sync with the copy printed out below */
+static unsigned int
+header_id_hash (unsigned int seed, const char *name, size_t *len)
+{
+	register const unsigned char *inptr = (const unsigned char *) name;
+	register unsigned int h = seed;
+
+	while (*inptr != '\0')
+		h = (h ^ (*inptr++ | 0x20)) * 16777619U;
+
+	*len = (size_t) (inptr - (const unsigned char *) name);
+
+	return (h ^ (h >> 16)) & (HEADER_ID_SLOTS - 1);
+}
+
+int main (int argc, char **argv)
+{
+	int slots[HEADER_ID_SLOTS];
+	unsigned int seed, h;
+	size_t i, len;
+
+	for (seed = 2166136261U; ; seed++) {
+		for (i = 0; i < HEADER_ID_SLOTS; i++)
+			slots[i] = -1;
+
+		for (i = 0; i < N_KNOWN_HEADERS; i++) {
+			h = header_id_hash (seed, known_headers[i].name, &len);
+			if (slots[h] != -1)
+				break;
+
+			slots[h] = (int) i;
+		}
+
+		if (i == N_KNOWN_HEADERS)
+			break;
+	}
+
+	printf ("/* THIS FILE IS AUTOGENERATED: DO NOT EDIT! */\n\n");
+	printf ("/*\n * To regenerate:\n * make gen-header-ids\n");
+	printf (" * ./gen-header-ids > gmime-header-ids-private.h\n */\n\n");
+
+	printf ("#define HEADER_ID_HASH_SEED %uU\n", seed);
+	printf ("#define HEADER_ID_SLOTS %d\n\n", HEADER_ID_SLOTS);
+
+	printf ("static unsigned int\n");
+	printf ("header_id_hash (const char *name, size_t *len)\n");
+	printf ("{\n");
+	printf ("\tregister const unsigned char *inptr = (const unsigned char *) name;\n");
+	printf ("\tregister unsigned int h = HEADER_ID_HASH_SEED;\n");
+	printf ("\t\n");
+	printf ("\twhile (*inptr != '\\0')\n");
+	printf ("\t\th = (h ^ (*inptr++ | 0x20)) * 16777619U;\n");
+	printf ("\t\n");
+	printf ("\t*len = (size_t) (inptr - (const unsigned char *) name);\n");
+	printf ("\t\n");
+	printf ("\treturn (h ^ (h >> 16)) & (HEADER_ID_SLOTS - 1);\n");
+	printf ("}\n\n");
+
+	printf ("static const struct {\n");
+	printf ("\tconst char *name;\n");
+	printf ("\tsize_t length;\n");
+	printf ("\tGMimeHeaderId id;\n");
+	printf ("} header_ids[HEADER_ID_SLOTS] = {\n");
+
+	for (i = 0; i < HEADER_ID_SLOTS; i++) {
+		if (slots[i] == -1) {
+			printf ("\t{ NULL, 0, GMIME_HEADER_ID_UNKNOWN }");
+		} else {
+			printf ("\t{ \"%s\", %u, %s }", known_headers[slots[i]].name,
+				(unsigned int) strlen (known_headers[slots[i]].name),
+				known_headers[slots[i]].id);
+		}
+
+		printf ("%s\n", i + 1 < HEADER_ID_SLOTS ? "," : "");
+	}
+
+	printf ("};\n");
+
+	return 0;
+}
@@ -0,0 +1,146 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iconv.h>
+#include <errno.h>
+
+/* Generates the byte -> Unicode tables used to convert the most common
+ * single-byte charsets to UTF-8 without going through iconv. Only the
+ * upper half of each table is emitted, the lower half must be ASCII.
+ *
+ * Note: windows-cp1255 and windows-cp1258 are deliberately left out since
+ * iconv combines base characters with the diacritics that follow them,
+ * which a simple table lookup cannot reproduce. */
+
+static struct {
+	const char *name;        /* the name returned by g_mime_charset_canon_name() */
+	const char *iconv_name;  /* the name to pass to iconv_open() */
+} charsets[] = {
+	{ "iso-8859-1",     "ISO-8859-1"  },
+	{ "iso-8859-2",     "ISO-8859-2"  },
+	{ "iso-8859-3",     "ISO-8859-3"  },
+	{ "iso-8859-4",     "ISO-8859-4"  },
+	{ "iso-8859-5",     "ISO-8859-5"  },
+	{ "iso-8859-6",     "ISO-8859-6"  },
+	{ "iso-8859-7",     "ISO-8859-7"  },
+	{ "iso-8859-8",     "ISO-8859-8"  },
+	{ "iso-8859-9",     "ISO-8859-9"  },
+	{ "iso-8859-10",    "ISO-8859-10" },
+	{ "iso-8859-11",    "ISO-8859-11" },
+	{ "iso-8859-13",    "ISO-8859-13" },
+	{ "iso-8859-14",    "ISO-8859-14" },
+	{ "iso-8859-15",    "ISO-8859-15" },
+	{ "iso-8859-16",    "ISO-8859-16" },
+	{ "windows-cp1250", "CP1250"      },
+	{ "windows-cp1251", "CP1251"      },
+	{ "windows-cp1252", "CP1252"      },
+	{ "windows-cp1253", "CP1253"      },
+	{ "windows-cp1254", "CP1254"      },
+	{ "windows-cp1256", "CP1256"      },
+	{ "windows-cp1257", "CP1257"      },
+	{ "koi8-r",         "KOI8-R"      },
+	{ "koi8-u",         "KOI8-U"      },
+};
+
+#define G_N_ELEMENTS(arr) (sizeof (arr) / sizeof ((arr)[0]))
+
+/* returns the Unicode code point for @c in the charset or 0 if it is not
+ * a complete character on its own */
+static unsigned int
+to_unicode (iconv_t cd, unsigned char c)
+{
+	unsigned char out[16], *outbuf = out;
+	size_t inleft = 1, outleft = sizeof (out);
+	char *inbuf = (char *) &c;
+	
+	iconv (cd, NULL, NULL, NULL, NULL);
+	
+	if (iconv (cd, &inbuf, &inleft, (char **) &outbuf, &outleft) == (size_t) -1)
+		return 0;
+	
+	/* we only handle charsets that map each byte to a single character */
+	if (outbuf - out != 4)
+		return 0;
+	
+	return (out[0] << 24) | (out[1] << 16) | (out[2] << 8) | out[3];
+}
+
+int main (int argc, char **argv)
+{
+	unsigned int table[128], u;
+	const char *name;
+	iconv_t cd;
+	size_t i;
+	int c;
+	
+	printf ("/* THIS FILE IS AUTOGENERATED: DO NOT EDIT! */\n\n");
+	printf ("/*\n * To regenerate:\n * make gen-sbcs-table\n");
+	printf (" * ./gen-sbcs-table > gmime-sbcs-table-private.h\n */\n\n");
+	
+	for (i = 0; i < G_N_ELEMENTS (charsets); i++) {
+		if ((cd = iconv_open ("UCS-4BE", charsets[i].iconv_name)) == (iconv_t) -1) {
+			fprintf (stderr, "%s: not supported by iconv: %s\n", charsets[i].iconv_name, strerror (errno));
+			exit (1);
+		}
+		
+		for (c = 0; c < 128; c++) {
+			if (to_unicode (cd, c) != (unsigned int) c) {
+				fprintf (stderr, "%s: not an ASCII superset\n", charsets[i].iconv_name);
+				exit (1);
+			}
+		}
+		
+		for (c = 128; c < 256; c++) {
+			if ((u = to_unicode (cd, c)) > 0xffff) {
+				fprintf (stderr, "%s: 0x%02x maps outside of the BMP\n", charsets[i].iconv_name, c);
+				exit (1);
+			}
+			
+			table[c - 128] = u;
+		}
+		
+		iconv_close (cd);
+		
+		printf ("static const unsigned short sbcs_");
+		for (name = charsets[i].name; *name; name++)
+			putchar (*name == '-' ? '_' : *name);
+		
+		printf ("[128] = {");
+		for (c = 0; c < 128; c++)
+			printf ("%s0x%04x%s", (c % 8) ? " " : "\n\t", table[c], c != 127 ? "," : "\n");
+		printf ("};\n\n");
+	}
+	
+	printf ("/* 0 means that the byte is not a valid character in the charset */\n");
+	printf ("static const struct {\n\tconst char *name;\n\tconst unsigned short *table;\n} sbcs_tables[] = {\n");
+	for (i = 0; i < G_N_ELEMENTS (charsets); i++) {
+		printf ("\t{ \"%s\", sbcs_", charsets[i].name);
+		for (name = charsets[i].name; *name; name++)
+			putchar (*name == '-' ? '_' : *name);
+		printf (" },\n");
+	}
+	printf ("};\n");
+	
+	return 0;
+}
@@ -482,7 +482,7 @@ g_mime_application_pkcs7_mime_verify (GMimeApplicationPkcs7Mime *pkcs7_mime, GMi
 	
 	*entity = NULL;
 	
-	if (!(ctx = g_mime_crypto_context_new ("application/pkcs7-mime"))) {
+	if (!(ctx = _g_mime_crypto_context_acquire ("application/pkcs7-mime"))) {
 		g_set_error (err, GMIME_ERROR, GMIME_ERROR_PROTOCOL_ERROR,
 			     _("Cannot verify application/pkcs7-mime part: no crypto context registered for this type."));
 		
@@ -506,7 +506,7 @@ g_mime_application_pkcs7_mime_verify (GMimeApplicationPkcs7Mime *pkcs7_mime, GMi
 		g_object_unref (ciphertext);
 		g_object_unref (filtered);
 		g_object_unref (stream);
-		g_object_unref (ctx);
+		_g_mime_crypto_context_release ("application/pkcs7-mime", ctx);
 		
 		return NULL;
 	}
@@ -514,7 +514,7 @@ g_mime_application_pkcs7_mime_verify (GMimeApplicationPkcs7Mime *pkcs7_mime, GMi
 	g_mime_stream_flush (filtered);
 	g_object_unref (ciphertext);
 	g_object_unref (filtered);
-	g_object_unref (ctx);
+	_g_mime_crypto_context_release ("application/pkcs7-mime", ctx);
 	
 	g_mime_stream_reset (stream);
 	parser = g_mime_parser_new ();
@@ -0,0 +1,176 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include "gmime-arena.h"
+
+/* An arena is a bump allocator for the strings and small structs that
+ * the parser creates for a single message. Nothing allocated from an
+ * arena is ever freed individually; the whole thing goes away in one
+ * shot when the last reference is dropped (each object holding memory
+ * from the arena keeps a reference).
+ *
+ * Allocating is not thread-safe, referencing is. */
+
+#define ARENA_CHUNK_SIZE 8192
+#define ARENA_ALIGN      (2 * sizeof (gpointer))
+
+typedef struct _ArenaChunk {
+	struct _ArenaChunk *next;
+	char *start, *end;
+} ArenaChunk;
+
+#define ARENA_CHUNK_HEAD ((sizeof (ArenaChunk) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+struct _GMimeArena {
+	volatile int ref_count;
+	ArenaChunk *chunks;
+	char *inptr, *inend;
+};
+
+static ArenaChunk *
+arena_chunk_new (size_t size)
+{
+	ArenaChunk *chunk;
+	
+	chunk = g_malloc (ARENA_CHUNK_HEAD + size);
+	chunk->start = ((char *) chunk) + ARENA_CHUNK_HEAD;
+	chunk->end = chunk->start + size;
+	chunk->next = NULL;
+	
+	return chunk;
+}
+
+
+/* creates a new arena with a reference count of 1 */
+GMimeArena *
+g_mime_arena_new (void)
+{
+	GMimeArena *arena;
+	
+	arena = g_slice_new (GMimeArena);
+	arena->ref_count = 1;
+	arena->chunks = NULL;
+	arena->inptr = NULL;
+	arena->inend = NULL;
+	
+	return arena;
+}
+
+
+/* adds a reference to @arena and returns it */
+GMimeArena *
+g_mime_arena_ref (GMimeArena *arena)
+{
+	g_atomic_int_inc (&arena->ref_count);
+	
+	return arena;
+}
+
+
+/* drops a reference to @arena, releasing all of the memory that was
+ * allocated from it once the last reference is gone */
+void
+g_mime_arena_unref (GMimeArena *arena)
+{
+	ArenaChunk *chunk, *next;
+	
+	if (!g_atomic_int_dec_and_test (&arena->ref_count))
+		return;
+	
+	chunk = arena->chunks;
+	while (chunk != NULL) {
+		next = chunk->next;
+		g_free (chunk);
+		chunk = next;
+	}
+	
+	g_slice_free (GMimeArena, arena);
+}
+
+
+/* allocates @size bytes from @arena. The memory is suitably aligned
+ * for any kind of struct and stays valid for as long as @arena does. */
+gpointer
+g_mime_arena_alloc (GMimeArena *arena, size_t size)
+{
+	ArenaChunk *chunk;
+	char *mem;
+	
+	size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+	
+	if ((size_t) (arena->inend - arena->inptr) >= size) {
+		mem = arena->inptr;
+		arena->inptr += size;
+		return mem;
+	}
+	
+	if (size > ARENA_CHUNK_SIZE / 4) {
+		/* large allocations get a chunk of their own so that
+		 * what's left of the current chunk does not go to waste */
+		chunk = arena_chunk_new (size);
+		
+		if (arena->chunks != NULL) {
+			chunk->next = arena->chunks->next;
+			arena->chunks->next = chunk;
+		} else {
+			arena->chunks = chunk;
+		}
+		
+		return chunk->start;
+	}
+	
+	chunk = arena_chunk_new (ARENA_CHUNK_SIZE);
+	chunk->next = arena->chunks;
+	arena->chunks = chunk;
+	
+	arena->inptr = chunk->start + size;
+	arena->inend = chunk->end;
+	
+	return chunk->start;
+}
+
+
+/* copies the first @n bytes of @str into @arena, nul-terminating the copy */
+char *
+g_mime_arena_strndup (GMimeArena *arena, const char *str, size_t n)
+{
+	char *dup;
+	
+	dup = g_mime_arena_alloc (arena, n + 1);
+	memcpy (dup, str, n);
+	dup[n] = '\0';
+	
+	return dup;
+}
+
+
+/* copies @str into @arena */
+char *
+g_mime_arena_strdup (GMimeArena *arena, const char *str)
+{
+	return g_mime_arena_strndup (arena, str, strlen (str));
+}
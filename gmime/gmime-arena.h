@@ -0,0 +1,41 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+
+
+#ifndef __GMIME_ARENA_H__
+#define __GMIME_ARENA_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GMimeArena GMimeArena;
+
+G_GNUC_INTERNAL GMimeArena *g_mime_arena_new (void);
+G_GNUC_INTERNAL GMimeArena *g_mime_arena_ref (GMimeArena *arena);
+G_GNUC_INTERNAL void g_mime_arena_unref (GMimeArena *arena);
+
+G_GNUC_INTERNAL gpointer g_mime_arena_alloc (GMimeArena *arena, size_t size);
+G_GNUC_INTERNAL char *g_mime_arena_strndup (GMimeArena *arena, const char *str, size_t n);
+G_GNUC_INTERNAL char *g_mime_arena_strdup (GMimeArena *arena, const char *str);
+
+G_END_DECLS
+
+#endif /* __GMIME_ARENA_H__ */
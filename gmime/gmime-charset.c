@@ -41,7 +41,10 @@
 #endif
 
 #include "gmime-charset-map-private.h"
+#include "gmime-sbcs-table-private.h"
 #include "gmime-table-private.h"
+#include "gmime-internal.h"
+#include "gmime-arena.h"
 #include "gmime-charset.h"
 #include "gmime-iconv.h"
 
@@ -82,6 +85,7 @@ static struct {
 	const char *iconv_name;
 } known_iconv_charsets[] = {
 	/* charset name, iconv-friendly name (sometimes case sensitive) */
+	/* UTF-8 must come first: it is interned as GMIME_CHARSET_ID_UTF8 */
 	{ "utf-8",           "UTF-8"      },
 	{ "utf8",            "UTF-8"      },
 	
@@ -164,7 +168,51 @@ static struct {
 	{ "koi8-u",      "uk" }
 };
 
-static GHashTable *iconv_charsets = NULL;
+/* The alias map is consulted for every encoded-word, every iconv_open()
+ * and every charset filter, but it only ever changes when we come across
+ * a charset name that we have not seen before. Lookups therefore do not
+ * take any locks: bucket heads are published with atomic pointer stores
+ * and an alias is never modified once it is reachable. Only writers
+ * serialize on the lock.
+ *
+ * When the table gets too full, a bigger copy is built and swapped in.
+ * Readers that are still walking the old copy are unaffected since
+ * nothing is ever freed before g_mime_charset_map_shutdown(), which
+ * releases the whole arena in one shot.
+ *
+ * Each distinct iconv name is also assigned a small integer id so that
+ * hot paths can compare charsets (and find their conversion tables)
+ * without ever touching the names again. Id 0 is never assigned. */
+
+typedef struct {
+	const char *iconv_name;
+	const unsigned short *sbcs_table;
+	guint id;
+} CharsetInfo;
+
+typedef struct {
+	volatile gint count;
+	guint size;
+	CharsetInfo *info[1];
+} CharsetInfoTable;
+
+typedef struct _CharsetAlias {
+	struct _CharsetAlias *next;
+	const char *name;          /* lowercased */
+	const CharsetInfo *info;
+	guint hash;
+} CharsetAlias;
+
+typedef struct {
+	guint mask;
+	CharsetAlias *buckets[1];
+} CharsetAliasTable;
+
+static CharsetAliasTable *charset_aliases = NULL;
+static CharsetInfoTable *charset_infos = NULL;
+static GHashTable *charset_ids = NULL;       /* iconv name -> CharsetInfo, writers only */
+static GMimeArena *charset_arena = NULL;     /* writers only */
+static guint charset_nalias = 0;             /* writers only */
 static char *locale_charset = NULL;
 static char *locale_lang = NULL;
 static int initialized = 0;
@@ -178,6 +226,330 @@ static GMutex lock;
 #define CHARSET_LOCK()
 #endif /* G_THREADS_ENABLED */
 
+static const char *iso_charsets[] = {
+	"us-ascii",
+	"iso-8859-1",
+	"iso-8859-2",
+	"iso-8859-3",
+	"iso-8859-4",
+	"iso-8859-5",
+	"iso-8859-6",
+	"iso-8859-7",
+	"iso-8859-8",
+	"iso-8859-9",
+	"iso-8859-10",
+	"iso-8859-11",
+	"iso-8859-12",
+	"iso-8859-13",
+	"iso-8859-14",
+	"iso-8859-15",
+	"iso-8859-16"
+};
+
+static const char *windows_charsets[] = {
+	"windows-cp1250",
+	"windows-cp1251",
+	"windows-cp1252",
+	"windows-cp1253",
+	"windows-cp1254",
+	"windows-cp1255",
+	"windows-cp1256",
+	"windows-cp1257",
+	"windows-cp1258",
+	"windows-cp1259"
+};
+
+
+static guint
+charset_hash (const char *name, size_t len)
+{
+	const unsigned char *inptr = (const unsigned char *) name;
+	const unsigned char *inend = inptr + len;
+	guint hash = 2166136261U;
+	
+	/* FNV-1a over the lowercased name */
+	while (inptr < inend)
+		hash = (hash ^ g_ascii_tolower (*inptr++)) * 16777619U;
+	
+	return hash;
+}
+
+/* canonicalizes an iconv name (see g_mime_charset_canon_name()) */
+static const char *
+charset_canon_name (const char *charset)
+{
+	const char *ptr;
+	char *endptr;
+	guint iso;
+	
+	if (g_ascii_strncasecmp (charset, "iso", 3) == 0) {
+		ptr = charset + 3;
+		if (*ptr == '-' || *ptr == '_')
+			ptr++;
+		
+		if (strncmp (ptr, "8859", 4) != 0)
+			return charset;
+		
+		ptr += 4;
+		if (*ptr == '-' || *ptr == '_')
+			ptr++;
+		
+		iso = strtoul (ptr, &endptr, 10);
+		if (endptr == ptr || *endptr != '\0')
+			return charset;
+		
+		if (iso >= G_N_ELEMENTS (iso_charsets))
+			return charset;
+		
+		return iso_charsets[iso];
+	} else if (!strncmp (charset, "CP125", 5)) {
+		ptr = charset + 5;
+		if (*ptr >= '0' && *ptr <= '9')
+			return windows_charsets[*ptr - '0'];
+	}
+	
+	return charset;
+}
+
+static const unsigned short *
+charset_sbcs_table (const char *canon_name)
+{
+	guint i;
+	
+	for (i = 0; i < G_N_ELEMENTS (sbcs_tables); i++) {
+		if (!g_ascii_strcasecmp (sbcs_tables[i].name, canon_name))
+			return sbcs_tables[i].table;
+	}
+	
+	return NULL;
+}
+
+static CharsetInfoTable *
+charset_info_table_new (guint size)
+{
+	CharsetInfoTable *table;
+	
+	table = g_mime_arena_alloc (charset_arena, G_STRUCT_OFFSET (CharsetInfoTable, info) + size * sizeof (CharsetInfo *));
+	table->size = size;
+	table->count = 0;
+	
+	return table;
+}
+
+static CharsetAliasTable *
+charset_alias_table_new (guint nbuckets)
+{
+	CharsetAliasTable *table;
+	
+	table = g_mime_arena_alloc (charset_arena, G_STRUCT_OFFSET (CharsetAliasTable, buckets) + nbuckets * sizeof (CharsetAlias *));
+	memset (table->buckets, 0, nbuckets * sizeof (CharsetAlias *));
+	table->mask = nbuckets - 1;
+	
+	return table;
+}
+
+/* Note: the following must be called with the lock held */
+
+/* interns @iconv_name, taking ownership of the string */
+static const CharsetInfo *
+charset_info_add (char *iconv_name)
+{
+	CharsetInfoTable *table = charset_infos;
+	CharsetInfoTable *grown;
+	CharsetInfo *info;
+	guint id;
+	
+	if ((info = g_hash_table_lookup (charset_ids, iconv_name))) {
+		g_free (iconv_name);
+		return info;
+	}
+	
+	info = g_mime_arena_alloc (charset_arena, sizeof (CharsetInfo));
+	info->iconv_name = g_mime_arena_strdup (charset_arena, iconv_name);
+	info->sbcs_table = charset_sbcs_table (charset_canon_name (info->iconv_name));
+	g_free (iconv_name);
+	
+	id = (guint) table->count;
+	
+	if (id == table->size) {
+		/* readers may still be indexing the old table, so copy it */
+		grown = charset_info_table_new (table->size * 2);
+		memcpy (grown->info, table->info, id * sizeof (CharsetInfo *));
+		grown->count = (gint) id;
+		
+		g_atomic_pointer_set (&charset_infos, grown);
+		table = grown;
+	}
+	
+	info->id = id;
+	table->info[id] = info;
+	g_atomic_int_set (&table->count, (gint) id + 1);
+	
+	g_hash_table_insert (charset_ids, (char *) info->iconv_name, info);
+	
+	return info;
+}
+
+static void
+charset_alias_insert (CharsetAliasTable *table, CharsetAlias *alias)
+{
+	CharsetAlias **bucket = &table->buckets[alias->hash & table->mask];
+	
+	alias->next = *bucket;
+	
+	/* once this store is visible, so are the contents of @alias */
+	g_atomic_pointer_set (bucket, alias);
+}
+
+static void
+charset_alias_add (const char *name, size_t len, guint hash, const CharsetInfo *info)
+{
+	CharsetAliasTable *table = charset_aliases;
+	CharsetAlias *alias, *copy;
+	CharsetAliasTable *grown;
+	char *lower;
+	guint i;
+	
+	if (charset_nalias >= 2 * (table->mask + 1)) {
+		grown = charset_alias_table_new (2 * (table->mask + 1));
+		
+		for (i = 0; i <= table->mask; i++) {
+			for (alias = table->buckets[i]; alias != NULL; alias = alias->next) {
+				copy = g_mime_arena_alloc (charset_arena, sizeof (CharsetAlias));
+				memcpy (copy, alias, sizeof (CharsetAlias));
+				charset_alias_insert (grown, copy);
+			}
+		}
+		
+		g_atomic_pointer_set (&charset_aliases, grown);
+		table = grown;
+	}
+	
+	lower = g_mime_arena_strndup (charset_arena, name, len);
+	for (i = 0; i < len; i++)
+		lower[i] = g_ascii_tolower (lower[i]);
+	
+	alias = g_mime_arena_alloc (charset_arena, sizeof (CharsetAlias));
+	alias->name = lower;
+	alias->info = info;
+	alias->hash = hash;
+	
+	charset_alias_insert (table, alias);
+	charset_nalias++;
+}
+
+static const CharsetInfo *
+charset_alias_lookup (CharsetAliasTable *table, const char *name, size_t len, guint hash)
+{
+	CharsetAlias *alias;
+	
+	alias = g_atomic_pointer_get (&table->buckets[hash & table->mask]);
+	
+	while (alias != NULL) {
+		if (alias->hash == hash && !g_ascii_strncasecmp (alias->name, name, len) && alias->name[len] == '\0')
+			return alias->info;
+		
+		alias = alias->next;
+	}
+	
+	return NULL;
+}
+
+/* computes the iconv name for a charset that isn't in the map yet */
+static char *
+charset_iconv_name_new (const char *charset, size_t len)
+{
+	char *name, *buf, *p;
+	int iso, codepage;
+	
+	name = g_ascii_strdown (charset, len);
+	
+	if (!strncmp (name, "iso", 3)) {
+		buf = name + 3;
+		if (*buf == '-' || *buf == '_')
+			buf++;
+		
+		iso = strtoul (buf, &p, 10);
+		
+		if (iso == 10646) {
+			/* they all become ICONV_10646 */
+			g_free (name);
+			return g_strdup (ICONV_10646);
+		} else if (p > buf) {
+			buf = p;
+			if (*buf == '-' || *buf == '_')
+				buf++;
+			
+			codepage = strtoul (buf, &p, 10);
+			
+			if (p > buf) {
+				/* codepage is numeric */
+#ifdef __aix__
+				if (codepage == 13)
+					buf = g_strdup ("IBM-921");
+				else
+#endif /* __aix__ */
+					buf = g_strdup_printf (ICONV_ISO_INT_FORMAT, iso, codepage);
+			} else {
+				/* codepage is a string - probably iso-2022-jp or something */
+				buf = g_strdup_printf (ICONV_ISO_STR_FORMAT, iso, p);
+			}
+			
+			g_free (name);
+			return buf;
+		}
+		
+		/* p == buf, which probably means we've
+		   encountered an invalid iso charset name */
+		return name;
+	} else if (!strncmp (name, "windows-", 8)) {
+		buf = name + 8;
+		if (!strncmp (buf, "cp", 2))
+			buf += 2;
+		
+		buf = g_strdup_printf ("CP%s", buf);
+		g_free (name);
+		return buf;
+	} else if (!strncmp (name, "microsoft-", 10)) {
+		buf = name + 10;
+		if (!strncmp (buf, "cp", 2))
+			buf += 2;
+		
+		buf = g_strdup_printf ("CP%s", buf);
+		g_free (name);
+		return buf;
+	}
+	
+	g_free (name);
+	
+	/* assume charset name is ok as is? */
+	return g_strndup (charset, len);
+}
+
+static const CharsetInfo *
+charset_resolve (const char *charset, size_t len)
+{
+	const CharsetInfo *info;
+	guint hash;
+	
+	hash = charset_hash (charset, len);
+	
+	if ((info = charset_alias_lookup (g_atomic_pointer_get (&charset_aliases), charset, len, hash)))
+		return info;
+	
+	CHARSET_LOCK ();
+	
+	/* another thread may have added it while we waited for the lock */
+	if (!(info = charset_alias_lookup (charset_aliases, charset, len, hash))) {
+		info = charset_info_add (charset_iconv_name_new (charset, len));
+		charset_alias_add (charset, len, hash, info);
+	}
+	
+	CHARSET_UNLOCK ();
+	
+	return info;
+}
+
 
 /**
  * g_mime_charset_map_shutdown:
@@ -201,8 +573,14 @@ g_mime_charset_map_shutdown (void)
 	}
 #endif
 	
-	g_hash_table_destroy (iconv_charsets);
-	iconv_charsets = NULL;
+	g_hash_table_destroy (charset_ids);
+	charset_ids = NULL;
+	
+	g_mime_arena_unref (charset_arena);
+	charset_arena = NULL;
+	charset_aliases = NULL;
+	charset_infos = NULL;
+	charset_nalias = 0;
 	
 	g_free (locale_charset);
 	locale_charset = NULL;
@@ -263,7 +641,9 @@ locale_parse_lang (const char *locale)
 void
 g_mime_charset_map_init (void)
 {
-	char *charset, *iconv_name, *locale;
+	const CharsetInfo *info;
+	const char *charset;
+	char *locale;
 	int i;
 	
 	initialized = MAX (initialized, 0);
@@ -275,12 +655,23 @@ g_mime_charset_map_init (void)
 	g_mutex_init (&lock);
 #endif
 	
-	iconv_charsets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	charset_arena = g_mime_arena_new ();
+	charset_ids = g_hash_table_new (g_str_hash, g_str_equal);
+	charset_infos = charset_info_table_new (64);
+	charset_aliases = charset_alias_table_new (128);
+	
+	/* id 0 is reserved for "no charset" */
+	charset_infos->count = 1;
+	charset_infos->info[0] = NULL;
 	
 	for (i = 0; known_iconv_charsets[i].charset != NULL; i++) {
-		charset = g_ascii_strdown (known_iconv_charsets[i].charset, -1);
-		iconv_name = g_strdup (known_iconv_charsets[i].iconv_name);
-		g_hash_table_insert (iconv_charsets, charset, iconv_name);
+		/* charsets without an iconv name get resolved on demand */
+		if (known_iconv_charsets[i].iconv_name == NULL)
+			continue;
+		
+		charset = known_iconv_charsets[i].charset;
+		info = charset_info_add (g_strdup (known_iconv_charsets[i].iconv_name));
+		charset_alias_add (charset, strlen (charset), charset_hash (charset, strlen (charset)), info);
 	}
 	
 #ifndef WIN32
@@ -407,20 +798,6 @@ g_mime_charset_language (const char *charset)
 }
 
 
-static const char *
-strdown (char *str)
-{
-	register char *s = str;
-	
-	while (*s) {
-		if (*s >= 'A' && *s <= 'Z')
-			*s += 0x20;
-		s++;
-	}
-	
-	return str;
-}
-
 /**
  * g_mime_charset_iconv_name:
  * @charset: charset name
@@ -432,119 +809,78 @@ strdown (char *str)
 const char *
 g_mime_charset_iconv_name (const char *charset)
 {
-	char *name, *iconv_name, *buf;
-	
 	if (charset == NULL)
 		return NULL;
 	
-	name = g_alloca (strlen (charset) + 1);
-	strcpy (name, charset);
-	strdown (name);
-	
-	CHARSET_LOCK ();
-	
-	iconv_name = g_hash_table_lookup (iconv_charsets, name);
-	if (iconv_name) {
-		CHARSET_UNLOCK ();
-		return iconv_name;
-	}
+	return charset_resolve (charset, strlen (charset))->iconv_name;
+}
+
+
+/**
+ * g_mime_charset_intern:
+ * @charset: charset name
+ *
+ * Looks up the unique id of the iconv-friendly name of @charset (see
+ * g_mime_charset_iconv_name()). Aliases of the same charset share the
+ * same id, so callers that need to compare charsets or look them up
+ * repeatedly can hold on to the id instead of the name.
+ *
+ * Ids are only valid until g_mime_shutdown() is called.
+ *
+ * Returns: a non-zero charset id, or %0 if @charset is %NULL.
+ **/
+guint
+g_mime_charset_intern (const char *charset)
+{
+	if (charset == NULL)
+		return 0;
 	
-	if (!strncmp (name, "iso", 3)) {
-		int iso, codepage;
-		char *p;
-		
-		buf = name + 3;
-		if (*buf == '-' || *buf == '_')
-			buf++;
-		
-		iso = strtoul (buf, &p, 10);
-		
-		if (iso == 10646) {
-			/* they all become ICONV_10646 */
-			iconv_name = g_strdup (ICONV_10646);
-		} else if (p > buf) {
-			buf = p;
-			if (*buf == '-' || *buf == '_')
-				buf++;
-			
-			codepage = strtoul (buf, &p, 10);
-			
-			if (p > buf) {
-				/* codepage is numeric */
-#ifdef __aix__
-				if (codepage == 13)
-					iconv_name = g_strdup ("IBM-921");
-				else
-#endif /* __aix__ */
-					iconv_name = g_strdup_printf (ICONV_ISO_INT_FORMAT,
-								      iso, codepage);
-			} else {
-				/* codepage is a string - probably iso-2022-jp or something */
-				iconv_name = g_strdup_printf (ICONV_ISO_STR_FORMAT,
-							      iso, p);
-			}
-		} else {
-			/* p == buf, which probably means we've
-			   encountered an invalid iso charset name */
-			iconv_name = g_strdup (name);
-		}
-	} else if (!strncmp (name, "windows-", 8)) {
-		buf = name + 8;
-		if (!strncmp (buf, "cp", 2))
-			buf += 2;
-		
-		iconv_name = g_strdup_printf ("CP%s", buf);
-	} else if (!strncmp (name, "microsoft-", 10)) {
-		buf = name + 10;
-		if (!strncmp (buf, "cp", 2))
-			buf += 2;
-		
-		iconv_name = g_strdup_printf ("CP%s", buf);
-	} else {
-		/* assume charset name is ok as is? */
-		iconv_name = g_strdup (charset);
-	}
+	return charset_resolve (charset, strlen (charset))->id;
+}
+
+
+/* same as g_mime_charset_intern(), but @charset need not be nul-terminated */
+guint
+_g_mime_charset_intern_len (const char *charset, size_t len)
+{
+	return charset_resolve (charset, len)->id;
+}
+
+
+static const CharsetInfo *
+charset_info_lookup (guint id)
+{
+	CharsetInfoTable *table;
 	
-	g_hash_table_insert (iconv_charsets, g_strdup (name), iconv_name);
+	table = g_atomic_pointer_get (&charset_infos);
 	
-	CHARSET_UNLOCK ();
+	if (id == 0 || id >= (guint) g_atomic_int_get (&table->count))
+		return NULL;
 	
-	return iconv_name;
+	return table->info[id];
 }
 
 
-static const char *iso_charsets[] = {
-	"us-ascii",
-	"iso-8859-1",
-	"iso-8859-2",
-	"iso-8859-3",
-	"iso-8859-4",
-	"iso-8859-5",
-	"iso-8859-6",
-	"iso-8859-7",
-	"iso-8859-8",
-	"iso-8859-9",
-	"iso-8859-10",
-	"iso-8859-11",
-	"iso-8859-12",
-	"iso-8859-13",
-	"iso-8859-14",
-	"iso-8859-15",
-	"iso-8859-16"
-};
-
-static const char *windows_charsets[] = {
-	"windows-cp1250",
-	"windows-cp1251",
-	"windows-cp1252",
-	"windows-cp1253",
-	"windows-cp1254",
-	"windows-cp1255",
-	"windows-cp1256",
-	"windows-cp1257",
-	"windows-cp1258",
-	"windows-cp1259"
-};
+/**
+ * g_mime_charset_id_get_iconv_name:
+ * @id: a charset id
+ *
+ * Gets the iconv-friendly charset name that was interned as @id by
+ * g_mime_charset_intern().
+ *
+ * Returns: (nullable): the iconv-friendly charset name, or %NULL if
+ * @id is not a valid charset id.
+ **/
+const char *
+g_mime_charset_id_get_iconv_name (guint id)
+{
+	const CharsetInfo *info;
+	
+	if (!(info = charset_info_lookup (id)))
+		return NULL;
+	
+	return info->iconv_name;
+}
 
 
 /**
@@ -563,41 +899,10 @@ static const char *windows_charsets[] = {
 const char *
 g_mime_charset_canon_name (const char *charset)
 {
-	const char *ptr;
-	char *endptr;
-	guint iso;
-	
 	if (!charset)
 		return NULL;
 	
-	charset = g_mime_charset_iconv_name (charset);
-	if (g_ascii_strncasecmp (charset, "iso", 3) == 0) {
-		ptr = charset + 3;
-		if (*ptr == '-' || *ptr == '_')
-			ptr++;
-		
-		if (strncmp (ptr, "8859", 4) != 0)
-			return charset;
-		
-		ptr += 4;
-		if (*ptr == '-' || *ptr == '_')
-			ptr++;
-		
-		iso = strtoul (ptr, &endptr, 10);
-		if (endptr == ptr || *endptr != '\0')
-			return charset;
-		
-		if (iso >= G_N_ELEMENTS (iso_charsets))
-			return charset;
-		
-		return iso_charsets[iso];
-	} else if (!strncmp (charset, "CP125", 5)) {
-		ptr = charset + 5;
-		if (*ptr >= '0' && *ptr <= '9')
-			return windows_charsets[*ptr - '0'];
-	}
-	
-	return charset;
+	return charset_canon_name (g_mime_charset_iconv_name (charset));
 }
 
 
@@ -912,3 +1217,99 @@ g_mime_charset_can_encode (GMimeCharset *mask, const char *charset, const char *
 	
 	return rc != (size_t) -1;
 }
+
+
+/* Single-byte charsets
+ *
+ * Converting the common ISO-8859-x, windows-125x and KOI8 charsets to
+ * UTF-8 is a matter of a table lookup per byte, which is a whole lot
+ * cheaper than going through iconv. The tables are generated by
+ * gen-sbcs-table.c and map the upper half of each charset to Unicode
+ * (the lower half is plain ASCII).
+ */
+
+/* Returns the conversion table for @charset or %NULL if it is not a
+ * single-byte charset that we have a table for. */
+const unsigned short *
+_g_mime_charset_sbcs_table (const char *charset)
+{
+	if (charset == NULL)
+		return NULL;
+	
+	return charset_resolve (charset, strlen (charset))->sbcs_table;
+}
+
+/* Same as _g_mime_charset_sbcs_table(), but for an interned charset id. */
+const unsigned short *
+_g_mime_charset_id_sbcs_table (guint id)
+{
+	const CharsetInfo *info;
+	
+	if (!(info = charset_info_lookup (id)))
+		return NULL;
+	
+	return info->sbcs_table;
+}
+
+/* Converts @inlen bytes of @inbuf to UTF-8 using the given conversion
+ * table. @outbuf must be large enough to hold 3 * @inlen bytes. Bytes
+ * that are not valid in the charset are replaced with @invalid (or
+ * dropped if @invalid is '\0') and counted in @ninval.
+ *
+ * Returns the number of bytes written to @outbuf. */
+size_t
+_g_mime_charset_sbcs_to_utf8 (const unsigned short *table, const char *inbuf, size_t inlen, char *outbuf, char invalid, size_t *ninval)
+{
+	const unsigned char *inptr = (const unsigned char *) inbuf;
+	const unsigned char *inend = inptr + inlen;
+	unsigned char *outptr = (unsigned char *) outbuf;
+	size_t n = 0;
+	guint64 word;
+	guint32 u;
+	
+	while (inptr < inend) {
+		/* copy runs of ASCII 8 bytes at a time */
+		while (inend - inptr >= 8) {
+			memcpy (&word, inptr, 8);
+			if (word & G_GUINT64_CONSTANT (0x8080808080808080))
+				break;
+			
+			memcpy (outptr, inptr, 8);
+			outptr += 8;
+			inptr += 8;
+		}
+		
+		if (inptr == inend)
+			break;
+		
+		if (*inptr < 128) {
+			*outptr++ = *inptr++;
+			continue;
+		}
+		
+		u = table[*inptr++ - 128];
+		
+		if (u == 0) {
+			/* not a valid character in this charset */
+			if (invalid != '\0')
+				*outptr++ = invalid;
+			n++;
+		} else if (u < 0x80) {
+			*outptr++ = u;
+		} else if (u < 0x800) {
+			outptr[0] = 0xc0 | (u >> 6);
+			outptr[1] = 0x80 | (u & 0x3f);
+			outptr += 2;
+		} else {
+			outptr[0] = 0xe0 | (u >> 12);
+			outptr[1] = 0x80 | ((u >> 6) & 0x3f);
+			outptr[2] = 0x80 | (u & 0x3f);
+			outptr += 3;
+		}
+	}
+	
+	if (ninval)
+		*ninval = n;
+	
+	return (size_t) (outptr - (unsigned char *) outbuf);
+}
@@ -38,6 +38,9 @@ const char *g_mime_charset_language (const char *charset);
 const char *g_mime_charset_canon_name (const char *charset);
 const char *g_mime_charset_iconv_name (const char *charset);
 
+guint       g_mime_charset_intern (const char *charset);
+const char *g_mime_charset_id_get_iconv_name (guint id);
+
 #ifndef GMIME_DISABLE_DEPRECATED
 const char *g_mime_charset_name (const char *charset);
 const char *g_mime_charset_locale_name (void);
@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include "gmime-crypto-context.h"
+#include "gmime-internal.h"
 #include "gmime-common.h"
 #include "gmime-error.h"
 
@@ -76,8 +77,32 @@ static int crypto_export_keys (GMimeCryptoContext *ctx, const char *keys[],
 			       GMimeStream *ostream, GError **err);
 
 
+/* protocol -> GMimeCryptoContextNewFunc */
 static GHashTable *type_hash = NULL;
 
+#ifdef G_THREADS_ENABLED
+static GMutex type_lock;
+#define TYPE_UNLOCK() g_mutex_unlock (&type_lock);
+#define TYPE_LOCK() g_mutex_lock (&type_lock);
+#else
+#define TYPE_UNLOCK()
+#define TYPE_LOCK()
+#endif /* G_THREADS_ENABLED */
+
+/* idle contexts kept around for reuse by the verify code paths, keyed
+ * by the GMimeCryptoContextNewFunc that created them */
+#define POOL_MAX_IDLE 4
+static GHashTable *pool_hash = NULL;
+
+#ifdef G_THREADS_ENABLED
+static GMutex pool_lock;
+#define POOL_UNLOCK() g_mutex_unlock (&pool_lock);
+#define POOL_LOCK() g_mutex_lock (&pool_lock);
+#else
+#define POOL_UNLOCK()
+#define POOL_LOCK()
+#endif /* G_THREADS_ENABLED */
+
 static GObjectClass *parent_class = NULL;
 
 
@@ -100,8 +125,6 @@ g_mime_crypto_context_get_type (void)
 		};
 		
 		type = g_type_register_static (G_TYPE_OBJECT, "GMimeCryptoContext", &info, 0);
-		
-		type_hash = g_hash_table_new_full (g_mime_strcase_hash, g_mime_strcase_equal, g_free, NULL);
 	}
 	
 	return type;
@@ -143,11 +166,42 @@ g_mime_crypto_context_finalize (GObject *object)
 }
 
 
+static void
+pool_free (gpointer key, gpointer value, gpointer user_data)
+{
+	g_slist_free_full ((GSList *) value, g_object_unref);
+}
+
 void
 g_mime_crypto_context_shutdown (void)
 {
-	g_hash_table_destroy (type_hash);
-	type_hash = NULL;
+	POOL_LOCK ();
+	if (pool_hash != NULL) {
+		g_hash_table_foreach (pool_hash, pool_free, NULL);
+		g_hash_table_destroy (pool_hash);
+		pool_hash = NULL;
+	}
+	POOL_UNLOCK ();
+	
+	TYPE_LOCK ();
+	if (type_hash != NULL) {
+		g_hash_table_destroy (type_hash);
+		type_hash = NULL;
+	}
+	TYPE_UNLOCK ();
+}
+
+static GMimeCryptoContextNewFunc
+crypto_context_lookup (const char *protocol)
+{
+	GMimeCryptoContextNewFunc func = NULL;
+	
+	TYPE_LOCK ();
+	if (type_hash != NULL)
+		func = g_hash_table_lookup (type_hash, protocol);
+	TYPE_UNLOCK ();
+	
+	return func;
 }
 
 
@@ -157,6 +211,8 @@ g_mime_crypto_context_shutdown (void)
  * @callback: a #GMimeCryptoContextNewFunc
  *
  * Registers the callback for the specified @protocol.
+ *
+ * This function is thread-safe.
  **/
 void
 g_mime_crypto_context_register (const char *protocol, GMimeCryptoContextNewFunc callback)
@@ -164,7 +220,12 @@ g_mime_crypto_context_register (const char *protocol, GMimeCryptoContextNewFunc
 	g_return_if_fail (protocol != NULL);
 	g_return_if_fail (callback != NULL);
 	
+	TYPE_LOCK ();
+	if (type_hash == NULL)
+		type_hash = g_hash_table_new_full (g_mime_strcase_hash, g_mime_strcase_equal, g_free, NULL);
+	
 	g_hash_table_replace (type_hash, g_strdup (protocol), callback);
+	TYPE_UNLOCK ();
 }
 
 
@@ -183,13 +244,64 @@ g_mime_crypto_context_new (const char *protocol)
 	
 	g_return_val_if_fail (protocol != NULL, NULL);
 	
-	if (!(func = g_hash_table_lookup (type_hash, protocol)))
+	if (!(func = crypto_context_lookup (protocol)))
 		return NULL;
 	
 	return func ();
 }
 
 
+GMimeCryptoContext *
+_g_mime_crypto_context_acquire (const char *protocol)
+{
+	GMimeCryptoContextNewFunc func;
+	GMimeCryptoContext *ctx = NULL;
+	GSList *idle;
+	
+	if (!(func = crypto_context_lookup (protocol)))
+		return NULL;
+	
+	POOL_LOCK ();
+	if (pool_hash != NULL && (idle = g_hash_table_lookup (pool_hash, func)) != NULL) {
+		ctx = idle->data;
+		g_hash_table_insert (pool_hash, func, g_slist_delete_link (idle, idle));
+	}
+	POOL_UNLOCK ();
+	
+	if (ctx == NULL)
+		ctx = func ();
+	
+	return ctx;
+}
+
+void
+_g_mime_crypto_context_release (const char *protocol, GMimeCryptoContext *ctx)
+{
+	GMimeCryptoContextNewFunc func;
+	GSList *idle;
+	
+	/* only pool contexts that nobody else holds a reference to */
+	if (g_atomic_int_get (&G_OBJECT (ctx)->ref_count) != 1 || !(func = crypto_context_lookup (protocol))) {
+		g_object_unref (ctx);
+		return;
+	}
+	
+	POOL_LOCK ();
+	if (pool_hash == NULL)
+		pool_hash = g_hash_table_new (g_direct_hash, g_direct_equal);
+	
+	idle = g_hash_table_lookup (pool_hash, func);
+	if (g_slist_length (idle) < POOL_MAX_IDLE) {
+		g_hash_table_insert (pool_hash, func, g_slist_prepend (idle, ctx));
+		ctx = NULL;
+	}
+	POOL_UNLOCK ();
+	
+	if (ctx != NULL)
+		g_object_unref (ctx);
+}
+
+
 /**
  * g_mime_crypto_context_set_request_password: (skip)
  * @ctx: a #GMimeCryptoContext
@@ -29,6 +29,7 @@
 
 #include "gmime-table-private.h"
 #include "gmime-encodings.h"
+#include "gmime-simd.h"
 
 
 #ifdef ENABLE_WARNINGS
@@ -99,6 +100,26 @@ static unsigned char tohex[16] = {
 	'8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
 };
 
+/* maps hex digits to their values, everything else to 0xff */
+static unsigned char fromhex[256] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
 
 /**
  * g_mime_content_encoding_from_string:
@@ -422,7 +443,7 @@ size_t
 g_mime_encoding_base64_encode_step (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save)
 {
 	register const unsigned char *inptr;
-	register unsigned char *outptr;
+	unsigned char *outptr;
 	
 	if (inlen == 0)
 		return 0;
@@ -430,8 +451,14 @@ g_mime_encoding_base64_encode_step (const unsigned char *inbuf, size_t inlen, un
 	outptr = outbuf;
 	inptr = inbuf;
 	
+	if (((unsigned char *)save)[0] == 0 && inlen >= 16) {
+		/* we're at a quantum boundary, so encode as much as we can in bulk */
+		inptr = g_mime_simd_base64_encode (inptr, inbuf + inlen, &outptr, state);
+		inlen -= (inptr - inbuf);
+	}
+	
 	if (inlen + ((unsigned char *)save)[0] > 2) {
-		const unsigned char *inend = inbuf + inlen - 2;
+		const unsigned char *inend = inptr + inlen - 2;
 		register int c1 = 0, c2 = 0, c3 = 0;
 		register int already;
 		
@@ -508,13 +535,16 @@ size_t
 g_mime_encoding_base64_decode_step (const unsigned char *inbuf, size_t inlen, unsigned char *outbuf, int *state, guint32 *save)
 {
 	register const unsigned char *inptr;
-	register unsigned char *outptr;
+	unsigned char *outptr;
 	const unsigned char *inend;
 	register guint32 saved;
+	const unsigned char *start;
 	unsigned char last[2];
 	unsigned char c, rank;
+	gboolean bulk;
 	int n;
 	
+	bulk = g_mime_simd_has (GMIME_SIMD_SSE41);
 	inend = inbuf + inlen;
 	outptr = outbuf;
 	inptr = inbuf;
@@ -531,21 +561,41 @@ g_mime_encoding_base64_decode_step (const unsigned char *inbuf, size_t inlen, un
 	
 	last[1] = '\0';
 	
-	/* convert 4 base64 bytes to 3 normal bytes */
 	while (inptr < inend) {
-		rank = gmime_base64_rank[(c = *inptr++)];
-		if (rank != 0xff) {
-			saved = (saved << 6) | rank;
-			last[1] = last[0];
-			last[0] = c;
-			n++;
-			if (n == 4) {
-				*outptr++ = saved >> 16;
-				if (last[1] != '=')
-					*outptr++ = saved >> 8;
-				if (last[0] != '=')
-					*outptr++ = saved;
-				n = 0;
+		if (bulk && n == 0 && inend - inptr >= 16) {
+			/* we're at a quantum boundary, so decode as much as we can in bulk */
+			start = inptr;
+			inptr = g_mime_simd_base64_decode (inptr, inend, &outptr);
+			
+			if (inptr > start) {
+				/* leave things exactly as if we had decoded it one char at a time */
+				saved = ((guint32) outptr[-4] << 24) | ((guint32) outptr[-3] << 16) |
+					((guint32) outptr[-2] << 8) | (guint32) outptr[-1];
+				last[1] = inptr[-2];
+				last[0] = inptr[-1];
+				continue;
+			}
+		}
+		
+		/* convert 4 base64 bytes to 3 normal bytes */
+		while (inptr < inend) {
+			rank = gmime_base64_rank[(c = *inptr++)];
+			if (rank != 0xff) {
+				saved = (saved << 6) | rank;
+				last[1] = last[0];
+				last[0] = c;
+				n++;
+				if (n == 4) {
+					*outptr++ = saved >> 16;
+					if (last[1] != '=')
+						*outptr++ = saved >> 8;
+					if (last[0] != '=')
+						*outptr++ = saved;
+					n = 0;
+				}
+			} else if (bulk) {
+				/* probably the end of a line; try the bulk decoder again */
+				break;
 			}
 		}
 	}
@@ -1027,9 +1077,9 @@ g_mime_encoding_quoted_decode_step (const unsigned char *inbuf, size_t inlen, un
 	 * Note: Trailing rubbish (at the end of input), like = or =x
 	 * or =\r will be lost.
 	 */
-	const register unsigned char *inptr = inbuf;
+	const unsigned char *inptr = inbuf;
 	const unsigned char *inend = inbuf + inlen;
-	register unsigned char *outptr = outbuf;
+	unsigned char *outptr = outbuf;
 	guint32 isave = *save;
 	int istate = *state;
 	unsigned char c;
@@ -1039,25 +1089,49 @@ g_mime_encoding_quoted_decode_step (const unsigned char *inbuf, size_t inlen, un
 	while (inptr < inend) {
 		switch (istate) {
 		case 0:
+#ifndef CANONICALISE_EOL
+			while (inptr < inend) {
+				/* copy the literal run up to the next '=' in bulk */
+				if ((inptr = g_mime_simd_qp_copy_literal (inptr, inend, &outptr)) == inend)
+					break;
+				
+				/* handle complete escape sequences and soft breaks in
+				 * place, leaving anything else (including sequences
+				 * split across calls) to the state machine below.
+				 * isave is updated exactly as the state machine would. */
+				if (inend - inptr >= 3 && (fromhex[inptr[1]] | fromhex[inptr[2]]) != 0xff) {
+					*outptr++ = (fromhex[inptr[1]] << 4) | fromhex[inptr[2]];
+					isave = toupper ((int) inptr[1]);
+					inptr += 3;
+				} else if (inend - inptr >= 2 && inptr[1] == '\n') {
+					inptr += 2;
+				} else if (inend - inptr >= 3 && inptr[1] == '\r' && inptr[2] == '\n') {
+					isave = '\r';
+					inptr += 3;
+				} else {
+					istate = 1;
+					inptr++;
+					break;
+				}
+			}
+#else
 			while (inptr < inend) {
 				c = *inptr++;
-				/* FIXME: use a specials table to avoid 3 comparisons for the common case */
 				if (c == '=') { 
 					istate = 1;
 					break;
 				}
-#ifdef CANONICALISE_EOL
 				/*else if (c=='\r') {
 					state = 3;
 				} else if (c=='\n') {
 					*outptr++ = '\r';
 					*outptr++ = c;
 					} */
-#endif
 				else {
 					*outptr++ = c;
 				}
 			}
+#endif
 			break;
 		case 1:
 			c = *inptr++;
@@ -26,6 +26,7 @@
 #include <errno.h>
 
 #include "gmime-filter-charset.h"
+#include "gmime-internal.h"
 #include "gmime-charset.h"
 #include "gmime-iconv.h"
 
@@ -54,6 +55,7 @@ static void filter_reset (GMimeFilter *filter);
 
 
 static GMimeFilterClass *parent_class = NULL;
+static GQuark sbcs_table_quark = 0;
 
 
 GType
@@ -89,6 +91,8 @@ g_mime_filter_charset_class_init (GMimeFilterCharsetClass *klass)
 	
 	parent_class = g_type_class_ref (GMIME_TYPE_FILTER);
 	
+	sbcs_table_quark = g_quark_from_static_string ("gmime-filter-charset-sbcs-table");
+	
 	object_class->finalize = g_mime_filter_charset_finalize;
 	
 	filter_class->copy = filter_copy;
@@ -127,15 +131,48 @@ filter_copy (GMimeFilter *filter)
 	return g_mime_filter_charset_new (charset->from_charset, charset->to_charset);
 }
 
+/**
+ * _g_mime_filter_charset_get_sbcs_table:
+ * @filter: a #GMimeFilterCharset
+ *
+ * Gets the built-in table that @filter uses to convert from a common
+ * single-byte charset to UTF-8. The table is kept as qdata so that it
+ * does not change the layout of the public struct.
+ *
+ * Returns: the conversion table or %NULL if @filter uses iconv.
+ **/
+const unsigned short *
+_g_mime_filter_charset_get_sbcs_table (GMimeFilterCharset *filter)
+{
+	return g_object_get_qdata ((GObject *) filter, sbcs_table_quark);
+}
+
+static void
+filter_convert_table (GMimeFilter *filter, const unsigned short *table, char *in, size_t len, char **out, size_t *outlen, size_t *outprespace)
+{
+	g_mime_filter_set_size (filter, len * 3 + 16, FALSE);
+	
+	/* like iconv below, invalid bytes are simply dropped */
+	*outlen = _g_mime_charset_sbcs_to_utf8 (table, in, len, filter->outbuf, '\0', NULL);
+	*outprespace = filter->outpre;
+	*out = filter->outbuf;
+}
+
 static void
 filter_filter (GMimeFilter *filter, char *in, size_t len, size_t prespace,
 	       char **out, size_t *outlen, size_t *outprespace)
 {
 	GMimeFilterCharset *charset = (GMimeFilterCharset *) filter;
 	size_t inleft, outleft, converted = 0;
+	const unsigned short *table;
 	char *inbuf;
 	char *outbuf;
 	
+	if ((table = _g_mime_filter_charset_get_sbcs_table (charset)) != NULL) {
+		filter_convert_table (filter, table, in, len, out, outlen, outprespace);
+		return;
+	}
+	
 	if (charset->cd == (iconv_t) -1)
 		goto noop;
 	
@@ -200,9 +237,15 @@ filter_complete (GMimeFilter *filter, char *in, size_t len, size_t prespace,
 {
 	GMimeFilterCharset *charset = (GMimeFilterCharset *) filter;
 	size_t inleft, outleft, converted = 0;
+	const unsigned short *table;
 	char *inbuf;
 	char *outbuf;
 	
+	if ((table = _g_mime_filter_charset_get_sbcs_table (charset)) != NULL) {
+		filter_convert_table (filter, table, in, len, out, outlen, outprespace);
+		return;
+	}
+	
 	if (charset->cd == (iconv_t) -1)
 		goto noop;
 	
@@ -304,11 +347,15 @@ filter_reset (GMimeFilter *filter)
 GMimeFilter *
 g_mime_filter_charset_new (const char *from_charset, const char *to_charset)
 {
+	const unsigned short *table = NULL;
+	iconv_t cd = (iconv_t) -1;
 	GMimeFilterCharset *charset;
-	iconv_t cd;
 	
-	cd = g_mime_iconv_open (to_charset, from_charset);
-	if (cd == (iconv_t) -1)
+	/* common single-byte charsets can be converted to UTF-8 without iconv */
+	if (g_mime_charset_intern (to_charset) == GMIME_CHARSET_ID_UTF8)
+		table = _g_mime_charset_sbcs_table (from_charset);
+	
+	if (table == NULL && (cd = g_mime_iconv_open (to_charset, from_charset)) == (iconv_t) -1)
 		return NULL;
 	
 	charset = g_object_new (GMIME_TYPE_FILTER_CHARSET, NULL);
@@ -316,5 +363,8 @@ g_mime_filter_charset_new (const char *from_charset, const char *to_charset)
 	charset->to_charset = g_strdup (to_charset);
 	charset->cd = cd;
 	
+	if (table != NULL)
+		g_object_set_qdata ((GObject *) charset, sbcs_table_quark, (gpointer) table);
+	
 	return (GMimeFilter *) charset;
 }
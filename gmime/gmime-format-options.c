@@ -37,6 +37,13 @@
  * @see_also:
  *
  * A #GMimeFormatOptions is used by GMime to determine how to serialize various objects and headers.
+ *
+ * Format options are not locked. A set of options that is in use by
+ * more than one thread must be frozen with g_mime_format_options_freeze()
+ * first, after which it can no longer be changed. The same goes for the
+ * default options returned by g_mime_format_options_get_default():
+ * change them before any other thread starts using them, or use
+ * g_mime_format_options_clone() to get a private copy.
  **/
 
 
@@ -47,6 +54,7 @@ struct _GMimeFormatOptions {
 	gboolean international;
 	GPtrArray *hidden;
 	guint maxline;
+	gboolean frozen;
 };
 
 static GMimeFormatOptions *default_options = NULL;
@@ -82,6 +90,10 @@ g_mime_format_options_shutdown (void)
  *
  * Gets the default format options.
  *
+ * Note: The default options are shared by every thread. They must not
+ * be changed while other threads may be using them; use
+ * g_mime_format_options_clone() to get a copy that can be modified.
+ *
  * Returns: the default format options.
  **/
 GMimeFormatOptions *
@@ -110,6 +122,7 @@ g_mime_format_options_new (void)
 	options->mixed_charsets = TRUE;
 	options->international = FALSE;
 	options->maxline = 78;
+	options->frozen = FALSE;
 	
 	return options;
 }
@@ -138,7 +151,8 @@ _g_mime_format_options_clone (GMimeFormatOptions *options, gboolean hidden)
 	clone->newline = options->newline;
 	clone->mixed_charsets = options->mixed_charsets;
 	clone->international = options->international;
-	clone->maxline = options->newline;
+	clone->maxline = options->maxline;
+	clone->frozen = FALSE;
 	
 	clone->hidden = g_ptr_array_new ();
 	
@@ -189,6 +203,43 @@ g_mime_format_options_free (GMimeFormatOptions *options)
 }
 
 
+/**
+ * g_mime_format_options_freeze:
+ * @options: a #GMimeFormatOptions
+ *
+ * Makes @options immutable. Once frozen, any attempt to change the
+ * options is an error, which makes it safe to use the same @options
+ * from multiple threads at once.
+ *
+ * Clones of frozen options are not frozen.
+ **/
+void
+g_mime_format_options_freeze (GMimeFormatOptions *options)
+{
+	g_return_if_fail (options != NULL);
+	
+	options->frozen = TRUE;
+}
+
+
+/**
+ * g_mime_format_options_is_frozen:
+ * @options: a #GMimeFormatOptions
+ *
+ * Gets whether or not @options has been frozen by
+ * g_mime_format_options_freeze().
+ *
+ * Returns: %TRUE if @options is frozen or %FALSE otherwise.
+ **/
+gboolean
+g_mime_format_options_is_frozen (GMimeFormatOptions *options)
+{
+	g_return_val_if_fail (options != NULL, FALSE);
+	
+	return options->frozen;
+}
+
+
 /**
  * g_mime_format_options_get_param_encoding_method:
  * @options: (nullable): a #GMimeFormatOptions or %NULL
@@ -219,6 +270,7 @@ void
 g_mime_format_options_set_param_encoding_method (GMimeFormatOptions *options, GMimeParamEncodingMethod method)
 {
 	g_return_if_fail (options != NULL);
+	g_return_if_fail (!options->frozen);
 	g_return_if_fail (method == GMIME_PARAM_ENCODING_METHOD_RFC2231 || method == GMIME_PARAM_ENCODING_METHOD_RFC2047);
 	
 	options->method = method;
@@ -251,6 +303,7 @@ void
 g_mime_format_options_set_newline_format (GMimeFormatOptions *options, GMimeNewLineFormat newline)
 {
 	g_return_if_fail (options != NULL);
+	g_return_if_fail (!options->frozen);
 	g_return_if_fail (newline == GMIME_NEWLINE_FORMAT_UNIX || newline == GMIME_NEWLINE_FORMAT_DOS);
 	
 	options->newline = newline;
@@ -331,6 +384,7 @@ void
 g_mime_format_options_set_allow_mixed_charsets (GMimeFormatOptions *options, gboolean allow)
 {
 	g_return_if_fail (options != NULL);
+	g_return_if_fail (!options->frozen);
 	
 	options->mixed_charsets = allow;
 }
@@ -362,6 +416,7 @@ void
 g_mime_format_options_set_allow_international (GMimeFormatOptions *options, gboolean allow)
 {
 	g_return_if_fail (options != NULL);
+	g_return_if_fail (!options->frozen);
 	
 	options->international = allow;
 }
@@ -393,6 +448,7 @@ void
 g_mime_format_options_set_max_line (GMimeFormatOptions *options, guint maxline)
 {
 	g_return_if_fail (options != NULL);
+	g_return_if_fail (!options->frozen);
 	
 	options->maxline = maxline;
 }
@@ -437,6 +493,7 @@ void
 g_mime_format_options_add_hidden_header (GMimeFormatOptions *options, const char *header)
 {
 	g_return_if_fail (options != NULL);
+	g_return_if_fail (!options->frozen);
 	g_return_if_fail (header != NULL);
 	
 	g_ptr_array_add (options->hidden, g_strdup (header));
@@ -456,6 +513,7 @@ g_mime_format_options_remove_hidden_header (GMimeFormatOptions *options, const c
 	guint i;
 	
 	g_return_if_fail (options != NULL);
+	g_return_if_fail (!options->frozen);
 	g_return_if_fail (header != NULL);
 	
 	for (i = options->hidden->len; i > 0; i--) {
@@ -479,6 +537,7 @@ g_mime_format_options_clear_hidden_headers (GMimeFormatOptions *options)
 	guint i;
 	
 	g_return_if_fail (options != NULL);
+	g_return_if_fail (!options->frozen);
 	
 	for (i = 0; i < options->hidden->len; i++)
 		g_free (options->hidden->pdata[i]);
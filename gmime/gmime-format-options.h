@@ -80,6 +80,9 @@ void g_mime_format_options_free (GMimeFormatOptions *options);
 
 GMimeFormatOptions *g_mime_format_options_clone (GMimeFormatOptions *options);
 
+void g_mime_format_options_freeze (GMimeFormatOptions *options);
+gboolean g_mime_format_options_is_frozen (GMimeFormatOptions *options);
+
 GMimeParamEncodingMethod g_mime_format_options_get_param_encoding_method (GMimeFormatOptions *options);
 void g_mime_format_options_set_param_encoding_method (GMimeFormatOptions *options, GMimeParamEncodingMethod method);
 
@@ -0,0 +1,159 @@
+/* THIS FILE IS AUTOGENERATED: DO NOT EDIT! */
+
+/*
+ * To regenerate:
+ * make gen-header-ids
+ * ./gen-header-ids > gmime-header-ids-private.h
+ */
+
+#define HEADER_ID_HASH_SEED 2166136326U
+#define HEADER_ID_SLOTS 128
+
+static unsigned int
+header_id_hash (const char *name, size_t *len)
+{
+	register const unsigned char *inptr = (const unsigned char *) name;
+	register unsigned int h = HEADER_ID_HASH_SEED;
+	
+	while (*inptr != '\0')
+		h = (h ^ (*inptr++ | 0x20)) * 16777619U;
+	
+	*len = (size_t) (inptr - (const unsigned char *) name);
+	
+	return (h ^ (h >> 16)) & (HEADER_ID_SLOTS - 1);
+}
+
+static const struct {
+	const char *name;
+	size_t length;
+	GMimeHeaderId id;
+} header_ids[HEADER_ID_SLOTS] = {
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "In-Reply-To", 11, GMIME_HEADER_ID_IN_REPLY_TO },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Content-Base", 12, GMIME_HEADER_ID_CONTENT_BASE },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Resent-To", 9, GMIME_HEADER_ID_RESENT_TO },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Message-Id", 10, GMIME_HEADER_ID_MESSAGE_ID },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Cc", 2, GMIME_HEADER_ID_CC },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Content-Type", 12, GMIME_HEADER_ID_CONTENT_TYPE },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Resent-From", 11, GMIME_HEADER_ID_RESENT_FROM },
+	{ "Keywords", 8, GMIME_HEADER_ID_KEYWORDS },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Sender", 6, GMIME_HEADER_ID_SENDER },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Date", 4, GMIME_HEADER_ID_DATE },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Subject", 7, GMIME_HEADER_ID_SUBJECT },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "MIME-Version", 12, GMIME_HEADER_ID_MIME_VERSION },
+	{ "Resent-Date", 11, GMIME_HEADER_ID_RESENT_DATE },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Comments", 8, GMIME_HEADER_ID_COMMENTS },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Content-Id", 10, GMIME_HEADER_ID_CONTENT_ID },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Resent-Cc", 9, GMIME_HEADER_ID_RESENT_CC },
+	{ "Content-Transfer-Encoding", 25, GMIME_HEADER_ID_CONTENT_TRANSFER_ENCODING },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "From", 4, GMIME_HEADER_ID_FROM },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Content-Location", 16, GMIME_HEADER_ID_CONTENT_LOCATION },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Return-Path", 11, GMIME_HEADER_ID_RETURN_PATH },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Content-Length", 14, GMIME_HEADER_ID_CONTENT_LENGTH },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Bcc", 3, GMIME_HEADER_ID_BCC },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Content-Description", 19, GMIME_HEADER_ID_CONTENT_DESCRIPTION },
+	{ "Disposition-Notification-To", 27, GMIME_HEADER_ID_DISPOSITION_NOTIFICATION_TO },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Resent-Bcc", 10, GMIME_HEADER_ID_RESENT_BCC },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Content-Md5", 11, GMIME_HEADER_ID_CONTENT_MD5 },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Resent-Reply-To", 15, GMIME_HEADER_ID_RESENT_REPLY_TO },
+	{ "Content-Disposition", 19, GMIME_HEADER_ID_CONTENT_DISPOSITION },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Resent-Sender", 13, GMIME_HEADER_ID_RESENT_SENDER },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Reply-To", 8, GMIME_HEADER_ID_REPLY_TO },
+	{ "References", 10, GMIME_HEADER_ID_REFERENCES },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Resent-Message-Id", 17, GMIME_HEADER_ID_RESENT_MESSAGE_ID },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "To", 2, GMIME_HEADER_ID_TO },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ NULL, 0, GMIME_HEADER_ID_UNKNOWN },
+	{ "Received", 8, GMIME_HEADER_ID_RECEIVED }
+};
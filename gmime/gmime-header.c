@@ -36,7 +36,9 @@
 #include "gmime-common.h"
 #include "gmime-header.h"
 #include "gmime-events.h"
+#include "gmime-arena.h"
 #include "gmime-utils.h"
+#include "gmime-header-ids-private.h"
 
 
 /**
@@ -51,33 +53,73 @@
 
 
 static struct {
-	const char *name;
+	GMimeHeaderId id;
 	GMimeHeaderRawValueFormatter formatter;
 } formatters[] = {
-	{ "Received",                    g_mime_header_format_received            },
-	{ "Sender",                      g_mime_header_format_addrlist            },
-	{ "From",                        g_mime_header_format_addrlist            },
-	{ "Reply-To",                    g_mime_header_format_addrlist            },
-	{ "To",                          g_mime_header_format_addrlist            },
-	{ "Cc",                          g_mime_header_format_addrlist            },
-	{ "Bcc",                         g_mime_header_format_addrlist            },
-	{ "Message-Id",                  g_mime_header_format_message_id          },
-	{ "In-Reply-To",                 g_mime_header_format_references          },
-	{ "References",                  g_mime_header_format_references          },
-	{ "Resent-Sender",               g_mime_header_format_addrlist            },
-	{ "Resent-From",                 g_mime_header_format_addrlist            },
-	{ "Resent-Reply-To",             g_mime_header_format_addrlist            },
-	{ "Resent-To",                   g_mime_header_format_addrlist            },
-	{ "Resent-Cc",                   g_mime_header_format_addrlist            },
-	{ "Resent-Bcc",                  g_mime_header_format_addrlist            },
-	{ "Resent-Message-Id",           g_mime_header_format_message_id          },
-	{ "Content-Type",                g_mime_header_format_content_type        },
-	{ "Content-Disposition",         g_mime_header_format_content_disposition },
-	{ "Content-Id",                  g_mime_header_format_message_id          },
-	{ "Disposition-Notification-To", g_mime_header_format_addrlist            },
+	{ GMIME_HEADER_ID_RECEIVED,                    g_mime_header_format_received            },
+	{ GMIME_HEADER_ID_SENDER,                      g_mime_header_format_addrlist            },
+	{ GMIME_HEADER_ID_FROM,                        g_mime_header_format_addrlist            },
+	{ GMIME_HEADER_ID_REPLY_TO,                    g_mime_header_format_addrlist            },
+	{ GMIME_HEADER_ID_TO,                          g_mime_header_format_addrlist            },
+	{ GMIME_HEADER_ID_CC,                          g_mime_header_format_addrlist            },
+	{ GMIME_HEADER_ID_BCC,                         g_mime_header_format_addrlist            },
+	{ GMIME_HEADER_ID_MESSAGE_ID,                  g_mime_header_format_message_id          },
+	{ GMIME_HEADER_ID_IN_REPLY_TO,                 g_mime_header_format_references          },
+	{ GMIME_HEADER_ID_REFERENCES,                  g_mime_header_format_references          },
+	{ GMIME_HEADER_ID_RESENT_SENDER,               g_mime_header_format_addrlist            },
+	{ GMIME_HEADER_ID_RESENT_FROM,                 g_mime_header_format_addrlist            },
+	{ GMIME_HEADER_ID_RESENT_REPLY_TO,             g_mime_header_format_addrlist            },
+	{ GMIME_HEADER_ID_RESENT_TO,                   g_mime_header_format_addrlist            },
+	{ GMIME_HEADER_ID_RESENT_CC,                   g_mime_header_format_addrlist            },
+	{ GMIME_HEADER_ID_RESENT_BCC,                  g_mime_header_format_addrlist            },
+	{ GMIME_HEADER_ID_RESENT_MESSAGE_ID,           g_mime_header_format_message_id          },
+	{ GMIME_HEADER_ID_CONTENT_TYPE,                g_mime_header_format_content_type        },
+	{ GMIME_HEADER_ID_CONTENT_DISPOSITION,         g_mime_header_format_content_disposition },
+	{ GMIME_HEADER_ID_CONTENT_ID,                  g_mime_header_format_message_id          },
+	{ GMIME_HEADER_ID_DISPOSITION_NOTIFICATION_TO, g_mime_header_format_addrlist            },
 };
 
 
+/* maps a well-known header field name (case-insensitively) to its id
+ * using the perfect hash generated by gen-header-ids */
+GMimeHeaderId
+_g_mime_header_id_lookup (const char *name)
+{
+	unsigned int slot;
+	size_t len;
+	
+	slot = header_id_hash (name, &len);
+	
+	if (header_ids[slot].length != len || header_ids[slot].name == NULL)
+		return GMIME_HEADER_ID_UNKNOWN;
+	
+	if (g_ascii_strcasecmp (header_ids[slot].name, name) != 0)
+		return GMIME_HEADER_ID_UNKNOWN;
+	
+	return header_ids[slot].id;
+}
+
+/* there is no room in the public struct for anything else, so the
+ * header's changed pointer refers to this rather than to the event */
+typedef struct {
+	GMimeEvent *changed;
+	GMimeArena *arena;
+	GMimeHeaderId id;
+	gboolean arena_raw_value;
+} GMimeHeaderPrivate;
+
+#define GMIME_HEADER_GET_PRIVATE(header) ((GMimeHeaderPrivate *) (header)->changed)
+
+/* well-known names compare by id, everything else by name */
+static inline gboolean
+header_name_matches (GMimeHeader *header, GMimeHeaderId id, const char *name)
+{
+	if (GMIME_HEADER_GET_PRIVATE (header)->id != id)
+		return FALSE;
+	
+	return id != GMIME_HEADER_ID_UNKNOWN || !g_ascii_strcasecmp (header->name, name);
+}
+
 static void g_mime_header_class_init (GMimeHeaderClass *klass);
 static void g_mime_header_init (GMimeHeader *header, GMimeHeaderClass *klass);
 static void g_mime_header_finalize (GObject *object);
@@ -122,7 +164,15 @@ g_mime_header_class_init (GMimeHeaderClass *klass)
 static void
 g_mime_header_init (GMimeHeader *header, GMimeHeaderClass *klass)
 {
-	header->changed = g_mime_event_new (header);
+	GMimeHeaderPrivate *priv;
+	
+	priv = g_slice_new (GMimeHeaderPrivate);
+	priv->changed = g_mime_event_new (header);
+	priv->id = GMIME_HEADER_ID_UNKNOWN;
+	priv->arena_raw_value = FALSE;
+	priv->arena = NULL;
+	
+	header->changed = priv;
 	header->formatter = NULL;
 	header->options = NULL;
 	header->reformat = FALSE;
@@ -134,17 +184,39 @@ g_mime_header_init (GMimeHeader *header, GMimeHeaderClass *klass)
 	header->offset = -1;
 }
 
+/* the name, raw_name and initial raw_value of a header constructed by
+ * the parser may live in the message's arena rather than the heap */
+static void
+header_free_raw_value (GMimeHeader *header)
+{
+	GMimeHeaderPrivate *priv = GMIME_HEADER_GET_PRIVATE (header);
+	
+	if (!priv->arena_raw_value)
+		g_free (header->raw_value);
+	
+	/* whatever replaces it is always allocated on the heap */
+	priv->arena_raw_value = FALSE;
+}
+
 static void
 g_mime_header_finalize (GObject *object)
 {
 	GMimeHeader *header = (GMimeHeader *) object;
+	GMimeHeaderPrivate *priv = GMIME_HEADER_GET_PRIVATE (header);
 	
-	g_mime_event_free (header->changed);
-	g_free (header->raw_value);
-	g_free (header->raw_name);
+	g_mime_event_free (priv->changed);
+	header_free_raw_value (header);
 	g_free (header->charset);
 	g_free (header->value);
-	g_free (header->name);
+	
+	if (priv->arena == NULL) {
+		g_free (header->raw_name);
+		g_free (header->name);
+	} else {
+		g_mime_arena_unref (priv->arena);
+	}
+	
+	g_slice_free (GMimeHeaderPrivate, priv);
 	
 	G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -153,38 +225,53 @@ g_mime_header_finalize (GObject *object)
 /**
  * g_mime_header_new:
  * @options: (nullable): a #GMimeParserOptions or %NULL
+ * @arena: (nullable): the #GMimeArena holding @name, @raw_name and @raw_value or %NULL
  * @name: header name
  * @value: header value
  * @raw_value: raw header value
  * @charset: a charset
  * @offset: file/stream offset for the start of the header (or %-1 if unknown)
  *
- * Creates a new #GMimeHeader.
+ * Creates a new #GMimeHeader. If @arena is non-%NULL, the header takes
+ * a reference on it and uses @name, @raw_name and @raw_value in place
+ * rather than copying them.
  *
  * Returns: a new #GMimeHeader with the specified values.
  **/
 static GMimeHeader *
-g_mime_header_new (GMimeParserOptions *options, const char *name, const char *value,
+g_mime_header_new (GMimeParserOptions *options, GMimeArena *arena, const char *name, const char *value,
 		   const char *raw_name, const char *raw_value, const char *charset,
 		   gint64 offset)
 {
 	GMimeHeaderRawValueFormatter formatter;
+	GMimeHeaderPrivate *priv;
 	GMimeHeader *header;
 	guint i;
 	
 	header = g_object_new (GMIME_TYPE_HEADER, NULL);
-	header->raw_value = raw_value ? g_strdup (raw_value) : NULL;
+	priv = GMIME_HEADER_GET_PRIVATE (header);
 	header->charset = charset ? g_strdup (charset) : NULL;
 	header->value = value ? g_strdup (value) : NULL;
-	header->raw_name = g_strdup (raw_name);
-	header->name = g_strdup (name);
+	
+	if (arena != NULL) {
+		priv->arena = g_mime_arena_ref (arena);
+		priv->arena_raw_value = raw_value != NULL;
+		header->raw_value = (char *) raw_value;
+		header->raw_name = (char *) raw_name;
+		header->name = (char *) name;
+	} else {
+		header->raw_value = raw_value ? g_strdup (raw_value) : NULL;
+		header->raw_name = g_strdup (raw_name);
+		header->name = g_strdup (name);
+	}
 	header->reformat = !raw_value;
 	header->options = options;
 	header->offset = offset;
+	priv->id = _g_mime_header_id_lookup (name);
 	
 	formatter = g_mime_header_format_default;
-	for (i = 0; i < G_N_ELEMENTS (formatters); i++) {
-		if (!g_ascii_strcasecmp (formatters[i].name, name)) {
+	for (i = 0; priv->id != GMIME_HEADER_ID_UNKNOWN && i < G_N_ELEMENTS (formatters); i++) {
+		if (formatters[i].id == priv->id) {
 			formatter = header->formatter = formatters[i].formatter;
 			break;
 		}
@@ -259,7 +346,7 @@ g_mime_header_set_value (GMimeHeader *header, GMimeFormatOptions *options, const
 	
 	formatter = header->formatter ? header->formatter : g_mime_header_format_default;
 	buf = g_mime_strdup_trim (value);
-	g_free (header->raw_value);
+	header_free_raw_value (header);
 	g_free (header->charset);
 	g_free (header->value);
 	
@@ -268,7 +355,7 @@ g_mime_header_set_value (GMimeHeader *header, GMimeFormatOptions *options, const
 	header->reformat = TRUE;
 	header->value = buf;
 	
-	g_mime_event_emit (header->changed, NULL);
+	g_mime_event_emit (GMIME_HEADER_GET_PRIVATE (header)->changed, NULL);
 }
 
 
@@ -341,14 +428,14 @@ g_mime_header_set_raw_value (GMimeHeader *header, const char *raw_value)
 	g_return_if_fail (raw_value != NULL);
 	
 	buf = g_strdup (raw_value);
-	g_free (header->raw_value);
+	header_free_raw_value (header);
 	g_free (header->value);
 
 	header->reformat = FALSE;
 	header->raw_value = buf;
 	header->value = NULL;
 	
-	g_mime_event_emit (header->changed, NULL);
+	g_mime_event_emit (GMIME_HEADER_GET_PRIVATE (header)->changed, NULL);
 }
 
 
@@ -376,6 +463,42 @@ _g_mime_header_set_offset (GMimeHeader *header, gint64 offset)
 }
 
 
+/* gets the id of @header's name if it is a well-known header or
+ * %GMIME_HEADER_ID_UNKNOWN otherwise */
+GMimeHeaderId
+_g_mime_header_get_id (GMimeHeader *header)
+{
+	return GMIME_HEADER_GET_PRIVATE (header)->id;
+}
+
+
+/* points @vector at the name, the ':' and the (possibly reformatted)
+ * raw value of @header; returns the reformatted value, if any, for the
+ * caller to free once it has been written */
+static char *
+header_get_iovec (GMimeHeader *header, GMimeFormatOptions *options, GMimeStreamIOVector *vector)
+{
+	GMimeHeaderRawValueFormatter formatter;
+	char *raw_value, *formatted = NULL;
+	
+	if (header->reformat) {
+		formatter = header->formatter ? header->formatter : g_mime_header_format_default;
+		raw_value = formatted = formatter (header, options, header->value, header->charset);
+	} else {
+		raw_value = header->raw_value;
+	}
+	
+	vector[0].data = header->raw_name;
+	vector[0].len = strlen (header->raw_name);
+	vector[1].data = (char *) ":";
+	vector[1].len = 1;
+	vector[2].data = raw_value;
+	vector[2].len = strlen (raw_value);
+	
+	return formatted;
+}
+
+
 /**
  * g_mime_header_write_to_stream:
  * @header: a #GMimeHeader
@@ -389,36 +512,21 @@ _g_mime_header_set_offset (GMimeHeader *header, gint64 offset)
 ssize_t
 g_mime_header_write_to_stream (GMimeHeader *header, GMimeFormatOptions *options, GMimeStream *stream)
 {
-	GMimeHeaderRawValueFormatter formatter;
-	ssize_t nwritten, total = 0;
-	char *raw_value, *buf;
+	GMimeStreamIOVector vector[3];
+	ssize_t nwritten;
+	char *formatted;
 	
 	g_return_val_if_fail (GMIME_IS_HEADER (header), -1);
 	g_return_val_if_fail (GMIME_IS_STREAM (stream), -1);
 	
 	if (!header->raw_value)
 		return 0;
-
-	if (header->reformat) {
-		formatter = header->formatter ? header->formatter : g_mime_header_format_default;
-		raw_value = formatter (header, options, header->value, header->charset);
-	} else {
-		raw_value = header->raw_value;
-	}
-	
-	buf = g_strdup_printf ("%s:%s", header->raw_name, raw_value);
-	nwritten = g_mime_stream_write_string (stream, buf);
-	
-	if (header->reformat)
-		g_free (raw_value);
-	g_free (buf);
 	
-	if (nwritten == -1)
-		return -1;
+	formatted = header_get_iovec (header, options, vector);
+	nwritten = (ssize_t) g_mime_stream_writev (stream, vector, 3);
+	g_free (formatted);
 	
-	total += nwritten;
-	
-	return total;
+	return nwritten;
 }
 
 
@@ -1000,7 +1108,7 @@ g_mime_header_list_finalize (GObject *object)
 	
 	for (i = 0; i < headers->array->len; i++) {
 		header = (GMimeHeader *) headers->array->pdata[i];
-		g_mime_event_remove (header->changed, (GMimeEventCallback) header_changed, headers);
+		g_mime_event_remove (GMIME_HEADER_GET_PRIVATE (header)->changed, (GMimeEventCallback) header_changed, headers);
 		g_object_unref (header);
 	}
 	
@@ -1051,7 +1159,7 @@ g_mime_header_list_clear (GMimeHeaderList *headers)
 	
 	for (i = 0; i < headers->array->len; i++) {
 		header = (GMimeHeader *) headers->array->pdata[i];
-		g_mime_event_remove (header->changed, (GMimeEventCallback) header_changed, headers);
+		g_mime_event_remove (GMIME_HEADER_GET_PRIVATE (header)->changed, (GMimeEventCallback) header_changed, headers);
 		g_object_unref (header);
 	}
 	
@@ -1143,8 +1251,8 @@ g_mime_header_list_prepend (GMimeHeaderList *headers, const char *name, const ch
 	g_return_if_fail (GMIME_IS_HEADER_LIST (headers));
 	g_return_if_fail (name != NULL);
 	
-	header = g_mime_header_new (headers->options, name, value, name, NULL, charset, -1);
-	g_mime_event_add (header->changed, (GMimeEventCallback) header_changed, headers);
+	header = g_mime_header_new (headers->options, NULL, name, value, name, NULL, charset, -1);
+	g_mime_event_add (GMIME_HEADER_GET_PRIVATE (header)->changed, (GMimeEventCallback) header_changed, headers);
 	g_hash_table_replace (headers->hash, header->name, header);
 	
 	if (headers->array->len > 0) {
@@ -1168,14 +1276,14 @@ g_mime_header_list_prepend (GMimeHeaderList *headers, const char *name, const ch
 
 
 void
-_g_mime_header_list_append (GMimeHeaderList *headers, const char *name, const char *raw_name,
+_g_mime_header_list_append (GMimeHeaderList *headers, GMimeArena *arena, const char *name, const char *raw_name,
 			    const char *raw_value, gint64 offset)
 {
 	GMimeHeaderListChangedEventArgs args;
 	GMimeHeader *header;
 	
-	header = g_mime_header_new (headers->options, name, NULL, raw_name, raw_value, NULL, offset);
-	g_mime_event_add (header->changed, (GMimeEventCallback) header_changed, headers);
+	header = g_mime_header_new (headers->options, arena, name, NULL, raw_name, raw_value, NULL, offset);
+	g_mime_event_add (GMIME_HEADER_GET_PRIVATE (header)->changed, (GMimeEventCallback) header_changed, headers);
 	g_ptr_array_add (headers->array, header);
 	
 	if (!g_hash_table_lookup (headers->hash, name))
@@ -1208,8 +1316,8 @@ g_mime_header_list_append (GMimeHeaderList *headers, const char *name, const cha
 	g_return_if_fail (GMIME_IS_HEADER_LIST (headers));
 	g_return_if_fail (name != NULL);
 	
-	header = g_mime_header_new (headers->options, name, value, name, NULL, charset, -1);
-	g_mime_event_add (header->changed, (GMimeEventCallback) header_changed, headers);
+	header = g_mime_header_new (headers->options, NULL, name, value, name, NULL, charset, -1);
+	g_mime_event_add (GMIME_HEADER_GET_PRIVATE (header)->changed, (GMimeEventCallback) header_changed, headers);
 	g_ptr_array_add (headers->array, header);
 	
 	if (!g_hash_table_lookup (headers->hash, name))
@@ -1246,12 +1354,15 @@ _g_mime_header_list_set (GMimeHeaderList *headers, const char *name, const char
 {
 	GMimeHeaderListChangedEventArgs args;
 	GMimeHeader *header, *hdr;
+	GMimeHeaderId id;
 	guint i;
 	
 	g_return_if_fail (GMIME_IS_HEADER_LIST (headers));
 	g_return_if_fail (name != NULL);
 	
 	if ((header = g_hash_table_lookup (headers->hash, name))) {
+		id = GMIME_HEADER_GET_PRIVATE (header)->id;
+		
 		g_mime_header_set_raw_value (header, raw_value);
 		
 		for (i = headers->array->len - 1; i > 0; i--) {
@@ -1260,10 +1371,10 @@ _g_mime_header_list_set (GMimeHeaderList *headers, const char *name, const char
 			if (hdr == header)
 				break;
 			
-			if (g_ascii_strcasecmp (header->name, hdr->name) != 0)
+			if (!header_name_matches (hdr, id, header->name))
 				continue;
 			
-			g_mime_event_remove (hdr->changed, (GMimeEventCallback) header_changed, headers);
+			g_mime_event_remove (GMIME_HEADER_GET_PRIVATE (hdr)->changed, (GMimeEventCallback) header_changed, headers);
 			g_ptr_array_remove_index (headers->array, i);
 			g_object_unref (hdr);
 		}
@@ -1273,7 +1384,7 @@ _g_mime_header_list_set (GMimeHeaderList *headers, const char *name, const char
 		
 		g_mime_event_emit (headers->changed, &args);
 	} else {
-		_g_mime_header_list_append (headers, name, name, raw_value, -1);
+		_g_mime_header_list_append (headers, NULL, name, name, raw_value, -1);
 	}
 }
 
@@ -1299,12 +1410,15 @@ g_mime_header_list_set (GMimeHeaderList *headers, const char *name, const char *
 {
 	GMimeHeaderListChangedEventArgs args;
 	GMimeHeader *header, *hdr;
+	GMimeHeaderId id;
 	guint i;
 	
 	g_return_if_fail (GMIME_IS_HEADER_LIST (headers));
 	g_return_if_fail (name != NULL);
 	
 	if ((header = g_hash_table_lookup (headers->hash, name))) {
+		id = GMIME_HEADER_GET_PRIVATE (header)->id;
+		
 		g_mime_header_set_value (header, NULL, value, charset);
 		
 		for (i = headers->array->len - 1; i > 0; i--) {
@@ -1313,10 +1427,10 @@ g_mime_header_list_set (GMimeHeaderList *headers, const char *name, const char *
 			if (hdr == header)
 				break;
 			
-			if (g_ascii_strcasecmp (header->name, hdr->name) != 0)
+			if (!header_name_matches (hdr, id, header->name))
 				continue;
 			
-			g_mime_event_remove (hdr->changed, (GMimeEventCallback) header_changed, headers);
+			g_mime_event_remove (GMIME_HEADER_GET_PRIVATE (hdr)->changed, (GMimeEventCallback) header_changed, headers);
 			g_ptr_array_remove_index (headers->array, i);
 			g_object_unref (hdr);
 		}
@@ -1368,6 +1482,7 @@ g_mime_header_list_remove (GMimeHeaderList *headers, const char *name)
 {
 	GMimeHeaderListChangedEventArgs args;
 	GMimeHeader *header, *hdr;
+	GMimeHeaderId id;
 	guint i;
 	
 	g_return_val_if_fail (GMIME_IS_HEADER_LIST (headers), FALSE);
@@ -1382,15 +1497,16 @@ g_mime_header_list_remove (GMimeHeaderList *headers, const char *name)
 			break;
 	}
 	
-	g_mime_event_remove (header->changed, (GMimeEventCallback) header_changed, headers);
+	g_mime_event_remove (GMIME_HEADER_GET_PRIVATE (header)->changed, (GMimeEventCallback) header_changed, headers);
 	g_ptr_array_remove_index (headers->array, i);
 	g_hash_table_remove (headers->hash, name);
 	
 	/* look for another header with the same name... */
+	id = GMIME_HEADER_GET_PRIVATE (header)->id;
 	while (i < headers->array->len) {
 		hdr = (GMimeHeader *) headers->array->pdata[i];
 		
-		if (!g_ascii_strcasecmp (hdr->name, name)) {
+		if (header_name_matches (hdr, id, header->name)) {
 			/* enter this node into the lookup table */
 			g_hash_table_insert (headers->hash, hdr->name, hdr);
 			break;
@@ -1421,6 +1537,7 @@ g_mime_header_list_remove_at (GMimeHeaderList *headers, int index)
 {
 	GMimeHeaderListChangedEventArgs args;
 	GMimeHeader *header, *hdr;
+	GMimeHeaderId id;
 	guint i;
 	
 	g_return_if_fail (GMIME_IS_HEADER_LIST (headers));
@@ -1430,18 +1547,19 @@ g_mime_header_list_remove_at (GMimeHeaderList *headers, int index)
 		return;
 	
 	header = (GMimeHeader *) headers->array->pdata[index];
-	g_mime_event_remove (header->changed, (GMimeEventCallback) header_changed, headers);
+	g_mime_event_remove (GMIME_HEADER_GET_PRIVATE (header)->changed, (GMimeEventCallback) header_changed, headers);
 	g_ptr_array_remove_index (headers->array, index);
 	
 	/* if this is the first instance of a header with this name, then we'll
 	 * need to update the hash table to point to the next instance... */
 	if ((hdr = g_hash_table_lookup (headers->hash, header->name)) == header) {
 		g_hash_table_remove (headers->hash, header->name);
+		id = GMIME_HEADER_GET_PRIVATE (header)->id;
 		
 		for (i = (guint) index; i < headers->array->len; i++) {
 			hdr = (GMimeHeader *) headers->array->pdata[i];
 			
-			if (!g_ascii_strcasecmp (header->name, hdr->name)) {
+			if (header_name_matches (hdr, id, header->name)) {
 				g_hash_table_insert (headers->hash, hdr->name, hdr);
 				break;
 			}
@@ -1469,35 +1587,46 @@ g_mime_header_list_remove_at (GMimeHeaderList *headers, int index)
 ssize_t
 g_mime_header_list_write_to_stream (GMimeHeaderList *headers, GMimeFormatOptions *options, GMimeStream *stream)
 {
-	ssize_t nwritten, total = 0;
+	GMimeStreamIOVector *vector;
+	GPtrArray *formatted;
 	GMimeStream *filtered;
 	GMimeHeader *header;
 	GMimeFilter *filter;
-	guint i;
+	ssize_t nwritten;
+	char *value;
+	guint i, n;
 	
 	g_return_val_if_fail (GMIME_IS_HEADER_LIST (headers), -1);
 	g_return_val_if_fail (GMIME_IS_STREAM (stream), -1);
 	
-	filtered = g_mime_stream_filter_new (stream);
-	filter = g_mime_format_options_create_newline_filter (options, FALSE);
-	g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
-	g_object_unref (filter);
+	vector = g_new (GMimeStreamIOVector, headers->array->len * 3 + 1);
+	formatted = g_ptr_array_new_with_free_func (g_free);
 	
-	for (i = 0; i < headers->array->len; i++) {
+	for (i = 0, n = 0; i < headers->array->len; i++) {
 		header = (GMimeHeader *) headers->array->pdata[i];
 		
-		if (!g_mime_format_options_is_hidden_header (options, header->name)) {
-			if ((nwritten = g_mime_header_write_to_stream (header, options, filtered)) == -1)
-				return -1;
+		if (header->raw_value && !g_mime_format_options_is_hidden_header (options, header->name)) {
+			if ((value = header_get_iovec (header, options, vector + n)))
+				g_ptr_array_add (formatted, value);
 			
-			total += nwritten;
+			n += 3;
 		}
 	}
 	
-	g_mime_stream_flush (filtered);
+	filtered = g_mime_stream_filter_new (stream);
+	filter = g_mime_format_options_create_newline_filter (options, FALSE);
+	g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
+	g_object_unref (filter);
+	
+	/* write the whole header block in one go rather than a header at a time */
+	if ((nwritten = (ssize_t) g_mime_stream_writev (filtered, vector, n)) != -1)
+		g_mime_stream_flush (filtered);
+	
+	g_ptr_array_free (formatted, TRUE);
 	g_object_unref (filtered);
+	g_free (vector);
 	
-	return total;
+	return nwritten;
 }
 
 
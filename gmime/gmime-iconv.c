@@ -24,10 +24,13 @@
 #endif
 
 #include <glib.h>
+#include <string.h>
+#include <stdio.h>
 #include <errno.h>
 
 #include "gmime-charset.h"
 #include "gmime-iconv.h"
+#include "gmime-internal.h"
 
 
 /**
@@ -39,9 +42,298 @@
  * These functions are wrappers around the system iconv(3) routines. The
  * purpose of this wrapper is to use the appropriate system charset alias for
  * the MIME charset names given as arguments.
+ *
+ * Opening an iconv descriptor can be expensive (on glibc it may involve
+ * loading gconv modules), so descriptors closed with g_mime_iconv_close()
+ * are reset and kept around for reuse by later calls to g_mime_iconv_open()
+ * for the same pair of charsets.
  **/
 
 
+/* The cache is keyed on the (to, from) pair of iconv charset names. Each
+ * node keeps a list of idle descriptors for its pair and a count of the
+ * descriptors that are currently checked out. Only nodes without any
+ * checked out descriptors are ever expired, least recently used first.
+ *
+ * On top of that, each thread keeps a handful of slots for descriptors
+ * of its own so that the common open/convert/close pattern (e.g. when
+ * decoding rfc2047 encoded-words) does not need to take the lock at all.
+ * A slot either holds an idle descriptor that the thread can reopen, or
+ * remembers the node of a descriptor that the thread has checked out so
+ * that closing it can put it straight back. Descriptors held by a thread
+ * are still accounted for as checked out. When all of a thread's slots
+ * are taken, its least recently used idle descriptor is handed back to
+ * its node to make room.
+ *
+ * Descriptors may be closed by a thread other than the one that opened
+ * them. When that happens iconv_stolen is bumped so that the opening
+ * thread no longer trusts what its slots say about the descriptors it
+ * has checked out until it has checked them against iconv_open_cds. */
+
+#define ICONV_CACHE_SIZE         16
+#define ICONV_THREAD_CACHE_SIZE  4
+
+typedef struct {
+	GSList *unused;
+	guint refcount;
+	GList *link;
+	char *key;
+} IconvCacheNode;
+
+typedef struct {
+	IconvCacheNode *node;
+	guint generation;
+	guint stolen;		/* value of iconv_stolen when checked out */
+	gboolean busy;		/* checked out rather than idle */
+	guint used;		/* value of the cache's clock when last used */
+	iconv_t cd;
+} IconvThreadCacheSlot;
+
+typedef struct {
+	IconvThreadCacheSlot slots[ICONV_THREAD_CACHE_SIZE];
+	guint clock;
+} IconvThreadCache;
+
+typedef struct {
+	IconvCacheNode *node;
+	IconvThreadCache *owner;	/* the thread holding it in one of its slots */
+} IconvDescriptor;
+
+static void iconv_thread_cache_free (gpointer data);
+
+static GPrivate iconv_thread_cache = G_PRIVATE_INIT (iconv_thread_cache_free);
+static GHashTable *iconv_open_cds = NULL;
+static GHashTable *iconv_cache = NULL;
+static GQueue iconv_lru = G_QUEUE_INIT;
+static guint iconv_generation = 0;
+static guint iconv_stolen = 0;
+
+#ifdef G_THREADS_ENABLED
+static GMutex lock;
+#define ICONV_CACHE_UNLOCK() g_mutex_unlock (&lock);
+#define ICONV_CACHE_LOCK() g_mutex_lock (&lock);
+#else
+#define ICONV_CACHE_UNLOCK()
+#define ICONV_CACHE_LOCK()
+#endif /* G_THREADS_ENABLED */
+
+
+static void
+iconv_cache_node_free (IconvCacheNode *node)
+{
+	GSList *cds;
+	
+	for (cds = node->unused; cds != NULL; cds = cds->next) {
+		g_hash_table_remove (iconv_open_cds, cds->data);
+		iconv_close ((iconv_t) cds->data);
+	}
+	
+	g_slist_free (node->unused);
+	g_free (node->key);
+	g_free (node);
+}
+
+/* must be called with the lock held */
+static void
+iconv_cache_release (IconvCacheNode *node, iconv_t cd)
+{
+	node->unused = g_slist_prepend (node->unused, cd);
+	node->refcount--;
+}
+
+/* must be called with the lock held */
+static void
+iconv_cache_expire (void)
+{
+	IconvCacheNode *node;
+	GList *link, *prev;
+	
+	link = iconv_lru.tail;
+	while (link != NULL && g_hash_table_size (iconv_cache) > ICONV_CACHE_SIZE) {
+		node = link->data;
+		prev = link->prev;
+		
+		if (node->refcount == 0) {
+			g_hash_table_remove (iconv_cache, node->key);
+			g_queue_delete_link (&iconv_lru, link);
+			iconv_cache_node_free (node);
+		}
+		
+		link = prev;
+	}
+}
+
+static void
+iconv_thread_cache_free (gpointer data)
+{
+	IconvThreadCache *cache = data;
+	IconvThreadCacheSlot *slot;
+	IconvDescriptor *desc;
+	guint i;
+	
+	ICONV_CACHE_LOCK ();
+	
+	for (i = 0; i < ICONV_THREAD_CACHE_SIZE; i++) {
+		slot = &cache->slots[i];
+		
+		if (slot->node == NULL)
+			continue;
+		
+		/* descriptors left over from before g_mime_shutdown() no
+		 * longer belong to any cache node */
+		if (iconv_cache == NULL || slot->generation != iconv_generation) {
+			if (!slot->busy)
+				iconv_close (slot->cd);
+			continue;
+		}
+		
+		/* skip descriptors that another thread has closed since */
+		desc = g_hash_table_lookup (iconv_open_cds, slot->cd);
+		if (desc == NULL || desc->owner != cache)
+			continue;
+		
+		/* the ones still checked out get released once closed */
+		desc->owner = NULL;
+		if (!slot->busy)
+			iconv_cache_release (slot->node, slot->cd);
+	}
+	
+	ICONV_CACHE_UNLOCK ();
+	
+	g_free (cache);
+}
+
+static IconvThreadCache *
+iconv_thread_cache_get (void)
+{
+	IconvThreadCache *cache;
+	
+	if (!(cache = g_private_get (&iconv_thread_cache))) {
+		cache = g_new0 (IconvThreadCache, 1);
+		g_private_set (&iconv_thread_cache, cache);
+	}
+	
+	return cache;
+}
+
+/* must be called with the lock held; finds a slot in @cache to keep
+ * @cd in, making room for it if need be */
+static IconvThreadCacheSlot *
+iconv_thread_cache_slot (IconvThreadCache *cache, iconv_t cd)
+{
+	IconvThreadCacheSlot *slot, *avail = NULL, *lru = NULL;
+	IconvDescriptor *desc;
+	guint i;
+	
+	for (i = 0; i < ICONV_THREAD_CACHE_SIZE; i++) {
+		slot = &cache->slots[i];
+		
+		/* an entry for a descriptor that has since been closed by
+		 * another thread and then closed for real */
+		if (slot->node != NULL && slot->busy && slot->cd == cd)
+			return slot;
+		
+		if (slot->node == NULL || slot->generation != iconv_generation) {
+			if (avail == NULL)
+				avail = slot;
+		} else if (!slot->busy && (lru == NULL || (gint) (slot->used - lru->used) < 0)) {
+			lru = slot;
+		}
+	}
+	
+	if (avail != NULL) {
+		if (avail->node != NULL && !avail->busy)
+			iconv_close (avail->cd);
+		
+		return avail;
+	}
+	
+	if (lru != NULL) {
+		/* hand the least recently used idle descriptor back to its node */
+		if ((desc = g_hash_table_lookup (iconv_open_cds, lru->cd)))
+			desc->owner = NULL;
+		
+		iconv_cache_release (lru->node, lru->cd);
+		lru->node = NULL;
+	}
+	
+	return lru;
+}
+
+/* must be called with the lock held */
+static void
+iconv_thread_cache_checkout (IconvThreadCache *cache, IconvDescriptor *desc, iconv_t cd)
+{
+	IconvThreadCacheSlot *slot;
+	
+	desc->owner = NULL;
+	
+	/* remember which node @cd belongs to so that closing it does
+	 * not need the lock */
+	if ((slot = iconv_thread_cache_slot (cache, cd))) {
+		slot->generation = iconv_generation;
+		slot->stolen = iconv_stolen;
+		slot->used = ++cache->clock;
+		slot->node = desc->node;
+		slot->busy = TRUE;
+		slot->cd = cd;
+		
+		desc->owner = cache;
+	}
+}
+
+
+void
+g_mime_iconv_init (void)
+{
+	ICONV_CACHE_LOCK ();
+	
+	if (iconv_cache == NULL) {
+		iconv_cache = g_hash_table_new (g_str_hash, g_str_equal);
+		iconv_open_cds = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+		g_atomic_int_inc (&iconv_generation);
+	}
+	
+	ICONV_CACHE_UNLOCK ();
+}
+
+
+/* descriptors that are still checked out at this point get closed
+ * for real (rather than cached) once they are released */
+void
+g_mime_iconv_shutdown (void)
+{
+	IconvThreadCache *cache;
+	IconvCacheNode *node;
+	
+	/* flush this thread's idle descriptors back to the cache first */
+	if ((cache = g_private_get (&iconv_thread_cache))) {
+		g_private_set (&iconv_thread_cache, NULL);
+		iconv_thread_cache_free (cache);
+	}
+	
+	ICONV_CACHE_LOCK ();
+	
+	if (iconv_cache == NULL) {
+		ICONV_CACHE_UNLOCK ();
+		return;
+	}
+	
+	while ((node = g_queue_pop_head (&iconv_lru)))
+		iconv_cache_node_free (node);
+	
+	g_hash_table_destroy (iconv_open_cds);
+	g_hash_table_destroy (iconv_cache);
+	iconv_open_cds = NULL;
+	iconv_cache = NULL;
+	
+	/* invalidate the idle descriptors still held by other threads */
+	g_atomic_int_inc (&iconv_generation);
+	
+	ICONV_CACHE_UNLOCK ();
+}
+
+
 /**
  * g_mime_iconv_open: (skip)
  * @to: charset to convert to
@@ -61,6 +353,15 @@
 iconv_t
 g_mime_iconv_open (const char *to, const char *from)
 {
+	IconvThreadCacheSlot *slot;
+	IconvThreadCache *cache;
+	IconvDescriptor *desc;
+	IconvCacheNode *node;
+	guint generation, i;
+	int errnosav;
+	iconv_t cd;
+	char *key;
+	
 	if (from == NULL || to == NULL) {
 		errno = EINVAL;
 		return (iconv_t) -1;
@@ -72,7 +373,78 @@ g_mime_iconv_open (const char *to, const char *from)
 	from = g_mime_charset_iconv_name (from);
 	to = g_mime_charset_iconv_name (to);
 	
-	return iconv_open (to, from);
+	key = g_alloca (strlen (from) + strlen (to) + 2);
+	sprintf (key, "%s:%s", from, to);
+	
+	/* try this thread's idle descriptors first, without taking the lock */
+	cache = iconv_thread_cache_get ();
+	generation = g_atomic_int_get (&iconv_generation);
+	
+	for (i = 0; i < ICONV_THREAD_CACHE_SIZE; i++) {
+		slot = &cache->slots[i];
+		
+		if (slot->node != NULL && !slot->busy && slot->generation == generation && !strcmp (slot->node->key, key)) {
+			slot->stolen = g_atomic_int_get (&iconv_stolen);
+			slot->used = ++cache->clock;
+			slot->busy = TRUE;
+			return slot->cd;
+		}
+	}
+	
+	ICONV_CACHE_LOCK ();
+	
+	if (iconv_cache == NULL) {
+		/* g_mime_init() has not been called */
+		ICONV_CACHE_UNLOCK ();
+		return iconv_open (to, from);
+	}
+	
+	if ((node = g_hash_table_lookup (iconv_cache, key))) {
+		/* mark the node as most recently used */
+		g_queue_unlink (&iconv_lru, node->link);
+		g_queue_push_head_link (&iconv_lru, node->link);
+		
+		if (node->unused != NULL) {
+			cd = (iconv_t) node->unused->data;
+			node->unused = g_slist_delete_link (node->unused, node->unused);
+			node->refcount++;
+			
+			desc = g_hash_table_lookup (iconv_open_cds, cd);
+			
+			goto checkout;
+		}
+	}
+	
+	if ((cd = iconv_open (to, from)) == (iconv_t) -1) {
+		errnosav = errno;
+		ICONV_CACHE_UNLOCK ();
+		errno = errnosav;
+		
+		return cd;
+	}
+	
+	if (node == NULL) {
+		node = g_new0 (IconvCacheNode, 1);
+		node->key = g_strdup (key);
+		g_hash_table_insert (iconv_cache, node->key, node);
+		g_queue_push_head (&iconv_lru, node);
+		node->link = iconv_lru.head;
+	}
+	
+	desc = g_new (IconvDescriptor, 1);
+	desc->node = node;
+	
+	g_hash_table_insert (iconv_open_cds, cd, desc);
+	node->refcount++;
+	
+	iconv_cache_expire ();
+	
+ checkout:
+	iconv_thread_cache_checkout (cache, desc, cd);
+	
+	ICONV_CACHE_UNLOCK ();
+	
+	return cd;
 }
 
 
@@ -90,5 +462,89 @@ g_mime_iconv_open (const char *to, const char *from)
 int
 g_mime_iconv_close (iconv_t cd)
 {
-	return iconv_close (cd);
+	IconvThreadCacheSlot *slot;
+	IconvThreadCache *cache;
+	IconvDescriptor *desc;
+	guint stolen, i;
+	
+	/* a descriptor that this thread checked out, and that no other
+	 * thread has closed in the meantime, goes straight back into its
+	 * slot without taking the lock */
+	cache = iconv_thread_cache_get ();
+	stolen = g_atomic_int_get (&iconv_stolen);
+	
+	for (i = 0; i < ICONV_THREAD_CACHE_SIZE; i++) {
+		slot = &cache->slots[i];
+		
+		if (slot->node == NULL || !slot->busy || slot->cd != cd)
+			continue;
+		
+		if (slot->stolen == stolen && slot->generation == g_atomic_int_get (&iconv_generation)) {
+			/* reset the conversion state before handing it out again */
+			iconv (cd, NULL, NULL, NULL, NULL);
+			slot->busy = FALSE;
+			
+			return 0;
+		}
+		
+		break;
+	}
+	
+	ICONV_CACHE_LOCK ();
+	
+	/* drop the entries for descriptors that have been closed by other
+	 * threads since this thread checked them out */
+	for (i = 0; i < ICONV_THREAD_CACHE_SIZE; i++) {
+		slot = &cache->slots[i];
+		
+		if (slot->node == NULL || !slot->busy)
+			continue;
+		
+		if (iconv_cache != NULL && slot->generation == iconv_generation &&
+		    (desc = g_hash_table_lookup (iconv_open_cds, slot->cd)) && desc->owner == cache) {
+			slot->stolen = iconv_stolen;
+			
+			if (slot->cd == cd) {
+				iconv (cd, NULL, NULL, NULL, NULL);
+				slot->busy = FALSE;
+				
+				ICONV_CACHE_UNLOCK ();
+				
+				return 0;
+			}
+		} else {
+			slot->node = NULL;
+		}
+	}
+	
+	if (iconv_cache == NULL || !(desc = g_hash_table_lookup (iconv_open_cds, cd))) {
+		/* not one of ours */
+		ICONV_CACHE_UNLOCK ();
+		return iconv_close (cd);
+	}
+	
+	/* make the thread that checked it out stop trusting its slots */
+	if (desc->owner != NULL)
+		g_atomic_int_inc (&iconv_stolen);
+	
+	/* reset the conversion state before handing it out again */
+	iconv (cd, NULL, NULL, NULL, NULL);
+	
+	desc->owner = NULL;
+	
+	if ((slot = iconv_thread_cache_slot (cache, cd))) {
+		slot->generation = iconv_generation;
+		slot->used = ++cache->clock;
+		slot->node = desc->node;
+		slot->busy = FALSE;
+		slot->cd = cd;
+		
+		desc->owner = cache;
+	} else {
+		iconv_cache_release (desc->node, cd);
+	}
+	
+	ICONV_CACHE_UNLOCK ();
+	
+	return 0;
 }
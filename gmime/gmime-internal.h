@@ -25,8 +25,12 @@
 #include <gmime/gmime-format-options.h>
 #include <gmime/gmime-parser-options.h>
 #include <gmime/gmime-object.h>
+#include <gmime/gmime-part.h>
 #include <gmime/gmime-events.h>
+#include <gmime/gmime-arena.h>
 #include <gmime/gmime-utils.h>
+#include <gmime/gmime-crypto-context.h>
+#include <gmime/gmime-filter-charset.h>
 
 G_BEGIN_DECLS
 
@@ -47,6 +51,45 @@ G_GNUC_INTERNAL void g_mime_format_options_init (void);
 G_GNUC_INTERNAL void g_mime_format_options_shutdown (void);
 G_GNUC_INTERNAL GMimeFormatOptions *_g_mime_format_options_clone (GMimeFormatOptions *options, gboolean hidden);
 
+/* GMimeCharset */
+#define GMIME_CHARSET_ID_UTF8 1
+G_GNUC_INTERNAL guint _g_mime_charset_intern_len (const char *charset, size_t len);
+G_GNUC_INTERNAL const unsigned short *_g_mime_charset_sbcs_table (const char *charset);
+G_GNUC_INTERNAL const unsigned short *_g_mime_charset_id_sbcs_table (guint id);
+G_GNUC_INTERNAL size_t _g_mime_charset_sbcs_to_utf8 (const unsigned short *table, const char *inbuf, size_t inlen,
+						     char *outbuf, char invalid, size_t *ninval);
+
+/* GMimeFilterCharset */
+G_GNUC_INTERNAL const unsigned short *_g_mime_filter_charset_get_sbcs_table (GMimeFilterCharset *filter);
+
+/* GMimeIconv */
+G_GNUC_INTERNAL void g_mime_iconv_init (void);
+G_GNUC_INTERNAL void g_mime_iconv_shutdown (void);
+
+/* GMimeUtils */
+G_GNUC_INTERNAL void g_mime_utils_shutdown (void);
+
+/* GMimeStream */
+typedef struct {
+	ssize_t (* borrow) (GMimeStream *stream, const char **buf, size_t len);
+	gint64  (* writev) (GMimeStream *stream, GMimeStreamIOVector *vector, size_t count);
+} GMimeStreamClassPrivate;
+
+#define GMIME_STREAM_CLASS_GET_PRIVATE(klass) (G_TYPE_CLASS_GET_PRIVATE ((klass), GMIME_TYPE_STREAM, GMimeStreamClassPrivate))
+
+G_GNUC_INTERNAL const char *_g_mime_stream_get_memory (GMimeStream *stream, gint64 *end);
+G_GNUC_INTERNAL gboolean _g_mime_stream_can_lend (GMimeStream *stream);
+
+/* GMimeStreamCat */
+G_GNUC_INTERNAL GMimeStream *_g_mime_stream_cat_splice_new (void);
+G_GNUC_INTERNAL gboolean _g_mime_stream_is_splice (GMimeStream *stream);
+G_GNUC_INTERNAL gboolean _g_mime_stream_cat_splice (GMimeStream *stream, GMimeStream *source);
+G_GNUC_INTERNAL GMimeStream *_g_mime_stream_cat_splice_finish (GMimeStream *stream);
+
+/* GMimeCryptoContext */
+G_GNUC_INTERNAL GMimeCryptoContext *_g_mime_crypto_context_acquire (const char *protocol);
+G_GNUC_INTERNAL void _g_mime_crypto_context_release (const char *protocol, GMimeCryptoContext *ctx);
+
 /* GMimeParserOptions */
 G_GNUC_INTERNAL void g_mime_parser_options_init (void);
 G_GNUC_INTERNAL void g_mime_parser_options_shutdown (void);
@@ -54,22 +97,66 @@ G_GNUC_INTERNAL void _g_mime_parser_options_warn (GMimeParserOptions *options, g
 						  const gchar *item);
 
 /* GMimeHeader */
+typedef enum {
+	GMIME_HEADER_ID_UNKNOWN,
+	GMIME_HEADER_ID_RETURN_PATH,
+	GMIME_HEADER_ID_RECEIVED,
+	GMIME_HEADER_ID_RESENT_DATE,
+	GMIME_HEADER_ID_RESENT_FROM,
+	GMIME_HEADER_ID_RESENT_SENDER,
+	GMIME_HEADER_ID_RESENT_REPLY_TO,
+	GMIME_HEADER_ID_RESENT_TO,
+	GMIME_HEADER_ID_RESENT_CC,
+	GMIME_HEADER_ID_RESENT_BCC,
+	GMIME_HEADER_ID_RESENT_MESSAGE_ID,
+	GMIME_HEADER_ID_DATE,
+	GMIME_HEADER_ID_FROM,
+	GMIME_HEADER_ID_SENDER,
+	GMIME_HEADER_ID_REPLY_TO,
+	GMIME_HEADER_ID_TO,
+	GMIME_HEADER_ID_CC,
+	GMIME_HEADER_ID_BCC,
+	GMIME_HEADER_ID_MESSAGE_ID,
+	GMIME_HEADER_ID_IN_REPLY_TO,
+	GMIME_HEADER_ID_REFERENCES,
+	GMIME_HEADER_ID_SUBJECT,
+	GMIME_HEADER_ID_COMMENTS,
+	GMIME_HEADER_ID_KEYWORDS,
+	GMIME_HEADER_ID_MIME_VERSION,
+	GMIME_HEADER_ID_CONTENT_TYPE,
+	GMIME_HEADER_ID_CONTENT_TRANSFER_ENCODING,
+	GMIME_HEADER_ID_CONTENT_DISPOSITION,
+	GMIME_HEADER_ID_CONTENT_ID,
+	GMIME_HEADER_ID_CONTENT_DESCRIPTION,
+	GMIME_HEADER_ID_CONTENT_LOCATION,
+	GMIME_HEADER_ID_CONTENT_MD5,
+	GMIME_HEADER_ID_CONTENT_LENGTH,
+	GMIME_HEADER_ID_CONTENT_BASE,
+	GMIME_HEADER_ID_DISPOSITION_NOTIFICATION_TO
+} GMimeHeaderId;
+
+G_GNUC_INTERNAL GMimeHeaderId _g_mime_header_id_lookup (const char *name);
+G_GNUC_INTERNAL GMimeHeaderId _g_mime_header_get_id (GMimeHeader *header);
 //G_GNUC_INTERNAL void _g_mime_header_set_raw_value (GMimeHeader *header, const char *raw_value);
 G_GNUC_INTERNAL void _g_mime_header_set_offset (GMimeHeader *header, gint64 offset);
 
 /* GMimeHeaderList */
 G_GNUC_INTERNAL GMimeParserOptions *_g_mime_header_list_get_options (GMimeHeaderList *headers);
 G_GNUC_INTERNAL void _g_mime_header_list_set_options (GMimeHeaderList *headers, GMimeParserOptions *options);
-G_GNUC_INTERNAL void _g_mime_header_list_append (GMimeHeaderList *headers, const char *name, const char *raw_name,
-						 const char *raw_value, gint64 offset);
+G_GNUC_INTERNAL void _g_mime_header_list_append (GMimeHeaderList *headers, GMimeArena *arena, const char *name,
+						 const char *raw_name, const char *raw_value, gint64 offset);
 G_GNUC_INTERNAL void _g_mime_header_list_set (GMimeHeaderList *headers, const char *name, const char *raw_value);
 
 /* GMimeObject */
 G_GNUC_INTERNAL void _g_mime_object_block_header_list_changed (GMimeObject *object);
 G_GNUC_INTERNAL void _g_mime_object_unblock_header_list_changed (GMimeObject *object);
 G_GNUC_INTERNAL void _g_mime_object_set_content_type (GMimeObject *object, GMimeContentType *content_type);
-G_GNUC_INTERNAL void _g_mime_object_append_header (GMimeObject *object, const char *name, const char *raw_name,
-						   const char *raw_value, gint64 offset);
+G_GNUC_INTERNAL void _g_mime_object_append_header (GMimeObject *object, GMimeArena *arena, const char *name,
+						   const char *raw_name, const char *raw_value, gint64 offset);
+
+/* GMimePart */
+G_GNUC_INTERNAL void _g_mime_part_set_lazy_content (GMimePart *mime_part, GMimeStream *stream, gint64 start, gint64 end,
+						    GMimeContentEncoding encoding);
 
 /* GMimeContentType */
 G_GNUC_INTERNAL GMimeContentType *_g_mime_content_type_parse (GMimeParserOptions *options, const char *str, gint64 offset);
@@ -341,7 +341,7 @@ message_partial_message_new (GMimeMessage *base)
 		offset = g_mime_header_get_offset (header);
 		name = g_mime_header_get_name (header);
 		
-		_g_mime_object_append_header ((GMimeObject *) message, name, raw_name, raw_value, offset);
+		_g_mime_object_append_header ((GMimeObject *) message, NULL, name, raw_name, raw_value, offset);
 	}
 	
 	return message;
@@ -77,18 +77,31 @@ static GMimeObjectClass *parent_class = NULL;
 
 static struct {
 	const char *name;
+	GMimeHeaderId id;
 	GMimeEventCallback changed_cb;
 } address_types[] = {
-	{ "Sender",   (GMimeEventCallback) sender_changed   },
-	{ "From",     (GMimeEventCallback) from_changed     },
-	{ "Reply-To", (GMimeEventCallback) reply_to_changed },
-	{ "To",       (GMimeEventCallback) to_list_changed  },
-	{ "Cc",       (GMimeEventCallback) cc_list_changed  },
-	{ "Bcc",      (GMimeEventCallback) bcc_list_changed }
+	{ "Sender",   GMIME_HEADER_ID_SENDER,   (GMimeEventCallback) sender_changed   },
+	{ "From",     GMIME_HEADER_ID_FROM,     (GMimeEventCallback) from_changed     },
+	{ "Reply-To", GMIME_HEADER_ID_REPLY_TO, (GMimeEventCallback) reply_to_changed },
+	{ "To",       GMIME_HEADER_ID_TO,       (GMimeEventCallback) to_list_changed  },
+	{ "Cc",       GMIME_HEADER_ID_CC,       (GMimeEventCallback) cc_list_changed  },
+	{ "Bcc",      GMIME_HEADER_ID_BCC,      (GMimeEventCallback) bcc_list_changed }
 };
 
 #define N_ADDRESS_TYPES G_N_ELEMENTS (address_types)
 
+/* the lazy header state doesn't fit in the public struct, so the
+ * addrlists table is the first member of a larger allocation */
+typedef struct {
+	InternetAddressList *addrlists[N_ADDRESS_TYPES];
+	GMimeHeader *message_id_header;
+	GMimeHeader *subject_header;
+	GMimeHeader *date_header;
+	guint dirty, exposed;
+} GMimeMessagePrivate;
+
+#define GMIME_MESSAGE_GET_PRIVATE(message) ((GMimeMessagePrivate *) (message)->addrlists)
+
 static char *rfc822_headers[] = {
 	"Return-Path",
 	"Received",
@@ -189,9 +202,10 @@ unblock_changed_event (GMimeMessage *message, GMimeAddressType type)
 static void
 g_mime_message_init (GMimeMessage *message, GMimeMessageClass *klass)
 {
+	GMimeMessagePrivate *priv = g_new0 (GMimeMessagePrivate, 1);
 	guint i;
 	
-	message->addrlists = g_new (InternetAddressList *, N_ADDRESS_TYPES);
+	message->addrlists = priv->addrlists;
 	((GMimeObject *) message)->ensure_newline = TRUE;
 	message->message_id = NULL;
 	message->mime_part = NULL;
@@ -209,6 +223,7 @@ static void
 g_mime_message_finalize (GObject *object)
 {
 	GMimeMessage *message = (GMimeMessage *) object;
+	GMimeMessagePrivate *priv = GMIME_MESSAGE_GET_PRIVATE (message);
 	guint i;
 	
 	/* disconnect changed handlers */
@@ -217,7 +232,15 @@ g_mime_message_finalize (GObject *object)
 		g_object_unref (message->addrlists[i]);
 	}
 	
-	g_free (message->addrlists);
+	if (priv->message_id_header)
+		g_object_unref (priv->message_id_header);
+	if (priv->subject_header)
+		g_object_unref (priv->subject_header);
+	if (priv->date_header)
+		g_object_unref (priv->date_header);
+	
+	g_free (priv);
+	
 	g_free (message->message_id);
 	g_free (message->subject);
 	g_free (message->marker);
@@ -233,40 +256,13 @@ g_mime_message_finalize (GObject *object)
 }
 
 
-enum {
-	HEADER_SENDER,
-	HEADER_FROM,
-	HEADER_REPLY_TO,
-	HEADER_TO,
-	HEADER_CC,
-	HEADER_BCC,
-	HEADER_SUBJECT,
-	HEADER_DATE,
-	HEADER_MESSAGE_ID,
-	HEADER_MIME_VERSION,
-	HEADER_UNKNOWN
-};
-
-static const char *message_headers[] = {
-	"Sender",
-	"From",
-	"Reply-To",
-	"To",
-	"Cc",
-	"Bcc",
-	"Subject",
-	"Date",
-	"Message-Id",
-	"MIME-Version",
-};
-
 static void
 message_update_addresses (GMimeMessage *message, GMimeParserOptions *options, GMimeAddressType type)
 {
 	GMimeHeaderList *headers = ((GMimeObject *) message)->headers;
 	InternetAddressList *addrlist, *list;
-	const char *name, *value;
 	GMimeHeader *header;
+	const char *value;
 	int count, i;
 	
 	block_changed_event (message, type);
@@ -278,9 +274,8 @@ message_update_addresses (GMimeMessage *message, GMimeParserOptions *options, GM
 	count = g_mime_header_list_get_count (headers);
 	for (i = 0; i < count; i++) {
 		header = g_mime_header_list_get_header_at (headers, i);
-		name = g_mime_header_get_name (header);
 		
-		if (g_ascii_strcasecmp (address_types[type].name, name) != 0)
+		if (_g_mime_header_get_id (header) != address_types[type].id)
 			continue;
 		
 		if ((value = g_mime_header_get_raw_value (header))) {
@@ -294,63 +289,159 @@ message_update_addresses (GMimeMessage *message, GMimeParserOptions *options, GM
 	unblock_changed_event (message, type);
 }
 
+/* The address lists, Subject, Date and Message-Id are not decoded as
+ * headers get added to the message; instead they are marked as stale
+ * and decoded the first time somebody asks for them. Messages that are
+ * only routed or filtered never pay for address or date parsing.
+ *
+ * Once an address list has been handed out to the caller, it is kept
+ * up-to-date eagerly so that the caller's reference never goes stale. */
+
 static void
-process_header (GMimeObject *object, GMimeHeader *header)
+message_set_pending_header (GMimeHeader **pending, GMimeHeader *header)
 {
-	GMimeParserOptions *options = _g_mime_header_list_get_options (object->headers);
-	GMimeMessage *message = (GMimeMessage *) object;
-	const char *name, *value;
-	guint i;
+	if (header != NULL)
+		g_object_ref (header);
 	
-	name = g_mime_header_get_name (header);
+	if (*pending != NULL)
+		g_object_unref (*pending);
 	
-	for (i = 0; i < G_N_ELEMENTS (message_headers); i++) {
-		if (!g_ascii_strcasecmp (message_headers[i], name))
-			break;
+	*pending = header;
+}
+
+static void
+message_addresses_changed (GMimeMessage *message, GMimeAddressType type)
+{
+	GMimeMessagePrivate *priv = GMIME_MESSAGE_GET_PRIVATE (message);
+	GMimeParserOptions *options;
+	
+	if (priv->exposed & (1 << type)) {
+		options = _g_mime_header_list_get_options (((GMimeObject *) message)->headers);
+		message_update_addresses (message, options, type);
+		priv->dirty &= ~(1 << type);
+	} else {
+		priv->dirty |= (1 << type);
 	}
+}
+
+static InternetAddressList *
+message_ensure_addresses (GMimeMessage *message, GMimeAddressType type)
+{
+	GMimeMessagePrivate *priv = GMIME_MESSAGE_GET_PRIVATE (message);
+	GMimeParserOptions *options;
 	
-	switch (i) {
-	case HEADER_SENDER:
-		message_update_addresses (message, options, GMIME_ADDRESS_TYPE_SENDER);
-		break;
-	case HEADER_FROM:
-		message_update_addresses (message, options, GMIME_ADDRESS_TYPE_FROM);
-		break;
-	case HEADER_REPLY_TO:
-		message_update_addresses (message, options, GMIME_ADDRESS_TYPE_REPLY_TO);
-		break;
-	case HEADER_TO:
-		message_update_addresses (message, options, GMIME_ADDRESS_TYPE_TO);
-		break;
-	case HEADER_CC:
-		message_update_addresses (message, options, GMIME_ADDRESS_TYPE_CC);
-		break;
-	case HEADER_BCC:
-		message_update_addresses (message, options, GMIME_ADDRESS_TYPE_BCC);
-		break;
-	case HEADER_SUBJECT:
+	if (priv->dirty & (1 << type)) {
+		options = _g_mime_header_list_get_options (((GMimeObject *) message)->headers);
+		message_update_addresses (message, options, type);
+		priv->dirty &= ~(1 << type);
+	}
+	
+	return message->addrlists[type];
+}
+
+static InternetAddressList *
+message_expose_addresses (GMimeMessage *message, GMimeAddressType type)
+{
+	GMimeMessagePrivate *priv = GMIME_MESSAGE_GET_PRIVATE (message);
+	
+	priv->exposed |= (1 << type);
+	
+	return message_ensure_addresses (message, type);
+}
+
+static const char *
+message_ensure_subject (GMimeMessage *message)
+{
+	GMimeMessagePrivate *priv = GMIME_MESSAGE_GET_PRIVATE (message);
+	const char *value;
+	
+	if (priv->subject_header) {
 		g_free (message->subject);
 		
-		if ((value = g_mime_header_get_value (header)))
+		if ((value = g_mime_header_get_value (priv->subject_header)))
 			message->subject = g_strdup (value);
 		else
 			message->subject = NULL;
-		break;
-	case HEADER_DATE:
-		if ((value = g_mime_header_get_value (header))) {
+		
+		message_set_pending_header (&priv->subject_header, NULL);
+	}
+	
+	return message->subject;
+}
+
+static GDateTime *
+message_ensure_date (GMimeMessage *message)
+{
+	GMimeMessagePrivate *priv = GMIME_MESSAGE_GET_PRIVATE (message);
+	const char *value;
+	
+	if (priv->date_header) {
+		if ((value = g_mime_header_get_value (priv->date_header))) {
 			if (message->date)
 				g_date_time_unref (message->date);
 			
 			message->date = g_mime_utils_header_decode_date (value);
 		}
-		break;
-	case HEADER_MESSAGE_ID:
+		
+		message_set_pending_header (&priv->date_header, NULL);
+	}
+	
+	return message->date;
+}
+
+static const char *
+message_ensure_message_id (GMimeMessage *message)
+{
+	GMimeMessagePrivate *priv = GMIME_MESSAGE_GET_PRIVATE (message);
+	const char *value;
+	
+	if (priv->message_id_header) {
 		g_free (message->message_id);
 		
-		if ((value = g_mime_header_get_value (header)))
+		if ((value = g_mime_header_get_value (priv->message_id_header)))
 			message->message_id = g_mime_utils_decode_message_id (value);
 		else
 			message->message_id = NULL;
+		
+		message_set_pending_header (&priv->message_id_header, NULL);
+	}
+	
+	return message->message_id;
+}
+
+static void
+process_header (GMimeObject *object, GMimeHeader *header)
+{
+	GMimeMessage *message = (GMimeMessage *) object;
+	GMimeMessagePrivate *priv = GMIME_MESSAGE_GET_PRIVATE (message);
+	
+	switch (_g_mime_header_get_id (header)) {
+	case GMIME_HEADER_ID_SENDER:
+		message_addresses_changed (message, GMIME_ADDRESS_TYPE_SENDER);
+		break;
+	case GMIME_HEADER_ID_FROM:
+		message_addresses_changed (message, GMIME_ADDRESS_TYPE_FROM);
+		break;
+	case GMIME_HEADER_ID_REPLY_TO:
+		message_addresses_changed (message, GMIME_ADDRESS_TYPE_REPLY_TO);
+		break;
+	case GMIME_HEADER_ID_TO:
+		message_addresses_changed (message, GMIME_ADDRESS_TYPE_TO);
+		break;
+	case GMIME_HEADER_ID_CC:
+		message_addresses_changed (message, GMIME_ADDRESS_TYPE_CC);
+		break;
+	case GMIME_HEADER_ID_BCC:
+		message_addresses_changed (message, GMIME_ADDRESS_TYPE_BCC);
+		break;
+	case GMIME_HEADER_ID_SUBJECT:
+		message_set_pending_header (&priv->subject_header, header);
+		break;
+	case GMIME_HEADER_ID_DATE:
+		message_set_pending_header (&priv->date_header, header);
+		break;
+	case GMIME_HEADER_ID_MESSAGE_ID:
+		message_set_pending_header (&priv->message_id_header, header);
 		break;
 	}
 }
@@ -374,48 +465,42 @@ message_header_changed (GMimeObject *object, GMimeHeader *header)
 static void
 message_header_removed (GMimeObject *object, GMimeHeader *header)
 {
-	GMimeParserOptions *options = _g_mime_header_list_get_options (object->headers);
 	GMimeMessage *message = (GMimeMessage *) object;
-	const char *name;
-	guint i;
-	
-	name = g_mime_header_get_name (header);
+	GMimeMessagePrivate *priv = GMIME_MESSAGE_GET_PRIVATE (message);
 	
-	for (i = 0; i < G_N_ELEMENTS (message_headers); i++) {
-		if (!g_ascii_strcasecmp (message_headers[i], name))
-			break;
-	}
-	
-	switch (i) {
-	case HEADER_SENDER:
-		message_update_addresses (message, options, GMIME_ADDRESS_TYPE_SENDER);
+	switch (_g_mime_header_get_id (header)) {
+	case GMIME_HEADER_ID_SENDER:
+		message_addresses_changed (message, GMIME_ADDRESS_TYPE_SENDER);
 		break;
-	case HEADER_FROM:
-		message_update_addresses (message, options, GMIME_ADDRESS_TYPE_FROM);
+	case GMIME_HEADER_ID_FROM:
+		message_addresses_changed (message, GMIME_ADDRESS_TYPE_FROM);
 		break;
-	case HEADER_REPLY_TO:
-		message_update_addresses (message, options, GMIME_ADDRESS_TYPE_REPLY_TO);
+	case GMIME_HEADER_ID_REPLY_TO:
+		message_addresses_changed (message, GMIME_ADDRESS_TYPE_REPLY_TO);
 		break;
-	case HEADER_TO:
-		message_update_addresses (message, options, GMIME_ADDRESS_TYPE_TO);
+	case GMIME_HEADER_ID_TO:
+		message_addresses_changed (message, GMIME_ADDRESS_TYPE_TO);
 		break;
-	case HEADER_CC:
-		message_update_addresses (message, options, GMIME_ADDRESS_TYPE_CC);
+	case GMIME_HEADER_ID_CC:
+		message_addresses_changed (message, GMIME_ADDRESS_TYPE_CC);
 		break;
-	case HEADER_BCC:
-		message_update_addresses (message, options, GMIME_ADDRESS_TYPE_BCC);
+	case GMIME_HEADER_ID_BCC:
+		message_addresses_changed (message, GMIME_ADDRESS_TYPE_BCC);
 		break;
-	case HEADER_SUBJECT:
+	case GMIME_HEADER_ID_SUBJECT:
+		message_set_pending_header (&priv->subject_header, NULL);
 		g_free (message->subject);
 		message->subject = NULL;
 		break;
-	case HEADER_DATE:
+	case GMIME_HEADER_ID_DATE:
+		message_set_pending_header (&priv->date_header, NULL);
 		if (message->date) {
 			g_date_time_unref (message->date);
 			message->date = NULL;
 		}
 		break;
-	case HEADER_MESSAGE_ID:
+	case GMIME_HEADER_ID_MESSAGE_ID:
+		message_set_pending_header (&priv->message_id_header, NULL);
 		g_free (message->message_id);
 		message->message_id = NULL;
 		break;
@@ -428,6 +513,7 @@ static void
 message_headers_cleared (GMimeObject *object)
 {
 	GMimeMessage *message = (GMimeMessage *) object;
+	GMimeMessagePrivate *priv = GMIME_MESSAGE_GET_PRIVATE (message);
 	guint i;
 	
 	for (i = 0; i < N_ADDRESS_TYPES; i++) {
@@ -436,6 +522,11 @@ message_headers_cleared (GMimeObject *object)
 		unblock_changed_event (message, i);
 	}
 	
+	message_set_pending_header (&priv->message_id_header, NULL);
+	message_set_pending_header (&priv->subject_header, NULL);
+	message_set_pending_header (&priv->date_header, NULL);
+	priv->dirty = 0;
+	
 	g_free (message->message_id);
 	message->message_id = NULL;
 	g_free (message->subject);
@@ -658,7 +749,7 @@ g_mime_message_get_sender (GMimeMessage *message)
 {
 	g_return_val_if_fail (GMIME_IS_MESSAGE (message), NULL);
 	
-	return message->addrlists[GMIME_ADDRESS_TYPE_SENDER];
+	return message_expose_addresses (message, GMIME_ADDRESS_TYPE_SENDER);
 }
 
 
@@ -675,7 +766,7 @@ g_mime_message_get_from (GMimeMessage *message)
 {
 	g_return_val_if_fail (GMIME_IS_MESSAGE (message), NULL);
 	
-	return message->addrlists[GMIME_ADDRESS_TYPE_FROM];
+	return message_expose_addresses (message, GMIME_ADDRESS_TYPE_FROM);
 }
 
 
@@ -692,7 +783,7 @@ g_mime_message_get_reply_to (GMimeMessage *message)
 {
 	g_return_val_if_fail (GMIME_IS_MESSAGE (message), NULL);
 	
-	return message->addrlists[GMIME_ADDRESS_TYPE_REPLY_TO];
+	return message_expose_addresses (message, GMIME_ADDRESS_TYPE_REPLY_TO);
 }
 
 
@@ -709,7 +800,7 @@ g_mime_message_get_to (GMimeMessage *message)
 {
 	g_return_val_if_fail (GMIME_IS_MESSAGE (message), NULL);
 	
-	return message->addrlists[GMIME_ADDRESS_TYPE_TO];
+	return message_expose_addresses (message, GMIME_ADDRESS_TYPE_TO);
 }
 
 
@@ -726,7 +817,7 @@ g_mime_message_get_cc (GMimeMessage *message)
 {
 	g_return_val_if_fail (GMIME_IS_MESSAGE (message), NULL);
 	
-	return message->addrlists[GMIME_ADDRESS_TYPE_CC];
+	return message_expose_addresses (message, GMIME_ADDRESS_TYPE_CC);
 }
 
 
@@ -743,7 +834,7 @@ g_mime_message_get_bcc (GMimeMessage *message)
 {
 	g_return_val_if_fail (GMIME_IS_MESSAGE (message), NULL);
 	
-	return message->addrlists[GMIME_ADDRESS_TYPE_BCC];
+	return message_expose_addresses (message, GMIME_ADDRESS_TYPE_BCC);
 }
 
 
@@ -835,7 +926,7 @@ g_mime_message_add_mailbox (GMimeMessage *message, GMimeAddressType type, const
 	g_return_if_fail (type < N_ADDRESS_TYPES);
 	g_return_if_fail (addr != NULL);
 	
-	addrlist = message->addrlists[type];
+	addrlist = message_ensure_addresses (message, type);
 	ia = internet_address_mailbox_new (name, addr);
 	internet_address_list_add (addrlist, ia);
 	g_object_unref (ia);
@@ -858,7 +949,7 @@ g_mime_message_get_addresses (GMimeMessage *message, GMimeAddressType type)
 	g_return_val_if_fail (GMIME_IS_MESSAGE (message), NULL);
 	g_return_val_if_fail (type < N_ADDRESS_TYPES, NULL);
 	
-	return message->addrlists[type];
+	return message_expose_addresses (message, type);
 }
 
 
@@ -881,7 +972,7 @@ g_mime_message_get_all_recipients (GMimeMessage *message)
 	g_return_val_if_fail (GMIME_IS_MESSAGE (message), NULL);
 	
 	for (i = GMIME_ADDRESS_TYPE_TO; i <= GMIME_ADDRESS_TYPE_BCC; i++) {
-		recipients = message->addrlists[i];
+		recipients = message_ensure_addresses (message, i);
 		
 		if (internet_address_list_length (recipients) == 0)
 			continue;
@@ -931,7 +1022,7 @@ g_mime_message_get_subject (GMimeMessage *message)
 {
 	g_return_val_if_fail (GMIME_IS_MESSAGE (message), NULL);
 	
-	return message->subject;
+	return message_ensure_subject (message);
 }
 
 
@@ -968,7 +1059,7 @@ g_mime_message_get_date (GMimeMessage *message)
 {
 	g_return_val_if_fail (GMIME_IS_MESSAGE (message), NULL);
 	
-	return message->date;
+	return message_ensure_date (message);
 }
 
 
@@ -1006,7 +1097,7 @@ g_mime_message_get_message_id (GMimeMessage *message)
 {
 	g_return_val_if_fail (GMIME_IS_MESSAGE (message), NULL);
 	
-	return message->message_id;
+	return message_ensure_message_id (message);
 }
 
 
@@ -1223,12 +1314,12 @@ g_mime_message_get_autocrypt_header (GMimeMessage *message, GDateTime *now)
 	if (now == NULL)
 		now = newnow = g_date_time_new_now_utc ();
 	effective_date = now;
-	if (message->date && g_date_time_compare (message->date, now) < 0)
+	if (message_ensure_date (message) && g_date_time_compare (message->date, now) < 0)
 		effective_date = message->date;
 	retlist = g_mime_object_get_autocrypt_headers (GMIME_OBJECT (message),
 						       effective_date,
 						       "autocrypt",
-						       message->addrlists[GMIME_ADDRESS_TYPE_FROM],
+						       message_ensure_addresses (message, GMIME_ADDRESS_TYPE_FROM),
 						       TRUE);
 	if (newnow)
 		g_date_time_unref (newnow);
@@ -1302,7 +1393,7 @@ g_mime_message_get_autocrypt_gossip_headers_from_inner_part (GMimeMessage *messa
 	if (now == NULL)
 		now = newnow = g_date_time_new_now_utc ();
 	effective_date = now;
-	if (message->date && g_date_time_compare (message->date, now) < 0)
+	if (message_ensure_date (message) && g_date_time_compare (message->date, now) < 0)
 		effective_date = message->date;
 	ret = g_mime_object_get_autocrypt_headers (inner_part,
 						   effective_date,
@@ -67,30 +67,40 @@ typedef enum _GMimeAddressType {
 } GMimeAddressType;
 
 
+/* these fields are decoded from the headers on demand, so direct
+ * access from outside of GMime itself is deprecated */
+#ifdef GMIME_COMPILATION
+#define GMIME_DEPRECATED_FIELD
+#else
+#define GMIME_DEPRECATED_FIELD G_GNUC_DEPRECATED
+#endif
+
 /**
  * GMimeMessage:
  * @parent_object: parent #GMimeObject
- * @addrlists: a table of address lists
+ * @addrlists: a table of address lists (deprecated: use g_mime_message_get_addresses() instead)
  * @mime_part: toplevel MIME part
- * @message_id: Message-Id string
- * @date: Date value
- * @subject: Subject string
+ * @message_id: Message-Id string (deprecated: use g_mime_message_get_message_id() instead)
+ * @date: Date value (deprecated: use g_mime_message_get_date() instead)
+ * @subject: Subject string (deprecated: use g_mime_message_get_subject() instead)
  *
  * A MIME Message object.
  **/
 struct _GMimeMessage {
 	GMimeObject parent_object;
 	
-	InternetAddressList **addrlists;
+	InternetAddressList **addrlists GMIME_DEPRECATED_FIELD;
 	GMimeObject *mime_part;
-	char *message_id;
-	GDateTime *date;
-	char *subject;
+	char *message_id GMIME_DEPRECATED_FIELD;
+	GDateTime *date GMIME_DEPRECATED_FIELD;
+	char *subject GMIME_DEPRECATED_FIELD;
 	
 	/* <private> */
 	char *marker;
 };
 
+#undef GMIME_DEPRECATED_FIELD
+
 struct _GMimeMessageClass {
 	GMimeObjectClass parent_class;
 	
@@ -353,33 +353,10 @@ check_protocol_supported (const char *protocol, const char *supported)
 }
 
 
-/**
- * g_mime_multipart_signed_verify:
- * @mps: a #GMimeMultipartSigned
- * @flags: a #GMimeVerifyFlags
- * @err: a #GError
- *
- * Attempts to verify the signed MIME part contained within the
- * multipart/signed object @mps.
- *
- * Returns: (nullable) (transfer full): a new #GMimeSignatureList object on
- * success or %NULL on fail. If the verification fails, an exception
- * will be set on @err to provide information as to why the failure
- * occurred.
- **/
-GMimeSignatureList *
-g_mime_multipart_signed_verify (GMimeMultipartSigned *mps, GMimeVerifyFlags flags, GError **err)
+static const char *
+multipart_signed_get_protocol (GMimeMultipartSigned *mps, GError **err)
 {
-	const char *supported, *protocol;
-	GMimeObject *content, *signature;
-	GMimeStream *stream, *sigstream;
-	GMimeSignatureList *signatures;
-	GMimeFormatOptions *options;
-	GMimeDataWrapper *wrapper;
-	GMimeCryptoContext *ctx;
-	char *mime_type;
-	
-	g_return_val_if_fail (GMIME_IS_MULTIPART_SIGNED (mps), NULL);
+	const char *protocol;
 	
 	if (g_mime_multipart_get_count ((GMimeMultipart *) mps) < 2) {
 		g_set_error_literal (err, GMIME_ERROR, GMIME_ERROR_PARSE_ERROR,
@@ -394,13 +371,20 @@ g_mime_multipart_signed_verify (GMimeMultipartSigned *mps, GMimeVerifyFlags flag
 		return NULL;
 	}
 	
-	if (!(ctx = g_mime_crypto_context_new (protocol))) {
-		g_set_error (err, GMIME_ERROR, GMIME_ERROR_PROTOCOL_ERROR,
-			     _("Cannot verify multipart/signed part: unregistered signature protocol '%s'."),
-			     protocol);
-		
-		return NULL;
-	}
+	return protocol;
+}
+
+static GMimeSignatureList *
+multipart_signed_verify (GMimeMultipartSigned *mps, GMimeCryptoContext *ctx, const char *protocol,
+			 GMimeVerifyFlags flags, GError **err)
+{
+	GMimeObject *content, *signature;
+	GMimeStream *stream, *sigstream, *splice;
+	GMimeSignatureList *signatures;
+	GMimeFormatOptions *options;
+	GMimeDataWrapper *wrapper;
+	const char *supported;
+	char *mime_type;
 	
 	supported = g_mime_crypto_context_get_signature_protocol (ctx);
 	
@@ -409,7 +393,6 @@ g_mime_multipart_signed_verify (GMimeMultipartSigned *mps, GMimeVerifyFlags flag
 		g_set_error (err, GMIME_ERROR, GMIME_ERROR_PROTOCOL_ERROR,
 			     _("Cannot verify multipart/signed part: unsupported signature protocol '%s'."),
 			     protocol);
-		g_object_unref (ctx);
 		
 		return NULL;
 	}
@@ -421,7 +404,6 @@ g_mime_multipart_signed_verify (GMimeMultipartSigned *mps, GMimeVerifyFlags flag
 	if (g_ascii_strcasecmp (mime_type, protocol) != 0) {
 		g_set_error_literal (err, GMIME_ERROR, GMIME_ERROR_PARSE_ERROR,
 				     _("Cannot verify multipart/signed part: signature content-type does not match protocol."));
-		g_object_unref (ctx);
 		g_free (mime_type);
 		
 		return NULL;
@@ -430,16 +412,20 @@ g_mime_multipart_signed_verify (GMimeMultipartSigned *mps, GMimeVerifyFlags flag
 	
 	content = g_mime_multipart_get_part ((GMimeMultipart *) mps, GMIME_MULTIPART_SIGNED_CONTENT);
 	
-	/* get the content stream */
-	stream = g_mime_stream_mem_new ();
+	/* get the content stream; the content of each leaf part is spliced
+	 * in by reference and canonicalized as it gets read rather than
+	 * being copied into memory up front */
+	splice = _g_mime_stream_cat_splice_new ();
 	
 	/* Note: see rfc2015 or rfc3156, section 5.1 */
 	options = _g_mime_format_options_clone (NULL, FALSE);
 	g_mime_format_options_set_newline_format (options, GMIME_NEWLINE_FORMAT_DOS);
 	
-	g_mime_object_write_to_stream (content, options, stream);
+	g_mime_object_write_to_stream (content, options, splice);
 	g_mime_format_options_free (options);
-	g_mime_stream_reset (stream);
+	
+	stream = _g_mime_stream_cat_splice_finish (splice);
+	g_object_unref (splice);
 	
 	/* get the signature stream */
 	wrapper = g_mime_part_get_content ((GMimePart *) signature);
@@ -451,12 +437,174 @@ g_mime_multipart_signed_verify (GMimeMultipartSigned *mps, GMimeVerifyFlags flag
 	/* verify the signature */
 	signatures = g_mime_crypto_context_verify (ctx, flags, stream, sigstream, NULL, err);
 	
-	d(printf ("attempted to verify:\n----- BEGIN SIGNED PART -----\n%.*s----- END SIGNED PART -----\n",
-		  (int) GMIME_STREAM_MEM (stream)->buffer->len, GMIME_STREAM_MEM (stream)->buffer->data));
-	
 	g_object_unref (sigstream);
 	g_object_unref (stream);
-	g_object_unref (ctx);
 	
 	return signatures;
 }
+
+
+/**
+ * g_mime_multipart_signed_verify:
+ * @mps: a #GMimeMultipartSigned
+ * @flags: a #GMimeVerifyFlags
+ * @err: a #GError
+ *
+ * Attempts to verify the signed MIME part contained within the
+ * multipart/signed object @mps.
+ *
+ * Returns: (nullable) (transfer full): a new #GMimeSignatureList object on
+ * success or %NULL on fail. If the verification fails, an exception
+ * will be set on @err to provide information as to why the failure
+ * occurred.
+ **/
+GMimeSignatureList *
+g_mime_multipart_signed_verify (GMimeMultipartSigned *mps, GMimeVerifyFlags flags, GError **err)
+{
+	GMimeSignatureList *signatures;
+	GMimeCryptoContext *ctx;
+	const char *protocol;
+	
+	g_return_val_if_fail (GMIME_IS_MULTIPART_SIGNED (mps), NULL);
+	
+	if (!(protocol = multipart_signed_get_protocol (mps, err)))
+		return NULL;
+	
+	if (!(ctx = _g_mime_crypto_context_acquire (protocol))) {
+		g_set_error (err, GMIME_ERROR, GMIME_ERROR_PROTOCOL_ERROR,
+			     _("Cannot verify multipart/signed part: unregistered signature protocol '%s'."),
+			     protocol);
+		
+		return NULL;
+	}
+	
+	signatures = multipart_signed_verify (mps, ctx, protocol, flags, err);
+	_g_mime_crypto_context_release (protocol, ctx);
+	
+	return signatures;
+}
+
+
+/**
+ * g_mime_multipart_signed_verify_with_context:
+ * @mps: a #GMimeMultipartSigned
+ * @ctx: a #GMimeCryptoContext
+ * @flags: a #GMimeVerifyFlags
+ * @err: a #GError
+ *
+ * Attempts to verify the signed MIME part contained within the
+ * multipart/signed object @mps using the supplied crypto context
+ * rather than creating a new one for the signature protocol.
+ *
+ * Returns: (nullable) (transfer full): a new #GMimeSignatureList object on
+ * success or %NULL on fail. If the verification fails, an exception
+ * will be set on @err to provide information as to why the failure
+ * occurred.
+ **/
+GMimeSignatureList *
+g_mime_multipart_signed_verify_with_context (GMimeMultipartSigned *mps, GMimeCryptoContext *ctx,
+					     GMimeVerifyFlags flags, GError **err)
+{
+	const char *protocol;
+	
+	g_return_val_if_fail (GMIME_IS_MULTIPART_SIGNED (mps), NULL);
+	g_return_val_if_fail (GMIME_IS_CRYPTO_CONTEXT (ctx), NULL);
+	
+	if (!(protocol = multipart_signed_get_protocol (mps, err)))
+		return NULL;
+	
+	return multipart_signed_verify (mps, ctx, protocol, flags, err);
+}
+
+
+static void
+free_nullable_object (gpointer object)
+{
+	if (object != NULL)
+		g_object_unref (object);
+}
+
+static void
+free_nullable_error (gpointer error)
+{
+	if (error != NULL)
+		g_error_free (error);
+}
+
+/**
+ * g_mime_multipart_signed_verify_batch:
+ * @parts: (element-type GMimeMultipartSigned): an array of #GMimeMultipartSigned parts
+ * @flags: a #GMimeVerifyFlags
+ * @errors: (out) (optional) (element-type GError): an array of errors
+ *
+ * Verifies each of the multipart/signed @parts, reusing one crypto
+ * context for all of the parts that share a signature protocol. This
+ * is considerably cheaper than calling g_mime_multipart_signed_verify()
+ * on each part when there are many of them.
+ *
+ * If @errors is not %NULL, it will be set to a new array holding
+ * the #GError for each part that could not be verified (or %NULL for
+ * each part that could), in the same order as @parts.
+ *
+ * Returns: (transfer full) (element-type GMimeSignatureList): a new
+ * array holding the #GMimeSignatureList for each part, or %NULL for
+ * each part that could not be verified, in the same order as @parts.
+ **/
+GPtrArray *
+g_mime_multipart_signed_verify_batch (GPtrArray *parts, GMimeVerifyFlags flags, GPtrArray **errors)
+{
+	GMimeSignatureList *signatures;
+	const char *protocol, *active = NULL;
+	GMimeCryptoContext *ctx = NULL;
+	GMimeMultipartSigned *mps;
+	GPtrArray *results;
+	GError *err;
+	guint i;
+	
+	g_return_val_if_fail (parts != NULL, NULL);
+	
+	results = g_ptr_array_new_full (parts->len, free_nullable_object);
+	if (errors != NULL)
+		*errors = g_ptr_array_new_full (parts->len, free_nullable_error);
+	
+	for (i = 0; i < parts->len; i++) {
+		mps = parts->pdata[i];
+		signatures = NULL;
+		err = NULL;
+		
+		if (!GMIME_IS_MULTIPART_SIGNED (mps)) {
+			g_set_error_literal (&err, GMIME_ERROR, GMIME_ERROR_INVALID_OPERATION,
+					     _("Cannot verify a part that is not a multipart/signed."));
+		} else if ((protocol = multipart_signed_get_protocol (mps, &err)) != NULL) {
+			/* the parts in a batch almost always share a protocol, so
+			 * hold on to the context until the protocol changes */
+			if (ctx == NULL || g_ascii_strcasecmp (protocol, active) != 0) {
+				if (ctx != NULL)
+					_g_mime_crypto_context_release (active, ctx);
+				
+				ctx = _g_mime_crypto_context_acquire (protocol);
+				active = protocol;
+			}
+			
+			if (ctx == NULL) {
+				g_set_error (&err, GMIME_ERROR, GMIME_ERROR_PROTOCOL_ERROR,
+					     _("Cannot verify multipart/signed part: unregistered signature protocol '%s'."),
+					     protocol);
+			} else {
+				signatures = multipart_signed_verify (mps, ctx, protocol, flags, &err);
+			}
+		}
+		
+		g_ptr_array_add (results, signatures);
+		
+		if (errors != NULL)
+			g_ptr_array_add (*errors, err);
+		else if (err != NULL)
+			g_error_free (err);
+	}
+	
+	if (ctx != NULL)
+		_g_mime_crypto_context_release (active, ctx);
+	
+	return results;
+}
@@ -68,6 +68,9 @@ GMimeMultipartSigned *g_mime_multipart_signed_sign (GMimeCryptoContext *ctx, GMi
 						    const char *userid, GError **err);
 
 GMimeSignatureList *g_mime_multipart_signed_verify (GMimeMultipartSigned *mps, GMimeVerifyFlags flags, GError **err);
+GMimeSignatureList *g_mime_multipart_signed_verify_with_context (GMimeMultipartSigned *mps, GMimeCryptoContext *ctx,
+								 GMimeVerifyFlags flags, GError **err);
+GPtrArray *g_mime_multipart_signed_verify_batch (GPtrArray *parts, GMimeVerifyFlags flags, GPtrArray **errors);
 
 G_END_DECLS
 
@@ -147,16 +147,24 @@ g_mime_multipart_finalize (GObject *object)
 	G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+#define vector_append(vector, n, str) G_STMT_START {	\
+	vector[n].data = (char *) (str);		\
+	vector[n].len = strlen (str);			\
+	n++;						\
+} G_STMT_END
+
 static ssize_t
 multipart_write_to_stream (GMimeObject *object, GMimeFormatOptions *options, gboolean content_only, GMimeStream *stream)
 {
 	GMimeMultipart *multipart = (GMimeMultipart *) object;
 	const char *boundary, *newline;
+	gboolean newline_pending = FALSE;
+	GMimeStreamIOVector vector[5];
 	ssize_t nwritten, total = 0;
 	GMimeFormatOptions *format;
 	gboolean is_signed;
 	GMimeObject *part;
-	guint i;
+	guint i, n;
 	
 	boundary = g_mime_object_get_content_type_parameter (object, "boundary");
 	newline = g_mime_format_options_get_newline (options);
@@ -199,8 +207,15 @@ multipart_write_to_stream (GMimeObject *object, GMimeFormatOptions *options, gbo
 	for (i = 0; i < multipart->children->len; i++) {
 		part = multipart->children->pdata[i];
 		
-		/* write the boundary */
-		if ((nwritten = g_mime_stream_printf (stream, "--%s%s", boundary, newline)) == -1) {
+		/* write the boundary, along with the newline ending the previous part */
+		n = 0;
+		if (newline_pending)
+			vector_append (vector, n, newline);
+		vector_append (vector, n, "--");
+		vector_append (vector, n, boundary ? boundary : "");
+		vector_append (vector, n, newline);
+		
+		if ((nwritten = g_mime_stream_writev (stream, vector, n)) == -1) {
 			if (is_signed)
 				g_mime_format_options_free (format);
 			return -1;
@@ -217,28 +232,29 @@ multipart_write_to_stream (GMimeObject *object, GMimeFormatOptions *options, gbo
 		
 		total += nwritten;
 		
-		if (!GMIME_IS_MULTIPART (part) || ((GMimeMultipart *) part)->write_end_boundary) {
-			if ((nwritten = g_mime_stream_write_string (stream, newline)) == -1) {
-				if (is_signed)
-					g_mime_format_options_free (format);
-				return -1;
-			}
-			
-			total += nwritten;
-		}
+		newline_pending = !GMIME_IS_MULTIPART (part) || ((GMimeMultipart *) part)->write_end_boundary;
 	}
 	
 	if (is_signed)
 		g_mime_format_options_free (format);
 	
 	/* write the end-boundary (but only if a boundary is set) */
+	n = 0;
+	if (newline_pending)
+		vector_append (vector, n, newline);
+	
 	if (multipart->write_end_boundary && boundary) {
-		if ((nwritten = g_mime_stream_printf (stream, "--%s--%s", boundary, newline)) == -1)
-			return -1;
-		
-		total += nwritten;
+		vector_append (vector, n, "--");
+		vector_append (vector, n, boundary);
+		vector_append (vector, n, "--");
+		vector_append (vector, n, newline);
 	}
 	
+	if ((nwritten = g_mime_stream_writev (stream, vector, n)) == -1)
+		return -1;
+	
+	total += nwritten;
+	
 	/* write the epilogue */
 	if (multipart->epilogue) {
 		if ((nwritten = g_mime_stream_write_string (stream, multipart->epilogue)) == -1)
@@ -77,7 +77,22 @@ static void content_type_changed (GMimeContentType *content_type, gpointer args,
 static void content_disposition_changed (GMimeContentDisposition *disposition, gpointer args, GMimeObject *object);
 
 
+/* The type registry is consulted for every MIME part that gets parsed,
+ * so lookups must not take a lock. Instead, registering a type builds
+ * a new copy of the registry and swaps it in. The copies that have
+ * been replaced may still be in use by other threads, so they are kept
+ * around until g_mime_object_type_registry_shutdown(). */
 static GHashTable *type_hash = NULL;
+static GSList *retired_type_hashes = NULL;
+
+#ifdef G_THREADS_ENABLED
+static GMutex registry_lock;
+#define REGISTRY_UNLOCK() g_mutex_unlock (&registry_lock);
+#define REGISTRY_LOCK() g_mutex_lock (&registry_lock);
+#else
+#define REGISTRY_UNLOCK()
+#define REGISTRY_LOCK()
+#endif /* G_THREADS_ENABLED */
 
 static GObjectClass *parent_class = NULL;
 
@@ -172,19 +187,6 @@ g_mime_object_finalize (GObject *object)
 	G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
-enum {
-	HEADER_CONTENT_DISPOSITION,
-	HEADER_CONTENT_TYPE,
-	HEADER_CONTENT_ID,
-	HEADER_UNKNOWN,
-};
-
-static char *content_headers[] = {
-	"Content-Disposition",
-	"Content-Type",
-	"Content-Id",
-};
-
 static void
 object_header_added (GMimeObject *object, GMimeHeader *header)
 {
@@ -198,37 +200,26 @@ object_header_changed (GMimeObject *object, GMimeHeader *header)
 	gboolean can_warn = g_mime_parser_options_get_warning_callback (options) != NULL;
 	GMimeContentDisposition *disposition;
 	GMimeContentType *content_type;
-	const char *name, *value;
-	guint i;
-	
-	name = g_mime_header_get_name (header);
+	const char *value;
 
 	/* validate header if requested, caches the decoded value */
 	if (G_UNLIKELY (can_warn))
 		g_mime_header_get_value (header);
 	
-	if (g_ascii_strncasecmp (name, "Content-", 8) != 0)
-		return;
-	
-	for (i = 0; i < G_N_ELEMENTS (content_headers); i++) {
-		if (!g_ascii_strcasecmp (content_headers[i] + 8, name + 8))
-			break;
-	}
-	
-	switch (i) {
-	case HEADER_CONTENT_DISPOSITION:
+	switch (_g_mime_header_get_id (header)) {
+	case GMIME_HEADER_ID_CONTENT_DISPOSITION:
 		value = g_mime_header_get_value (header);
 		disposition = _g_mime_content_disposition_parse (options, value, header->offset);
 		_g_mime_object_set_content_disposition (object, disposition);
 		g_object_unref (disposition);
 		break;
-	case HEADER_CONTENT_TYPE:
+	case GMIME_HEADER_ID_CONTENT_TYPE:
 		value = g_mime_header_get_value (header);
 		content_type = _g_mime_content_type_parse (options, value, header->offset);
 		_g_mime_object_set_content_type (object, content_type);
 		g_object_unref (content_type);
 		break;
-	case HEADER_CONTENT_ID:
+	case GMIME_HEADER_ID_CONTENT_ID:
 		value = g_mime_header_get_value (header);
 		g_free (object->content_id);
 		object->content_id = g_mime_utils_decode_message_id (value);
@@ -240,21 +231,9 @@ static void
 object_header_removed (GMimeObject *object, GMimeHeader *header)
 {
 	GMimeEvent *event;
-	const char *name;
-	guint i;
-	
-	name = g_mime_header_get_name (header);
-	
-	if (g_ascii_strncasecmp (name, "Content-", 8) != 0)
-		return;
 	
-	for (i = 0; i < G_N_ELEMENTS (content_headers); i++) {
-		if (!g_ascii_strcasecmp (content_headers[i] + 8, name + 8))
-			break;
-	}
-	
-	switch (i) {
-	case HEADER_CONTENT_DISPOSITION:
+	switch (_g_mime_header_get_id (header)) {
+	case GMIME_HEADER_ID_CONTENT_DISPOSITION:
 		if (object->disposition) {
 			event = object->disposition->changed;
 			g_mime_event_remove (event, (GMimeEventCallback) content_disposition_changed, object);
@@ -262,10 +241,10 @@ object_header_removed (GMimeObject *object, GMimeHeader *header)
 			object->disposition = NULL;
 		}
 		break;
-	case HEADER_CONTENT_TYPE:
+	case GMIME_HEADER_ID_CONTENT_TYPE:
 		/* never allow the removal of the Content-Type header */
 		break;
-	case HEADER_CONTENT_ID:
+	case GMIME_HEADER_ID_CONTENT_ID:
 		g_free (object->content_id);
 		object->content_id = NULL;
 		break;
@@ -351,6 +330,44 @@ content_disposition_changed (GMimeContentDisposition *disposition, gpointer args
 }
 
 
+static void
+subtype_bucket_copy (gpointer key, gpointer value, gpointer user_data)
+{
+	struct _subtype_bucket *sub = value, *copy;
+	GHashTable *subtype_hash = user_data;
+	
+	copy = g_new (struct _subtype_bucket, 1);
+	copy->subtype = g_strdup (sub->subtype);
+	copy->object_type = sub->object_type;
+	g_hash_table_insert (subtype_hash, copy->subtype, copy);
+}
+
+static void
+type_bucket_copy (gpointer key, gpointer value, gpointer user_data)
+{
+	struct _type_bucket *bucket = value, *copy;
+	GHashTable *registry = user_data;
+	
+	copy = g_new (struct _type_bucket, 1);
+	copy->type = g_strdup (bucket->type);
+	copy->object_type = bucket->object_type;
+	copy->subtype_hash = g_hash_table_new (g_mime_strcase_hash, g_mime_strcase_equal);
+	g_hash_table_foreach (bucket->subtype_hash, subtype_bucket_copy, copy->subtype_hash);
+	g_hash_table_insert (registry, copy->type, copy);
+}
+
+static GHashTable *
+type_hash_copy (GHashTable *registry)
+{
+	GHashTable *copy;
+	
+	copy = g_hash_table_new (g_mime_strcase_hash, g_mime_strcase_equal);
+	g_hash_table_foreach (registry, type_bucket_copy, copy);
+	
+	return copy;
+}
+
+
 /**
  * g_mime_object_register_type:
  * @type: mime type
@@ -362,29 +379,78 @@ content_disposition_changed (GMimeContentDisposition *disposition, gpointer args
  *
  * Note: You may use the wildcard "*" to match any type and/or
  * subtype.
+ *
+ * This function is thread-safe, but it is relatively expensive, so
+ * types should be registered once at startup rather than on demand.
  **/
 void
 g_mime_object_register_type (const char *type, const char *subtype, GType object_type)
 {
 	struct _type_bucket *bucket;
 	struct _subtype_bucket *sub;
+	GHashTable *registry;
 	
 	g_return_if_fail (object_type != 0);
 	g_return_if_fail (subtype != NULL);
 	g_return_if_fail (type != NULL);
 	
-	if (!(bucket = g_hash_table_lookup (type_hash, type))) {
+	REGISTRY_LOCK ();
+	
+	/* nobody else can see the copy until we publish it */
+	registry = type_hash_copy (type_hash);
+	
+	if (!(bucket = g_hash_table_lookup (registry, type))) {
 		bucket = g_new (struct _type_bucket, 1);
 		bucket->type = g_strdup (type);
 		bucket->object_type = *type == '*' ? object_type : 0;
 		bucket->subtype_hash = g_hash_table_new (g_mime_strcase_hash, g_mime_strcase_equal);
-		g_hash_table_insert (type_hash, bucket->type, bucket);
+		g_hash_table_insert (registry, bucket->type, bucket);
+	}
+	
+	if (!(sub = g_hash_table_lookup (bucket->subtype_hash, subtype))) {
+		sub = g_new (struct _subtype_bucket, 1);
+		sub->subtype = g_strdup (subtype);
+		g_hash_table_insert (bucket->subtype_hash, sub->subtype, sub);
 	}
 	
-	sub = g_new (struct _subtype_bucket, 1);
-	sub->subtype = g_strdup (subtype);
 	sub->object_type = object_type;
-	g_hash_table_insert (bucket->subtype_hash, sub->subtype, sub);
+	
+	retired_type_hashes = g_slist_prepend (retired_type_hashes, type_hash);
+	g_atomic_pointer_set (&type_hash, registry);
+	
+	REGISTRY_UNLOCK ();
+}
+
+
+static GType
+object_type_lookup (const char *type, const char *subtype)
+{
+	struct _type_bucket *bucket;
+	struct _subtype_bucket *sub;
+	GHashTable *registry;
+	GType obj_type;
+	
+	registry = g_atomic_pointer_get (&type_hash);
+	
+	if ((bucket = g_hash_table_lookup (registry, type))) {
+		if (!(sub = g_hash_table_lookup (bucket->subtype_hash, subtype)))
+			sub = g_hash_table_lookup (bucket->subtype_hash, "*");
+		
+		obj_type = sub ? sub->object_type : 0;
+	} else {
+		bucket = g_hash_table_lookup (registry, "*");
+		obj_type = bucket ? bucket->object_type : 0;
+	}
+	
+	if (!obj_type) {
+		/* use the default mime object */
+		if ((bucket = g_hash_table_lookup (registry, "*"))) {
+			sub = g_hash_table_lookup (bucket->subtype_hash, "*");
+			obj_type = sub ? sub->object_type : 0;
+		}
+	}
+	
+	return obj_type;
 }
 
 
@@ -407,33 +473,13 @@ g_mime_object_register_type (const char *type, const char *subtype, GType object
 GMimeObject *
 g_mime_object_new (GMimeParserOptions *options, GMimeContentType *content_type)
 {
-	struct _type_bucket *bucket;
-	struct _subtype_bucket *sub;
 	GMimeObject *object;
 	GType obj_type;
 	
 	g_return_val_if_fail (GMIME_IS_CONTENT_TYPE (content_type), NULL);
 	
-	if ((bucket = g_hash_table_lookup (type_hash, content_type->type))) {
-		if (!(sub = g_hash_table_lookup (bucket->subtype_hash, content_type->subtype)))
-			sub = g_hash_table_lookup (bucket->subtype_hash, "*");
-		
-		obj_type = sub ? sub->object_type : 0;
-	} else {
-		bucket = g_hash_table_lookup (type_hash, "*");
-		obj_type = bucket ? bucket->object_type : 0;
-	}
-	
-	if (!obj_type) {
-		/* use the default mime object */
-		if ((bucket = g_hash_table_lookup (type_hash, "*"))) {
-			sub = g_hash_table_lookup (bucket->subtype_hash, "*");
-			obj_type = sub ? sub->object_type : 0;
-		}
-		
-		if (!obj_type)
-			return NULL;
-	}
+	if (!(obj_type = object_type_lookup (content_type->type, content_type->subtype)))
+		return NULL;
 	
 	object = g_object_new (obj_type, NULL);
 	_g_mime_header_list_set_options (object->headers, options);
@@ -463,33 +509,13 @@ g_mime_object_new (GMimeParserOptions *options, GMimeContentType *content_type)
 GMimeObject *
 g_mime_object_new_type (GMimeParserOptions *options, const char *type, const char *subtype)
 {
-	struct _type_bucket *bucket;
-	struct _subtype_bucket *sub;
 	GMimeObject *object;
 	GType obj_type;
 	
 	g_return_val_if_fail (type != NULL, NULL);
 	
-	if ((bucket = g_hash_table_lookup (type_hash, type))) {
-		if (!(sub = g_hash_table_lookup (bucket->subtype_hash, subtype)))
-			sub = g_hash_table_lookup (bucket->subtype_hash, "*");
-		
-		obj_type = sub ? sub->object_type : 0;
-	} else {
-		bucket = g_hash_table_lookup (type_hash, "*");
-		obj_type = bucket ? bucket->object_type : 0;
-	}
-	
-	if (!obj_type) {
-		/* use the default mime object */
-		if ((bucket = g_hash_table_lookup (type_hash, "*"))) {
-			sub = g_hash_table_lookup (bucket->subtype_hash, "*");
-			obj_type = sub ? sub->object_type : 0;
-		}
-		
-		if (!obj_type)
-			return NULL;
-	}
+	if (!(obj_type = object_type_lookup (type, subtype)))
+		return NULL;
 	
 	object = g_object_new (obj_type, NULL);
 	_g_mime_header_list_set_options (object->headers, options);
@@ -846,10 +872,10 @@ g_mime_object_prepend_header (GMimeObject *object, const char *header, const cha
 
 
 void
-_g_mime_object_append_header (GMimeObject *object, const char *header, const char *raw_name,
-			      const char *raw_value, gint64 offset)
+_g_mime_object_append_header (GMimeObject *object, GMimeArena *arena, const char *header,
+			      const char *raw_name, const char *raw_value, gint64 offset)
 {
-	_g_mime_header_list_append (object->headers, header, raw_name, raw_value, offset);
+	_g_mime_header_list_append (object->headers, arena, header, raw_name, raw_value, offset);
 }
 
 
@@ -1090,11 +1116,20 @@ type_bucket_foreach (gpointer key, gpointer value, gpointer user_data)
 	g_free (bucket);
 }
 
+static void
+type_hash_free (GHashTable *registry)
+{
+	g_hash_table_foreach (registry, type_bucket_foreach, NULL);
+	g_hash_table_destroy (registry);
+}
+
 void
 g_mime_object_type_registry_shutdown (void)
 {
-	g_hash_table_foreach (type_hash, type_bucket_foreach, NULL);
-	g_hash_table_destroy (type_hash);
+	g_slist_free_full (retired_type_hashes, (GDestroyNotify) type_hash_free);
+	retired_type_hashes = NULL;
+	
+	type_hash_free (type_hash);
 	type_hash = NULL;
 }
 
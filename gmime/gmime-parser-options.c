@@ -39,6 +39,13 @@ static char *default_charsets[3] = { "utf-8", "iso-8859-1", NULL };
  *
  * A #GMimeParserOptions is used to pass various options to #GMimeParser
  * and all of the various other parser functions in GMime.
+ *
+ * Parser options are not locked. A set of options that is in use by
+ * more than one thread must be frozen with g_mime_parser_options_freeze()
+ * first, after which it can no longer be changed. The same goes for the
+ * default options returned by g_mime_parser_options_get_default():
+ * change them before any other thread starts using them, or use
+ * g_mime_parser_options_clone() to get a private copy.
  **/
 
 
@@ -50,6 +57,7 @@ struct _GMimeParserOptions {
 	char **charsets;
 	GMimeParserWarningFunc warning_cb;
 	gpointer warning_user_data;
+	gboolean frozen;
 };
 
 static GMimeParserOptions *default_options = NULL;
@@ -97,6 +105,10 @@ _g_mime_parser_options_warn (GMimeParserOptions *options, gint64 offset, guint e
  *
  * Gets the default parser options.
  *
+ * Note: The default options are shared by every thread. They must not
+ * be changed while other threads may be using them; use
+ * g_mime_parser_options_clone() to get a copy that can be modified.
+ *
  * Returns: the default parser options.
  **/
 GMimeParserOptions *
@@ -131,7 +143,8 @@ g_mime_parser_options_new (void)
 	
 	options->warning_cb = NULL;
 	options->warning_user_data = NULL;
-
+	options->frozen = FALSE;
+	
 	return options;
 }
 
@@ -169,7 +182,8 @@ g_mime_parser_options_clone (GMimeParserOptions *options)
 	
 	clone->warning_cb = options->warning_cb;
 	clone->warning_user_data = options->warning_user_data;
-
+	clone->frozen = FALSE;
+	
 	return clone;
 }
 
@@ -192,6 +206,43 @@ g_mime_parser_options_free (GMimeParserOptions *options)
 }
 
 
+/**
+ * g_mime_parser_options_freeze:
+ * @options: a #GMimeParserOptions
+ *
+ * Makes @options immutable. Once frozen, any attempt to change the
+ * options is an error, which makes it safe to use the same @options
+ * from multiple threads at once.
+ *
+ * Clones of frozen options are not frozen.
+ **/
+void
+g_mime_parser_options_freeze (GMimeParserOptions *options)
+{
+	g_return_if_fail (options != NULL);
+	
+	options->frozen = TRUE;
+}
+
+
+/**
+ * g_mime_parser_options_is_frozen:
+ * @options: a #GMimeParserOptions
+ *
+ * Gets whether or not @options has been frozen by
+ * g_mime_parser_options_freeze().
+ *
+ * Returns: %TRUE if @options is frozen or %FALSE otherwise.
+ **/
+gboolean
+g_mime_parser_options_is_frozen (GMimeParserOptions *options)
+{
+	g_return_val_if_fail (options != NULL, FALSE);
+	
+	return options->frozen;
+}
+
+
 /**
  * g_mime_parser_options_get_address_compliance_mode:
  * @options: (nullable): a #GMimeParserOptions or %NULL
@@ -230,6 +281,7 @@ void
 g_mime_parser_options_set_address_compliance_mode (GMimeParserOptions *options, GMimeRfcComplianceMode mode)
 {
 	g_return_if_fail (options != NULL);
+	g_return_if_fail (!options->frozen);
 	
 	options->addresses = mode;
 }
@@ -279,6 +331,7 @@ void
 g_mime_parser_options_set_allow_addresses_without_domain (GMimeParserOptions *options, gboolean allow)
 {
 	g_return_if_fail (options != NULL);
+	g_return_if_fail (!options->frozen);
 	
 	options->allow_no_domain = allow;
 }
@@ -324,6 +377,7 @@ void
 g_mime_parser_options_set_parameter_compliance_mode (GMimeParserOptions *options, GMimeRfcComplianceMode mode)
 {
 	g_return_if_fail (options != NULL);
+	g_return_if_fail (!options->frozen);
 	
 	options->parameters = mode;
 }
@@ -367,6 +421,7 @@ void
 g_mime_parser_options_set_rfc2047_compliance_mode (GMimeParserOptions *options, GMimeRfcComplianceMode mode)
 {
 	g_return_if_fail (options != NULL);
+	g_return_if_fail (!options->frozen);
 	
 	options->rfc2047 = mode;
 }
@@ -404,6 +459,7 @@ g_mime_parser_options_set_fallback_charsets (GMimeParserOptions *options, const
 	guint i, n = 0;
 	
 	g_return_if_fail (options != NULL);
+	g_return_if_fail (!options->frozen);
 	
 	g_strfreev (options->charsets);
 	
@@ -447,6 +503,7 @@ void
 g_mime_parser_options_set_warning_callback (GMimeParserOptions *options, GMimeParserWarningFunc warning_cb, gpointer user_data)
 {
 	g_return_if_fail (options != NULL);
+	g_return_if_fail (!options->frozen);
 	
 	options->warning_cb = warning_cb;
 	options->warning_user_data = user_data;
@@ -104,6 +104,9 @@ void g_mime_parser_options_free (GMimeParserOptions *options);
 
 GMimeParserOptions *g_mime_parser_options_clone (GMimeParserOptions *options);
 
+void g_mime_parser_options_freeze (GMimeParserOptions *options);
+gboolean g_mime_parser_options_is_frozen (GMimeParserOptions *options);
+
 GMimeRfcComplianceMode g_mime_parser_options_get_address_compliance_mode (GMimeParserOptions *options);
 void g_mime_parser_options_set_address_compliance_mode (GMimeParserOptions *options, GMimeRfcComplianceMode mode);
 
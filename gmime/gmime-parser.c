@@ -26,17 +26,26 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 #include "gmime-parser.h"
 
 #include "gmime-table-private.h"
 #include "gmime-message-part.h"
 #include "gmime-parse-utils.h"
+#include "gmime-stream-mmap.h"
+#include "gmime-stream-fs.h"
 #include "gmime-stream-null.h"
 #include "gmime-stream-mem.h"
 #include "gmime-multipart.h"
 #include "gmime-internal.h"
 #include "gmime-common.h"
+#include "gmime-simd.h"
 #include "gmime-part.h"
 
 #ifdef ENABLE_WARNINGS
@@ -70,6 +79,15 @@ typedef enum {
 	BOUNDARY_PARENT_END
 } BoundaryType;
 
+typedef struct _boundary_key {
+	struct _boundary_key *shadowed;  /* the next key further out with the same text */
+	struct _boundary_stack *level;
+	const char *text;
+	size_t len;
+	guint hash;
+	gboolean final;
+} BoundaryKey;
+
 typedef struct _boundary_stack {
 	struct _boundary_stack *parent;
 	char *boundary;
@@ -77,12 +95,16 @@ typedef struct _boundary_stack {
 	size_t boundarylenfinal;
 	size_t boundarylenmax;
 	gint64 content_end;
+	BoundaryKey keys[2];             /* the boundary and end-boundary, if indexed */
+	gboolean indexed;
+	guint depth;
 } BoundaryStack;
 
 typedef struct {
 	char *raw_name, *name;
 	char *raw_value;
 	gint64 offset;
+	GMimeHeaderId id;
 } Header;
 
 typedef struct _content_type {
@@ -104,9 +126,15 @@ static GMimeObject *parser_construct_multipart (GMimeParser *parser, GMimeParser
 
 static GObjectClass *parent_class = NULL;
 
-/* size of read buffer */
+/* minimum (and default) size of read buffer */
 #define SCAN_BUF 4096
 
+/* largest read buffer the parser will choose on its own */
+#define SCAN_BUF_AUTO_MAX (64 * 1024)
+
+/* largest read buffer the parser will use at all */
+#define SCAN_BUF_MAX (16 * 1024 * 1024)
+
 /* headroom guaranteed to be before each read buffer */
 #define SCAN_HEAD 128
 
@@ -132,7 +160,9 @@ struct _GMimeParserPrivate {
 	gint64 offset;
 	
 	/* i/o buffers */
-	char realbuf[SCAN_HEAD + SCAN_BUF + 4];
+	size_t buffer_size;
+	size_t scan_buf;
+	char *realbuf;
 	char *inbuf;
 	char *inptr;
 	char *inend;
@@ -158,6 +188,7 @@ struct _GMimeParserPrivate {
 	gint64 header_offset;
 	
 	GPtrArray *headers;
+	GMimeArena *arena;       /* holds the headers of the current message, if enabled */
 	
 	/* header buffer */
 	char *headerbuf;
@@ -165,6 +196,7 @@ struct _GMimeParserPrivate {
 	size_t headerleft;
 	
 	BoundaryStack *bounds;
+	GHashTable *boundaries;  /* BoundaryKey -> innermost BoundaryKey with that text */
 	
 	GMimeOpenPGPState openpgp;
 	short int state;
@@ -174,7 +206,10 @@ struct _GMimeParserPrivate {
 	unsigned short int have_regex:1;
 	unsigned short int persist_stream:1;
 	unsigned short int respect_content_length:1;
-	unsigned short int unused:11;
+	unsigned short int direct:1;
+	unsigned short int lazy_content:1;
+	unsigned short int use_arena:1;
+	unsigned short int unused:8;
 };
 
 static const char MBOX_BOUNDARY[6] = "From ";
@@ -183,16 +218,54 @@ static const char MBOX_BOUNDARY[6] = "From ";
 static const char MMDF_BOUNDARY[6] = "\1\1\1\1";
 #define MMDF_BOUNDARY_LEN 4
 
+/* FNV-1a, one byte at a time so that a hash can be extended as the
+ * text gets longer */
+#define BOUNDARY_HASH_INIT 2166136261U
+#define boundary_hash_step(hash, c) (((hash) ^ (unsigned char) (c)) * 16777619U)
+
+static guint
+boundary_key_hash (gconstpointer key)
+{
+	return ((const BoundaryKey *) key)->hash;
+}
+
+static gboolean
+boundary_key_equal (gconstpointer a, gconstpointer b)
+{
+	const BoundaryKey *ka = a, *kb = b;
+	
+	return ka->len == kb->len && !memcmp (ka->text, kb->text, ka->len);
+}
+
+static void
+boundary_key_init (BoundaryKey *key, BoundaryStack *level, const char *text, size_t len, gboolean final)
+{
+	guint hash = BOUNDARY_HASH_INIT;
+	size_t i;
+	
+	for (i = 0; i < len; i++)
+		hash = boundary_hash_step (hash, text[i]);
+	
+	key->shadowed = NULL;
+	key->level = level;
+	key->text = text;
+	key->len = len;
+	key->hash = hash;
+	key->final = final;
+}
+
 static void
 parser_push_boundary (GMimeParser *parser, const char *boundary)
 {
 	struct _GMimeParserPrivate *priv = parser->priv;
 	BoundaryStack *s;
 	size_t max;
+	int i;
 	
 	max = priv->bounds ? priv->bounds->boundarylenmax : 0;
 	
 	s = g_slice_new (BoundaryStack);
+	s->depth = priv->bounds ? priv->bounds->depth + 1 : 0;
 	s->parent = priv->bounds;
 	priv->bounds = s;
 	
@@ -200,14 +273,27 @@ parser_push_boundary (GMimeParser *parser, const char *boundary)
 		s->boundary = g_strdup (boundary);
 		s->boundarylen = MBOX_BOUNDARY_LEN;
 		s->boundarylenfinal = MBOX_BOUNDARY_LEN;
+		s->indexed = FALSE;
 	} else if (boundary == MMDF_BOUNDARY) {
 		s->boundary = g_strdup (boundary);
 		s->boundarylen = MMDF_BOUNDARY_LEN;
 		s->boundarylenfinal = MMDF_BOUNDARY_LEN;
+		s->indexed = FALSE;
 	} else {
 		s->boundary = g_strdup_printf ("--%s--", boundary);
 		s->boundarylen = strlen (boundary) + 2;
 		s->boundarylenfinal = s->boundarylen + 2;
+		s->indexed = TRUE;
+		
+		/* index both forms of the boundary so that check_boundary() can
+		 * find the level a line belongs to without walking the stack */
+		boundary_key_init (&s->keys[0], s, s->boundary, s->boundarylen, FALSE);
+		boundary_key_init (&s->keys[1], s, s->boundary, s->boundarylenfinal, TRUE);
+		
+		for (i = 0; i < 2; i++) {
+			s->keys[i].shadowed = g_hash_table_lookup (priv->boundaries, &s->keys[i]);
+			g_hash_table_replace (priv->boundaries, &s->keys[i], &s->keys[i]);
+		}
 	}
 	
 	s->boundarylenmax = MAX (s->boundarylenfinal, max);
@@ -220,6 +306,7 @@ parser_pop_boundary (GMimeParser *parser)
 {
 	struct _GMimeParserPrivate *priv = parser->priv;
 	BoundaryStack *s;
+	int i;
 	
 	if (!priv->bounds) {
 		d(g_warning ("boundary stack underflow"));
@@ -229,13 +316,22 @@ parser_pop_boundary (GMimeParser *parser)
 	s = priv->bounds;
 	priv->bounds = priv->bounds->parent;
 	
+	if (s->indexed) {
+		for (i = 1; i >= 0; i--) {
+			if (s->keys[i].shadowed)
+				g_hash_table_replace (priv->boundaries, s->keys[i].shadowed, s->keys[i].shadowed);
+			else
+				g_hash_table_remove (priv->boundaries, &s->keys[i]);
+		}
+	}
+	
 	g_free (s->boundary);
 	
 	g_slice_free (BoundaryStack, s);
 }
 
 static const char *
-parser_find_header (GMimeParser *parser, const char *name, gint64 *offset)
+parser_find_header (GMimeParser *parser, GMimeHeaderId id, gint64 *offset)
 {
 	struct _GMimeParserPrivate *priv = parser->priv;
 	Header *header;
@@ -244,7 +340,7 @@ parser_find_header (GMimeParser *parser, const char *name, gint64 *offset)
 	for (i = priv->headers->len; i > 0; i--) {
 		header = priv->headers->pdata[i - 1];
 		
-		if (g_ascii_strcasecmp (header->name, name) != 0)
+		if (header->id != id)
 			continue;
 		
 		if (offset)
@@ -265,7 +361,8 @@ parser_free_headers (struct _GMimeParserPrivate *priv)
 	g_free (priv->preheader);
 	priv->preheader = NULL;
 	
-	for (i = 0; i < priv->headers->len; i++) {
+	/* the arena owns the headers (see parser_arena_begin()) */
+	for (i = 0; priv->arena == NULL && i < priv->headers->len; i++) {
 		header = priv->headers->pdata[i];
 		
 		g_free (header->name);
@@ -277,6 +374,29 @@ parser_free_headers (struct _GMimeParserPrivate *priv)
 	g_ptr_array_set_size (priv->headers, 0);
 }
 
+/* When enabled, each message gets an arena of its own for its Header
+ * records and strings; the GMimeHeaders created from them adopt the
+ * strings and keep the arena alive, so it gets released in one go
+ * once the message and all of its headers are gone.
+ *
+ * All of the Headers in priv->headers must come from the same place,
+ * so the arena only ever gets swapped while there are none pending. */
+static void
+parser_arena_begin (struct _GMimeParserPrivate *priv)
+{
+	if (priv->use_arena && priv->arena == NULL && priv->headers->len == 0)
+		priv->arena = g_mime_arena_new ();
+}
+
+static void
+parser_arena_end (struct _GMimeParserPrivate *priv)
+{
+	if (priv->arena != NULL && priv->headers->len == 0) {
+		g_mime_arena_unref (priv->arena);
+		priv->arena = NULL;
+	}
+}
+
 GType
 g_mime_parser_get_type (void)
 {
@@ -319,8 +439,14 @@ g_mime_parser_init (GMimeParser *parser, GMimeParserClass *klass)
 	parser->priv->respect_content_length = FALSE;
 	parser->priv->format = GMIME_FORMAT_MESSAGE;
 	parser->priv->persist_stream = TRUE;
+	parser->priv->lazy_content = FALSE;
+	parser->priv->use_arena = FALSE;
 	parser->priv->have_regex = FALSE;
 	parser->priv->regex = NULL;
+	parser->priv->buffer_size = 0;
+	parser->priv->scan_buf = 0;
+	parser->priv->realbuf = NULL;
+	parser->priv->boundaries = g_hash_table_new (boundary_key_hash, boundary_key_equal);
 	
 	parser_init (parser, NULL);
 }
@@ -335,29 +461,65 @@ g_mime_parser_finalize (GObject *object)
 	if (parser->priv->regex)
 		g_regex_unref (parser->priv->regex);
 	
+	g_hash_table_destroy (parser->priv->boundaries);
+	g_free (parser->priv->realbuf);
 	g_free (parser->priv);
 	
 	G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 
+static size_t
+parser_choose_scan_buf (struct _GMimeParserPrivate *priv, GMimeStream *stream)
+{
+	size_t size = SCAN_BUF;
+	gint64 length;
+	
+	if (priv->buffer_size != 0)
+		return priv->buffer_size;
+	
+	if (stream == NULL)
+		return SCAN_BUF;
+	
+	/* don't allocate more than we'll ever be able to fill */
+	if ((length = g_mime_stream_length (stream)) == -1)
+		length = SCAN_BUF_AUTO_MAX;
+	
+	while (size < SCAN_BUF_AUTO_MAX && (gint64) size < length)
+		size <<= 1;
+	
+	return size;
+}
+
 static void
 parser_init (GMimeParser *parser, GMimeStream *stream)
 {
 	struct _GMimeParserPrivate *priv = parser->priv;
 	gint64 offset = -1;
+	size_t scan_buf;
+	gint64 end;
 	
 	if (stream) {
 		g_object_ref (stream);
 		offset = g_mime_stream_tell (stream);
 	}
 	
+	/* memory-backed streams can be scanned in place (see optimization comment [3]) */
+	priv->direct = stream && offset != -1 && _g_mime_stream_get_memory (stream, &end) != NULL;
+	
 	priv->state = GMIME_PARSER_STATE_INIT;
 	
 	priv->stream = stream;
 	
 	priv->offset = offset;
 	
+	scan_buf = parser_choose_scan_buf (priv, stream);
+	if (priv->realbuf == NULL || priv->scan_buf != scan_buf) {
+		g_free (priv->realbuf);
+		priv->realbuf = g_malloc (SCAN_HEAD + scan_buf + 4);
+		priv->scan_buf = scan_buf;
+	}
+	
 	priv->inbuf = priv->realbuf + SCAN_HEAD;
 	priv->inptr = priv->inbuf;
 	priv->inend = priv->inbuf;
@@ -368,6 +530,7 @@ parser_init (GMimeParser *parser, GMimeStream *stream)
 	priv->preheader = NULL;
 	
 	priv->headers = g_ptr_array_new ();
+	priv->arena = NULL;
 	
 	priv->headerbuf = g_malloc (HEADER_INIT_SIZE);
 	priv->headerleft = HEADER_INIT_SIZE - 1;
@@ -404,6 +567,9 @@ parser_close (GMimeParser *parser)
 	parser_free_headers (priv);
 	g_ptr_array_free (priv->headers, TRUE);
 	
+	if (priv->arena)
+		g_mime_arena_unref (priv->arena);
+	
 	while (priv->bounds)
 		parser_pop_boundary (parser);
 }
@@ -509,7 +675,9 @@ g_mime_parser_get_persist_stream (GMimeParser *parser)
  *
  * Note: This attribute only serves as a hint to the @parser. If the
  * underlying stream does not support seeking, then this attribute
- * will be ignored.
+ * will be ignored. It is also ignored if lazy loading has been enabled
+ * with g_mime_parser_set_lazy_content(), since the content of lazily
+ * loaded parts is never copied into memory.
  *
  * By default, this feature is enabled if the underlying stream is seekable.
  **/
@@ -597,6 +765,180 @@ g_mime_parser_set_respect_content_length (GMimeParser *parser, gboolean respect_
 }
 
 
+/**
+ * g_mime_parser_get_lazy_content:
+ * @parser: a #GMimeParser context
+ *
+ * Gets whether or not @parser is set to load the content of MIME parts
+ * lazily.
+ *
+ * Returns: %TRUE if @parser loads MIME part content lazily or %FALSE
+ * otherwise.
+ **/
+gboolean
+g_mime_parser_get_lazy_content (GMimeParser *parser)
+{
+	g_return_val_if_fail (GMIME_IS_PARSER (parser), FALSE);
+	
+	return parser->priv->lazy_content;
+}
+
+
+/**
+ * g_mime_parser_set_lazy_content:
+ * @parser: a #GMimeParser context
+ * @lazy_content: %TRUE if MIME part content should be loaded lazily
+ *
+ * Sets whether or not @parser should only record where the content of
+ * each MIME part is located within the stream rather than loading it.
+ *
+ * This is useful when only the headers and the MIME structure of
+ * messages are of interest: a #GMimePart's content object is not
+ * created until something (such as g_mime_part_get_content()) asks
+ * for it and, when the extent of the content is known without having
+ * to look for a boundary (e.g. the body of a single-part message), the
+ * content is not even read. Since the content is always loaded from
+ * the underlying stream, the stream must not be modified while any of
+ * the parsed parts are still in use.
+ *
+ * Note: Until the content is loaded, the #GMimePart's content field is
+ * %NULL, so code that reads the field directly must call
+ * g_mime_part_get_content() first.
+ *
+ * Note: Lazily loaded content always refers to the underlying stream,
+ * so the persist-stream attribute (see g_mime_parser_set_persist_stream())
+ * is ignored while lazy loading is enabled. This attribute is itself
+ * ignored if the underlying stream does not support seeking.
+ *
+ * By default, this feature is disabled.
+ **/
+void
+g_mime_parser_set_lazy_content (GMimeParser *parser, gboolean lazy_content)
+{
+	g_return_if_fail (GMIME_IS_PARSER (parser));
+	
+	parser->priv->lazy_content = lazy_content ? 1 : 0;
+}
+
+
+/**
+ * g_mime_parser_get_use_arena:
+ * @parser: a #GMimeParser context
+ *
+ * Gets whether or not @parser allocates the headers of each message
+ * from a per-message arena.
+ *
+ * Returns: %TRUE if @parser uses a per-message arena or %FALSE
+ * otherwise.
+ **/
+gboolean
+g_mime_parser_get_use_arena (GMimeParser *parser)
+{
+	g_return_val_if_fail (GMIME_IS_PARSER (parser), FALSE);
+	
+	return parser->priv->use_arena;
+}
+
+
+/**
+ * g_mime_parser_set_use_arena:
+ * @parser: a #GMimeParser context
+ * @use_arena: %TRUE if headers should be allocated from a per-message arena
+ *
+ * Sets whether or not @parser should allocate the header names and
+ * values of each message it constructs (and of the MIME parts within
+ * it) from a single arena rather than from the heap one string at a
+ * time. The headers of the resulting objects refer to the strings in
+ * the arena directly and the arena is released in one shot once the
+ * message and all of its headers have been finalized.
+ *
+ * This reduces the allocation overhead of parsing messages that are
+ * discarded shortly afterwards. However, since the arena is only
+ * released as a whole, holding on to a single #GMimeHeader keeps all
+ * of the header strings of its message alive.
+ *
+ * By default, this feature is disabled.
+ **/
+void
+g_mime_parser_set_use_arena (GMimeParser *parser, gboolean use_arena)
+{
+	g_return_if_fail (GMIME_IS_PARSER (parser));
+	
+	parser->priv->use_arena = use_arena ? 1 : 0;
+}
+
+
+/**
+ * g_mime_parser_get_buffer_size:
+ * @parser: a #GMimeParser context
+ *
+ * Gets the size of the read buffer that @parser uses when reading
+ * from its stream.
+ *
+ * Returns: the size of the read buffer, in bytes.
+ **/
+size_t
+g_mime_parser_get_buffer_size (GMimeParser *parser)
+{
+	g_return_val_if_fail (GMIME_IS_PARSER (parser), 0);
+	
+	return parser->priv->scan_buf;
+}
+
+
+/**
+ * g_mime_parser_set_buffer_size:
+ * @parser: a #GMimeParser context
+ * @size: the size of the read buffer in bytes or %0 to let the parser decide
+ *
+ * Sets the size of the read buffer that @parser uses when reading from
+ * its stream. Larger buffers mean fewer (and larger) reads from the
+ * underlying stream as well as less shuffling of data around within
+ * the buffer, which can make a big difference when parsing large mbox
+ * files. Sizes smaller than 4 KiB are rounded up and sizes larger than
+ * 16 MiB are rounded down.
+ *
+ * By default (or if @size is %0), the parser picks a buffer size
+ * between 4 KiB and 64 KiB based on the length of the stream.
+ *
+ * The buffer may be resized at any time; data that has already been
+ * read into the buffer is preserved.
+ **/
+void
+g_mime_parser_set_buffer_size (GMimeParser *parser, size_t size)
+{
+	struct _GMimeParserPrivate *priv;
+	size_t inptr, inbuf, inend;
+	
+	g_return_if_fail (GMIME_IS_PARSER (parser));
+	
+	priv = parser->priv;
+	
+	if (size != 0)
+		size = CLAMP (size, SCAN_BUF, SCAN_BUF_MAX);
+	
+	priv->buffer_size = size;
+	size = parser_choose_scan_buf (priv, priv->stream);
+	
+	if (size == priv->scan_buf)
+		return;
+	
+	inptr = priv->inptr - priv->realbuf;
+	inbuf = priv->inbuf - priv->realbuf;
+	inend = priv->inend - priv->realbuf;
+	
+	/* never discard data that has already been read */
+	if (inend > SCAN_HEAD)
+		size = MAX (size, inend - SCAN_HEAD);
+	
+	priv->realbuf = g_realloc (priv->realbuf, SCAN_HEAD + size + 4);
+	priv->inptr = priv->realbuf + inptr;
+	priv->inbuf = priv->realbuf + inbuf;
+	priv->inend = priv->realbuf + inend;
+	priv->scan_buf = size;
+}
+
+
 /**
  * g_mime_parser_set_header_regex: (skip)
  * @parser: a #GMimeParser context
@@ -674,7 +1016,7 @@ parser_fill (GMimeParser *parser, size_t atleast)
 	
 	priv->inptr = inptr;
 	priv->inend = inbuf;
-	inend = priv->realbuf + SCAN_HEAD + SCAN_BUF;
+	inend = priv->realbuf + SCAN_HEAD + priv->scan_buf;
 	
 	if ((nread = g_mime_stream_read (priv->stream, inbuf, inend - inbuf)) > 0) {
 		priv->offset += nread;
@@ -889,18 +1231,28 @@ header_parse (GMimeParser *parser, GMimeParserOptions *options)
 		return;
 	}
 	
-	header = g_slice_new (Header);
-	g_ptr_array_add (priv->headers, header);
+	if (priv->arena != NULL) {
+		header = g_mime_arena_alloc (priv->arena, sizeof (Header));
+		header->raw_name = g_mime_arena_strndup (priv->arena, priv->headerbuf, (size_t) (inptr - priv->headerbuf));
+		header->raw_value = g_mime_arena_strndup (priv->arena, inptr + 1, (size_t) (priv->headerptr - (inptr + 1)));
+	} else {
+		header = g_slice_new (Header);
+		header->raw_name = g_strndup (priv->headerbuf, (size_t) (inptr - priv->headerbuf));
+		header->raw_value = g_strdup (inptr + 1);
+	}
 	
-	header->raw_name = g_strndup (priv->headerbuf, (size_t) (inptr - priv->headerbuf));
-	header->raw_value = g_strdup (inptr + 1);
+	g_ptr_array_add (priv->headers, header);
 	header->offset = priv->header_offset;
 	
 	/* now walk backwards over lwsp characters */
 	while (inptr > priv->headerbuf && is_blank (inptr[-1]))
 		inptr--;
 	
-	header->name = g_strndup (priv->headerbuf, (size_t) (inptr - priv->headerbuf));
+	if (priv->arena != NULL)
+		header->name = g_mime_arena_strndup (priv->arena, priv->headerbuf, (size_t) (inptr - priv->headerbuf));
+	else
+		header->name = g_strndup (priv->headerbuf, (size_t) (inptr - priv->headerbuf));
+	header->id = _g_mime_header_id_lookup (header->name);
 	
 	priv->headerleft += priv->headerptr - priv->headerbuf;
 	priv->headerptr = priv->headerbuf;
@@ -931,16 +1283,25 @@ has_message_headers (GPtrArray *headers)
 	for (i = 0; i < headers->len; i++) {
 		header = headers->pdata[i];
 		
-		if (!g_ascii_strcasecmp (header->name, "Subject"))
+		switch (header->id) {
+		case GMIME_HEADER_ID_SUBJECT:
 			found |= SUBJECT;
-		else if (!g_ascii_strcasecmp (header->name, "From"))
+			break;
+		case GMIME_HEADER_ID_FROM:
 			found |= FROM;
-		else if (!g_ascii_strcasecmp (header->name, "Date"))
+			break;
+		case GMIME_HEADER_ID_DATE:
 			found |= DATE;
-		else if (!g_ascii_strcasecmp (header->name, "To"))
+			break;
+		case GMIME_HEADER_ID_TO:
 			found |= TO;
-		else if (!g_ascii_strcasecmp (header->name, "Cc"))
+			break;
+		case GMIME_HEADER_ID_CC:
 			found |= CC;
+			break;
+		default:
+			break;
+		}
 	}
 	
 	return found != 0;
@@ -955,7 +1316,7 @@ has_content_headers (GPtrArray *headers)
 	for (i = 0; i < headers->len; i++) {
 		header = headers->pdata[i];
 		
-		if (!g_ascii_strcasecmp (header->name, "Content-Type"))
+		if (header->id == GMIME_HEADER_ID_CONTENT_TYPE)
 			return TRUE;
 	}
 	
@@ -1214,7 +1575,7 @@ parser_content_type (GMimeParser *parser, GMimeContentType *parent)
 	
 	content_type = g_slice_new (ContentType);
 	
-	if (!(value = parser_find_header (parser, "Content-Type", NULL)) ||
+	if (!(value = parser_find_header (parser, GMIME_HEADER_ID_CONTENT_TYPE, NULL)) ||
 	    !g_mime_parse_content_type (&value, &content_type->type, &content_type->subtype)) {
 		if (parent != NULL && g_mime_content_type_is_type (parent, "multipart", "digest")) {
 			content_type->type = g_strdup ("message");
@@ -1356,11 +1717,75 @@ is_boundary (struct _GMimeParserPrivate *priv, const char *text, size_t len, con
 	return TRUE;
 }
 
+/* finds the innermost level of the boundary stack that @start is a
+ * boundary (or end-boundary) for in time proportional to the length
+ * of the line rather than to the depth of the stack */
 static BoundaryType
-check_boundary (struct _GMimeParserPrivate *priv, const char *start, size_t len)
+check_boundary_indexed (struct _GMimeParserPrivate *priv, const char *start, size_t len, gint64 offset)
+{
+	BoundaryKey key, *match = NULL, *k;
+	size_t max, i;
+	guint hash;
+	
+	if (priv->bounds == NULL)
+		return BOUNDARY_NONE;
+	
+	/* a boundary may be followed by linear whitespace, so every prefix
+	 * that leaves nothing but whitespace behind is a candidate */
+	key.len = len;
+	while (key.len > 0 && is_lwsp (start[key.len - 1]))
+		key.len--;
+	
+	max = MIN (len, priv->bounds->boundarylenmax);
+	if (key.len > max)
+		return BOUNDARY_NONE;
+	
+	hash = BOUNDARY_HASH_INIT;
+	for (i = 0; i < key.len; i++)
+		hash = boundary_hash_step (hash, start[i]);
+	
+	key.text = start;
+	
+	while (TRUE) {
+		key.hash = hash;
+		
+		/* the first key with this text that applies is the innermost */
+		for (k = g_hash_table_lookup (priv->boundaries, &key); k != NULL; k = k->shadowed) {
+			if (k->final && offset < k->level->content_end)
+				continue;
+			
+			if (match == NULL || k->level->depth > match->level->depth)
+				match = k;
+			
+			break;
+		}
+		
+		if (key.len == max)
+			break;
+		
+		hash = boundary_hash_step (hash, start[key.len]);
+		key.len++;
+	}
+	
+	if (match == NULL)
+		return BOUNDARY_NONE;
+	
+	if (match->final) {
+		d(printf ("found %s\n", match->level->content_end != -1 && offset >= match->level->content_end ?
+			  "end of content" : "end boundary"));
+		return match->level == priv->bounds ? BOUNDARY_IMMEDIATE_END : BOUNDARY_PARENT_END;
+	}
+	
+	d(printf ("found boundary\n"));
+	
+	return match->level == priv->bounds ? BOUNDARY_IMMEDIATE : BOUNDARY_PARENT;
+}
+
+static BoundaryType
+check_boundary (struct _GMimeParserPrivate *priv, const char *start, size_t len, gint64 offset)
 {
-	gint64 offset = parser_offset (priv, start);
 	const char *marker;
+	BoundaryType type;
 	BoundaryStack *s;
 	size_t mlen;
 	guint i;
@@ -1379,21 +1804,28 @@ check_boundary (struct _GMimeParserPrivate *priv, const char *start, size_t len)
 	
 	d(printf ("checking boundary '%.*s'\n", len, start));
 	
-	s = priv->bounds;
-	while (s) {
-		if (offset >= s->content_end &&
-		    is_boundary (priv, start, len, s->boundary, s->boundarylenfinal)) {
-			d(printf ("found %s\n", s->content_end != -1 && offset >= s->content_end ?
-				  "end of content" : "end boundary"));
-			return s == priv->bounds ? BOUNDARY_IMMEDIATE_END : BOUNDARY_PARENT_END;
-		}
-		
-		if (is_boundary (priv, start, len, s->boundary, s->boundarylen)) {
-			d(printf ("found boundary\n"));
-			return s == priv->bounds ? BOUNDARY_IMMEDIATE : BOUNDARY_PARENT;
+	if (start[0] == '-') {
+		/* MIME boundaries are looked up by their text */
+		if ((type = check_boundary_indexed (priv, start, len, offset)) != BOUNDARY_NONE)
+			return type;
+	} else {
+		/* the mbox/mmdf markers are not indexed, but there's rarely more than one */
+		s = priv->bounds;
+		while (s) {
+			if (offset >= s->content_end &&
+			    is_boundary (priv, start, len, s->boundary, s->boundarylenfinal)) {
+				d(printf ("found %s\n", s->content_end != -1 && offset >= s->content_end ?
+					  "end of content" : "end boundary"));
+				return s == priv->bounds ? BOUNDARY_IMMEDIATE_END : BOUNDARY_PARENT_END;
+			}
+			
+			if (is_boundary (priv, start, len, s->boundary, s->boundarylen)) {
+				d(printf ("found boundary\n"));
+				return s == priv->bounds ? BOUNDARY_IMMEDIATE : BOUNDARY_PARENT;
+			}
+			
+			s = s->parent;
 		}
-		
-		s = s->parent;
 	}
 	
 	d(printf ("'%.*s' not a boundary\n", len, start));
@@ -1440,12 +1872,133 @@ found_immediate_boundary (struct _GMimeParserPrivate *priv, gboolean end)
  * inend every trip through our inner while-loop. This cuts the number
  * of instructions down from ~7 to ~4, assuming the compiler does its
  * job correctly ;-)
+ *
+ * 2. Most content lines (e.g. base64 attachments) cannot possibly be
+ * a boundary because they start with neither "--" nor the mbox/mmdf
+ * marker. When the CPU supports it, we use a vectorized scanner to
+ * skip over runs of such lines in bulk and write them to the content
+ * stream with a single write, leaving only the candidate lines for
+ * check_boundary().
+ *
+ * 3. When the underlying stream is a GMimeStreamMem or GMimeStreamMmap,
+ * there is no need to copy the content into our read buffer just to
+ * scan it: parser_scan_content_direct() scans the memory in place and
+ * then repositions the parser at the boundary it found. Headers are
+ * still parsed out of the read buffer since they're comparatively
+ * small. Content streams for persistent parsers become substreams of
+ * the source stream and therefore never get copied at all.
+ *
+ * 4. When loading content lazily, the only thing we need to know
+ * about a MIME part's content is where it ends. If there are no
+ * boundaries left on the stack, the content extends to the end of
+ * the stream and so parser_skip_content() can simply seek there
+ * without reading a single byte of it.
  **/
 
 
 /* we add 2 for \r\n */
 #define MAX_BOUNDARY_LEN(bounds) (bounds ? bounds->boundarylenmax + 2 : 0)
 
+static BoundaryType
+parser_scan_content_direct (GMimeParser *parser, GMimeStream *content, gint64 *begin, gint64 *end, gboolean *empty)
+{
+	struct _GMimeParserPrivate *priv = parser->priv;
+	BoundaryType found = BOUNDARY_NONE;
+	const char *map, *start, *eoln;
+	register const char *inptr;
+	const char *inend;
+	ssize_t nread;
+	gint64 offset;
+	size_t len;
+	char m;
+	
+	d(printf ("scan-content-direct\n"));
+	
+	priv->openpgp = GMIME_OPENPGP_NONE;
+	priv->midline = FALSE;
+	
+	map = _g_mime_stream_get_memory (priv->stream, &offset);
+	inend = map + offset;
+	
+	offset = parser_offset (priv, NULL);
+	start = inptr = map + offset;
+	*begin = offset;
+	
+	/* only lines beginning with "--" or the mbox/mmdf marker can be boundaries */
+	switch (priv->format) {
+	case GMIME_FORMAT_MBOX: m = MBOX_BOUNDARY[0]; break;
+	case GMIME_FORMAT_MMDF: m = MMDF_BOUNDARY[0]; break;
+	default: m = '-'; break;
+	}
+	
+	while (inptr < inend) {
+		/* Note: see optimization comment [2] */
+		inptr = g_mime_simd_scan_line_starts (inptr, inend, '-', m);
+		start = inptr;
+		
+		if (inptr == inend)
+			break;
+		
+		if ((eoln = memchr (inptr, '\n', inend - inptr)) != NULL) {
+			len = (size_t) (eoln - start);
+			inptr = eoln;
+			
+			if ((found = check_boundary (priv, start, len, start - map)))
+				goto boundary;
+			
+			inptr++;
+		} else {
+			/* check for a boundary not ending in a \n (EOF) */
+			priv->midline = TRUE;
+			len = (size_t) (inend - start);
+			inptr = inend;
+			
+			if ((found = check_boundary (priv, start, len, start - map)))
+				goto boundary;
+		}
+	}
+	
+	found = BOUNDARY_EOS;
+	start = inptr = inend;
+	
+ boundary:
+	
+	len = (size_t) (start - (map + offset));
+	*empty = len == 0;
+	
+	if (found != BOUNDARY_EOS && len > 0) {
+		/* the last \r\n belongs to the boundary */
+		if (inptr[-1] == '\r')
+			len -= MIN (len, 2);
+		else
+			len--;
+	}
+	
+	*end = offset + len;
+	
+	if (content != NULL)
+		g_mime_stream_write (content, map + offset, len);
+	
+	/* don't chew up the boundary: resume parsing at the start of its line */
+	priv->inptr = priv->inend = priv->inbuf;
+	priv->offset = g_mime_stream_seek (priv->stream, start - map, GMIME_STREAM_SEEK_SET);
+	
+	if (found == BOUNDARY_EOS) {
+		/* let the stream figure out that it has reached the end */
+		parser_fill (parser, 0);
+	} else {
+		/* callers expect the boundary line to be buffered at priv->inptr */
+		len = MIN ((size_t) (inptr - start) + (inptr < inend ? 1 : 0), priv->scan_buf);
+		
+		if ((nread = g_mime_stream_read (priv->stream, priv->inbuf, len)) > 0) {
+			priv->offset += nread;
+			priv->inend += nread;
+		}
+	}
+	
+	return found;
+}
+
 static BoundaryType
 parser_scan_content (GMimeParser *parser, GMimeStream *content, gboolean *empty)
 {
@@ -1456,9 +2009,16 @@ parser_scan_content (GMimeParser *parser, GMimeStream *content, gboolean *empty)
 	register char *inptr;
 	unsigned int mask;
 	size_t nleft, len;
+	gboolean bulk;
 	size_t atleast;
 	gint64 pos;
-	char c;
+	char c, m;
+	
+	if (priv->direct) {
+		gint64 begin, end;
+		
+		return parser_scan_content_direct (parser, content, &begin, &end, empty);
+	}
 	
 	d(printf ("scan-content\n"));
 	
@@ -1472,6 +2032,15 @@ parser_scan_content (GMimeParser *parser, GMimeStream *content, gboolean *empty)
 	/* figure out minimum amount of data we need */
 	atleast = MAX (SCAN_HEAD, MAX_BOUNDARY_LEN (priv->bounds));
 	
+	/* only lines beginning with "--" or the mbox/mmdf marker can be boundaries */
+	switch (priv->format) {
+	case GMIME_FORMAT_MBOX: m = MBOX_BOUNDARY[0]; break;
+	case GMIME_FORMAT_MMDF: m = MMDF_BOUNDARY[0]; break;
+	default: m = '-'; break;
+	}
+	
+	bulk = g_mime_simd_has (GMIME_SIMD_SSE2);
+	
 	do {
 	refill:
 		nleft = priv->inend - inptr;
@@ -1493,6 +2062,18 @@ parser_scan_content (GMimeParser *parser, GMimeStream *content, gboolean *empty)
 		priv->midline = FALSE;
 		
 		while (inptr < inend) {
+			if (bulk) {
+				/* Note: see optimization comment [2] */
+				start = inptr;
+				inptr = (char *) g_mime_simd_scan_line_starts (inptr, inend, '-', m);
+				
+				if (inptr > start)
+					g_mime_stream_write (content, start, (size_t) (inptr - start));
+				
+				if (inptr == inend)
+					break;
+			}
+			
 			aligned = (char *) (((size_t) (inptr + 3)) & ~3);
 			start = inptr;
 			
@@ -1521,7 +2102,7 @@ parser_scan_content (GMimeParser *parser, GMimeStream *content, gboolean *empty)
 			len = (size_t) (inptr - start);
 			
 			if (inptr < inend) {
-				if ((found = check_boundary (priv, start, len)))
+				if ((found = check_boundary (priv, start, len, parser_offset (priv, start))))
 					goto boundary;
 				
 				inptr++;
@@ -1538,7 +2119,7 @@ parser_scan_content (GMimeParser *parser, GMimeStream *content, gboolean *empty)
 				}
 				
 				/* check for a boundary not ending in a \n (EOF) */
-				if ((found = check_boundary (priv, start, len)))
+				if ((found = check_boundary (priv, start, len, parser_offset (priv, start))))
 					goto boundary;
 			}
 			
@@ -1567,6 +2148,42 @@ parser_scan_content (GMimeParser *parser, GMimeStream *content, gboolean *empty)
 	return found;
 }
 
+static BoundaryType
+parser_skip_content (GMimeParser *parser, gint64 *begin, gint64 *end, gboolean *empty, gboolean *scanned)
+{
+	struct _GMimeParserPrivate *priv = parser->priv;
+	GMimeStream *null;
+	BoundaryType found;
+	
+	*begin = parser_offset (priv, NULL);
+	*scanned = TRUE;
+	
+	/* Note: see optimization comment [4] */
+	if (priv->bounds == NULL && (*end = g_mime_stream_seek (priv->stream, 0, GMIME_STREAM_SEEK_END)) != -1) {
+		priv->inptr = priv->inend = priv->inbuf;
+		priv->midline = FALSE;
+		priv->offset = *end;
+		
+		/* let the stream figure out that it has reached the end */
+		parser_fill (parser, 0);
+		
+		*empty = *end == *begin;
+		*scanned = FALSE;
+		
+		return BOUNDARY_EOS;
+	}
+	
+	if (priv->direct)
+		return parser_scan_content_direct (parser, NULL, begin, end, empty);
+	
+	null = g_mime_stream_null_new ();
+	found = parser_scan_content (parser, null, empty);
+	*end = *begin + g_mime_stream_tell (null);
+	g_object_unref (null);
+	
+	return found;
+}
+
 static void
 parser_scan_mime_part_content (GMimeParser *parser, GMimePart *mime_part, BoundaryType *found)
 {
@@ -1575,39 +2192,69 @@ parser_scan_mime_part_content (GMimeParser *parser, GMimePart *mime_part, Bounda
 	GMimeContentEncoding encoding;
 	GMimeDataWrapper *content;
 	GMimeStream *stream;
+	gboolean empty, scanned = TRUE;
 	GByteArray *buffer;
 	gint64 start, len;
-	gboolean empty;
 	
 	g_assert (priv->state >= GMIME_PARSER_STATE_HEADERS_END);
 	
-	if (priv->persist_stream && priv->seekable) {
-		stream = g_mime_stream_null_new ();
-		start = parser_offset (priv, NULL);
+	if (priv->lazy_content && priv->seekable) {
+		gint64 end;
+		
+		*found = parser_skip_content (parser, &start, &end, &empty, &scanned);
+		len = end - start;
+		stream = NULL;
+	} else if (priv->direct) {
+		const char *map;
+		gint64 end;
+		
+		/* Note: see optimization comment [3] */
+		*found = parser_scan_content_direct (parser, NULL, &start, &end, &empty);
+		
+		if (priv->persist_stream) {
+			stream = g_mime_stream_substream (priv->stream, start, end);
+		} else {
+			map = _g_mime_stream_get_memory (priv->stream, &len);
+			stream = g_mime_stream_mem_new_with_buffer (map + start, (size_t) (end - start));
+		}
 	} else {
-		stream = g_mime_stream_mem_new ();
-		start = 0;
+		if (priv->persist_stream && priv->seekable) {
+			stream = g_mime_stream_null_new ();
+			start = parser_offset (priv, NULL);
+		} else {
+			stream = g_mime_stream_mem_new ();
+			start = 0;
+		}
+		
+		*found = parser_scan_content (parser, stream, &empty);
+		len = g_mime_stream_tell (stream);
+		
+		if (priv->persist_stream && priv->seekable) {
+			g_object_unref (stream);
+			
+			stream = g_mime_stream_substream (priv->stream, start, start + len);
+		} else {
+			buffer = g_mime_stream_mem_get_byte_array ((GMimeStreamMem *) stream);
+			g_byte_array_set_size (buffer, (guint) len);
+			g_mime_stream_reset (stream);
+		}
 	}
 	
-	*found = parser_scan_content (parser, stream, &empty);
-	len = g_mime_stream_tell (stream);
+	encoding = g_mime_part_get_content_encoding (mime_part);
 	
-	if (priv->persist_stream && priv->seekable) {
+	if (stream != NULL) {
+		content = g_mime_data_wrapper_new_with_stream (stream, encoding);
 		g_object_unref (stream);
 		
-		stream = g_mime_stream_substream (priv->stream, start, start + len);
+		g_mime_part_set_content (mime_part, content);
+		g_object_unref (content);
 	} else {
-		buffer = g_mime_stream_mem_get_byte_array ((GMimeStreamMem *) stream);
-		g_byte_array_set_size (buffer, (guint) len);
-		g_mime_stream_reset (stream);
+		_g_mime_part_set_lazy_content (mime_part, priv->stream, start, start + len, encoding);
 	}
 	
-	encoding = g_mime_part_get_content_encoding (mime_part);
-	content = g_mime_data_wrapper_new_with_stream (stream, encoding);
-	g_object_unref (stream);
-	
-	g_mime_part_set_content (mime_part, content);
-	g_object_unref (content);
+	/* if we never looked at the content, we know nothing about any OpenPGP data in it */
+	if (!scanned)
+		return;
 	
 	content_type = g_mime_object_get_content_type ((GMimeObject *) mime_part);
 	
@@ -1651,22 +2298,27 @@ check_header_conflict (GMimeParserOptions *options, GMimeObject *object, const H
 	}
 }
 
-static int
-compare_header (const void *a, const void *b)
-{
-	return g_ascii_strcasecmp ((const gchar *) a, * (const gchar **) b);
-}
-
-/* headers which may exist only once according to RFC 5322, Sect. 3.6 (keep the list sorted) */
-static const char *rfc5322_single_hdr[] = {
-	"bcc", "cc", "date", "from", "in-reply-to", "message-id", "references", "reply-to", "sender", "subject", "to"
-};
-
 static void
 check_repeated_header (GMimeParserOptions *options, GMimeObject *object, const Header *header)
 {
-	if (bsearch (header->name, rfc5322_single_hdr, G_N_ELEMENTS (rfc5322_single_hdr), sizeof (char *), compare_header))
+	/* headers which may exist only once according to RFC 5322, Sect. 3.6 */
+	switch (header->id) {
+	case GMIME_HEADER_ID_BCC:
+	case GMIME_HEADER_ID_CC:
+	case GMIME_HEADER_ID_DATE:
+	case GMIME_HEADER_ID_FROM:
+	case GMIME_HEADER_ID_IN_REPLY_TO:
+	case GMIME_HEADER_ID_MESSAGE_ID:
+	case GMIME_HEADER_ID_REFERENCES:
+	case GMIME_HEADER_ID_REPLY_TO:
+	case GMIME_HEADER_ID_SENDER:
+	case GMIME_HEADER_ID_SUBJECT:
+	case GMIME_HEADER_ID_TO:
 		check_header_conflict (options, object, header);
+		break;
+	default:
+		break;
+	}
 }
 
 static void
@@ -1704,7 +2356,7 @@ parser_scan_message_part (GMimeParser *parser, GMimeParserOptions *options, GMim
 		while (*inptr != '\n')
 			inptr++;
 		
-		*found = check_boundary (priv, priv->inptr, inptr - priv->inptr);
+		*found = check_boundary (priv, priv->inptr, inptr - priv->inptr, parser_offset (priv, NULL));
 		switch (*found) {
 		case BOUNDARY_IMMEDIATE_END:
 		case BOUNDARY_IMMEDIATE:
@@ -1743,7 +2395,7 @@ parser_scan_message_part (GMimeParser *parser, GMimeParserOptions *options, GMim
 		if (g_ascii_strncasecmp (header->name, "Content-", 8) != 0) {
 			if (can_warn)
 				check_repeated_header (options, (GMimeObject *) message, header);
-			_g_mime_object_append_header ((GMimeObject *) message, header->name, header->raw_name,
+			_g_mime_object_append_header ((GMimeObject *) message, priv->arena, header->name, header->raw_name,
 						      header->raw_value, header->offset);
 		}
 	}
@@ -1786,7 +2438,7 @@ parser_construct_leaf_part (GMimeParser *parser, GMimeParserOptions *options, Co
 		
 		if (!toplevel || !g_ascii_strncasecmp (header->name, "Content-", 8)) {
 			check_header_conflict (options, object, header);
-			_g_mime_object_append_header (object, header->name, header->raw_name,
+			_g_mime_object_append_header (object, priv->arena, header->name, header->raw_name,
 						      header->raw_value, header->offset);
 		}
 	}
@@ -1931,10 +2583,10 @@ parser_construct_multipart (GMimeParser *parser, GMimeParserOptions *options, Co
 		if (!toplevel || !g_ascii_strncasecmp (header->name, "Content-", 8)) {
 			check_header_conflict (options, object, header);
 			
-			if (!g_ascii_strcasecmp (header->name, "Content-Type"))
+			if (header->id == GMIME_HEADER_ID_CONTENT_TYPE)
 				ctype_offset = header->offset;
 			
-			_g_mime_object_append_header (object, header->name, header->raw_name,
+			_g_mime_object_append_header (object, priv->arena, header->name, header->raw_name,
 						      header->raw_value, header->offset);
 		}
 	}
@@ -2031,9 +2683,15 @@ parser_construct_part (GMimeParser *parser, GMimeParserOptions *options)
 GMimeObject *
 g_mime_parser_construct_part (GMimeParser *parser, GMimeParserOptions *options)
 {
+	GMimeObject *object;
+	
 	g_return_val_if_fail (GMIME_IS_PARSER (parser), NULL);
 	
-	return parser_construct_part (parser, options);
+	parser_arena_begin (parser->priv);
+	object = parser_construct_part (parser, options);
+	parser_arena_end (parser->priv);
+	
+	return object;
 }
 
 
@@ -2072,7 +2730,7 @@ parser_construct_message (GMimeParser *parser, GMimeParserOptions *options)
 	for (i = 0; i < priv->headers->len; i++) {
 		header = priv->headers->pdata[i];
 		
-		if (priv->respect_content_length && !g_ascii_strcasecmp (header->name, "Content-Length")) {
+		if (priv->respect_content_length && header->id == GMIME_HEADER_ID_CONTENT_LENGTH) {
 			inptr = header->raw_value;
 			while (is_lwsp (*inptr))
 				inptr++;
@@ -2085,7 +2743,7 @@ parser_construct_message (GMimeParser *parser, GMimeParserOptions *options)
 		if (g_ascii_strncasecmp (header->name, "Content-", 8) != 0) {
 			if (can_warn)
 				check_repeated_header (options, (GMimeObject *) message, header);
-			_g_mime_object_append_header ((GMimeObject *) message, header->name, header->raw_name,
+			_g_mime_object_append_header ((GMimeObject *) message, priv->arena, header->name, header->raw_name,
 						      header->raw_value, header->offset);
 		}
 	}
@@ -2131,9 +2789,410 @@ parser_construct_message (GMimeParser *parser, GMimeParserOptions *options)
 GMimeMessage *
 g_mime_parser_construct_message (GMimeParser *parser, GMimeParserOptions *options)
 {
+	GMimeMessage *message;
+	
 	g_return_val_if_fail (GMIME_IS_PARSER (parser), NULL);
 	
-	return parser_construct_message (parser, options);
+	parser_arena_begin (parser->priv);
+	message = parser_construct_message (parser, options);
+	parser_arena_end (parser->priv);
+	
+	return message;
+}
+
+
+typedef struct {
+	gint64 offset;
+	gboolean crlf;
+} MarkerIndex;
+
+typedef struct {
+	GMimeParserOptions *options;
+	GMimeStream *stream;
+	GMimeFormat format;
+	size_t buffer_size;
+	gboolean persist;
+	gboolean arena;
+	gboolean lazy;
+	
+	GMimeMessage *message;
+	gint64 offset;
+	char *marker;
+	gboolean done;
+} ParserJob;
+
+typedef struct {
+	GMutex lock;
+	GCond cond;
+} ParserJobQueue;
+
+static int
+parser_construct_messages_serial (GMimeParser *parser, GMimeParserOptions *options,
+				  GMimeParserMessageFunc func, gpointer user_data)
+{
+	GMimeMessage *message;
+	char *marker;
+	gint64 offset;
+	int n = 0;
+	
+	while (!g_mime_parser_eos (parser)) {
+		if (!(message = g_mime_parser_construct_message (parser, options)))
+			break;
+		
+		marker = g_mime_parser_get_mbox_marker (parser);
+		offset = parser->priv->marker_offset;
+		
+		func (message, marker, offset, user_data);
+		g_object_unref (message);
+		g_free (marker);
+		n++;
+	}
+	
+	return n;
+}
+
+/* whether parser_step_headers() would take the line at @start to be a
+ * header field rather than something that ends the header block */
+static gboolean
+is_header_field (const char *start, const char *inend)
+{
+	gboolean blank = FALSE;
+	
+	while (start < inend && *start != ':') {
+		if (is_blank (*start)) {
+			blank = TRUE;
+		} else if (blank || is_ctrl (*start)) {
+			return FALSE;
+		}
+		
+		start++;
+	}
+	
+	return start < inend;
+}
+
+/* finds the offsets of all of the remaining messages using the same
+ * rule that the serial parser uses to split them: a marker line splits
+ * the stream anywhere except within the top-level header block of a
+ * message, where "From :" is a (mangled) header rather than a From-line */
+static GArray *
+parser_index_markers (GMimeParser *parser)
+{
+	struct _GMimeParserPrivate *priv = parser->priv;
+	gboolean headers = FALSE;
+	register char *inptr;
+	char *start, *inend;
+	const char *marker;
+	MarkerIndex entry;
+	ssize_t left = 0;
+	GArray *index;
+	size_t len;
+	
+	if (priv->format == GMIME_FORMAT_MBOX) {
+		marker = MBOX_BOUNDARY;
+		len = MBOX_BOUNDARY_LEN;
+	} else {
+		marker = MMDF_BOUNDARY;
+		len = MMDF_BOUNDARY_LEN;
+	}
+	
+	index = g_array_new (FALSE, FALSE, sizeof (MarkerIndex));
+	
+	do {
+	refill:
+		if (parser_fill (parser, MAX (SCAN_HEAD, left)) <= left)
+			break;
+		
+		inptr = priv->inptr;
+		inend = priv->inend;
+		*inend = '\n';
+		
+		while (inptr < inend) {
+			start = inptr;
+			while (*inptr != '\n')
+				inptr++;
+			
+			if (inptr + 1 >= inend) {
+				/* we don't have enough data; if we can't get more we have to bail */
+				left = (ssize_t) (inend - start);
+				priv->inptr = start;
+				goto refill;
+			}
+			
+			inptr++;
+			
+			if (headers) {
+				/* a blank line ends the header block */
+				if (*start == '\n' || (*start == '\r' && start[1] == '\n')) {
+					headers = FALSE;
+					continue;
+				}
+				
+				/* folded and well-formed header lines are part of it */
+				if (is_blank (*start) || is_header_field (start, inptr - 1))
+					continue;
+				
+				/* anything else is either the next From-line or the
+				 * start of the content (the header block was never
+				 * terminated) */
+				headers = FALSE;
+			}
+			
+			if ((size_t) (inptr - 1 - start) >= len && !strncmp (start, marker, len)) {
+				entry.offset = parser_offset (priv, start);
+				
+				/* the marker line is the boundary that terminates the previous
+				 * message, so remember whether or not it ends with a \r\n */
+				entry.crlf = inptr[-2] == '\r';
+				
+				g_array_append_val (index, entry);
+				
+				headers = priv->format == GMIME_FORMAT_MBOX;
+			}
+		}
+		
+		priv->inptr = inptr;
+		left = 0;
+	} while (1);
+	
+	priv->state = GMIME_PARSER_STATE_ERROR;
+	priv->inptr = priv->inend;
+	
+	return index;
+}
+
+static GMimeStream *
+parser_shared_stream (GMimeStream *stream)
+{
+#ifdef HAVE_MMAP
+	GMimeStream *mm;
+	int fd;
+#endif
+	gint64 end;
+	
+	/* memory-backed streams can be read by several threads at once */
+	if (_g_mime_stream_get_memory (stream, &end) != NULL)
+		return g_object_ref (stream);
+	
+#ifdef HAVE_MMAP
+	/* file streams cannot (they share the file offset), but we
+	 * can get the same effect by mapping the file into memory */
+	if (GMIME_IS_STREAM_FS (stream) && (fd = dup (((GMimeStreamFs *) stream)->fd)) != -1) {
+		if ((mm = g_mime_stream_mmap_new_with_bounds (fd, PROT_READ, MAP_PRIVATE, stream->bound_start, stream->bound_end)))
+			return mm;
+		
+		close (fd);
+	}
+#endif
+	
+	return NULL;
+}
+
+static void
+parser_job_run (gpointer data, gpointer user_data)
+{
+	ParserJobQueue *queue = user_data;
+	ParserJob *job = data;
+	GMimeParser *parser;
+	
+	parser = g_mime_parser_new_with_stream (job->stream);
+	g_mime_parser_set_persist_stream (parser, job->persist);
+	g_mime_parser_set_lazy_content (parser, job->lazy);
+	g_mime_parser_set_use_arena (parser, job->arena);
+	g_mime_parser_set_format (parser, job->format);
+	g_mime_parser_set_buffer_size (parser, job->buffer_size);
+	
+	job->message = g_mime_parser_construct_message (parser, job->options);
+	job->marker = g_mime_parser_get_mbox_marker (parser);
+	g_object_unref (parser);
+	
+	g_mutex_lock (&queue->lock);
+	job->done = TRUE;
+	g_cond_broadcast (&queue->cond);
+	g_mutex_unlock (&queue->lock);
+}
+
+static void
+parser_job_free (ParserJob *job)
+{
+	if (job->message)
+		g_object_unref (job->message);
+	
+	g_object_unref (job->stream);
+	g_free (job->marker);
+	g_free (job);
+}
+
+
+/**
+ * g_mime_parser_construct_messages:
+ * @parser: a #GMimeParser context
+ * @options: (nullable): a #GMimeParserOptions or %NULL
+ * @n_threads: the maximum number of worker threads or %-1 to use one per processor
+ * @func: (scope call): the function to call for each message
+ * @user_data: user-supplied callback data
+ *
+ * Constructs all of the remaining messages in an mbox or MMDF stream,
+ * calling @func for each of them in the order that they appear in the
+ * stream. @func is always invoked from the calling thread. Parsing
+ * stops at the first message that cannot be constructed, so @func is
+ * never passed a %NULL message.
+ *
+ * When @parser's stream is seekable, the stream is first scanned for
+ * the From-lines (or MMDF markers) that separate the messages and the
+ * messages are then parsed concurrently by up to @n_threads worker
+ * threads, each using its own #GMimeParser. File streams get mapped
+ * into memory for this so that the workers do not contend over the
+ * file offset; any other kind of stream that is not memory-backed
+ * gets each message copied into memory before it is handed off to a
+ * worker.
+ *
+ * Messages are parsed one after the other in the calling thread if
+ * @n_threads is %1, if the stream is not seekable or if @parser has
+ * been set to respect Content-Length headers (since in that case a
+ * From-line does not necessarily start a new message).
+ *
+ * The messages are split up the same way in both cases, except that a
+ * line beginning with "From :" within the headers of a MIME part or of
+ * an attached message (as opposed to the headers of the message itself)
+ * is taken to be a header by the serial parser but a From-line by the
+ * concurrent one.
+ *
+ * Note: @parser's header regex callback is not invoked for messages
+ * that are parsed by the worker threads and @options must not be
+ * modified until this function returns.
+ *
+ * Returns: the number of messages constructed or %-1 on error.
+ **/
+int
+g_mime_parser_construct_messages (GMimeParser *parser, GMimeParserOptions *options, int n_threads,
+				  GMimeParserMessageFunc func, gpointer user_data)
+{
+	struct _GMimeParserPrivate *priv;
+	guint window, submitted, delivered, i;
+	ParserJobQueue queue;
+	MarkerIndex *entry;
+	GMimeStream *source;
+	GThreadPool *pool;
+	ParserJob **jobs;
+	ParserJob *job;
+	GArray *index;
+	gint64 end;
+	
+	g_return_val_if_fail (GMIME_IS_PARSER (parser), -1);
+	g_return_val_if_fail (func != NULL, -1);
+	
+	priv = parser->priv;
+	
+	if (priv->stream == NULL || priv->format == GMIME_FORMAT_MESSAGE)
+		return -1;
+	
+	if (n_threads < 0)
+		n_threads = (int) g_get_num_processors ();
+	
+	if (n_threads <= 1 || !priv->seekable || priv->respect_content_length)
+		return parser_construct_messages_serial (parser, options, func, user_data);
+	
+	index = parser_index_markers (parser);
+	
+	if (index->len == 0) {
+		g_array_free (index, TRUE);
+		return 0;
+	}
+	
+	source = parser_shared_stream (priv->stream);
+	
+	g_mutex_init (&queue.lock);
+	g_cond_init (&queue.cond);
+	
+	if (!(pool = g_thread_pool_new (parser_job_run, &queue, n_threads, FALSE, NULL))) {
+		g_array_free (index, TRUE);
+		g_mutex_clear (&queue.lock);
+		g_cond_clear (&queue.cond);
+		if (source)
+			g_object_unref (source);
+		return -1;
+	}
+	
+	/* keep a bounded number of messages in flight so that a large
+	 * mbox does not end up entirely in memory */
+	window = (guint) n_threads * 4;
+	jobs = g_new0 (ParserJob *, window);
+	submitted = delivered = 0;
+	
+	while (delivered < index->len) {
+		while (submitted < index->len && submitted - delivered < window) {
+			entry = &g_array_index (index, MarkerIndex, submitted);
+			
+			if (submitted + 1 < index->len) {
+				/* the last \n (or \r\n) belongs to the next From-line */
+				end = entry[1].offset - (entry[1].crlf ? 2 : 1);
+				end = MAX (end, entry->offset);
+			} else {
+				end = priv->stream->bound_end;
+			}
+			
+			job = g_new0 (ParserJob, 1);
+			job->options = options;
+			job->format = priv->format;
+			job->buffer_size = priv->buffer_size;
+			job->persist = priv->persist_stream;
+			job->lazy = priv->lazy_content;
+			job->arena = priv->use_arena;
+			job->offset = entry->offset;
+			
+			if (source != NULL) {
+				job->stream = g_mime_stream_substream (source, entry->offset, end);
+			} else {
+				GMimeStream *substream;
+				
+				substream = g_mime_stream_substream (priv->stream, entry->offset, end);
+				job->stream = g_mime_stream_mem_new ();
+				g_mime_stream_write_to_stream (substream, job->stream);
+				g_mime_stream_reset (job->stream);
+				g_object_unref (substream);
+			}
+			
+			jobs[submitted % window] = job;
+			g_thread_pool_push (pool, job, NULL);
+			submitted++;
+		}
+		
+		job = jobs[delivered % window];
+		
+		g_mutex_lock (&queue.lock);
+		while (!job->done)
+			g_cond_wait (&queue.cond, &queue.lock);
+		g_mutex_unlock (&queue.lock);
+		
+		/* stop at the first message that could not be parsed, just
+		 * like parser_construct_messages_serial() does */
+		if (job->message == NULL)
+			break;
+		
+		func (job->message, job->marker, job->offset, user_data);
+		jobs[delivered % window] = NULL;
+		parser_job_free (job);
+		delivered++;
+	}
+	
+	/* don't bother parsing whatever is still queued if we stopped early */
+	g_thread_pool_free (pool, TRUE, TRUE);
+	g_mutex_clear (&queue.lock);
+	g_cond_clear (&queue.cond);
+	g_array_free (index, TRUE);
+	
+	for (i = 0; i < window; i++) {
+		if (jobs[i] != NULL)
+			parser_job_free (jobs[i]);
+	}
+	
+	g_free (jobs);
+	
+	if (source)
+		g_object_unref (source);
+	
+	return (int) delivered;
 }
 
 
@@ -94,6 +94,19 @@ typedef void (* GMimeParserHeaderRegexFunc) (GMimeParser *parser, const char *he
 					     const char *value, gint64 offset,
 					     gpointer user_data);
 
+/**
+ * GMimeParserMessageFunc:
+ * @message: the message
+ * @marker: (nullable): the mbox-style From-line of the message or %NULL
+ * @offset: the stream offset of the message's From-line (or MMDF marker)
+ * @user_data: The user-supplied callback data.
+ *
+ * Function signature for the callback to
+ * g_mime_parser_construct_messages().
+ **/
+typedef void (* GMimeParserMessageFunc) (GMimeMessage *message, const char *marker,
+					 gint64 offset, gpointer user_data);
+
 
 GType g_mime_parser_get_type (void);
 
@@ -111,12 +124,23 @@ void g_mime_parser_set_format (GMimeParser *parser, GMimeFormat format);
 gboolean g_mime_parser_get_respect_content_length (GMimeParser *parser);
 void g_mime_parser_set_respect_content_length (GMimeParser *parser, gboolean respect_content_length);
 
+gboolean g_mime_parser_get_lazy_content (GMimeParser *parser);
+void g_mime_parser_set_lazy_content (GMimeParser *parser, gboolean lazy_content);
+
+gboolean g_mime_parser_get_use_arena (GMimeParser *parser);
+void g_mime_parser_set_use_arena (GMimeParser *parser, gboolean use_arena);
+
+size_t g_mime_parser_get_buffer_size (GMimeParser *parser);
+void g_mime_parser_set_buffer_size (GMimeParser *parser, size_t size);
+
 void g_mime_parser_set_header_regex (GMimeParser *parser, const char *regex,
 				     GMimeParserHeaderRegexFunc header_cb,
 				     gpointer user_data);
 
 GMimeObject *g_mime_parser_construct_part (GMimeParser *parser, GMimeParserOptions *options);
 GMimeMessage *g_mime_parser_construct_message (GMimeParser *parser, GMimeParserOptions *options);
+int g_mime_parser_construct_messages (GMimeParser *parser, GMimeParserOptions *options, int n_threads,
+				      GMimeParserMessageFunc func, gpointer user_data);
 
 gint64 g_mime_parser_tell (GMimeParser *parser);
 
@@ -75,6 +75,7 @@ static void set_content (GMimePart *mime_part, GMimeDataWrapper *content);
 
 
 static GMimeObjectClass *parent_class = NULL;
+static GQuark lazy_content_quark = 0;
 
 
 GType
@@ -120,6 +121,8 @@ g_mime_part_class_init (GMimePartClass *klass)
 	object_class->encode = mime_part_encode;
 	
 	klass->set_content = set_content;
+	
+	lazy_content_quark = g_quark_from_static_string ("gmime-part-lazy-content");
 }
 
 static void
@@ -149,20 +152,68 @@ g_mime_part_finalize (GObject *object)
 }
 
 
-enum {
-	HEADER_CONTENT_TRANSFER_ENCODING,
-	HEADER_CONTENT_DESCRIPTION,
-	HEADER_CONTENT_LOCATION,
-	HEADER_CONTENT_MD5,
-	HEADER_UNKNOWN
-};
+typedef struct {
+	GMimeContentEncoding encoding;
+	GMimeStream *stream;
+	gint64 start, end;
+} LazyContent;
 
-static const char *content_headers[] = {
-	"Content-Transfer-Encoding",
-	"Content-Description",
-	"Content-Location",
-	"Content-Md5",
-};
+static void
+lazy_content_free (gpointer user_data)
+{
+	LazyContent *lazy = user_data;
+	
+	g_object_unref (lazy->stream);
+	g_slice_free (LazyContent, lazy);
+}
+
+/**
+ * _g_mime_part_set_lazy_content:
+ * @mime_part: a #GMimePart
+ * @stream: the stream that the part was parsed from
+ * @start: the offset of the beginning of the content within @stream
+ * @end: the offset of the end of the content within @stream
+ * @encoding: the encoding of the content
+ *
+ * Records where the content of @mime_part can be found within @stream
+ * without actually creating the content object. The #GMimeDataWrapper
+ * (and the substream of @stream that it wraps) are created the first
+ * time that anything needs the content.
+ **/
+void
+_g_mime_part_set_lazy_content (GMimePart *mime_part, GMimeStream *stream, gint64 start, gint64 end, GMimeContentEncoding encoding)
+{
+	LazyContent *lazy;
+	
+	lazy = g_slice_new (LazyContent);
+	lazy->stream = g_object_ref (stream);
+	lazy->encoding = encoding;
+	lazy->start = start;
+	lazy->end = end;
+	
+	g_object_set_qdata_full ((GObject *) mime_part, lazy_content_quark, lazy, lazy_content_free);
+}
+
+static void
+mime_part_load_content (GMimePart *mime_part)
+{
+	LazyContent *lazy;
+	GMimeStream *stream;
+	
+	if (mime_part->content != NULL)
+		return;
+	
+	if (!(lazy = g_object_steal_qdata ((GObject *) mime_part, lazy_content_quark)))
+		return;
+	
+	/* Note: we don't go through the set_content() vfunc because that
+	 * would forget what the parser figured out about the OpenPGP data */
+	stream = g_mime_stream_substream (lazy->stream, lazy->start, lazy->end);
+	mime_part->content = g_mime_data_wrapper_new_with_stream (stream, lazy->encoding);
+	g_object_unref (stream);
+	
+	lazy_content_free (lazy);
+}
 
 
 static void
@@ -185,37 +236,26 @@ static gboolean
 process_header (GMimeObject *object, GMimeHeader *header)
 {
 	GMimePart *mime_part = (GMimePart *) object;
-	const char *name, *value;
 	char encoding[32];
-	guint i;
-	
-	name = g_mime_header_get_name (header);
-	
-	if (g_ascii_strncasecmp (name, "Content-", 8) != 0)
-		return FALSE;
-	
-	for (i = 0; i < G_N_ELEMENTS (content_headers); i++) {
-		if (!g_ascii_strcasecmp (content_headers[i] + 8, name + 8))
-			break;
-	}
+	const char *value;
 	
-	switch (i) {
-	case HEADER_CONTENT_TRANSFER_ENCODING:
+	switch (_g_mime_header_get_id (header)) {
+	case GMIME_HEADER_ID_CONTENT_TRANSFER_ENCODING:
 		value = g_mime_header_get_value (header);
 		copy_atom (value, encoding, sizeof (encoding) - 1);
 		mime_part->encoding = g_mime_content_encoding_from_string (encoding);
 		break;
-	case HEADER_CONTENT_DESCRIPTION:
+	case GMIME_HEADER_ID_CONTENT_DESCRIPTION:
 		value = g_mime_header_get_value (header);
 		g_free (mime_part->content_description);
 		mime_part->content_description = g_strdup (value);
 		break;
-	case HEADER_CONTENT_LOCATION:
+	case GMIME_HEADER_ID_CONTENT_LOCATION:
 		value = g_mime_header_get_value (header);
 		g_free (mime_part->content_location);
 		mime_part->content_location = g_strdup (value);
 		break;
-	case HEADER_CONTENT_MD5:
+	case GMIME_HEADER_ID_CONTENT_MD5:
 		value = g_mime_header_get_value (header);
 		g_free (mime_part->content_md5);
 		mime_part->content_md5 = g_strdup (value);
@@ -249,36 +289,25 @@ static void
 mime_part_header_removed (GMimeObject *object, GMimeHeader *header)
 {
 	GMimePart *mime_part = (GMimePart *) object;
-	const char *name;
-	guint i;
-	
-	name = g_mime_header_get_name (header);
 	
-	if (!g_ascii_strncasecmp (name, "Content-", 8)) {
-		for (i = 0; i < G_N_ELEMENTS (content_headers); i++) {
-			if (!g_ascii_strcasecmp (content_headers[i] + 8, name + 8))
-				break;
-		}
-		
-		switch (i) {
-		case HEADER_CONTENT_TRANSFER_ENCODING:
-			mime_part->encoding = GMIME_CONTENT_ENCODING_DEFAULT;
-			break;
-		case HEADER_CONTENT_DESCRIPTION:
-			g_free (mime_part->content_description);
-			mime_part->content_description = NULL;
-			break;
-		case HEADER_CONTENT_LOCATION:
-			g_free (mime_part->content_location);
-			mime_part->content_location = NULL;
-			break;
-		case HEADER_CONTENT_MD5:
-			g_free (mime_part->content_md5);
-			mime_part->content_md5 = NULL;
-			break;
-		default:
-			break;
-		}
+	switch (_g_mime_header_get_id (header)) {
+	case GMIME_HEADER_ID_CONTENT_TRANSFER_ENCODING:
+		mime_part->encoding = GMIME_CONTENT_ENCODING_DEFAULT;
+		break;
+	case GMIME_HEADER_ID_CONTENT_DESCRIPTION:
+		g_free (mime_part->content_description);
+		mime_part->content_description = NULL;
+		break;
+	case GMIME_HEADER_ID_CONTENT_LOCATION:
+		g_free (mime_part->content_location);
+		mime_part->content_location = NULL;
+		break;
+	case GMIME_HEADER_ID_CONTENT_MD5:
+		g_free (mime_part->content_md5);
+		mime_part->content_md5 = NULL;
+		break;
+	default:
+		break;
 	}
 	
 	GMIME_OBJECT_CLASS (parent_class)->header_removed (object, header);
@@ -301,6 +330,37 @@ mime_part_headers_cleared (GMimeObject *object)
 }
 
 
+/* if @stream is a splice target, hand it the (already encoded) content
+ * by reference rather than copying it. Returns -1 if @stream is not a
+ * splice target and 0 otherwise: the content only gets read (and its
+ * newlines canonicalized) once the splice target is read back, so no
+ * bytes have actually been written yet. */
+static ssize_t
+splice_content (GMimePart *part, GMimeFormatOptions *options, GMimeStream *content, GMimeStream *stream)
+{
+	GMimeObject *object = (GMimeObject *) part;
+	GMimeStream *substream, *filtered;
+	GMimeFilter *filter;
+	
+	if (!_g_mime_stream_is_splice (stream))
+		return -1;
+	
+	substream = g_mime_stream_substream (content, content->bound_start, content->bound_end);
+	filtered = g_mime_stream_filter_new (substream);
+	g_object_unref (substream);
+	
+	if (part->encoding != GMIME_CONTENT_ENCODING_BINARY) {
+		filter = g_mime_format_options_create_newline_filter (options, object->ensure_newline);
+		g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
+		g_object_unref (filter);
+	}
+	
+	_g_mime_stream_cat_splice (stream, filtered);
+	g_object_unref (filtered);
+	
+	return 0;
+}
+
 static ssize_t
 write_content (GMimePart *part, GMimeFormatOptions *options, GMimeStream *stream)
 {
@@ -309,6 +369,8 @@ write_content (GMimePart *part, GMimeFormatOptions *options, GMimeStream *stream
 	GMimeStream *filtered;
 	GMimeFilter *filter;
 	
+	mime_part_load_content (part);
+	
 	if (!part->content)
 		return 0;
 	
@@ -370,6 +432,10 @@ write_content (GMimePart *part, GMimeFormatOptions *options, GMimeStream *stream
 		GMimeStream *content;
 		
 		content = g_mime_data_wrapper_get_stream (part->content);
+		
+		if ((nwritten = splice_content (part, options, content, stream)) != -1)
+			return nwritten;
+		
 		g_mime_stream_reset (content);
 		
 		filtered = g_mime_stream_filter_new (stream);
@@ -447,6 +513,8 @@ mime_part_encode (GMimeObject *object, GMimeEncodingConstraint constraint)
 		break;
 	}
 	
+	mime_part_load_content (part);
+	
 	filter = g_mime_filter_best_new (GMIME_FILTER_BEST_ENCODING);
 	
 	null = g_mime_stream_null_new ();
@@ -622,6 +690,8 @@ g_mime_part_set_content_md5 (GMimePart *mime_part, const char *content_md5)
 	
 	g_return_if_fail (GMIME_IS_PART (mime_part));
 	
+	mime_part_load_content (mime_part);
+	
 	g_free (mime_part->content_md5);
 	
 	if (!content_md5) {
@@ -683,6 +753,9 @@ g_mime_part_verify_content_md5 (GMimePart *mime_part)
 	size_t len;
 	
 	g_return_val_if_fail (GMIME_IS_PART (mime_part), FALSE);
+	
+	mime_part_load_content (mime_part);
+	
 	g_return_val_if_fail (GMIME_IS_DATA_WRAPPER (mime_part->content), FALSE);
 	
 	if (!mime_part->content_md5)
@@ -843,6 +916,8 @@ g_mime_part_get_best_content_encoding (GMimePart *mime_part, GMimeEncodingConstr
 	
 	g_return_val_if_fail (GMIME_IS_PART (mime_part), GMIME_CONTENT_ENCODING_DEFAULT);
 	
+	mime_part_load_content (mime_part);
+	
 	stream = g_mime_stream_null_new ();
 	filtered = g_mime_stream_filter_new (stream);
 	g_object_unref (stream);
@@ -936,6 +1011,9 @@ g_mime_part_get_filename (GMimePart *mime_part)
 static void
 set_content (GMimePart *mime_part, GMimeDataWrapper *content)
 {
+	/* forget about any content the parser left for us to load lazily */
+	g_object_set_qdata ((GObject *) mime_part, lazy_content_quark, NULL);
+	
 	if (mime_part->content)
 		g_object_unref (mime_part->content);
 	
@@ -980,6 +1058,8 @@ g_mime_part_get_content (GMimePart *mime_part)
 {
 	g_return_val_if_fail (GMIME_IS_PART (mime_part), NULL);
 	
+	mime_part_load_content (mime_part);
+	
 	return mime_part->content;
 }
 
@@ -1015,6 +1095,8 @@ g_mime_part_get_openpgp_data (GMimePart *mime_part)
 {
 	g_return_val_if_fail (GMIME_IS_PART (mime_part), GMIME_OPENPGP_DATA_NONE);
 	
+	mime_part_load_content (mime_part);
+	
 	if (mime_part->content == NULL)
 		return GMIME_OPENPGP_DATA_NONE;
 	
@@ -1064,6 +1146,8 @@ g_mime_part_openpgp_encrypt (GMimePart *mime_part, gboolean sign, const char *us
 	
 	g_return_val_if_fail (GMIME_IS_PART (mime_part), FALSE);
 	
+	mime_part_load_content (mime_part);
+	
 	if (mime_part->content == NULL) {
 		g_set_error_literal (err, GMIME_ERROR, GMIME_ERROR_INVALID_OPERATION,
 				     _("No content set on the MIME part."));
@@ -1123,6 +1207,8 @@ g_mime_part_openpgp_decrypt (GMimePart *mime_part, GMimeDecryptFlags flags, cons
 	
 	g_return_val_if_fail (GMIME_IS_PART (mime_part), FALSE);
 	
+	mime_part_load_content (mime_part);
+	
 	if (mime_part->content == NULL) {
 		g_set_error_literal (err, GMIME_ERROR, GMIME_ERROR_INVALID_OPERATION,
 				     _("No content set on the MIME part."));
@@ -1180,6 +1266,8 @@ g_mime_part_openpgp_sign (GMimePart *mime_part, const char *userid, GError **err
 	
 	g_return_val_if_fail (GMIME_IS_PART (mime_part), FALSE);
 	
+	mime_part_load_content (mime_part);
+	
 	if (mime_part->content == NULL) {
 		g_set_error_literal (err, GMIME_ERROR, GMIME_ERROR_INVALID_OPERATION,
 				     _("No content set on the MIME part."));
@@ -1238,13 +1326,15 @@ g_mime_part_openpgp_verify (GMimePart *mime_part, GMimeVerifyFlags flags, GError
 	
 	g_return_val_if_fail (GMIME_IS_PART (mime_part), FALSE);
 	
+	mime_part_load_content (mime_part);
+	
 	if (mime_part->content == NULL) {
 		g_set_error_literal (err, GMIME_ERROR, GMIME_ERROR_INVALID_OPERATION,
 				     _("No content set on the MIME part."));
 		return NULL;
 	}
 	
-	if (!(ctx = g_mime_crypto_context_new ("application/pgp-signature"))) {
+	if (!(ctx = _g_mime_crypto_context_acquire ("application/pgp-signature"))) {
 		g_set_error_literal (err, GMIME_ERROR, GMIME_ERROR_NOT_SUPPORTED,
 				     _("No crypto context registered for application/pgp-signature."));
 		return NULL;
@@ -1256,8 +1346,8 @@ g_mime_part_openpgp_verify (GMimePart *mime_part, GMimeVerifyFlags flags, GError
 	g_mime_stream_reset (istream);
 	
 	signatures = g_mime_crypto_context_verify (ctx, flags, istream, NULL, extracted, err);
+	_g_mime_crypto_context_release ("application/pgp-signature", ctx);
 	g_object_unref (istream);
-	g_object_unref (ctx);
 	
 	if (signatures == NULL) {
 		g_object_unref (extracted);
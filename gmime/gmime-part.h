@@ -55,6 +55,10 @@ typedef struct _GMimePartClass GMimePartClass;
  * @content: a #GMimeDataWrapper representing the MIME part's content
  *
  * A leaf-node MIME part object.
+ *
+ * Note: If the part was parsed with g_mime_parser_set_lazy_content()
+ * enabled, @content is %NULL until the content is first needed. Use
+ * g_mime_part_get_content() rather than reading @content directly.
  **/
 struct _GMimePart {
 	GMimeObject parent_object;
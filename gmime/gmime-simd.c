@@ -0,0 +1,1007 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#ifdef HAVE_X86_SIMD
+#include <immintrin.h>
+#endif
+
+#include "gmime-simd.h"
+
+#define d(x)
+
+
+/* Runtime CPU dispatch for the vectorized code paths.
+ *
+ * g_mime_simd_init() probes the CPU once (from g_mime_init()) and
+ * every kernel below checks g_mime_simd_flags before using a wider
+ * instruction set, falling back to plain C otherwise.
+ *
+ * Setting the GMIME_SIMD environment variable to "none", "sse2",
+ * "sse4.1" or "avx2" caps the instruction sets that will be used,
+ * which is useful for benchmarking and for testing the fallbacks.
+ */
+
+guint g_mime_simd_flags = 0;
+
+void
+g_mime_simd_init (void)
+{
+	const char *env;
+	guint flags = 0;
+
+#ifdef HAVE_X86_SIMD
+	__builtin_cpu_init ();
+
+	if (__builtin_cpu_supports ("sse2"))
+		flags |= GMIME_SIMD_SSE2;
+	if (__builtin_cpu_supports ("ssse3"))
+		flags |= GMIME_SIMD_SSSE3;
+	if (__builtin_cpu_supports ("sse4.1"))
+		flags |= GMIME_SIMD_SSE41;
+	if (__builtin_cpu_supports ("avx2"))
+		flags |= GMIME_SIMD_AVX2;
+	if (__builtin_cpu_supports ("pclmul"))
+		flags |= GMIME_SIMD_PCLMUL;
+#endif
+
+	if ((env = g_getenv ("GMIME_SIMD")) != NULL) {
+		if (!g_ascii_strcasecmp (env, "none"))
+			flags = 0;
+		else if (!g_ascii_strcasecmp (env, "sse2"))
+			flags &= GMIME_SIMD_SSE2;
+		else if (!g_ascii_strcasecmp (env, "sse4.1"))
+			flags &= ~GMIME_SIMD_AVX2;
+	}
+
+	d(g_printerr ("gmime simd flags: 0x%x\n", flags));
+
+	g_mime_simd_flags = flags;
+}
+
+
+static inline const char *
+scan_line_starts_tail (const char *inptr, const char *inend, const char *last, gboolean bol, char c0, char c1)
+{
+	while (inptr < inend) {
+		if (bol && (*inptr == c0 || *inptr == c1))
+			return inptr;
+
+		if ((bol = *inptr++ == '\n'))
+			last = inptr;
+	}
+
+	return last;
+}
+
+#ifdef HAVE_X86_SIMD
+__attribute__ ((target ("sse2")))
+static const char *
+scan_line_starts_sse2 (const char *inptr, const char *inend, char c0, char c1)
+{
+	const __m128i nl = _mm_set1_epi8 ('\n');
+	const __m128i v0 = _mm_set1_epi8 (c0);
+	const __m128i v1 = _mm_set1_epi8 (c1);
+	unsigned int nls, hits, bol = 1;
+	const char *last = inptr;
+	__m128i block;
+
+	while (inptr + 16 <= inend) {
+		block = _mm_loadu_si128 ((const __m128i *) inptr);
+		nls = (unsigned int) _mm_movemask_epi8 (_mm_cmpeq_epi8 (block, nl));
+		hits = (unsigned int) _mm_movemask_epi8 (_mm_or_si128 (_mm_cmpeq_epi8 (block, v0),
+								       _mm_cmpeq_epi8 (block, v1)));
+
+		/* only characters at the beginning of a line are interesting */
+		if ((hits &= (nls << 1) | bol) != 0)
+			return inptr + __builtin_ctz (hits);
+
+		if (nls != 0)
+			last = inptr + (32 - __builtin_clz (nls));
+
+		bol = (nls >> 15) & 1;
+		inptr += 16;
+	}
+
+	return scan_line_starts_tail (inptr, inend, last, bol, c0, c1);
+}
+
+__attribute__ ((target ("avx2")))
+static const char *
+scan_line_starts_avx2 (const char *inptr, const char *inend, char c0, char c1)
+{
+	const __m256i nl = _mm256_set1_epi8 ('\n');
+	const __m256i v0 = _mm256_set1_epi8 (c0);
+	const __m256i v1 = _mm256_set1_epi8 (c1);
+	unsigned int nls, hits, bol = 1;
+	const char *last = inptr;
+	__m256i block;
+
+	while (inptr + 32 <= inend) {
+		block = _mm256_loadu_si256 ((const __m256i *) inptr);
+		nls = (unsigned int) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (block, nl));
+		hits = (unsigned int) _mm256_movemask_epi8 (_mm256_or_si256 (_mm256_cmpeq_epi8 (block, v0),
+									     _mm256_cmpeq_epi8 (block, v1)));
+
+		/* only characters at the beginning of a line are interesting */
+		if ((hits &= (nls << 1) | bol) != 0)
+			return inptr + __builtin_ctz (hits);
+
+		if (nls != 0)
+			last = inptr + (32 - __builtin_clz (nls));
+
+		bol = nls >> 31;
+		inptr += 32;
+	}
+
+	return scan_line_starts_tail (inptr, inend, last, bol, c0, c1);
+}
+#endif /* HAVE_X86_SIMD */
+
+
+/**
+ * g_mime_simd_scan_line_starts:
+ * @inptr: the beginning of a line
+ * @inend: the end of the input buffer
+ * @c0: a character to look for
+ * @c1: another character to look for
+ *
+ * Scans the lines of the input buffer for the first line that begins
+ * with either @c0 or @c1.
+ *
+ * Returns: a pointer to the beginning of the first line that begins
+ * with @c0 or @c1 or, if there is no such line, a pointer to the
+ * beginning of the last line in the buffer (the only line that is not
+ * terminated by a '\n'), which will be @inend if the buffer ends with
+ * a '\n'.
+ **/
+const char *
+g_mime_simd_scan_line_starts (const char *inptr, const char *inend, char c0, char c1)
+{
+#ifdef HAVE_X86_SIMD
+	if (g_mime_simd_has (GMIME_SIMD_AVX2))
+		return scan_line_starts_avx2 (inptr, inend, c0, c1);
+
+	if (g_mime_simd_has (GMIME_SIMD_SSE2))
+		return scan_line_starts_sse2 (inptr, inend, c0, c1);
+#endif
+
+	return scan_line_starts_tail (inptr, inend, inptr, TRUE, c0, c1);
+}
+
+
+/* Base64
+ *
+ * The vectorized base64 codecs below only ever deal with complete
+ * quantums (3 raw bytes <-> 4 base64 characters) so that the callers
+ * in gmime-encodings.c can hand off to them at quantum boundaries and
+ * pick up where they left off without any change to the state that
+ * they carry across calls.
+ *
+ * The algorithms are the pshufb-based ones described by Wojciech Muła
+ * and Daniel Lemire ("Faster Base64 Encoding and Decoding using AVX2
+ * Instructions").
+ */
+
+#define BASE64_QUANTUMS_PER_LINE 19
+
+#ifdef HAVE_X86_SIMD
+static const char base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static inline unsigned char *
+base64_encode_quantum (const unsigned char *inptr, unsigned char *outptr)
+{
+	*outptr++ = base64_alphabet[inptr[0] >> 2];
+	*outptr++ = base64_alphabet[((inptr[0] & 0x03) << 4) | (inptr[1] >> 4)];
+	*outptr++ = base64_alphabet[((inptr[1] & 0x0f) << 2) | (inptr[2] >> 6)];
+	*outptr++ = base64_alphabet[inptr[2] & 0x3f];
+	
+	return outptr;
+}
+
+/* spreads 12 raw bytes out into 16 6-bit indexes */
+__attribute__ ((target ("sse4.1")))
+static inline __m128i
+base64_enc_reshuffle_sse41 (__m128i in)
+{
+	__m128i t0, t1, t2, t3;
+	
+	in = _mm_shuffle_epi8 (in, _mm_set_epi8 (10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+	t0 = _mm_and_si128 (in, _mm_set1_epi32 (0x0fc0fc00));
+	t1 = _mm_mulhi_epu16 (t0, _mm_set1_epi32 (0x04000040));
+	t2 = _mm_and_si128 (in, _mm_set1_epi32 (0x003f03f0));
+	t3 = _mm_mullo_epi16 (t2, _mm_set1_epi32 (0x01000010));
+	
+	return _mm_or_si128 (t1, t3);
+}
+
+/* maps 16 6-bit indexes to their base64 characters */
+__attribute__ ((target ("sse4.1")))
+static inline __m128i
+base64_enc_translate_sse41 (__m128i in)
+{
+	const __m128i lut = _mm_setr_epi8 (65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+	__m128i indexes;
+	
+	indexes = _mm_subs_epu8 (in, _mm_set1_epi8 (51));
+	indexes = _mm_sub_epi8 (indexes, _mm_cmpgt_epi8 (in, _mm_set1_epi8 (25)));
+	
+	return _mm_add_epi8 (in, _mm_shuffle_epi8 (lut, indexes));
+}
+
+__attribute__ ((target ("sse4.1")))
+static const unsigned char *
+base64_encode_sse41 (const unsigned char *inptr, const unsigned char *inend, unsigned char **out, int *state)
+{
+	unsigned char *outptr = *out;
+	int already = *state;
+	__m128i block;
+	
+	/* each block reads 16 bytes but only consumes 12 of them */
+	while (inend - inptr >= 16) {
+		if (BASE64_QUANTUMS_PER_LINE - already >= 4) {
+			block = _mm_loadu_si128 ((const __m128i *) inptr);
+			block = base64_enc_translate_sse41 (base64_enc_reshuffle_sse41 (block));
+			_mm_storeu_si128 ((__m128i *) outptr, block);
+			already += 4;
+			outptr += 16;
+			inptr += 12;
+		} else {
+			outptr = base64_encode_quantum (inptr, outptr);
+			already++;
+			inptr += 3;
+		}
+		
+		if (already >= BASE64_QUANTUMS_PER_LINE) {
+			*outptr++ = '\n';
+			already = 0;
+		}
+	}
+	
+	*state = already;
+	*out = outptr;
+	
+	return inptr;
+}
+
+/* maps 32 6-bit indexes to their base64 characters */
+__attribute__ ((target ("avx2")))
+static inline __m256i
+base64_enc_translate_avx2 (__m256i in)
+{
+	const __m256i lut = _mm256_setr_epi8 (65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+					      65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+	__m256i indexes;
+	
+	indexes = _mm256_subs_epu8 (in, _mm256_set1_epi8 (51));
+	indexes = _mm256_sub_epi8 (indexes, _mm256_cmpgt_epi8 (in, _mm256_set1_epi8 (25)));
+	
+	return _mm256_add_epi8 (in, _mm256_shuffle_epi8 (lut, indexes));
+}
+
+__attribute__ ((target ("avx2")))
+static const unsigned char *
+base64_encode_avx2 (const unsigned char *inptr, const unsigned char *inend, unsigned char **out, int *state)
+{
+	unsigned char *outptr = *out;
+	int already = *state;
+	__m128i lo, hi;
+	__m256i block;
+	
+	/* each block reads 28 bytes but only consumes 24 of them */
+	while (inend - inptr >= 28) {
+		if (BASE64_QUANTUMS_PER_LINE - already >= 8) {
+			lo = base64_enc_reshuffle_sse41 (_mm_loadu_si128 ((const __m128i *) inptr));
+			hi = base64_enc_reshuffle_sse41 (_mm_loadu_si128 ((const __m128i *) (inptr + 12)));
+			block = _mm256_inserti128_si256 (_mm256_castsi128_si256 (lo), hi, 1);
+			block = base64_enc_translate_avx2 (block);
+			
+			_mm256_storeu_si256 ((__m256i *) outptr, block);
+			already += 8;
+			outptr += 32;
+			inptr += 24;
+		} else if (BASE64_QUANTUMS_PER_LINE - already >= 4) {
+			lo = _mm_loadu_si128 ((const __m128i *) inptr);
+			lo = base64_enc_translate_sse41 (base64_enc_reshuffle_sse41 (lo));
+			_mm_storeu_si128 ((__m128i *) outptr, lo);
+			already += 4;
+			outptr += 16;
+			inptr += 12;
+		} else {
+			outptr = base64_encode_quantum (inptr, outptr);
+			already++;
+			inptr += 3;
+		}
+		
+		if (already >= BASE64_QUANTUMS_PER_LINE) {
+			*outptr++ = '\n';
+			already = 0;
+		}
+	}
+	
+	/* Note: we don't hand off to base64_encode_sse41() for the tail
+	 * because mixing legacy SSE code with AVX code is very slow */
+	while (inend - inptr >= 16) {
+		if (BASE64_QUANTUMS_PER_LINE - already >= 4) {
+			lo = _mm_loadu_si128 ((const __m128i *) inptr);
+			lo = base64_enc_translate_sse41 (base64_enc_reshuffle_sse41 (lo));
+			_mm_storeu_si128 ((__m128i *) outptr, lo);
+			already += 4;
+			outptr += 16;
+			inptr += 12;
+		} else {
+			outptr = base64_encode_quantum (inptr, outptr);
+			already++;
+			inptr += 3;
+		}
+		
+		if (already >= BASE64_QUANTUMS_PER_LINE) {
+			*outptr++ = '\n';
+			already = 0;
+		}
+	}
+	
+	*state = already;
+	*out = outptr;
+	
+	return inptr;
+}
+#endif /* HAVE_X86_SIMD */
+
+
+/**
+ * g_mime_simd_base64_encode:
+ * @inptr: the beginning of the raw input
+ * @inend: the end of the raw input
+ * @outptr: a pointer to the output buffer pointer
+ * @state: the number of quantums already written to the current line
+ *
+ * Base64 encodes as many complete quantums of the input as can be
+ * done efficiently, breaking lines exactly the way that
+ * g_mime_encoding_base64_encode_step() does.
+ *
+ * Returns: a pointer to the first byte of input that was not encoded.
+ * @outptr and @state are updated to reflect the encoded output.
+ **/
+const unsigned char *
+g_mime_simd_base64_encode (const unsigned char *inptr, const unsigned char *inend, unsigned char **outptr, int *state)
+{
+#ifdef HAVE_X86_SIMD
+	if (g_mime_simd_has (GMIME_SIMD_AVX2))
+		return base64_encode_avx2 (inptr, inend, outptr, state);
+	
+	if (g_mime_simd_has (GMIME_SIMD_SSE41))
+		return base64_encode_sse41 (inptr, inend, outptr, state);
+#endif
+	
+	return inptr;
+}
+
+#ifdef HAVE_X86_SIMD
+/* Validates 16 base64 characters and maps them to their 6-bit values.
+ * Returns FALSE if any of them is not in the base64 alphabet (which
+ * includes whitespace and the '=' padding character). */
+__attribute__ ((target ("sse4.1")))
+static inline gboolean
+base64_dec_translate_sse41 (__m128i *block)
+{
+	const __m128i lut_lo = _mm_setr_epi8 (0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+					      0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+	const __m128i lut_hi = _mm_setr_epi8 (0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+					      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m128i lut_roll = _mm_setr_epi8 (0, 16, 19, 4, -65, -65, -71, -71,
+						0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i mask_2f = _mm_set1_epi8 (0x2f);
+	__m128i hi_nibbles, lo_nibbles, hi, lo, roll;
+	
+	hi_nibbles = _mm_and_si128 (_mm_srli_epi32 (*block, 4), mask_2f);
+	lo_nibbles = _mm_and_si128 (*block, mask_2f);
+	hi = _mm_shuffle_epi8 (lut_hi, hi_nibbles);
+	lo = _mm_shuffle_epi8 (lut_lo, lo_nibbles);
+	
+	if (!_mm_testz_si128 (lo, hi))
+		return FALSE;
+	
+	roll = _mm_shuffle_epi8 (lut_roll, _mm_add_epi8 (_mm_cmpeq_epi8 (*block, mask_2f), hi_nibbles));
+	*block = _mm_add_epi8 (*block, roll);
+	
+	return TRUE;
+}
+
+/* packs 16 6-bit values into 12 bytes (in the low 12 bytes of the result) */
+__attribute__ ((target ("sse4.1")))
+static inline __m128i
+base64_dec_reshuffle_sse41 (__m128i in)
+{
+	__m128i out;
+	
+	out = _mm_maddubs_epi16 (in, _mm_set1_epi32 (0x01400140));
+	out = _mm_madd_epi16 (out, _mm_set1_epi32 (0x00011000));
+	
+	return _mm_shuffle_epi8 (out, _mm_setr_epi8 (2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+__attribute__ ((target ("sse4.1")))
+static inline void
+base64_dec_store12_sse41 (unsigned char *outptr, __m128i block)
+{
+	guint32 last = (guint32) _mm_extract_epi32 (block, 2);
+	
+	/* never write past the 12 bytes that we've actually decoded */
+	_mm_storel_epi64 ((__m128i *) outptr, block);
+	memcpy (outptr + 8, &last, 4);
+}
+
+__attribute__ ((target ("sse4.1")))
+static const unsigned char *
+base64_decode_sse41 (const unsigned char *inptr, const unsigned char *inend, unsigned char **out)
+{
+	unsigned char *outptr = *out;
+	__m128i block;
+	
+	while (inend - inptr >= 16) {
+		block = _mm_loadu_si128 ((const __m128i *) inptr);
+		
+		if (!base64_dec_translate_sse41 (&block))
+			break;
+		
+		base64_dec_store12_sse41 (outptr, base64_dec_reshuffle_sse41 (block));
+		outptr += 12;
+		inptr += 16;
+	}
+	
+	*out = outptr;
+	
+	return inptr;
+}
+
+__attribute__ ((target ("avx2")))
+static const unsigned char *
+base64_decode_avx2 (const unsigned char *inptr, const unsigned char *inend, unsigned char **out)
+{
+	const __m256i lut_lo = _mm256_setr_epi8 (0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+						 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+						 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+						 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+	const __m256i lut_hi = _mm256_setr_epi8 (0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+						 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+						 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+						 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+	const __m256i lut_roll = _mm256_setr_epi8 (0, 16, 19, 4, -65, -65, -71, -71,
+						   0, 0, 0, 0, 0, 0, 0, 0,
+						   0, 16, 19, 4, -65, -65, -71, -71,
+						   0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i mask_2f = _mm256_set1_epi8 (0x2f);
+	__m256i block, hi_nibbles, lo_nibbles, hi, lo, roll;
+	unsigned char *outptr = *out;
+	__m128i lo128;
+	
+	while (inend - inptr >= 32) {
+		block = _mm256_loadu_si256 ((const __m256i *) inptr);
+		
+		hi_nibbles = _mm256_and_si256 (_mm256_srli_epi32 (block, 4), mask_2f);
+		lo_nibbles = _mm256_and_si256 (block, mask_2f);
+		hi = _mm256_shuffle_epi8 (lut_hi, hi_nibbles);
+		lo = _mm256_shuffle_epi8 (lut_lo, lo_nibbles);
+		
+		if (!_mm256_testz_si256 (lo, hi))
+			break;
+		
+		roll = _mm256_shuffle_epi8 (lut_roll, _mm256_add_epi8 (_mm256_cmpeq_epi8 (block, mask_2f), hi_nibbles));
+		block = _mm256_add_epi8 (block, roll);
+		
+		block = _mm256_maddubs_epi16 (block, _mm256_set1_epi32 (0x01400140));
+		block = _mm256_madd_epi16 (block, _mm256_set1_epi32 (0x00011000));
+		block = _mm256_shuffle_epi8 (block, _mm256_setr_epi8 (2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+								      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+		
+		/* gather the 12 bytes from each lane into the low 24 bytes */
+		block = _mm256_permutevar8x32_epi32 (block, _mm256_setr_epi32 (0, 1, 2, 4, 5, 6, 3, 7));
+		_mm_storeu_si128 ((__m128i *) outptr, _mm256_castsi256_si128 (block));
+		_mm_storel_epi64 ((__m128i *) (outptr + 16), _mm256_extracti128_si256 (block, 1));
+		outptr += 24;
+		inptr += 32;
+	}
+	
+	/* Note: see base64_encode_avx2() for why this doesn't use base64_decode_sse41() */
+	while (inend - inptr >= 16) {
+		lo128 = _mm_loadu_si128 ((const __m128i *) inptr);
+		
+		if (!base64_dec_translate_sse41 (&lo128))
+			break;
+		
+		base64_dec_store12_sse41 (outptr, base64_dec_reshuffle_sse41 (lo128));
+		outptr += 12;
+		inptr += 16;
+	}
+	
+	*out = outptr;
+	
+	return inptr;
+}
+#endif /* HAVE_X86_SIMD */
+
+
+/**
+ * g_mime_simd_base64_decode:
+ * @inptr: the beginning of the base64 input
+ * @inend: the end of the base64 input
+ * @outptr: a pointer to the output buffer pointer
+ *
+ * Decodes blocks of base64 characters until it reaches a block that
+ * contains anything other than base64 alphabet characters (such as a
+ * line break or padding). @inptr must point to the beginning of a
+ * quantum.
+ *
+ * Returns: a pointer to the first character that was not decoded,
+ * which is always a multiple of 16 characters from @inptr. @outptr is
+ * advanced past the decoded output.
+ **/
+const unsigned char *
+g_mime_simd_base64_decode (const unsigned char *inptr, const unsigned char *inend, unsigned char **outptr)
+{
+#ifdef HAVE_X86_SIMD
+	if (g_mime_simd_has (GMIME_SIMD_AVX2))
+		return base64_decode_avx2 (inptr, inend, outptr);
+	
+	if (g_mime_simd_has (GMIME_SIMD_SSE41))
+		return base64_decode_sse41 (inptr, inend, outptr);
+#endif
+	
+	return inptr;
+}
+
+
+/* Quoted-printable
+ *
+ * Most quoted-printable text is made up of long runs of literal
+ * characters with the occasional '=' escape or soft line break, so the
+ * decoder copies everything up to the next '=' in bulk and only steps
+ * through the escape sequences one character at a time.
+ */
+
+#ifdef HAVE_X86_SIMD
+__attribute__ ((target ("sse2")))
+static const unsigned char *
+qp_copy_literal_sse2 (const unsigned char *inptr, const unsigned char *inend, unsigned char **outptr)
+{
+	const __m128i eq = _mm_set1_epi8 ('=');
+	unsigned char *outbuf = *outptr;
+	unsigned int mask, n;
+	__m128i block;
+	
+	while (inptr + 16 <= inend) {
+		block = _mm_loadu_si128 ((const __m128i *) inptr);
+		
+		if ((mask = (unsigned int) _mm_movemask_epi8 (_mm_cmpeq_epi8 (block, eq))) != 0) {
+			n = __builtin_ctz (mask);
+			memcpy (outbuf, inptr, n);
+			*outptr = outbuf + n;
+			
+			return inptr + n;
+		}
+		
+		_mm_storeu_si128 ((__m128i *) outbuf, block);
+		outbuf += 16;
+		inptr += 16;
+	}
+	
+	*outptr = outbuf;
+	
+	return inptr;
+}
+
+__attribute__ ((target ("avx2")))
+static const unsigned char *
+qp_copy_literal_avx2 (const unsigned char *inptr, const unsigned char *inend, unsigned char **outptr)
+{
+	const __m256i eq = _mm256_set1_epi8 ('=');
+	unsigned char *outbuf = *outptr;
+	unsigned int mask, n;
+	__m256i block;
+	
+	while (inptr + 32 <= inend) {
+		block = _mm256_loadu_si256 ((const __m256i *) inptr);
+		
+		if ((mask = (unsigned int) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (block, eq))) != 0) {
+			n = __builtin_ctz (mask);
+			memcpy (outbuf, inptr, n);
+			*outptr = outbuf + n;
+			
+			return inptr + n;
+		}
+		
+		_mm256_storeu_si256 ((__m256i *) outbuf, block);
+		outbuf += 32;
+		inptr += 32;
+	}
+	
+	*outptr = outbuf;
+	
+	return inptr;
+}
+#endif /* HAVE_X86_SIMD */
+
+
+/**
+ * g_mime_simd_qp_copy_literal:
+ * @inptr: the beginning of the quoted-printable input
+ * @inend: the end of the quoted-printable input
+ * @outptr: a pointer to the output buffer pointer
+ *
+ * Copies the literal characters preceding the next '=' to the output
+ * buffer. Never writes more bytes than it consumes.
+ *
+ * Returns: a pointer to the next '=' or @inend if there is none.
+ * @outptr is advanced past the copied characters.
+ **/
+const unsigned char *
+g_mime_simd_qp_copy_literal (const unsigned char *inptr, const unsigned char *inend, unsigned char **outptr)
+{
+	const unsigned char *eq;
+	size_t n;
+	
+#ifdef HAVE_X86_SIMD
+	if (g_mime_simd_has (GMIME_SIMD_AVX2))
+		inptr = qp_copy_literal_avx2 (inptr, inend, outptr);
+	else if (g_mime_simd_has (GMIME_SIMD_SSE2))
+		inptr = qp_copy_literal_sse2 (inptr, inend, outptr);
+	
+	if (inptr < inend && *inptr == '=')
+		return inptr;
+#endif
+	
+	if (!(eq = memchr (inptr, '=', inend - inptr)))
+		eq = inend;
+	
+	n = eq - inptr;
+	memcpy (*outptr, inptr, n);
+	*outptr += n;
+	
+	return eq;
+}
+
+
+/* Header text
+ *
+ * Most header values are plain 7bit text without a single encoded-word
+ * in them, so the rfc2047 decoder first scans for the only bytes that
+ * could make decoding anything other than a copy: '=' and 8bit bytes.
+ */
+
+#ifdef HAVE_X86_SIMD
+__attribute__ ((target ("sse2")))
+static const char *
+scan_ascii_sse2 (const char *inptr, const char *inend, char c)
+{
+	const __m128i stop = _mm_set1_epi8 (c);
+	unsigned int mask;
+	__m128i block;
+	
+	while (inptr + 16 <= inend) {
+		block = _mm_loadu_si128 ((const __m128i *) inptr);
+		
+		/* the sign bit is set for both 8bit bytes and matches */
+		if ((mask = (unsigned int) _mm_movemask_epi8 (_mm_or_si128 (block, _mm_cmpeq_epi8 (block, stop)))) != 0)
+			return inptr + __builtin_ctz (mask);
+		
+		inptr += 16;
+	}
+	
+	return inptr;
+}
+
+__attribute__ ((target ("avx2")))
+static const char *
+scan_ascii_avx2 (const char *inptr, const char *inend, char c)
+{
+	const __m256i stop = _mm256_set1_epi8 (c);
+	unsigned int mask;
+	__m256i block;
+	
+	while (inptr + 32 <= inend) {
+		block = _mm256_loadu_si256 ((const __m256i *) inptr);
+		
+		if ((mask = (unsigned int) _mm256_movemask_epi8 (_mm256_or_si256 (block, _mm256_cmpeq_epi8 (block, stop)))) != 0)
+			return inptr + __builtin_ctz (mask);
+		
+		inptr += 32;
+	}
+	
+	return inptr;
+}
+#endif /* HAVE_X86_SIMD */
+
+
+/**
+ * g_mime_simd_scan_ascii:
+ * @inptr: the beginning of the input
+ * @inend: the end of the input
+ * @c: a 7bit character to stop at
+ *
+ * Scans for the first byte that is either @c or not 7bit ASCII.
+ *
+ * Returns: a pointer to that byte or @inend if there is none.
+ **/
+const char *
+g_mime_simd_scan_ascii (const char *inptr, const char *inend, char c)
+{
+	const guint64 ones = G_GUINT64_CONSTANT (0x0101010101010101);
+	const guint64 highs = G_GUINT64_CONSTANT (0x8080808080808080);
+	const guint64 stop = ones * (unsigned char) c;
+	guint64 word, x;
+	
+#ifdef HAVE_X86_SIMD
+	if (g_mime_simd_has (GMIME_SIMD_AVX2))
+		inptr = scan_ascii_avx2 (inptr, inend, c);
+	else if (g_mime_simd_has (GMIME_SIMD_SSE2))
+		inptr = scan_ascii_sse2 (inptr, inend, c);
+#endif
+	
+	/* 8 bytes at a time: a byte of x is zero wherever the word matches @c */
+	while (inend - inptr >= 8) {
+		memcpy (&word, inptr, 8);
+		x = word ^ stop;
+		
+		if (((word | ((x - ones) & ~x)) & highs) != 0)
+			break;
+		
+		inptr += 8;
+	}
+	
+	while (inptr < inend && *inptr != c && !(*inptr & 0x80))
+		inptr++;
+	
+	return inptr;
+}
+
+
+/* yEnc
+ *
+ * yEncoded data is almost entirely made up of bytes that decode by
+ * simply subtracting 42; only '=' escapes and line endings need any
+ * thought, so the decoder handles runs of plain bytes in bulk.
+ *
+ * The CRC32 of the (decoded) data is computed by folding 64 bytes at a
+ * time with carry-less multiplication, as described in Intel's "Fast
+ * CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+ */
+
+/* the characters that stop a run of plain yEncoded data */
+#define is_yenc_special(c) ((c) == '=' || (c) == '\r' || (c) == '\n')
+
+#ifdef HAVE_X86_SIMD
+__attribute__ ((target ("sse2")))
+static const unsigned char *
+ydecode_sse2 (const unsigned char *inptr, const unsigned char *inend, unsigned char **outptr)
+{
+	const __m128i eq = _mm_set1_epi8 ('=');
+	const __m128i cr = _mm_set1_epi8 ('\r');
+	const __m128i lf = _mm_set1_epi8 ('\n');
+	const __m128i bias = _mm_set1_epi8 (42);
+	unsigned char *outbuf = *outptr;
+	__m128i block, special;
+	unsigned int mask;
+	
+	while (inptr + 16 <= inend) {
+		block = _mm_loadu_si128 ((const __m128i *) inptr);
+		special = _mm_or_si128 (_mm_cmpeq_epi8 (block, eq),
+					_mm_or_si128 (_mm_cmpeq_epi8 (block, cr), _mm_cmpeq_epi8 (block, lf)));
+		
+		if ((mask = (unsigned int) _mm_movemask_epi8 (special)) != 0) {
+			const unsigned char *stop = inptr + __builtin_ctz (mask);
+			
+			while (inptr < stop)
+				*outbuf++ = *inptr++ - 42;
+			
+			break;
+		}
+		
+		_mm_storeu_si128 ((__m128i *) outbuf, _mm_sub_epi8 (block, bias));
+		outbuf += 16;
+		inptr += 16;
+	}
+	
+	*outptr = outbuf;
+	
+	return inptr;
+}
+
+__attribute__ ((target ("avx2")))
+static const unsigned char *
+ydecode_avx2 (const unsigned char *inptr, const unsigned char *inend, unsigned char **outptr)
+{
+	const __m256i eq = _mm256_set1_epi8 ('=');
+	const __m256i cr = _mm256_set1_epi8 ('\r');
+	const __m256i lf = _mm256_set1_epi8 ('\n');
+	const __m256i bias = _mm256_set1_epi8 (42);
+	unsigned char *outbuf = *outptr;
+	__m256i block, special;
+	unsigned int mask;
+	
+	while (inptr + 32 <= inend) {
+		block = _mm256_loadu_si256 ((const __m256i *) inptr);
+		special = _mm256_or_si256 (_mm256_cmpeq_epi8 (block, eq),
+					   _mm256_or_si256 (_mm256_cmpeq_epi8 (block, cr), _mm256_cmpeq_epi8 (block, lf)));
+		
+		if ((mask = (unsigned int) _mm256_movemask_epi8 (special)) != 0) {
+			const unsigned char *stop = inptr + __builtin_ctz (mask);
+			
+			while (inptr < stop)
+				*outbuf++ = *inptr++ - 42;
+			
+			break;
+		}
+		
+		_mm256_storeu_si256 ((__m256i *) outbuf, _mm256_sub_epi8 (block, bias));
+		outbuf += 32;
+		inptr += 32;
+	}
+	
+	*outptr = outbuf;
+	
+	return inptr;
+}
+
+__attribute__ ((target ("pclmul,sse4.1")))
+static const unsigned char *
+crc32_pclmul (const unsigned char *inptr, const unsigned char *inend, guint32 *crc)
+{
+	const __m128i k1k2 = _mm_set_epi64x (0x01c6e41596, 0x0154442bd4);
+	const __m128i k3k4 = _mm_set_epi64x (0x00ccaa009e, 0x01751997d0);
+	const __m128i k5k0 = _mm_set_epi64x (0x0000000000, 0x0163cd6124);
+	const __m128i poly = _mm_set_epi64x (0x01f7011641, 0x01db710641);
+	const __m128i mask32 = _mm_setr_epi32 (~0, 0, ~0, 0);
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+	
+	if (inptr + 64 > inend)
+		return inptr;
+	
+	x1 = _mm_xor_si128 (_mm_loadu_si128 ((const __m128i *) inptr), _mm_cvtsi32_si128 ((int) *crc));
+	x2 = _mm_loadu_si128 ((const __m128i *) (inptr + 16));
+	x3 = _mm_loadu_si128 ((const __m128i *) (inptr + 32));
+	x4 = _mm_loadu_si128 ((const __m128i *) (inptr + 48));
+	inptr += 64;
+	
+	/* fold 4 x 128 bits at a time */
+	while (inptr + 64 <= inend) {
+		x5 = _mm_clmulepi64_si128 (x1, k1k2, 0x00);
+		x6 = _mm_clmulepi64_si128 (x2, k1k2, 0x00);
+		x7 = _mm_clmulepi64_si128 (x3, k1k2, 0x00);
+		x8 = _mm_clmulepi64_si128 (x4, k1k2, 0x00);
+		
+		x1 = _mm_clmulepi64_si128 (x1, k1k2, 0x11);
+		x2 = _mm_clmulepi64_si128 (x2, k1k2, 0x11);
+		x3 = _mm_clmulepi64_si128 (x3, k1k2, 0x11);
+		x4 = _mm_clmulepi64_si128 (x4, k1k2, 0x11);
+		
+		x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x5), _mm_loadu_si128 ((const __m128i *) inptr));
+		x2 = _mm_xor_si128 (_mm_xor_si128 (x2, x6), _mm_loadu_si128 ((const __m128i *) (inptr + 16)));
+		x3 = _mm_xor_si128 (_mm_xor_si128 (x3, x7), _mm_loadu_si128 ((const __m128i *) (inptr + 32)));
+		x4 = _mm_xor_si128 (_mm_xor_si128 (x4, x8), _mm_loadu_si128 ((const __m128i *) (inptr + 48)));
+		inptr += 64;
+	}
+	
+	/* fold the 4 lanes into one */
+	x5 = _mm_clmulepi64_si128 (x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128 (x1, k3k4, 0x11);
+	x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x2), x5);
+	
+	x5 = _mm_clmulepi64_si128 (x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128 (x1, k3k4, 0x11);
+	x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x3), x5);
+	
+	x5 = _mm_clmulepi64_si128 (x1, k3k4, 0x00);
+	x1 = _mm_clmulepi64_si128 (x1, k3k4, 0x11);
+	x1 = _mm_xor_si128 (_mm_xor_si128 (x1, x4), x5);
+	
+	/* fold in any remaining 128-bit blocks */
+	while (inptr + 16 <= inend) {
+		x5 = _mm_clmulepi64_si128 (x1, k3k4, 0x00);
+		x1 = _mm_clmulepi64_si128 (x1, k3k4, 0x11);
+		x1 = _mm_xor_si128 (_mm_xor_si128 (x1, _mm_loadu_si128 ((const __m128i *) inptr)), x5);
+		inptr += 16;
+	}
+	
+	/* reduce 128 bits to 64 */
+	x2 = _mm_clmulepi64_si128 (x1, k3k4, 0x10);
+	x1 = _mm_xor_si128 (_mm_srli_si128 (x1, 8), x2);
+	
+	x2 = _mm_srli_si128 (x1, 4);
+	x1 = _mm_and_si128 (x1, mask32);
+	x1 = _mm_clmulepi64_si128 (x1, k5k0, 0x00);
+	x1 = _mm_xor_si128 (x1, x2);
+	
+	/* Barrett reduction down to 32 bits */
+	x2 = _mm_and_si128 (x1, mask32);
+	x2 = _mm_clmulepi64_si128 (x2, poly, 0x10);
+	x2 = _mm_and_si128 (x2, mask32);
+	x2 = _mm_clmulepi64_si128 (x2, poly, 0x00);
+	x1 = _mm_xor_si128 (x1, x2);
+	
+	*crc = (guint32) _mm_extract_epi32 (x1, 1);
+	
+	return inptr;
+}
+#endif /* HAVE_X86_SIMD */
+
+
+/**
+ * g_mime_simd_ydecode:
+ * @inptr: the beginning of the yEncoded input
+ * @inend: the end of the yEncoded input
+ * @outptr: a pointer to the output buffer pointer
+ *
+ * Decodes the plain characters preceding the next '=', '\r' or '\n'
+ * to the output buffer. Never writes more bytes than it consumes.
+ *
+ * Returns: a pointer to the next special character or @inend if there
+ * is none. @outptr is advanced past the decoded characters.
+ **/
+const unsigned char *
+g_mime_simd_ydecode (const unsigned char *inptr, const unsigned char *inend, unsigned char **outptr)
+{
+	unsigned char *outbuf;
+	
+#ifdef HAVE_X86_SIMD
+	if (g_mime_simd_has (GMIME_SIMD_AVX2))
+		inptr = ydecode_avx2 (inptr, inend, outptr);
+	else if (g_mime_simd_has (GMIME_SIMD_SSE2))
+		inptr = ydecode_sse2 (inptr, inend, outptr);
+#endif
+	
+	outbuf = *outptr;
+	while (inptr < inend && !is_yenc_special (*inptr))
+		*outbuf++ = *inptr++ - 42;
+	
+	*outptr = outbuf;
+	
+	return inptr;
+}
+
+
+/**
+ * g_mime_simd_crc32:
+ * @inptr: the beginning of the input
+ * @inend: the end of the input
+ * @crc: the (pre-inverted) CRC32 state
+ *
+ * Updates @crc with as much of the input as can be folded efficiently,
+ * which may be none of it.
+ *
+ * Returns: a pointer to the remaining input, which is always less than
+ * 16 bytes if any input was consumed.
+ **/
+const unsigned char *
+g_mime_simd_crc32 (const unsigned char *inptr, const unsigned char *inend, guint32 *crc)
+{
+#ifdef HAVE_X86_SIMD
+	if (g_mime_simd_has (GMIME_SIMD_PCLMUL) && g_mime_simd_has (GMIME_SIMD_SSE41))
+		return crc32_pclmul (inptr, inend, crc);
+#endif
+	
+	return inptr;
+}
@@ -0,0 +1,65 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public License
+ *  as published by the Free Software Foundation; either version 2.1
+ *  of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free
+ *  Software Foundation, 51 Franklin Street, Fifth Floor, Boston, MA
+ *  02110-1301, USA.
+ */
+
+
+#ifndef __GMIME_SIMD_H__
+#define __GMIME_SIMD_H__
+
+#include <sys/types.h>
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* CPU features the vectorized code paths may use */
+enum {
+	GMIME_SIMD_SSE2   = (1 << 0),
+	GMIME_SIMD_SSSE3  = (1 << 1),
+	GMIME_SIMD_SSE41  = (1 << 2),
+	GMIME_SIMD_AVX2   = (1 << 3),
+	GMIME_SIMD_PCLMUL = (1 << 4)
+};
+
+G_GNUC_INTERNAL extern guint g_mime_simd_flags;
+
+#define g_mime_simd_has(flag) ((g_mime_simd_flags & (flag)) != 0)
+
+G_GNUC_INTERNAL void g_mime_simd_init (void);
+
+G_GNUC_INTERNAL const char *g_mime_simd_scan_line_starts (const char *inptr, const char *inend, char c0, char c1);
+
+G_GNUC_INTERNAL const unsigned char *g_mime_simd_base64_encode (const unsigned char *inptr, const unsigned char *inend,
+								unsigned char **outptr, int *state);
+G_GNUC_INTERNAL const unsigned char *g_mime_simd_base64_decode (const unsigned char *inptr, const unsigned char *inend,
+								unsigned char **outptr);
+
+G_GNUC_INTERNAL const unsigned char *g_mime_simd_qp_copy_literal (const unsigned char *inptr, const unsigned char *inend,
+								  unsigned char **outptr);
+
+G_GNUC_INTERNAL const char *g_mime_simd_scan_ascii (const char *inptr, const char *inend, char c);
+
+G_GNUC_INTERNAL const unsigned char *g_mime_simd_ydecode (const unsigned char *inptr, const unsigned char *inend,
+							  unsigned char **outptr);
+G_GNUC_INTERNAL const unsigned char *g_mime_simd_crc32 (const unsigned char *inptr, const unsigned char *inend,
+							guint32 *crc);
+
+G_END_DECLS
+
+#endif /* __GMIME_SIMD_H__ */
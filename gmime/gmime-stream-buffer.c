@@ -27,6 +27,7 @@
 #include <errno.h>
 
 #include "gmime-stream-buffer.h"
+#include "gmime-internal.h"
 
 /**
  * SECTION: gmime-stream-buffer
@@ -52,6 +53,7 @@ static void g_mime_stream_buffer_finalize (GObject *object);
 
 static ssize_t stream_read (GMimeStream *stream, char *buf, size_t len);
 static ssize_t stream_write (GMimeStream *stream, const char *buf, size_t len);
+static gint64 stream_writev (GMimeStream *stream, GMimeStreamIOVector *vector, size_t count);
 static int stream_flush (GMimeStream *stream);
 static int stream_close (GMimeStream *stream);
 static gboolean stream_eos (GMimeStream *stream);
@@ -110,6 +112,8 @@ g_mime_stream_buffer_class_init (GMimeStreamBufferClass *klass)
 	stream_class->tell = stream_tell;
 	stream_class->length = stream_length;
 	stream_class->substream = stream_substream;
+	
+	GMIME_STREAM_CLASS_GET_PRIVATE (stream_class)->writev = stream_writev;
 }
 
 static void
@@ -262,6 +266,47 @@ stream_write (GMimeStream *stream, const char *buf, size_t len)
 	return nwritten;
 }
 
+static gint64
+stream_writev (GMimeStream *stream, GMimeStreamIOVector *vector, size_t count)
+{
+	GMimeStreamBuffer *buffer = (GMimeStreamBuffer *) stream;
+	size_t total = 0;
+	gint64 nwritten;
+	size_t i;
+	
+	if (buffer->source == NULL) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	if (buffer->mode != GMIME_STREAM_BUFFER_BLOCK_WRITE) {
+		/* nothing gets buffered, so let the source write them all at once */
+		if ((nwritten = g_mime_stream_writev (buffer->source, vector, count)) == -1)
+			return -1;
+		
+		stream->position += nwritten;
+		
+		return nwritten;
+	}
+	
+	for (i = 0; i < count; i++)
+		total += vector[i].len;
+	
+	if (total > BLOCK_BUFFER_LEN - buffer->buflen)
+		return GMIME_STREAM_CLASS_GET_PRIVATE (parent_class)->writev (stream, vector, count);
+	
+	/* it all fits, so gather it into our pending write buffer */
+	for (i = 0; i < count; i++) {
+		memcpy (buffer->bufptr, vector[i].data, vector[i].len);
+		buffer->bufptr += vector[i].len;
+	}
+	
+	buffer->buflen += total;
+	stream->position += total;
+	
+	return total;
+}
+
 static int
 stream_flush (GMimeStream *stream)
 {
@@ -26,6 +26,8 @@
 #include <errno.h>
 
 #include "gmime-stream-cat.h"
+#include "gmime-stream-mem.h"
+#include "gmime-internal.h"
 
 #define d(x)
 
@@ -149,9 +151,12 @@ stream_read (GMimeStream *stream, char *buf, size_t len)
 	if (!(current = cat->current))
 		return -1;
 	
-	/* make sure our stream position is where it should be */
+	/* make sure our stream position is where it should be (sources
+	 * that cannot tell, such as filter streams, can only be read
+	 * sequentially) */
 	offset = current->stream->bound_start + current->position;
-	if (g_mime_stream_seek (current->stream, offset, GMIME_STREAM_SEEK_SET) == -1)
+	if (g_mime_stream_tell (current->stream) != -1 &&
+	    g_mime_stream_seek (current->stream, offset, GMIME_STREAM_SEEK_SET) == -1)
 		return -1;
 	
 	do {
@@ -724,3 +729,89 @@ g_mime_stream_cat_add_source (GMimeStreamCat *cat, GMimeStream *source)
 	
 	return 0;
 }
+
+
+/* A splice target is a memory stream that collects whatever is written
+ * to it, but also lets the writer splice in whole streams by reference
+ * (so that e.g. large MIME part content does not need to be copied).
+ * Reading back the result is done via the #GMimeStreamCat returned by
+ * _g_mime_stream_cat_splice_finish(). */
+
+static GQuark
+splice_quark (void)
+{
+	static GQuark quark = 0;
+	
+	if (quark == 0)
+		quark = g_quark_from_static_string ("gmime-stream-cat-splice");
+	
+	return quark;
+}
+
+GMimeStream *
+_g_mime_stream_cat_splice_new (void)
+{
+	GMimeStream *stream;
+	
+	stream = g_mime_stream_mem_new ();
+	g_object_set_qdata_full ((GObject *) stream, splice_quark (), g_mime_stream_cat_new (), g_object_unref);
+	
+	return stream;
+}
+
+gboolean
+_g_mime_stream_is_splice (GMimeStream *stream)
+{
+	return g_object_get_qdata ((GObject *) stream, splice_quark ()) != NULL;
+}
+
+static void
+splice_flush (GMimeStream *stream, GMimeStreamCat *cat)
+{
+	GByteArray *buffer = ((GMimeStreamMem *) stream)->buffer;
+	GMimeStream *pending;
+	
+	if (buffer->len == 0)
+		return;
+	
+	pending = g_mime_stream_mem_new_with_buffer ((const char *) buffer->data, buffer->len);
+	g_mime_stream_cat_add_source (cat, pending);
+	g_object_unref (pending);
+	
+	g_byte_array_set_size (buffer, 0);
+	g_mime_stream_reset (stream);
+}
+
+gboolean
+_g_mime_stream_cat_splice (GMimeStream *stream, GMimeStream *source)
+{
+	GMimeStreamCat *cat;
+	
+	if (!(cat = g_object_get_qdata ((GObject *) stream, splice_quark ())))
+		return FALSE;
+	
+	splice_flush (stream, cat);
+	g_mime_stream_cat_add_source (cat, source);
+	
+	return TRUE;
+}
+
+GMimeStream *
+_g_mime_stream_cat_splice_finish (GMimeStream *stream)
+{
+	GMimeStreamCat *cat;
+	
+	cat = g_object_steal_qdata ((GObject *) stream, splice_quark ());
+	splice_flush (stream, cat);
+	
+	if (cat->sources == NULL) {
+		GMimeStream *empty = g_mime_stream_mem_new ();
+		
+		g_mime_stream_cat_add_source (cat, empty);
+		g_object_unref (empty);
+	}
+	
+	g_mime_stream_reset ((GMimeStream *) cat);
+	
+	return (GMimeStream *) cat;
+}
@@ -26,6 +26,11 @@
 #include <string.h>
 
 #include "gmime-stream-filter.h"
+#include "gmime-filter-basic.h"
+#include "gmime-filter-charset.h"
+#include "gmime-filter-dos2unix.h"
+#include "gmime-filter-unix2dos.h"
+#include "gmime-internal.h"
 
 
 /**
@@ -41,17 +46,32 @@
  *
  * When data passes through a #GMimeStreamFilter, it will pass through
  * #GMimeFilter filters in the order they were added.
+ *
+ * Some common pairs of adjacent filters (a base64 decoder followed by
+ * a #GMimeFilterDos2Unix, a #GMimeFilterUnix2Dos followed by a base64
+ * encoder, or a quoted-printable decoder followed by a
+ * #GMimeFilterCharset converting to UTF-8) are recognized and run as a
+ * single fused pass over the data. The output is identical to running
+ * the filters one after the other.
  **/
 
 
 #define READ_PAD (64)		/* bytes padded before buffer */
 #define READ_SIZE (4096)
 
+#define FUSE_CHUNK (2048)	/* input bytes per chunk in the fused kernels */
+
 #define _PRIVATE(o) (((GMimeStreamFilter *)(o))->priv)
 
+typedef void (* FusedFilterFunc) (GMimeFilter *first, GMimeFilter *second,
+				  char *inbuf, size_t inlen, char **outbuf,
+				  size_t *outlen, size_t *outprespace,
+				  gboolean flush);
+
 struct _filter {
 	struct _filter *next;
 	GMimeFilter *filter;
+	FusedFilterFunc fused;  /* non-NULL if this filter and the next can be run as one */
 	int id;
 };
 
@@ -65,6 +85,8 @@ struct _GMimeStreamFilterPrivate {
 	char *filtered;		/* the filtered data */
 	size_t filteredlen;
 	
+	GByteArray *gather;	/* scratch buffer for writev */
+	
 	int last_was_read:1;	/* was the last op read or write? */
 	int flushed:1;          /* have the filters been flushed? */
 };
@@ -74,6 +96,8 @@ static void g_mime_stream_filter_init (GMimeStreamFilter *stream, GMimeStreamFil
 static void g_mime_stream_filter_finalize (GObject *object);
 
 static ssize_t stream_read (GMimeStream *stream, char *buf, size_t n);
+static ssize_t stream_borrow (GMimeStream *stream, const char **buf, size_t n);
+static gint64 stream_writev (GMimeStream *stream, GMimeStreamIOVector *vector, size_t count);
 static ssize_t stream_write (GMimeStream *stream, const char *buf, size_t n);
 static int stream_flush (GMimeStream *stream);
 static int stream_close (GMimeStream *stream);
@@ -133,6 +157,9 @@ g_mime_stream_filter_class_init (GMimeStreamFilterClass *klass)
 	stream_class->tell = stream_tell;
 	stream_class->length = stream_length;
 	stream_class->substream = stream_substream;
+	
+	GMIME_STREAM_CLASS_GET_PRIVATE (stream_class)->borrow = stream_borrow;
+	GMIME_STREAM_CLASS_GET_PRIVATE (stream_class)->writev = stream_writev;
 }
 
 static void
@@ -148,6 +175,7 @@ g_mime_stream_filter_init (GMimeStreamFilter *stream, GMimeStreamFilterClass *kl
 	stream->priv->last_was_read = TRUE;
 	stream->priv->filteredlen = 0;
 	stream->priv->flushed = FALSE;
+	stream->priv->gather = NULL;
 }
 
 static void
@@ -165,6 +193,9 @@ g_mime_stream_filter_finalize (GObject *object)
 		f = fn;
 	}
 	
+	if (p->gather)
+		g_byte_array_free (p->gather, TRUE);
+	
 	g_free (p->realbuffer);
 	g_free (p);
 	
@@ -175,57 +206,352 @@ g_mime_stream_filter_finalize (GObject *object)
 }
 
 
+/* dos2unix conversion that may be done in place (@outptr <= @inptr)
+ * as long as there is a byte of room for a '\r' held over from the
+ * previous call */
+static char *
+dos2unix_convert (GMimeFilterDos2Unix *dos2unix, char *outptr, const char *inptr, const char *inend)
+{
+	const char *cr;
+	size_t n;
+	char c;
+	
+	while (inptr < inend) {
+		if (dos2unix->pc != '\r') {
+			/* everything up to the next '\r' passes through untouched */
+			if (!(cr = memchr (inptr, '\r', inend - inptr)))
+				cr = inend;
+			
+			if ((n = cr - inptr) > 0) {
+				if (outptr != inptr)
+					memmove (outptr, inptr, n);
+				dos2unix->pc = cr[-1];
+				outptr += n;
+				inptr = cr;
+			}
+			
+			if (inptr == inend)
+				break;
+		}
+		
+		c = *inptr++;
+		
+		if (c == '\n') {
+			*outptr++ = c;
+		} else {
+			if (dos2unix->pc == '\r')
+				*outptr++ = '\r';
+			
+			if (c != '\r')
+				*outptr++ = c;
+		}
+		
+		dos2unix->pc = c;
+	}
+	
+	return outptr;
+}
+
+static void
+fused_base64_decode_dos2unix (GMimeFilter *first, GMimeFilter *second, char *inbuf, size_t inlen,
+			      char **outbuf, size_t *outlen, size_t *outprespace, gboolean flush)
+{
+	GMimeEncoding *encoder = &((GMimeFilterBasic *) first)->encoder;
+	GMimeFilterDos2Unix *dos2unix = (GMimeFilterDos2Unix *) second;
+	char *outptr, *decoded;
+	size_t n, nwritten;
+	
+	/* room for the decoded data, a held over '\r' and a trailing '\n' */
+	g_mime_filter_set_size (first, inlen + 5, FALSE);
+	outptr = first->outbuf;
+	
+	/* decode a chunk at a time just ahead of the output and convert
+	 * the line endings while the chunk is still in the cache */
+	while (inlen > 0) {
+		n = MIN (inlen, FUSE_CHUNK);
+		decoded = outptr + 1;
+		
+		nwritten = g_mime_encoding_base64_decode_step ((const unsigned char *) inbuf, n, (unsigned char *) decoded,
+							       &encoder->state, &encoder->save);
+		outptr = dos2unix_convert (dos2unix, outptr, decoded, decoded + nwritten);
+		inbuf += n;
+		inlen -= n;
+	}
+	
+	if (flush && dos2unix->ensure_newline && dos2unix->pc != '\n')
+		dos2unix->pc = *outptr++ = '\n';
+	
+	*outlen = outptr - first->outbuf;
+	*outprespace = first->outpre;
+	*outbuf = first->outbuf;
+}
+
+static size_t
+unix2dos_convert (GMimeFilterUnix2Dos *unix2dos, char *outbuf, const char *inptr, const char *inend)
+{
+	char *outptr = outbuf;
+	const char *lf;
+	size_t n;
+	
+	while (inptr < inend) {
+		/* everything up to the next '\n' passes through untouched */
+		if (!(lf = memchr (inptr, '\n', inend - inptr)))
+			lf = inend;
+		
+		if ((n = lf - inptr) > 0) {
+			memcpy (outptr, inptr, n);
+			unix2dos->pc = lf[-1];
+			outptr += n;
+			inptr = lf;
+		}
+		
+		if (inptr == inend)
+			break;
+		
+		if (unix2dos->pc != '\r')
+			*outptr++ = '\r';
+		*outptr++ = '\n';
+		
+		unix2dos->pc = *inptr++;
+	}
+	
+	return outptr - outbuf;
+}
+
+static void
+fused_unix2dos_base64_encode (GMimeFilter *first, GMimeFilter *second, char *inbuf, size_t inlen,
+			      char **outbuf, size_t *outlen, size_t *outprespace, gboolean flush)
+{
+	GMimeFilterUnix2Dos *unix2dos = (GMimeFilterUnix2Dos *) first;
+	GMimeEncoding *encoder = &((GMimeFilterBasic *) second)->encoder;
+	unsigned char *outptr;
+	char buf[FUSE_CHUNK * 2 + 2];
+	size_t n, len;
+	
+	g_mime_filter_set_size (second, GMIME_BASE64_ENCODE_LEN (inlen * 2 + 2), FALSE);
+	outptr = (unsigned char *) second->outbuf;
+	
+	do {
+		n = MIN (inlen, FUSE_CHUNK);
+		len = unix2dos_convert (unix2dos, buf, inbuf, inbuf + n);
+		inbuf += n;
+		inlen -= n;
+		
+		if (flush && inlen == 0) {
+			if (unix2dos->ensure_newline && unix2dos->pc != '\n') {
+				if (unix2dos->pc != '\r')
+					buf[len++] = '\r';
+				buf[len++] = '\n';
+			}
+			
+			outptr += g_mime_encoding_base64_encode_close ((const unsigned char *) buf, len, outptr,
+								       &encoder->state, &encoder->save);
+		} else {
+			outptr += g_mime_encoding_base64_encode_step ((const unsigned char *) buf, len, outptr,
+								      &encoder->state, &encoder->save);
+		}
+	} while (inlen > 0);
+	
+	*outlen = (char *) outptr - second->outbuf;
+	*outprespace = second->outpre;
+	*outbuf = second->outbuf;
+}
+
+static void
+fused_qp_decode_charset (GMimeFilter *first, GMimeFilter *second, char *inbuf, size_t inlen,
+			 char **outbuf, size_t *outlen, size_t *outprespace, gboolean flush)
+{
+	GMimeEncoding *encoder = &((GMimeFilterBasic *) first)->encoder;
+	const unsigned short *table = _g_mime_filter_charset_get_sbcs_table ((GMimeFilterCharset *) second);
+	char buf[FUSE_CHUNK + 2];
+	char *outptr;
+	size_t n, len;
+	
+	g_mime_filter_set_size (second, (inlen + 2) * 3 + 16, FALSE);
+	outptr = second->outbuf;
+	
+	while (inlen > 0) {
+		n = MIN (inlen, FUSE_CHUNK);
+		len = g_mime_encoding_quoted_decode_step ((const unsigned char *) inbuf, n, (unsigned char *) buf,
+							  &encoder->state, &encoder->save);
+		
+		/* like GMimeFilterCharset, invalid bytes are simply dropped */
+		outptr += _g_mime_charset_sbcs_to_utf8 (table, buf, len, outptr, '\0', NULL);
+		inbuf += n;
+		inlen -= n;
+	}
+	
+	*outlen = outptr - second->outbuf;
+	*outprespace = second->outpre;
+	*outbuf = second->outbuf;
+}
+
+static FusedFilterFunc
+filter_get_fused (GMimeFilter *first, GMimeFilter *second)
+{
+	GMimeEncoding *encoder;
+	
+	/* only exact types are fused; subclasses may override the filter methods */
+	if (G_OBJECT_TYPE (first) == GMIME_TYPE_FILTER_BASIC) {
+		encoder = &((GMimeFilterBasic *) first)->encoder;
+		
+		if (encoder->encode)
+			return NULL;
+		
+		if (encoder->encoding == GMIME_CONTENT_ENCODING_BASE64 &&
+		    G_OBJECT_TYPE (second) == GMIME_TYPE_FILTER_DOS2UNIX)
+			return fused_base64_decode_dos2unix;
+		
+		if (encoder->encoding == GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE &&
+		    G_OBJECT_TYPE (second) == GMIME_TYPE_FILTER_CHARSET &&
+		    _g_mime_filter_charset_get_sbcs_table ((GMimeFilterCharset *) second) != NULL)
+			return fused_qp_decode_charset;
+	} else if (G_OBJECT_TYPE (first) == GMIME_TYPE_FILTER_UNIX2DOS &&
+		   G_OBJECT_TYPE (second) == GMIME_TYPE_FILTER_BASIC) {
+		encoder = &((GMimeFilterBasic *) second)->encoder;
+		
+		if (encoder->encode && encoder->encoding == GMIME_CONTENT_ENCODING_BASE64)
+			return fused_unix2dos_base64_encode;
+	}
+	
+	return NULL;
+}
+
+static void
+filters_fuse (struct _filter *f)
+{
+	while (f != NULL) {
+		f->fused = f->next ? filter_get_fused (f->filter, f->next->filter) : NULL;
+		f = f->next;
+	}
+}
+
+static void
+filters_run (struct _filter *f, char *inbuf, size_t inlen, size_t prespace,
+	     char **outbuf, size_t *outlen, size_t *outprespace, gboolean flush)
+{
+	while (f != NULL) {
+		/* a filter with backed up data needs the generic path to prepend it */
+		if (f->fused && f->filter->backlen == 0 && f->next->filter->backlen == 0) {
+			f->fused (f->filter, f->next->filter, inbuf, inlen, &inbuf, &inlen, &prespace, flush);
+			f = f->next->next;
+			continue;
+		}
+		
+		if (flush)
+			g_mime_filter_complete (f->filter, inbuf, inlen, prespace, &inbuf, &inlen, &prespace);
+		else
+			g_mime_filter_filter (f->filter, inbuf, inlen, prespace, &inbuf, &inlen, &prespace);
+		
+		f = f->next;
+	}
+	
+	*outprespace = prespace;
+	*outbuf = inbuf;
+	*outlen = inlen;
+}
+
+/* reads the next block from the source and runs it through the filters */
+static ssize_t
+stream_fill (GMimeStreamFilter *filter)
+{
+	struct _GMimeStreamFilterPrivate *priv = filter->priv;
+	size_t presize = READ_PAD;
+	ssize_t nread;
+	
+	nread = g_mime_stream_read (filter->source, priv->buffer, READ_SIZE);
+	if (nread <= 0) {
+		/* this is somewhat untested */
+		if (g_mime_stream_eos (filter->source) && !priv->flushed) {
+			filters_run (priv->filters, priv->buffer, 0, presize, &priv->filtered,
+				     &priv->filteredlen, &presize, TRUE);
+			
+			nread = priv->filteredlen;
+			priv->flushed = TRUE;
+		}
+		
+		return nread;
+	}
+	
+	priv->flushed = FALSE;
+	
+	filters_run (priv->filters, priv->buffer, nread, presize, &priv->filtered,
+		     &priv->filteredlen, &presize, FALSE);
+	
+	return priv->filteredlen;
+}
+
+/* with no filters to run, the source's data can be handed over as-is */
+static ssize_t
+stream_passthrough (GMimeStreamFilter *filter, ssize_t nread)
+{
+	struct _GMimeStreamFilterPrivate *priv = filter->priv;
+	
+	if (nread <= 0 && g_mime_stream_eos (filter->source) && !priv->flushed) {
+		priv->flushed = TRUE;
+		return 0;
+	}
+	
+	if (nread > 0)
+		priv->flushed = FALSE;
+	
+	return nread;
+}
+
 static ssize_t
 stream_read (GMimeStream *stream, char *buf, size_t n)
 {
 	GMimeStreamFilter *filter = (GMimeStreamFilter *) stream;
 	struct _GMimeStreamFilterPrivate *priv = filter->priv;
-	struct _filter *f;
 	ssize_t nread;
 	
 	priv->last_was_read = TRUE;
 	
 	if (priv->filteredlen <= 0) {
-		size_t presize = READ_PAD;
+		if (priv->filters == NULL)
+			return stream_passthrough (filter, g_mime_stream_read (filter->source, buf, n));
 		
-		nread = g_mime_stream_read (filter->source, priv->buffer, READ_SIZE);
-		if (nread <= 0) {
-			/* this is somewhat untested */
-			if (g_mime_stream_eos (filter->source) && !priv->flushed) {
-				priv->filtered = priv->buffer;
-				priv->filteredlen = 0;
-				f = priv->filters;
-				
-				while (f != NULL) {
-					g_mime_filter_complete (f->filter, priv->filtered, priv->filteredlen,
-								presize, &priv->filtered, &priv->filteredlen,
-								&presize);
-					f = f->next;
-				}
-				
-				nread = priv->filteredlen;
-				priv->flushed = TRUE;
-			}
+		if ((nread = stream_fill (filter)) <= 0)
+			return nread;
+	}
+	
+	nread = MIN (n, priv->filteredlen);
+	memcpy (buf, priv->filtered, nread);
+	priv->filteredlen -= nread;
+	priv->filtered += nread;
+	
+	return nread;
+}
+
+static ssize_t
+stream_borrow (GMimeStream *stream, const char **buf, size_t n)
+{
+	GMimeStreamFilter *filter = (GMimeStreamFilter *) stream;
+	struct _GMimeStreamFilterPrivate *priv = filter->priv;
+	ssize_t nread;
+	
+	priv->last_was_read = TRUE;
+	
+	if (priv->filteredlen <= 0) {
+		if (priv->filters == NULL) {
+			if (_g_mime_stream_can_lend (filter->source))
+				return stream_passthrough (filter, g_mime_stream_borrow (filter->source, buf, n));
 			
-			if (nread <= 0)
-				return nread;
-		} else {
-			priv->filtered = priv->buffer;
-			priv->filteredlen = nread;
-			priv->flushed = FALSE;
-			f = priv->filters;
+			/* read into our own buffer rather than making the
+			 * source allocate one that outlives this call */
+			nread = g_mime_stream_read (filter->source, priv->buffer, MIN (n, READ_SIZE));
+			*buf = priv->buffer;
 			
-			while (f != NULL) {
-				g_mime_filter_filter (f->filter, priv->filtered, priv->filteredlen, presize,
-						      &priv->filtered, &priv->filteredlen, &presize);
-				
-				f = f->next;
-			}
+			return stream_passthrough (filter, nread);
 		}
+		
+		if ((nread = stream_fill (filter)) <= 0)
+			return nread;
 	}
 	
+	/* lend out the output of the last filter rather than copying it */
 	nread = MIN (n, priv->filteredlen);
-	memcpy (buf, priv->filtered, nread);
+	*buf = priv->filtered;
 	priv->filteredlen -= nread;
 	priv->filtered += nread;
 	
@@ -239,19 +565,12 @@ stream_write (GMimeStream *stream, const char *buf, size_t n)
 	struct _GMimeStreamFilterPrivate *priv = filter->priv;
 	char *buffer = (char *) buf;
 	ssize_t nwritten = n;
-	struct _filter *f;
 	size_t presize;
 	
 	priv->last_was_read = FALSE;
 	priv->flushed = FALSE;
 	
-	f = priv->filters;
-	presize = 0;
-	while (f != NULL) {
-		g_mime_filter_filter (f->filter, buffer, n, presize, &buffer, &n, &presize);
-		
-		f = f->next;
-	}
+	filters_run (priv->filters, buffer, n, 0, &buffer, &n, &presize, FALSE);
 	
 	if (g_mime_stream_write (filter->source, buffer, n) == -1)
 		return -1;
@@ -260,13 +579,41 @@ stream_write (GMimeStream *stream, const char *buf, size_t n)
 	return nwritten;
 }
 
+static gint64
+stream_writev (GMimeStream *stream, GMimeStreamIOVector *vector, size_t count)
+{
+	GMimeStreamFilter *filter = (GMimeStreamFilter *) stream;
+	struct _GMimeStreamFilterPrivate *priv = filter->priv;
+	size_t i;
+	
+	if (priv->filters == NULL) {
+		priv->last_was_read = FALSE;
+		priv->flushed = FALSE;
+		
+		return g_mime_stream_writev (filter->source, vector, count);
+	}
+	
+	/* gather everything up so that the filters only run once and the
+	 * source gets a single write */
+	if (priv->gather == NULL)
+		priv->gather = g_byte_array_new ();
+	
+	g_byte_array_set_size (priv->gather, 0);
+	for (i = 0; i < count; i++)
+		g_byte_array_append (priv->gather, vector[i].data, vector[i].len);
+	
+	if (stream_write (stream, (const char *) priv->gather->data, priv->gather->len) == -1)
+		return -1;
+	
+	return priv->gather->len;
+}
+
 static int
 stream_flush (GMimeStream *stream)
 {
 	GMimeStreamFilter *filter = (GMimeStreamFilter *) stream;
 	struct _GMimeStreamFilterPrivate *priv = filter->priv;
 	size_t presize, len;
-	struct _filter *f;
 	char *buffer;
 	
 	if (priv->last_was_read) {
@@ -274,16 +621,7 @@ stream_flush (GMimeStream *stream)
 		return 0;
 	}
 	
-	buffer = "";
-	len = 0;
-	presize = 0;
-	f = priv->filters;
-	
-	while (f != NULL) {
-		g_mime_filter_complete (f->filter, buffer, len, presize, &buffer, &len, &presize);
-		
-		f = f->next;
-	}
+	filters_run (priv->filters, "", 0, 0, &buffer, &len, &presize, TRUE);
 	
 	if (len > 0 && g_mime_stream_write (filter->source, buffer, len) == -1)
 		return -1;
@@ -392,6 +730,7 @@ stream_substream (GMimeStream *stream, gint64 start, gint64 end)
 		}
 		
 		s->next = NULL;
+		filters_fuse (sub->priv->filters);
 		
 		sub->priv->filterid = filter->priv->filterid;
 	}
@@ -465,6 +804,8 @@ g_mime_stream_filter_add (GMimeStreamFilter *stream, GMimeFilter *filter)
 	f->next = fn;
 	fn->next = NULL;
 	
+	filters_fuse (priv->filters);
+	
 	return fn->id;
 }
 
@@ -500,6 +841,8 @@ g_mime_stream_filter_remove (GMimeStreamFilter *stream, int id)
 		}
 		f = f->next;
 	}
+	
+	filters_fuse (priv->filters);
 }
 
 
@@ -28,13 +28,24 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
 
 #include "gmime-stream-fs.h"
+#include "gmime-internal.h"
 #include "gmime-error.h"
 
+#if defined (HAVE_SYS_UIO_H) && defined (HAVE_WRITEV)
+#define USE_WRITEV 1
+
+/* the most vectors handed to a single writev() call */
+#define FS_IOV_MAX 64
+#endif
+
 #ifndef HAVE_FSYNC
 #ifdef G_OS_WIN32
 /* _commit() is the equivalent of fsync() on Windows, but it aborts the
@@ -71,6 +82,9 @@ static gint64 stream_seek (GMimeStream *stream, gint64 offset, GMimeSeekWhence w
 static gint64 stream_tell (GMimeStream *stream);
 static gint64 stream_length (GMimeStream *stream);
 static GMimeStream *stream_substream (GMimeStream *stream, gint64 start, gint64 end);
+#ifdef USE_WRITEV
+static gint64 stream_writev (GMimeStream *stream, GMimeStreamIOVector *vector, size_t count);
+#endif
 
 
 static GMimeStreamClass *parent_class = NULL;
@@ -121,6 +135,10 @@ g_mime_stream_fs_class_init (GMimeStreamFsClass *klass)
 	stream_class->tell = stream_tell;
 	stream_class->length = stream_length;
 	stream_class->substream = stream_substream;
+	
+#ifdef USE_WRITEV
+	GMIME_STREAM_CLASS_GET_PRIVATE (stream_class)->writev = stream_writev;
+#endif
 }
 
 static void
@@ -223,6 +241,74 @@ stream_write (GMimeStream *stream, const char *buf, size_t len)
 	return nwritten;
 }
 
+#ifdef USE_WRITEV
+static gint64
+stream_writev (GMimeStream *stream, GMimeStreamIOVector *vector, size_t count)
+{
+	GMimeStreamFs *fs = (GMimeStreamFs *) stream;
+	struct iovec iov[FS_IOV_MAX];
+	size_t offset = 0, skip, i = 0, j, n;
+	gint64 total = 0;
+	ssize_t nwritten;
+	
+	if (fs->fd == -1) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	/* writes to a bounded stream need to be clamped one at a time */
+	if (stream->bound_end != -1)
+		return GMIME_STREAM_CLASS_GET_PRIVATE (parent_class)->writev (stream, vector, count);
+	
+	/* make sure we are at the right position */
+	if (lseek (fs->fd, (off_t) stream->position, SEEK_SET) == -1)
+		return -1;
+	
+	while (i < count) {
+		/* @offset is how much of vector[i] has already been written */
+		for (n = 0, j = i, skip = offset; j < count && n < FS_IOV_MAX; j++, skip = 0) {
+			if (vector[j].len > skip) {
+				iov[n].iov_base = (char *) vector[j].data + skip;
+				iov[n].iov_len = vector[j].len - skip;
+				n++;
+			}
+		}
+		
+		if (n == 0)
+			break;
+		
+		do {
+			nwritten = writev (fs->fd, iov, (int) n);
+		} while (nwritten == -1 && (errno == EINTR || errno == EAGAIN));
+		
+		if (nwritten == -1) {
+			if (errno == EFBIG || errno == ENOSPC)
+				fs->eos = TRUE;
+			
+			/* like stream_write(), only fail if nothing was written */
+			return total > 0 ? total : -1;
+		}
+		
+		if (nwritten == 0)
+			break;
+		
+		stream->position += nwritten;
+		total += nwritten;
+		
+		/* skip past whatever got written */
+		while (i < count && (size_t) nwritten >= vector[i].len - offset) {
+			nwritten -= vector[i].len - offset;
+			offset = 0;
+			i++;
+		}
+		
+		offset += nwritten;
+	}
+	
+	return total;
+}
+#endif
+
 static int
 stream_flush (GMimeStream *stream)
 {
@@ -27,6 +27,7 @@
 #include <errno.h>
 
 #include "gmime-stream-mem.h"
+#include "gmime-internal.h"
 
 
 /**
@@ -54,6 +55,8 @@ static gint64 stream_seek (GMimeStream *stream, gint64 offset, GMimeSeekWhence w
 static gint64 stream_tell (GMimeStream *stream);
 static gint64 stream_length (GMimeStream *stream);
 static GMimeStream *stream_substream (GMimeStream *stream, gint64 start, gint64 end);
+static ssize_t stream_borrow (GMimeStream *stream, const char **buf, size_t len);
+static gint64 stream_writev (GMimeStream *stream, GMimeStreamIOVector *vector, size_t count);
 
 
 static GMimeStreamClass *parent_class = NULL;
@@ -104,6 +107,9 @@ g_mime_stream_mem_class_init (GMimeStreamMemClass *klass)
 	stream_class->tell = stream_tell;
 	stream_class->length = stream_length;
 	stream_class->substream = stream_substream;
+	
+	GMIME_STREAM_CLASS_GET_PRIVATE (stream_class)->borrow = stream_borrow;
+	GMIME_STREAM_CLASS_GET_PRIVATE (stream_class)->writev = stream_writev;
 }
 
 static void
@@ -150,6 +156,32 @@ stream_read (GMimeStream *stream, char *buf, size_t len)
 	return n;
 }
 
+static ssize_t
+stream_borrow (GMimeStream *stream, const char **buf, size_t len)
+{
+	GMimeStreamMem *mem = (GMimeStreamMem *) stream;
+	gint64 bound_end;
+	ssize_t n;
+	
+	if (mem->buffer == NULL) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	bound_end = stream->bound_end != -1 ? stream->bound_end : (gint64) mem->buffer->len;
+	
+	n = (size_t) MIN (bound_end - stream->position, (gint64) len);
+	if (n > 0) {
+		*buf = (const char *) mem->buffer->data + stream->position;
+		stream->position += n;
+	} else if (n < 0) {
+		errno = EINVAL;
+		n = -1;
+	}
+	
+	return n;
+}
+
 static ssize_t
 stream_write (GMimeStream *stream, const char *buf, size_t len)
 {
@@ -182,6 +214,41 @@ stream_write (GMimeStream *stream, const char *buf, size_t len)
 	return n;
 }
 
+static gint64
+stream_writev (GMimeStream *stream, GMimeStreamIOVector *vector, size_t count)
+{
+	GMimeStreamMem *mem = (GMimeStreamMem *) stream;
+	unsigned char *outptr;
+	size_t total = 0;
+	size_t i;
+	
+	if (mem->buffer == NULL) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	/* writes to a bounded stream need to be clamped one at a time */
+	if (stream->bound_end != -1)
+		return GMIME_STREAM_CLASS_GET_PRIVATE (parent_class)->writev (stream, vector, count);
+	
+	for (i = 0; i < count; i++)
+		total += vector[i].len;
+	
+	/* grow the buffer once and then gather everything into it */
+	if (stream->position + total > mem->buffer->len)
+		g_byte_array_set_size (mem->buffer, (guint) (stream->position + total));
+	
+	outptr = mem->buffer->data + stream->position;
+	for (i = 0; i < count; i++) {
+		memcpy (outptr, vector[i].data, vector[i].len);
+		outptr += vector[i].len;
+	}
+	
+	stream->position += total;
+	
+	return total;
+}
+
 static int
 stream_flush (GMimeStream *stream)
 {
@@ -34,6 +34,7 @@
 #include <errno.h>
 
 #include "gmime-stream-mmap.h"
+#include "gmime-internal.h"
 
 
 /**
@@ -63,6 +64,7 @@ static gint64 stream_seek (GMimeStream *stream, gint64 offset, GMimeSeekWhence w
 static gint64 stream_tell (GMimeStream *stream);
 static gint64 stream_length (GMimeStream *stream);
 static GMimeStream *stream_substream (GMimeStream *stream, gint64 start, gint64 end);
+static ssize_t stream_borrow (GMimeStream *stream, const char **buf, size_t len);
 
 
 static GMimeStreamClass *parent_class = NULL;
@@ -113,6 +115,8 @@ g_mime_stream_mmap_class_init (GMimeStreamMmapClass *klass)
 	stream_class->tell = stream_tell;
 	stream_class->length = stream_length;
 	stream_class->substream = stream_substream;
+	
+	GMIME_STREAM_CLASS_GET_PRIVATE (stream_class)->borrow = stream_borrow;
 }
 
 static void
@@ -170,6 +174,39 @@ stream_read (GMimeStream *stream, char *buf, size_t len)
 	return nread;
 }
 
+static ssize_t
+stream_borrow (GMimeStream *stream, const char **buf, size_t len)
+{
+	GMimeStreamMmap *mm = (GMimeStreamMmap *) stream;
+	char *mapptr;
+	ssize_t nread;
+	
+	if (mm->fd == -1) {
+		errno = EBADF;
+		return -1;
+	}
+	
+	if (stream->bound_end != -1 && stream->position >= stream->bound_end) {
+		errno = EINVAL;
+		return -1;
+	}
+	
+	mapptr = mm->map + stream->position;
+	
+	if (stream->bound_end == -1)
+		nread = MIN ((gint64) ((mm->map + mm->maplen) - mapptr), (gint64) len);
+	else
+		nread = MIN (stream->bound_end - stream->position, (gint64) len);
+	
+	if (nread > 0) {
+		*buf = mapptr;
+		stream->position += nread;
+	} else
+		mm->eos = TRUE;
+	
+	return nread;
+}
+
 static ssize_t
 stream_write (GMimeStream *stream, const char *buf, size_t len)
 {
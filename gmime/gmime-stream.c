@@ -23,9 +23,21 @@
 #include <config.h>
 #endif
 
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
 #include <string.h>
+#include <unistd.h>
+#include <errno.h>
 
 #include "gmime-stream.h"
+#include "gmime-stream-fs.h"
+#include "gmime-stream-mem.h"
+#include "gmime-stream-mmap.h"
+#include "gmime-internal.h"
 
 #define d(x)
 
@@ -48,6 +60,8 @@ static void g_mime_stream_init (GMimeStream *stream, GMimeStreamClass *klass);
 static void g_mime_stream_finalize (GObject *object);
 
 static ssize_t stream_read (GMimeStream *stream, char *buf, size_t len);
+static ssize_t stream_borrow (GMimeStream *stream, const char **buf, size_t len);
+static gint64 stream_writev (GMimeStream *stream, GMimeStreamIOVector *vector, size_t count);
 static ssize_t stream_write (GMimeStream *stream, const char *buf, size_t len);
 static int stream_flush (GMimeStream *stream);
 static int stream_close (GMimeStream *stream);
@@ -60,6 +74,7 @@ static GMimeStream *stream_substream (GMimeStream *stream, gint64 start, gint64
 
 
 static GObjectClass *parent_class = NULL;
+static GQuark borrow_buffer_quark = 0;
 
 
 GType
@@ -82,6 +97,10 @@ g_mime_stream_get_type (void)
 		
 		type = g_type_register_static (G_TYPE_OBJECT, "GMimeStream",
 					       &info, G_TYPE_FLAG_ABSTRACT);
+		
+		/* methods added since 3.0 live here so that the layout
+		 * of GMimeStreamClass stays the same */
+		g_type_add_class_private (type, sizeof (GMimeStreamClassPrivate));
 	}
 	
 	return type;
@@ -91,9 +110,11 @@ g_mime_stream_get_type (void)
 static void
 g_mime_stream_class_init (GMimeStreamClass *klass)
 {
+	GMimeStreamClassPrivate *priv = GMIME_STREAM_CLASS_GET_PRIVATE (klass);
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 	
 	parent_class = g_type_class_ref (G_TYPE_OBJECT);
+	borrow_buffer_quark = g_quark_from_static_string ("gmime-stream-borrow-buffer");
 	
 	object_class->finalize = g_mime_stream_finalize;
 	
@@ -107,6 +128,9 @@ g_mime_stream_class_init (GMimeStreamClass *klass)
 	klass->tell = stream_tell;
 	klass->length = stream_length;
 	klass->substream = stream_substream;
+	
+	priv->borrow = stream_borrow;
+	priv->writev = stream_writev;
 }
 
 static void
@@ -179,6 +203,76 @@ g_mime_stream_read (GMimeStream *stream, char *buf, size_t len)
 }
 
 
+/* the most the default borrow implementation will read at a time */
+#define BORROW_BUFSIZE (64 * 1024)
+
+static ssize_t
+stream_borrow (GMimeStream *stream, const char **buf, size_t len)
+{
+	GByteArray *buffer;
+	ssize_t nread;
+	
+	/* streams that have no buffer of their own to lend out get one
+	 * that lives as long as they do */
+	if (!(buffer = g_object_get_qdata ((GObject *) stream, borrow_buffer_quark))) {
+		buffer = g_byte_array_new ();
+		g_object_set_qdata_full ((GObject *) stream, borrow_buffer_quark, buffer,
+					 (GDestroyNotify) g_byte_array_unref);
+	}
+	
+	len = MIN (len, BORROW_BUFSIZE);
+	if (buffer->len < len)
+		g_byte_array_set_size (buffer, len);
+	
+	if ((nread = g_mime_stream_read (stream, (char *) buffer->data, len)) > 0)
+		*buf = (const char *) buffer->data;
+	
+	return nread;
+}
+
+
+/**
+ * g_mime_stream_borrow:
+ * @stream: a #GMimeStream
+ * @buf: (out) (array length=len) (element-type guint8) (transfer none): pointer to the data
+ * @len: the maximum number of bytes to borrow
+ *
+ * Attempts to read up to @len bytes from @stream, but rather than
+ * copying them into a caller-supplied buffer, points @buf at the data
+ * where it already lives (the memory of a #GMimeStreamMem or
+ * #GMimeStreamMmap or the output of the filters of a
+ * #GMimeStreamFilter, for example). Streams that keep no such data
+ * read into a buffer of their own instead.
+ *
+ * The data is owned by @stream and is only valid until the next
+ * operation on @stream.
+ *
+ * Returns: the number of bytes borrowed, %0 at the end of the stream or
+ * %-1 on fail.
+ **/
+ssize_t
+g_mime_stream_borrow (GMimeStream *stream, const char **buf, size_t len)
+{
+	g_return_val_if_fail (GMIME_IS_STREAM (stream), -1);
+	g_return_val_if_fail (buf != NULL, -1);
+	
+	*buf = NULL;
+	
+	if (len == 0)
+		return 0;
+	
+	return GMIME_STREAM_CLASS_GET_PRIVATE (GMIME_STREAM_GET_CLASS (stream))->borrow (stream, buf, len);
+}
+
+/* whether @stream has data of its own to lend out or whether borrowing
+ * from it would have to read into a buffer kept just for the purpose */
+gboolean
+_g_mime_stream_can_lend (GMimeStream *stream)
+{
+	return GMIME_STREAM_CLASS_GET_PRIVATE (GMIME_STREAM_GET_CLASS (stream))->borrow != stream_borrow;
+}
+
+
 static ssize_t
 stream_write (GMimeStream *stream, const char *buf, size_t len)
 {
@@ -528,6 +622,150 @@ g_mime_stream_printf (GMimeStream *stream, const char *fmt, ...)
 }
 
 
+/* if @stream is backed by memory (a #GMimeStreamMem or a mapped
+ * #GMimeStreamMmap), returns the start of that memory and sets @end to
+ * the offset just past the last byte that belongs to @stream (its
+ * bound_end, if it has one). Otherwise returns %NULL and leaves @end
+ * alone. Offsets such as stream->position index directly into the
+ * returned memory. */
+const char *
+_g_mime_stream_get_memory (GMimeStream *stream, gint64 *end)
+{
+	if (GMIME_IS_STREAM_MEM (stream)) {
+		GMimeStreamMem *mem = (GMimeStreamMem *) stream;
+		
+		if (mem->buffer == NULL)
+			return NULL;
+		
+		*end = stream->bound_end != -1 ? stream->bound_end : (gint64) mem->buffer->len;
+		
+		return (const char *) mem->buffer->data;
+	}
+	
+	if (GMIME_IS_STREAM_MMAP (stream)) {
+		GMimeStreamMmap *mm = (GMimeStreamMmap *) stream;
+		
+		if (mm->fd == -1 || mm->map == NULL)
+			return NULL;
+		
+		*end = stream->bound_end != -1 ? stream->bound_end : (gint64) mm->maplen;
+		
+		return mm->map;
+	}
+	
+	return NULL;
+}
+
+/* the most we hand to g_mime_stream_write() at a time so that filter
+ * streams don't have to grow their buffers to the size of the source */
+#define WRITE_FROM_MEMORY_MAX (1024 * 1024)
+
+/* write the remainder of a memory-backed stream straight out of its
+ * buffer rather than bouncing it through an intermediate one */
+static gint64
+write_memory_to_stream (GMimeStream *src, GMimeStream *dest)
+{
+	const char *data;
+	gint64 total = 0;
+	ssize_t nwritten;
+	gint64 end;
+	
+	/* re-fetch the buffer each time around in case writing to
+	 * @dest caused it to be reallocated */
+	while ((data = _g_mime_stream_get_memory (src, &end)) != NULL && src->position < end) {
+		size_t len = (size_t) MIN (end - src->position, WRITE_FROM_MEMORY_MAX);
+		
+		if ((nwritten = g_mime_stream_write (dest, data + src->position, len)) < 0)
+			return -1;
+		
+		src->position += nwritten;
+		total += nwritten;
+	}
+	
+	if (GMIME_IS_STREAM_MMAP (src))
+		((GMimeStreamMmap *) src)->eos = TRUE;
+	
+	return total;
+}
+
+#if defined (HAVE_COPY_FILE_RANGE) || defined (HAVE_SENDFILE)
+/* the most we ask the kernel to copy in a single call */
+#define KERNEL_COPY_MAX (0x7ffff000)
+
+/* let the kernel copy file data from @src to @dest without it ever
+ * passing through userspace; stops at the first error so that the
+ * caller can finish up (or report the error) the slow way */
+static gint64
+copy_fd_to_fd (GMimeStream *src, GMimeStream *dest)
+{
+	GMimeStreamFs *in = (GMimeStreamFs *) src;
+	GMimeStreamFs *out = (GMimeStreamFs *) dest;
+#ifdef HAVE_COPY_FILE_RANGE
+	gboolean use_copy_file_range = TRUE;
+#endif
+	gint64 total = 0;
+	ssize_t n;
+	size_t len;
+	
+	while (!in->eos) {
+		if (src->bound_end != -1) {
+			if (src->position >= src->bound_end)
+				break;
+			
+			len = (size_t) MIN (src->bound_end - src->position, KERNEL_COPY_MAX);
+		} else {
+			len = KERNEL_COPY_MAX;
+		}
+		
+		n = -1;
+		
+#ifdef HAVE_COPY_FILE_RANGE
+		if (use_copy_file_range) {
+			loff_t inoff = src->position, outoff = dest->position;
+			
+			if ((n = copy_file_range (in->fd, &inoff, out->fd, &outoff, len, 0)) == -1) {
+				if (errno == EINTR)
+					continue;
+				
+				/* unsupported for this pair of files (cross-fs, O_APPEND, old
+				 * kernel, etc) - try sendfile() instead */
+				use_copy_file_range = FALSE;
+			}
+		}
+#endif
+		
+#ifdef HAVE_SENDFILE
+		if (n == -1) {
+			off_t inoff = src->position;
+			
+			if (lseek (out->fd, (off_t) dest->position, SEEK_SET) == -1)
+				break;
+			
+			if ((n = sendfile (out->fd, in->fd, &inoff, len)) == -1 && errno == EINTR)
+				continue;
+		}
+#endif
+		
+		if (n == -1)
+			break;
+		
+		if (n == 0) {
+			in->eos = TRUE;
+			break;
+		}
+		
+		src->position += n;
+		dest->position += n;
+		total += n;
+	}
+	
+	return total;
+}
+#endif
+
+/* the most read from the source at a time when there is no faster way to copy */
+#define WRITE_TO_STREAM_BUFSIZE (64 * 1024)
+
 /**
  * g_mime_stream_write_to_stream:
  * @src: source stream
@@ -541,15 +779,42 @@ gint64
 g_mime_stream_write_to_stream (GMimeStream *src, GMimeStream *dest)
 {
 	ssize_t nread, nwritten;
+	char *buffer = NULL;
 	gint64 total = 0;
-	char buf[4096];
+	const char *buf;
+	gint64 end;
 	
 	g_return_val_if_fail (GMIME_IS_STREAM (src), -1);
 	g_return_val_if_fail (GMIME_IS_STREAM (dest), -1);
 	
+	if (src != dest && _g_mime_stream_get_memory (src, &end) != NULL)
+		return write_memory_to_stream (src, dest);
+	
+#if defined (HAVE_COPY_FILE_RANGE) || defined (HAVE_SENDFILE)
+	if (GMIME_IS_STREAM_FS (src) && GMIME_IS_STREAM_FS (dest) && dest->bound_end == -1)
+		total = copy_fd_to_fd (src, dest);
+#endif
+	
+	if (g_mime_stream_eos (src))
+		return total;
+	
+	/* borrowing lets filter streams hand over their output without it
+	 * being copied into yet another buffer first, but streams with
+	 * nothing of their own to lend are read into a buffer that only
+	 * lives as long as this call */
+	if (!_g_mime_stream_can_lend (src))
+		buffer = g_malloc (WRITE_TO_STREAM_BUFSIZE);
+	
 	while (!g_mime_stream_eos (src)) {
-		if ((nread = g_mime_stream_read (src, buf, sizeof (buf))) < 0)
-			return -1;
+		if (buffer != NULL) {
+			nread = g_mime_stream_read (src, buffer, WRITE_TO_STREAM_BUFSIZE);
+			buf = buffer;
+		} else {
+			nread = g_mime_stream_borrow (src, &buf, WRITE_TO_STREAM_BUFSIZE);
+		}
+		
+		if (nread < 0)
+			goto exception;
 		
 		if (nread > 0) {
 			nwritten = 0;
@@ -557,7 +822,7 @@ g_mime_stream_write_to_stream (GMimeStream *src, GMimeStream *dest)
 				ssize_t len;
 				
 				if ((len = g_mime_stream_write (dest, buf + nwritten, nread - nwritten)) < 0)
-					return -1;
+					goto exception;
 				
 				nwritten += len;
 			}
@@ -566,28 +831,23 @@ g_mime_stream_write_to_stream (GMimeStream *src, GMimeStream *dest)
 		}
 	}
 	
+	g_free (buffer);
+	
 	return total;
+	
+ exception:
+	g_free (buffer);
+	
+	return -1;
 }
 
 
-/**
- * g_mime_stream_writev:
- * @stream: a #GMimeStream
- * @vector: a #GMimeStreamIOVector
- * @count: number of vector elements
- *
- * Writes at most @count blocks described by @vector to @stream.
- *
- * Returns: the number of bytes written or %-1 on fail.
- **/
-gint64
-g_mime_stream_writev (GMimeStream *stream, GMimeStreamIOVector *vector, size_t count)
+static gint64
+stream_writev (GMimeStream *stream, GMimeStreamIOVector *vector, size_t count)
 {
 	gint64 total = 0;
 	size_t i;
 	
-	g_return_val_if_fail (GMIME_IS_STREAM (stream), -1);
-	
 	for (i = 0; i < count; i++) {
 		char *buffer = vector[i].data;
 		size_t nwritten = 0;
@@ -606,3 +866,29 @@ g_mime_stream_writev (GMimeStream *stream, GMimeStreamIOVector *vector, size_t c
 	
 	return total;
 }
+
+
+/**
+ * g_mime_stream_writev:
+ * @stream: a #GMimeStream
+ * @vector: a #GMimeStreamIOVector
+ * @count: number of vector elements
+ *
+ * Writes at most @count blocks described by @vector to @stream.
+ *
+ * Streams that are able to will write all of the blocks at once
+ * (e.g. using writev() for a #GMimeStreamFs), which is a lot cheaper
+ * than writing them one at a time with g_mime_stream_write().
+ *
+ * Returns: the number of bytes written or %-1 on fail.
+ **/
+gint64
+g_mime_stream_writev (GMimeStream *stream, GMimeStreamIOVector *vector, size_t count)
+{
+	g_return_val_if_fail (GMIME_IS_STREAM (stream), -1);
+	
+	if (count == 0)
+		return 0;
+	
+	return GMIME_STREAM_CLASS_GET_PRIVATE (GMIME_STREAM_GET_CLASS (stream))->writev (stream, vector, count);
+}
@@ -110,6 +110,7 @@ void g_mime_stream_construct (GMimeStream *stream, gint64 start, gint64 end);
 
 /* public methods */
 ssize_t   g_mime_stream_read    (GMimeStream *stream, char *buf, size_t len);
+ssize_t   g_mime_stream_borrow  (GMimeStream *stream, const char **buf, size_t len);
 ssize_t   g_mime_stream_write   (GMimeStream *stream, const char *buf, size_t len);
 int       g_mime_stream_flush   (GMimeStream *stream);
 int       g_mime_stream_close   (GMimeStream *stream);
@@ -63,6 +63,7 @@
 #include "gmime-charset.h"
 #include "gmime-iconv.h"
 #include "gmime-iconv-utils.h"
+#include "gmime-simd.h"
 
 #ifdef ENABLE_WARNINGS
 #define w(x) x
@@ -442,14 +443,78 @@ get_time (const char *in, size_t inlen, int *hour, int *min, int *sec)
 	return TRUE;
 }
 
+/* Creating a GTimeZone means parsing its identifier, so the ones for
+ * the offsets that show up in Date headers (whole quarter hours up to
+ * +/-2345) are cached. The cache is lock-free: threads that race to
+ * fill the same slot simply keep whichever GTimeZone got there first. */
+#define TZ_CACHE_SIZE ((23 * 4 + 3) * 2 + 1)
+
+static GTimeZone *tz_cache[TZ_CACHE_SIZE];
+
+static GTimeZone *
+date_tzone_new (int tz_offset)
+{
+	int value = ABS (tz_offset);
+	int hours = value / 100;
+	int minutes = value % 100;
+	GTimeZone *tz;
+	char tzone[8];
+	int index;
+	
+	if (hours > 23 || minutes >= 60 || (minutes % 15) != 0) {
+		snprintf (tzone, sizeof (tzone), "%+05d", tz_offset);
+		
+		return g_time_zone_new (tzone);
+	}
+	
+	index = (hours * 4) + (minutes / 15);
+	index = (TZ_CACHE_SIZE / 2) + (tz_offset < 0 ? -index : index);
+	
+	if (!(tz = g_atomic_pointer_get (&tz_cache[index]))) {
+		snprintf (tzone, sizeof (tzone), "%+05d", tz_offset);
+		tz = g_time_zone_new (tzone);
+		
+		if (!g_atomic_pointer_compare_and_exchange (&tz_cache[index], NULL, tz)) {
+			g_time_zone_unref (tz);
+			tz = g_atomic_pointer_get (&tz_cache[index]);
+		}
+	}
+	
+	return g_time_zone_ref (tz);
+}
+
+void
+g_mime_utils_shutdown (void)
+{
+	guint i;
+	
+	for (i = 0; i < TZ_CACHE_SIZE; i++) {
+		if (tz_cache[i] != NULL) {
+			g_time_zone_unref (tz_cache[i]);
+			tz_cache[i] = NULL;
+		}
+	}
+}
+
+static int
+get_tzone_offset (const char *in, size_t inlen)
+{
+	guint t;
+	
+	for (t = 0; t < G_N_ELEMENTS (tz_offsets); t++) {
+		if (strlen (tz_offsets[t].name) == inlen && !strncmp (in, tz_offsets[t].name, inlen))
+			return tz_offsets[t].offset;
+	}
+	
+	return -1;
+}
+
 static GTimeZone *
 get_tzone (date_token **token)
 {
 	const char *inptr, *inend;
-	char tzone[8];
-	size_t len, n;
 	int value, i;
-	guint t;
+	size_t len;
 	
 	for (i = 0; *token && i < 2; *token = (*token)->next, i++) {
 		inptr = (*token)->start;
@@ -463,10 +528,7 @@ get_tzone (date_token **token)
 			if ((value = decode_int (inptr + 1, len - 1)) == -1)
 				return NULL;
 			
-			memcpy (tzone, inptr, len);
-			tzone[len] = '\0';
-			
-			return g_time_zone_new (tzone);
+			return date_tzone_new (*inptr == '-' ? -value : value);
 		}
 		
 		if (*inptr == '(') {
@@ -477,16 +539,9 @@ get_tzone (date_token **token)
 				len--;
 		}
 		
-		for (t = 0; t < G_N_ELEMENTS (tz_offsets); t++) {
-			n = strlen (tz_offsets[t].name);
-			
-			if (n != len || strncmp (inptr, tz_offsets[t].name, n) != 0)
-				continue;
-			
-			snprintf (tzone, 6, "%+05d", tz_offsets[t].offset);
-			
-			return g_time_zone_new (tzone);
-		}
+		/* Note: none of the named timezones have an offset of -1 */
+		if ((value = get_tzone_offset (inptr, len)) != -1)
+			return date_tzone_new (value);
 	}
 	
 	return NULL;
@@ -675,6 +730,168 @@ parse_broken_date (date_token *tokens)
 	return date;
 }
 
+/* The fast path: parses a well-formed rfc5322 date-time in a single
+ * pass without tokenizing it first.
+ *
+ *   [ day-of-week "," ] day month year hour ":" minute [ ":" second ] zone [ comment ]
+ *
+ * Anything else, such as obsolete 2-digit years, full month names or
+ * missing and unknown timezones, is left to the more forgiving
+ * token-based parsers above. */
+typedef struct {
+	int year, month, day;
+	int hour, min, sec;
+	int tz_offset;
+} rfc5322_date;
+
+#define is_date_lwsp(c) ((c) == ' ' || (c) == '\t')
+#define is_date_digit(c) ((c) >= '0' && (c) <= '9')
+#define is_date_alpha(c) (((c) >= 'A' && (c) <= 'Z') || ((c) >= 'a' && (c) <= 'z'))
+#define date_2digit(p) (((p)[0] - '0') * 10 + ((p)[1] - '0'))
+
+static gboolean
+parse_rfc5322_date (const char *in, rfc5322_date *date)
+{
+	register const char *inptr = in;
+	const char *start;
+	int value;
+	
+	while (is_date_lwsp (*inptr))
+		inptr++;
+	
+	/* day-of-week (ignored, just like the token-based parsers do) */
+	if (is_date_alpha (*inptr)) {
+		if (get_wday (inptr, 3) == -1 || inptr[3] != ',')
+			return FALSE;
+		
+		inptr += 4;
+		
+		while (is_date_lwsp (*inptr))
+			inptr++;
+	}
+	
+	/* day */
+	if (!is_date_digit (inptr[0]))
+		return FALSE;
+	
+	if (is_date_digit (inptr[1])) {
+		date->day = date_2digit (inptr);
+		inptr += 2;
+	} else {
+		date->day = inptr[0] - '0';
+		inptr++;
+	}
+	
+	if (date->day < 1 || !is_date_lwsp (*inptr))
+		return FALSE;
+	
+	while (is_date_lwsp (*inptr))
+		inptr++;
+	
+	/* month */
+	if (!is_date_alpha (inptr[0]) || !is_date_alpha (inptr[1]) || !is_date_alpha (inptr[2]) ||
+	    !is_date_lwsp (inptr[3]) || (date->month = get_month (inptr, 3)) == -1)
+		return FALSE;
+	
+	inptr += 4;
+	
+	while (is_date_lwsp (*inptr))
+		inptr++;
+	
+	/* year */
+	if (!is_date_digit (inptr[0]) || !is_date_digit (inptr[1]) || !is_date_digit (inptr[2]) ||
+	    !is_date_digit (inptr[3]) || !is_date_lwsp (inptr[4]))
+		return FALSE;
+	
+	date->year = date_2digit (inptr) * 100 + date_2digit (inptr + 2);
+	inptr += 5;
+	
+	if (date->year < 1969 || date->day > g_date_get_days_in_month (date->month, date->year))
+		return FALSE;
+	
+	while (is_date_lwsp (*inptr))
+		inptr++;
+	
+	/* hour ":" minute [ ":" second ] */
+	if (!is_date_digit (inptr[0]) || !is_date_digit (inptr[1]) || inptr[2] != ':' ||
+	    !is_date_digit (inptr[3]) || !is_date_digit (inptr[4]))
+		return FALSE;
+	
+	date->hour = date_2digit (inptr);
+	date->min = date_2digit (inptr + 3);
+	date->sec = 0;
+	inptr += 5;
+	
+	if (*inptr == ':') {
+		if (!is_date_digit (inptr[1]) || !is_date_digit (inptr[2]))
+			return FALSE;
+		
+		date->sec = date_2digit (inptr + 1);
+		inptr += 3;
+	}
+	
+	if (date->hour > 23 || date->min > 59 || date->sec > 59 || !is_date_lwsp (*inptr))
+		return FALSE;
+	
+	while (is_date_lwsp (*inptr))
+		inptr++;
+	
+	/* zone */
+	if (inptr[0] == '+' || inptr[0] == '-') {
+		if (!is_date_digit (inptr[1]) || !is_date_digit (inptr[2]) ||
+		    !is_date_digit (inptr[3]) || !is_date_digit (inptr[4]))
+			return FALSE;
+		
+		if (date_2digit (inptr + 1) > 23 || date_2digit (inptr + 3) > 59)
+			return FALSE;
+		
+		value = date_2digit (inptr + 1) * 100 + date_2digit (inptr + 3);
+		date->tz_offset = inptr[0] == '-' ? -value : value;
+		inptr += 5;
+	} else {
+		start = inptr;
+		while (is_date_alpha (*inptr))
+			inptr++;
+		
+		if ((date->tz_offset = get_tzone_offset (start, (size_t) (inptr - start))) == -1)
+			return FALSE;
+	}
+	
+	if (*inptr != '\0' && !is_date_lwsp (*inptr))
+		return FALSE;
+	
+	while (is_date_lwsp (*inptr))
+		inptr++;
+	
+	/* an optional trailing comment, e.g. "(PST)" */
+	if (*inptr == '(') {
+		if (!(inptr = strchr (inptr, ')')))
+			return FALSE;
+		
+		inptr++;
+		
+		while (is_date_lwsp (*inptr))
+			inptr++;
+	}
+	
+	return *inptr == '\0';
+}
+
+/* the number of days since 1970-01-01 (see Howard Hinnant's days_from_civil) */
+static gint64
+days_from_civil (int year, int month, int day)
+{
+	int era, yoe, doy, doe;
+	
+	year -= month <= 2;
+	era = (year >= 0 ? year : year - 399) / 400;
+	yoe = year - era * 400;
+	doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	
+	return (gint64) era * 146097 + doe - 719468;
+}
+
 #if 0
 static void
 gmime_datetok_table_init (void)
@@ -720,17 +937,8 @@ gmime_datetok_table_init (void)
 #endif
 
 
-/**
- * g_mime_utils_header_decode_date:
- * @str: input date string
- *
- * Parses the rfc822 date string.
- *
- * Returns: (nullable) (transfer full): the #GDateTime representation of the date
- * string specified by @str or %NULL on error.
- **/
-GDateTime *
-g_mime_utils_header_decode_date (const char *str)
+static GDateTime *
+decode_date_tokens (const char *str)
 {
 	date_token *token, *tokens;
 	GDateTime *date;
@@ -752,6 +960,96 @@ g_mime_utils_header_decode_date (const char *str)
 }
 
 
+/**
+ * g_mime_utils_header_decode_date:
+ * @str: input date string
+ *
+ * Parses the rfc822 date string.
+ *
+ * Returns: (nullable) (transfer full): the #GDateTime representation of the date
+ * string specified by @str or %NULL on error.
+ **/
+GDateTime *
+g_mime_utils_header_decode_date (const char *str)
+{
+	GDateTime *date;
+	rfc5322_date parsed;
+	GTimeZone *tz;
+	
+	g_return_val_if_fail (str != NULL, NULL);
+	
+	if (parse_rfc5322_date (str, &parsed)) {
+		tz = date_tzone_new (parsed.tz_offset);
+		date = g_date_time_new (tz, parsed.year, parsed.month, parsed.day,
+					parsed.hour, parsed.min, (gdouble) parsed.sec);
+		g_time_zone_unref (tz);
+		
+		if (date != NULL)
+			return date;
+	}
+	
+	return decode_date_tokens (str);
+}
+
+
+/**
+ * g_mime_utils_header_decode_date_unix:
+ * @str: input date string
+ * @unix_time: (out): return location for the number of seconds since the epoch
+ * @tz_offset: (out) (optional): return location for the timezone offset
+ *
+ * Parses the rfc822 date string, just like
+ * g_mime_utils_header_decode_date(), but without creating a
+ * #GDateTime. Well-formed rfc5322 dates are parsed without allocating
+ * any memory, making this better suited to sorting or indexing large
+ * numbers of messages by date.
+ *
+ * The timezone offset is in the same form as it appears in the header,
+ * e.g. -0500 is returned as -500.
+ *
+ * Returns: %TRUE if @str could be parsed or %FALSE otherwise.
+ **/
+gboolean
+g_mime_utils_header_decode_date_unix (const char *str, gint64 *unix_time, int *tz_offset)
+{
+	rfc5322_date parsed;
+	GDateTime *date;
+	GTimeSpan tz;
+	int minutes;
+	
+	g_return_val_if_fail (str != NULL, FALSE);
+	g_return_val_if_fail (unix_time != NULL, FALSE);
+	
+	if (parse_rfc5322_date (str, &parsed)) {
+		minutes = ((ABS (parsed.tz_offset) / 100) * 60) + (ABS (parsed.tz_offset) % 100);
+		if (parsed.tz_offset < 0)
+			minutes = -minutes;
+		
+		*unix_time = days_from_civil (parsed.year, parsed.month, parsed.day) * 86400;
+		*unix_time += (parsed.hour * 3600) + (parsed.min * 60) + parsed.sec - (minutes * 60);
+		
+		if (tz_offset)
+			*tz_offset = parsed.tz_offset;
+		
+		return TRUE;
+	}
+	
+	if (!(date = decode_date_tokens (str)))
+		return FALSE;
+	
+	*unix_time = g_date_time_to_unix (date);
+	
+	if (tz_offset) {
+		tz = g_date_time_get_utc_offset (date) / G_TIME_SPAN_MINUTE;
+		*tz_offset = (int) ((tz / 60) * 100 + (tz % 60));
+	}
+	
+	g_date_time_unref (date);
+	
+	return TRUE;
+}
+
+
 /**
  * g_mime_utils_generate_message_id:
  * @fqdn: Fully qualified domain name
@@ -1154,6 +1452,25 @@ charset_convert (iconv_t cd, const char *inbuf, size_t inleft, char **outp, size
 }
 
 
+/* like charset_convert() but using one of the built-in single-byte
+ * charset tables instead of an iconv descriptor */
+static size_t
+charset_convert_sbcs (const unsigned short *table, const char *inbuf, size_t inleft, char **outp, size_t *outlenp, size_t *ninval)
+{
+	size_t outlen;
+	
+	if (*outp == NULL || *outlenp < inleft * 3) {
+		*outlenp = inleft * 3;
+		*outp = g_realloc (*outp, *outlenp + 1);
+	}
+	
+	outlen = _g_mime_charset_sbcs_to_utf8 (table, inbuf, inleft, *outp, '?', ninval);
+	(*outp)[outlen] = '\0';
+	
+	return outlen;
+}
+
+
 /**
  * g_mime_utils_decode_8bit:
  * @options: (nullable): a #GMimeParserOptions or %NULL
@@ -1173,6 +1490,7 @@ char *
 g_mime_utils_decode_8bit (GMimeParserOptions *options, const char *text, size_t len)
 {
 	size_t outleft, outlen, min, ninval;
+	const unsigned short *table;
 	const char **charsets;
 	const char *best;
 	iconv_t cd;
@@ -1189,12 +1507,14 @@ g_mime_utils_decode_8bit (GMimeParserOptions *options, const char *text, size_t
 	out = g_malloc (outleft + 1);
 	
 	for (i = 0; charsets[i]; i++) {
-		if ((cd = g_mime_iconv_open ("UTF-8", charsets[i])) == (iconv_t) -1)
+		if ((table = _g_mime_charset_sbcs_table (charsets[i]))) {
+			outlen = charset_convert_sbcs (table, text, len, &out, &outleft, &ninval);
+		} else if ((cd = g_mime_iconv_open ("UTF-8", charsets[i])) != (iconv_t) -1) {
+			outlen = charset_convert (cd, text, len, &out, &outleft, &ninval);
+			g_mime_iconv_close (cd);
+		} else {
 			continue;
-		
-		outlen = charset_convert (cd, text, len, &out, &outleft, &ninval);
-		
-		g_mime_iconv_close (cd);
+		}
 		
 		if (ninval == 0)
 			return g_realloc (out, outlen + 1);
@@ -1209,6 +1529,12 @@ g_mime_utils_decode_8bit (GMimeParserOptions *options, const char *text, size_t
 	 * try to find the one that fit the best and use that to convert what we can,
 	 * replacing any byte we can't convert with a '?' */
 	
+	if ((table = _g_mime_charset_sbcs_table (best))) {
+		outlen = charset_convert_sbcs (table, text, len, &out, &outleft, &ninval);
+		
+		return g_realloc (out, outlen + 1);
+	}
+	
 	if ((cd = g_mime_iconv_open ("UTF-8", best)) == (iconv_t) -1) {
 		/* this shouldn't happen... but if we are here, then
 		 * it did...  the only thing we can do at this point
@@ -1370,41 +1696,39 @@ is_rfc2047_token (const char *inptr, size_t len)
 typedef struct _rfc2047_token {
 	struct _rfc2047_token *next;
 	const char *charset;
+	guint charset_id;
 	const char *text;
 	size_t length;
 	char encoding;
 	char is_8bit;
 } rfc2047_token;
 
-#define rfc2047_token_list_free(tokens) g_slice_free_chain (rfc2047_token, tokens, next)
 #define rfc2047_token_free(token) g_slice_free (rfc2047_token, token)
 
-static rfc2047_token *
-rfc2047_token_new (const char *text, size_t len)
+static void
+rfc2047_token_init (rfc2047_token *token, const char *text, size_t len, gboolean is_8bit)
 {
-	rfc2047_token *token;
-	
-	token = g_slice_new0 (rfc2047_token);
+	token->charset = NULL;
+	token->charset_id = 0;
 	token->length = len;
 	token->text = text;
-	
-	return token;
+	token->encoding = 0;
+	token->is_8bit = is_8bit ? 1 : 0;
 }
 
-static rfc2047_token *
-rfc2047_token_new_encoded_word (const char *word, size_t len)
+static gboolean
+rfc2047_token_parse_encoded_word (rfc2047_token *token, const char *word, size_t len)
 {
-	rfc2047_token *token;
 	const char *payload;
 	const char *charset;
 	const char *inptr;
-	char *buf, *lang;
+	const char *lang;
 	char encoding;
 	size_t n;
 	
 	/* check that this could even be an encoded-word token */
-	if (len < 7 || strncmp (word, "=?", 2) != 0 || strncmp (word + len - 2, "?=", 2) != 0)
-		return NULL;
+	if (len < 7 || word[0] != '=' || word[1] != '?' || word[len - 2] != '?' || word[len - 1] != '=')
+		return FALSE;
 	
 	/* skip over '=?' */
 	inptr = word + 2;
@@ -1412,19 +1736,14 @@ rfc2047_token_new_encoded_word (const char *word, size_t len)
 	
 	if (*charset == '?' || *charset == '*') {
 		/* this would result in an empty charset */
-		return NULL;
+		return FALSE;
 	}
 	
 	/* skip to the end of the charset */
 	if (!(inptr = memchr (inptr, '?', len - 2)) || inptr[2] != '?')
-		return NULL;
+		return FALSE;
 	
-	/* copy the charset into a buffer */
 	n = (size_t) (inptr - charset);
-	buf = g_alloca (n + 1);
-	memcpy (buf, charset, n);
-	buf[n] = '\0';
-	charset = buf;
 	
 	/* rfc2231 updates rfc2047 encoded words...
 	 * The ABNF given in RFC 2047 for encoded-words is:
@@ -1434,15 +1753,15 @@ rfc2047_token_new_encoded_word (const char *word, size_t len)
 	 */
 	
 	/* trim off the 'language' part if it's there... */
-	if ((lang = strchr (charset, '*')))
-		*lang = '\0';
+	if ((lang = memchr (charset, '*', n)))
+		n = (size_t) (lang - charset);
 	
 	/* skip over the '?' */
 	inptr++;
 	
 	/* make sure the first char after the encoding is another '?' */
 	if (inptr[1] != '?')
-		return NULL;
+		return FALSE;
 	
 	switch (*inptr++) {
 	case 'B': case 'b':
@@ -1452,7 +1771,7 @@ rfc2047_token_new_encoded_word (const char *word, size_t len)
 		encoding = 'Q';
 		break;
 	default:
-		return NULL;
+		return FALSE;
 	}
 	
 	/* the payload begins right after the '?' */
@@ -1463,298 +1782,281 @@ rfc2047_token_new_encoded_word (const char *word, size_t len)
 	
 	/* make sure that we don't have something like: =?iso-8859-1?Q?= */
 	if (payload > inptr)
-		return NULL;
+		return FALSE;
 	
-	token = rfc2047_token_new (payload, inptr - payload);
-	token->charset = g_mime_charset_iconv_name (charset);
+	token->charset_id = _g_mime_charset_intern_len (charset, n);
+	token->charset = g_mime_charset_id_get_iconv_name (token->charset_id);
+	token->length = (size_t) (inptr - payload);
+	token->text = payload;
 	token->encoding = encoding;
+	token->is_8bit = 0;
 	
-	return token;
+	return TRUE;
 }
 
-static rfc2047_token *
-tokenize_rfc2047_phrase (GMimeParserOptions *options, const char *in, size_t *len, gint64 offset)
-{
-	gboolean can_warn = g_mime_parser_options_get_warning_callback (options) != NULL;
-	rfc2047_token list, *lwsp, *token, *tail;
-	register const char *inptr = in;
-	gboolean has_specials = FALSE;
+
+/* Splits a 'text' or 'phrase' header value into rfc2047_tokens one at
+ * a time so that the decoder can consume them as they are found
+ * without allocating anything. Linear whitespace between two
+ * encoded-words is dropped here, as required by rfc2047. */
+typedef struct {
+	GMimeParserOptions *options;
 	GMimeRfcComplianceMode mode;
-	gboolean encoded = FALSE;
-	const char *text, *word;
-	gboolean ascii;
-	size_t n;
-	
-	mode = g_mime_parser_options_get_rfc2047_compliance_mode (options);
-	tail = (rfc2047_token *) &list;
-	list.next = NULL;
-	lwsp = NULL;
+	const char *in, *inptr;
+	gint64 offset;
+	gboolean can_warn;
+	gboolean phrase;
+	gboolean encoded;
+	gboolean pending;
+	rfc2047_token word;
+} rfc2047_scanner;
+
+static void
+rfc2047_scanner_init (rfc2047_scanner *scanner, GMimeParserOptions *options, const char *in, gboolean phrase, gint64 offset)
+{
+	scanner->can_warn = g_mime_parser_options_get_warning_callback (options) != NULL;
+	scanner->mode = g_mime_parser_options_get_rfc2047_compliance_mode (options);
+	scanner->options = options;
+	scanner->phrase = phrase;
+	scanner->offset = offset;
+	scanner->encoded = FALSE;
+	scanner->pending = FALSE;
+	scanner->inptr = in;
+	scanner->in = in;
+}
+
+/* scans a word of a 'text' header starting at @inptr and returns its end */
+static const char *
+rfc2047_scan_text_word (rfc2047_scanner *scanner, const char *inptr, gboolean *ascii, gboolean *has_specials)
+{
+	const char *word = inptr;
 	
-	while (*inptr != '\0') {
-		text = inptr;
-		while (is_lwsp (*inptr))
-			inptr++;
-		
-		if (inptr > text)
-			lwsp = rfc2047_token_new (text, inptr - text);
-		else
-			lwsp = NULL;
-		
-		word = inptr;
-		ascii = TRUE;
-		if (is_atom (*inptr)) {
-			if (G_LIKELY (mode == GMIME_RFC_COMPLIANCE_LOOSE)) {
-				/* Make an extra effort to detect and
-				 * separate encoded-word tokens that
-				 * have been merged with other
-				 * words. */
-				
-				has_specials = FALSE;
-				
-				if (!strncmp (inptr, "=?", 2)) {
-					inptr += 2;
-					
-					/* skip past the charset (if one is even declared, sigh) */
-					while (*inptr && *inptr != '?') {
-						if (!is_atom (*inptr)) {
-							ascii = ascii && is_ascii (*inptr);
-							has_specials = TRUE;
-						}
-						inptr++;
-					}
-					
-					/* sanity check encoding type */
-					if (inptr[0] != '?' || inptr[1] == '\0' || !strchr ("BbQq", inptr[1]) || inptr[2] != '?')
-						goto non_rfc2047;
-					
-					inptr += 3;
-					
-					/* find the end of the rfc2047 encoded word token */
-					while (*inptr && strncmp (inptr, "?=", 2) != 0) {
-						if (!is_atom (*inptr)) {
-							ascii = ascii && is_ascii (*inptr);
-							has_specials = TRUE;
-						}
-						inptr++;
-					}
-					
-					if (*inptr == '\0') {
-						/* didn't find an end marker... */
-						has_specials = FALSE;
-						inptr = word + 2;
-						ascii = TRUE;
-						
-						goto non_rfc2047;
-					}
-					
-					inptr += 2;
-				} else {
-				non_rfc2047:
-					/* stop if we encounter a possible rfc2047 encoded
-					 * token even if it's inside another word, sigh. */
-					while (is_atom (*inptr) && strncmp (inptr, "=?", 2) != 0)
-						inptr++;
-				}
-			} else {
-				while (is_atom (*inptr))
-					inptr++;
+	if (G_LIKELY (scanner->mode == GMIME_RFC_COMPLIANCE_LOOSE)) {
+		if (inptr[0] == '=' && inptr[1] == '?') {
+			inptr += 2;
+			
+			/* skip past the charset (if one is even declared, sigh) */
+			while (*inptr && *inptr != '?') {
+				*ascii = *ascii && is_ascii (*inptr);
+				if (is_lwsp (*inptr))
+					*has_specials = TRUE;
+				inptr++;
 			}
 			
-			n = (size_t) (inptr - word);
-			if ((token = rfc2047_token_new_encoded_word (word, n))) {
-				if (can_warn && has_specials)
-					_g_mime_parser_options_warn (options, offset, GMIME_WARN_INVALID_RFC2047_HEADER_VALUE, in);
-				
-				/* rfc2047 states that you must ignore all
-				 * whitespace between encoded words */
-				if (!encoded && lwsp != NULL) {
-					tail->next = lwsp;
-					tail = lwsp;
-				} else if (lwsp != NULL) {
-					rfc2047_token_free (lwsp);
-				}
-				
-				tail->next = token;
-				tail = token;
-				
-				encoded = TRUE;
-			} else {
-				/* append the lwsp and atom tokens */
-				if (lwsp != NULL) {
-					tail->next = lwsp;
-					tail = lwsp;
-				}
-				
-				token = rfc2047_token_new (word, n);
-				token->is_8bit = ascii ? 0 : 1;
-				tail->next = token;
-				tail = token;
+			/* sanity check encoding type */
+			if (inptr[0] != '?' || inptr[1] == '\0' || !strchr ("BbQq", inptr[1]) || inptr[2] != '?')
+				goto non_rfc2047;
+			
+			inptr += 3;
+			
+			/* find the end of the rfc2047 encoded word token */
+			while (*inptr && !(inptr[0] == '?' && inptr[1] == '=')) {
+				*ascii = *ascii && is_ascii (*inptr);
+				if (is_lwsp (*inptr))
+					*has_specials = TRUE;
+				inptr++;
+			}
+			
+			if (*inptr == '\0') {
+				/* didn't find an end marker... */
+				*has_specials = FALSE;
+				inptr = word + 2;
+				*ascii = TRUE;
 				
-				encoded = FALSE;
+				goto non_rfc2047;
 			}
+			
+			inptr += 2;
 		} else {
-			/* append the lwsp token */
-			if (lwsp != NULL) {
-				tail->next = lwsp;
-				tail = lwsp;
+		non_rfc2047:
+			/* stop if we encounter a possible rfc2047 encoded
+			 * token even if it's inside another word, sigh. */
+			while (*inptr && !is_lwsp (*inptr) && !(inptr[0] == '=' && inptr[1] == '?')) {
+				*ascii = *ascii && is_ascii (*inptr);
+				inptr++;
 			}
+		}
+	} else {
+		while (*inptr && !is_lwsp (*inptr)) {
+			*ascii = *ascii && is_ascii (*inptr);
+			inptr++;
+		}
+	}
+	
+	return inptr;
+}
+
+/* scans an atom of a 'phrase' header starting at @inptr and returns its end */
+static const char *
+rfc2047_scan_phrase_word (rfc2047_scanner *scanner, const char *inptr, gboolean *ascii, gboolean *has_specials)
+{
+	const char *word = inptr;
+	
+	if (G_LIKELY (scanner->mode == GMIME_RFC_COMPLIANCE_LOOSE)) {
+		/* Make an extra effort to detect and
+		 * separate encoded-word tokens that
+		 * have been merged with other
+		 * words. */
+		
+		if (inptr[0] == '=' && inptr[1] == '?') {
+			inptr += 2;
 			
-			ascii = TRUE;
-			while (*inptr && !is_lwsp (*inptr) && !is_atom (*inptr)) {
-				ascii = ascii && is_ascii (*inptr);
+			/* skip past the charset (if one is even declared, sigh) */
+			while (*inptr && *inptr != '?') {
+				if (!is_atom (*inptr)) {
+					*ascii = *ascii && is_ascii (*inptr);
+					*has_specials = TRUE;
+				}
 				inptr++;
 			}
 			
-			n = (size_t) (inptr - word);
-			token = rfc2047_token_new (word, n);
-			token->is_8bit = ascii ? 0 : 1;
+			/* sanity check encoding type */
+			if (inptr[0] != '?' || inptr[1] == '\0' || !strchr ("BbQq", inptr[1]) || inptr[2] != '?')
+				goto non_rfc2047;
 			
-			tail->next = token;
-			tail = token;
+			inptr += 3;
 			
-			encoded = FALSE;
+			/* find the end of the rfc2047 encoded word token */
+			while (*inptr && !(inptr[0] == '?' && inptr[1] == '=')) {
+				if (!is_atom (*inptr)) {
+					*ascii = *ascii && is_ascii (*inptr);
+					*has_specials = TRUE;
+				}
+				inptr++;
+			}
+			
+			if (*inptr == '\0') {
+				/* didn't find an end marker... */
+				*has_specials = FALSE;
+				inptr = word + 2;
+				*ascii = TRUE;
+				
+				goto non_rfc2047;
+			}
+			
+			inptr += 2;
+		} else {
+		non_rfc2047:
+			/* stop if we encounter a possible rfc2047 encoded
+			 * token even if it's inside another word, sigh. */
+			while (is_atom (*inptr) && !(inptr[0] == '=' && inptr[1] == '?'))
+				inptr++;
 		}
+	} else {
+		while (is_atom (*inptr))
+			inptr++;
 	}
 	
-	*len = (size_t) (inptr - in);
-	
-	return list.next;
+	return inptr;
 }
 
-static rfc2047_token *
-tokenize_rfc2047_text (GMimeParserOptions *options, const char *in, size_t *len, gint64 offset)
+static gboolean
+rfc2047_scanner_next (rfc2047_scanner *scanner, rfc2047_token *token)
 {
-	gboolean can_warn = g_mime_parser_options_get_warning_callback (options) != NULL;
-	rfc2047_token list, *lwsp, *token, *tail;
-	register const char *inptr = in;
+	register const char *inptr = scanner->inptr;
 	gboolean has_specials = FALSE;
-	GMimeRfcComplianceMode mode;
-	gboolean encoded = FALSE;
+	gboolean ascii = TRUE;
 	const char *text, *word;
-	gboolean ascii;
+	rfc2047_token *next;
 	size_t n;
 	
-	mode = g_mime_parser_options_get_rfc2047_compliance_mode (options);
-	tail = (rfc2047_token *) &list;
-	list.next = NULL;
-	lwsp = NULL;
+	if (scanner->pending) {
+		/* the word that followed the last lwsp token */
+		*token = scanner->word;
+		scanner->pending = FALSE;
+		return TRUE;
+	}
 	
-	while (*inptr != '\0') {
-		text = inptr;
-		while (is_lwsp (*inptr))
-			inptr++;
-		
-		if (inptr > text)
-			lwsp = rfc2047_token_new (text, inptr - text);
+	if (*inptr == '\0')
+		return FALSE;
+	
+	text = inptr;
+	while (is_lwsp (*inptr))
+		inptr++;
+	
+	if (*inptr == '\0' && !scanner->phrase) {
+		/* trailing lwsp */
+		rfc2047_token_init (token, text, (size_t) (inptr - text), FALSE);
+		scanner->inptr = inptr;
+		return TRUE;
+	}
+	
+	/* scan the word into the token itself unless it has to wait for the lwsp */
+	next = inptr > text ? &scanner->word : token;
+	word = inptr;
+	
+	if (!scanner->phrase || is_atom (*inptr)) {
+		if (scanner->phrase)
+			inptr = rfc2047_scan_phrase_word (scanner, inptr, &ascii, &has_specials);
 		else
-			lwsp = NULL;
+			inptr = rfc2047_scan_text_word (scanner, inptr, &ascii, &has_specials);
 		
-		if (*inptr != '\0') {
-			word = inptr;
-			ascii = TRUE;
+		n = (size_t) (inptr - word);
+		if (rfc2047_token_parse_encoded_word (next, word, n)) {
+			if (scanner->can_warn && has_specials)
+				_g_mime_parser_options_warn (scanner->options, scanner->offset, GMIME_WARN_INVALID_RFC2047_HEADER_VALUE, scanner->in);
 			
-			if (G_LIKELY (mode == GMIME_RFC_COMPLIANCE_LOOSE)) {
-				has_specials = FALSE;
-				
-				if (!strncmp (inptr, "=?", 2)) {
-					inptr += 2;
-					
-					/* skip past the charset (if one is even declared, sigh) */
-					while (*inptr && *inptr != '?') {
-						ascii = ascii && is_ascii (*inptr);
-						if (is_lwsp (*inptr))
-							has_specials = TRUE;
-						inptr++;
-					}
-					
-					/* sanity check encoding type */
-					if (inptr[0] != '?' || inptr[1] == '\0' || !strchr ("BbQq", inptr[1]) || inptr[2] != '?')
-						goto non_rfc2047;
-					
-					inptr += 3;
-					
-					/* find the end of the rfc2047 encoded word token */
-					while (*inptr && strncmp (inptr, "?=", 2) != 0) {
-						ascii = ascii && is_ascii (*inptr);
-						if (is_lwsp (*inptr))
-							has_specials = TRUE;
-						inptr++;
-					}
-					
-					if (*inptr == '\0') {
-						/* didn't find an end marker... */
-						has_specials = FALSE;
-						inptr = word + 2;
-						ascii = TRUE;
-						
-						goto non_rfc2047;
-					}
-					
-					inptr += 2;
-				} else {
-				non_rfc2047:
-					/* stop if we encounter a possible rfc2047 encoded
-					 * token even if it's inside another word, sigh. */
-					while (*inptr && !is_lwsp (*inptr) && strncmp (inptr, "=?", 2) != 0) {
-						ascii = ascii && is_ascii (*inptr);
-						inptr++;
-					}
-				}
-			} else {
-				while (*inptr && !is_lwsp (*inptr)) {
-					ascii = ascii && is_ascii (*inptr);
-					inptr++;
-				}
+			/* rfc2047 states that you must ignore all
+			 * whitespace between encoded words */
+			if (scanner->encoded && next != token) {
+				*token = *next;
+				next = token;
 			}
 			
-			n = (size_t) (inptr - word);
-			if ((token = rfc2047_token_new_encoded_word (word, n))) {
-				if (can_warn && has_specials)
-					_g_mime_parser_options_warn (options, offset, GMIME_WARN_INVALID_RFC2047_HEADER_VALUE, in);
-				
-				/* rfc2047 states that you must ignore all
-				 * whitespace between encoded words */
-				if (!encoded && lwsp != NULL) {
-					tail->next = lwsp;
-					tail = lwsp;
-				} else if (lwsp != NULL) {
-					rfc2047_token_free (lwsp);
-				}
-				
-				tail->next = token;
-				tail = token;
-				
-				encoded = TRUE;
-			} else {
-				/* append the lwsp and atom tokens */
-				if (lwsp != NULL) {
-					tail->next = lwsp;
-					tail = lwsp;
-				}
-				
-				token = rfc2047_token_new (word, n);
-				token->is_8bit = ascii ? 0 : 1;
-				tail->next = token;
-				tail = token;
-				
-				encoded = FALSE;
-			}
+			scanner->encoded = TRUE;
 		} else {
-			if (lwsp != NULL) {
-				/* appending trailing lwsp */
-				tail->next = lwsp;
-				tail = lwsp;
-			}
+			rfc2047_token_init (next, word, n, !ascii);
 			
-			break;
+			scanner->encoded = FALSE;
 		}
+	} else {
+		while (*inptr && !is_lwsp (*inptr) && !is_atom (*inptr)) {
+			ascii = ascii && is_ascii (*inptr);
+			inptr++;
+		}
+		
+		rfc2047_token_init (next, word, (size_t) (inptr - word), !ascii);
+		
+		scanner->encoded = FALSE;
+	}
+	
+	if (next != token) {
+		/* return the lwsp now and the word on the next call */
+		rfc2047_token_init (token, text, (size_t) (word - text), FALSE);
+		scanner->pending = TRUE;
+	}
+	
+	scanner->inptr = inptr;
+	
+	return TRUE;
+}
+
+/* builds a list of tokens for the header folding code */
+static rfc2047_token *
+tokenize_rfc2047 (GMimeParserOptions *options, const char *in, gboolean phrase, size_t *len, gint64 offset)
+{
+	rfc2047_scanner scanner;
+	rfc2047_token list, *tail;
+	rfc2047_token token;
+	
+	rfc2047_scanner_init (&scanner, options, in, phrase, offset);
+	tail = (rfc2047_token *) &list;
+	list.next = NULL;
+	
+	while (rfc2047_scanner_next (&scanner, &token)) {
+		tail->next = g_slice_dup (rfc2047_token, &token);
+		tail = tail->next;
+		tail->next = NULL;
 	}
 	
-	*len = (size_t) (inptr - in);
+	*len = (size_t) (scanner.inptr - in);
 	
 	return list.next;
 }
 
+#define tokenize_rfc2047_phrase(options, in, len, offset) tokenize_rfc2047 (options, in, TRUE, len, offset)
+#define tokenize_rfc2047_text(options, in, len, offset) tokenize_rfc2047 (options, in, FALSE, len, offset)
+
 static size_t
 rfc2047_token_decode (rfc2047_token *token, unsigned char *outbuf, int *state, guint32 *save)
 {
@@ -1767,124 +2069,201 @@ rfc2047_token_decode (rfc2047_token *token, unsigned char *outbuf, int *state, g
 		return quoted_decode (inbuf, len, outbuf, state, save);
 }
 
-static char *
-rfc2047_decode_tokens (GMimeParserOptions *options, rfc2047_token *tokens, size_t buflen, const char **charset_out)
-{
-	rfc2047_token *token, *next;
-	size_t outlen, ninval, len;
-	unsigned char *outptr;
-	const char *charset;
-	GByteArray *outbuf;
+
+/* Decodes the tokens produced by an rfc2047_scanner straight into the
+ * output string as they are scanned.
+ *
+ * In order to work around broken mailers, the raw decoded content of
+ * runs of identically encoded word tokens is combined before being
+ * converted into UTF-8, so the decoder keeps the current run in @raw
+ * until a token that does not belong to it comes along. */
+typedef struct {
+	GMimeParserOptions *options;
+	const char **charset_out;
 	GString *decoded;
+	GByteArray *raw;
+	const char *charset;
+	guint charset_id;
 	char encoding;
 	guint32 save;
-	iconv_t cd;
 	int state;
+} rfc2047_decoder;
+
+/* converts the current run of encoded-words into UTF-8 */
+static void
+rfc2047_decoder_flush (rfc2047_decoder *decoder)
+{
+	const char *charset = decoder->charset;
+	const unsigned short *table;
+	size_t outlen, ninval, len;
+	GString *decoded;
+	char *outptr;
+	iconv_t cd;
 	char *str;
 	
-	decoded = g_string_sized_new (buflen + 1);
-	outbuf = g_byte_array_sized_new (76);
-
-	if (charset_out)
-		*charset_out = NULL;
+	if (decoder->encoding == 0)
+		return;
 	
-	token = tokens;
-	while (token != NULL) {
-		next = token->next;
+	outptr = (char *) decoder->raw->data;
+	outlen = decoder->raw->len;
+	decoded = decoder->decoded;
+	
+	if (decoder->charset_id == GMIME_CHARSET_ID_UTF8) {
+		/* slight optimization over going through iconv */
+		str = outptr;
+		len = outlen;
 		
-		if (token->encoding) {
-			/* In order to work around broken mailers, we need to combine
-			 * the raw decoded content of runs of identically encoded word
-			 * tokens before converting into UTF-8. */
-			encoding = token->encoding;
-			charset = token->charset;
-			len = token->length;
-			state = 0;
-			save = 0;
-			
-			/* Note: if any token was encoded in UTF-8, return UTF-8 as the charset used;
-			 * otherwise, use the first charset we encounter... */
-			if (charset_out && (*charset_out == NULL || !g_ascii_strcasecmp (charset, "UTF-8")))
-				*charset_out = charset;
-			
-			/* find the end of the run (and measure the buffer length we'll need) */
-			while (next && next->encoding == encoding && !strcmp (next->charset, charset)) {
-				len += next->length;
-				next = next->next;
-			}
-			
-			/* make sure our temporary output buffer is large enough... */
-			if (len > outbuf->len)
-				g_byte_array_set_size (outbuf, len);
-			
-			/* base64 / quoted-printable decode each of the tokens... */
-			outptr = outbuf->data;
-			outlen = 0;
-			do {
-				/* Note: by not resetting state/save each loop, we effectively
-				 * treat the payloads as one continuous block, thus allowing
-				 * us to handle cases where a hex-encoded triplet of a
-				 * quoted-printable encoded payload is split between 2 or more
-				 * encoded-word tokens. */
-				len = rfc2047_token_decode (token, outptr, &state, &save);
-				token = token->next;
-				outptr += len;
-				outlen += len;
-			} while (token != next);
-			outptr = outbuf->data;
-			
-			/* convert the raw decoded text into UTF-8 */
-			if (!g_ascii_strcasecmp (charset, "UTF-8")) {
-				/* slight optimization over going through iconv */
-				str = (char *) outptr;
-				len = outlen;
-				
-				while (!g_utf8_validate (str, len, (const char **) &str)) {
-					len = outlen - (str - (char *) outptr);
-					*str = '?';
-				}
-				
-				g_string_append_len (decoded, (char *) outptr, outlen);
-			} else if ((cd = g_mime_iconv_open ("UTF-8", charset)) == (iconv_t) -1) {
-				w(g_warning ("Cannot convert from %s to UTF-8, header display may "
-					     "be corrupt: %s", charset[0] ? charset : "unspecified charset",
-					     g_strerror (errno)));
-				
-				str = g_mime_utils_decode_8bit (options, (char *) outptr, outlen);
-				g_string_append (decoded, str);
-				g_free (str);
-			} else {
-				str = g_malloc (outlen + 1);
-				len = outlen;
-				
-				len = charset_convert (cd, (char *) outptr, outlen, &str, &len, &ninval);
-				g_mime_iconv_close (cd);
-				
-				g_string_append_len (decoded, str, len);
-				g_free (str);
-				
+		while (!g_utf8_validate (str, len, (const char **) &str)) {
+			len = outlen - (str - outptr);
+			*str = '?';
+		}
+		
+		g_string_append_len (decoded, outptr, outlen);
+	} else if ((table = _g_mime_charset_id_sbcs_table (decoder->charset_id))) {
+		/* convert straight into the output string */
+		len = decoded->len;
+		g_string_set_size (decoded, len + (outlen * 3));
+		len += _g_mime_charset_sbcs_to_utf8 (table, outptr, outlen, decoded->str + len, '?', &ninval);
+		g_string_truncate (decoded, len);
+	} else if ((cd = g_mime_iconv_open ("UTF-8", charset)) == (iconv_t) -1) {
+		w(g_warning ("Cannot convert from %s to UTF-8, header display may "
+			     "be corrupt: %s", charset[0] ? charset : "unspecified charset",
+			     g_strerror (errno)));
+		
+		str = g_mime_utils_decode_8bit (decoder->options, outptr, outlen);
+		g_string_append (decoded, str);
+		g_free (str);
+	} else {
+		str = g_malloc (outlen + 1);
+		len = outlen;
+		
+		len = charset_convert (cd, outptr, outlen, &str, &len, &ninval);
+		g_mime_iconv_close (cd);
+		
+		g_string_append_len (decoded, str, len);
+		g_free (str);
+	
 #if w(!)0
-				if (ninval > 0) {
-					g_warning ("Failed to completely convert \"%.*s\" to UTF-8, display may be "
-						   "corrupt: %s", outlen, (char *) outptr, g_strerror (errno));
-				}
+		if (ninval > 0) {
+			g_warning ("Failed to completely convert \"%.*s\" to UTF-8, display may be "
+				   "corrupt: %s", outlen, outptr, g_strerror (errno));
+		}
 #endif
-			}
-		} else if (token->is_8bit) {
+	}
+	
+	g_byte_array_set_size (decoder->raw, 0);
+	decoder->encoding = 0;
+}
+
+static void
+rfc2047_decoder_add (rfc2047_decoder *decoder, rfc2047_token *token)
+{
+	size_t outlen, len;
+	char *str;
+	
+	if (token->encoding == 0) {
+		rfc2047_decoder_flush (decoder);
+		
+		if (token->is_8bit) {
 			/* *sigh* I hate broken mailers... */
-			str = g_mime_utils_decode_8bit (options, token->text, token->length);
-			g_string_append (decoded, str);
+			str = g_mime_utils_decode_8bit (decoder->options, token->text, token->length);
+			g_string_append (decoder->decoded, str);
 			g_free (str);
 		} else {
-			g_string_append_len (decoded, token->text, token->length);
+			g_string_append_len (decoder->decoded, token->text, token->length);
 		}
 		
-		token = next;
+		return;
 	}
 	
-	g_byte_array_free (outbuf, TRUE);
+	if (token->encoding != decoder->encoding || token->charset_id != decoder->charset_id) {
+		/* start a new run */
+		rfc2047_decoder_flush (decoder);
+		
+		decoder->charset_id = token->charset_id;
+		decoder->encoding = token->encoding;
+		decoder->charset = token->charset;
+		decoder->state = 0;
+		decoder->save = 0;
+		
+		/* Note: if any token was encoded in UTF-8, return UTF-8 as the charset used;
+		 * otherwise, use the first charset we encounter... */
+		if (decoder->charset_out && (*decoder->charset_out == NULL || token->charset_id == GMIME_CHARSET_ID_UTF8))
+			*decoder->charset_out = token->charset;
+		
+		if (decoder->raw == NULL)
+			decoder->raw = g_byte_array_sized_new (76);
+	}
 	
-	return g_string_free (decoded, FALSE);
+	/* Note: by not resetting state/save for each token, we effectively
+	 * treat the payloads as one continuous block, thus allowing us to
+	 * handle cases where a hex-encoded triplet of a quoted-printable
+	 * encoded payload is split between 2 or more encoded-word tokens.
+	 *
+	 * The state can hold up to 3 bytes of a previous payload, so leave
+	 * room for those in addition to the payload itself. */
+	outlen = decoder->raw->len;
+	g_byte_array_set_size (decoder->raw, outlen + token->length + 4);
+	len = rfc2047_token_decode (token, decoder->raw->data + outlen, &decoder->state, &decoder->save);
+	g_byte_array_set_size (decoder->raw, outlen + len);
+}
+
+/* Most header values are plain 7bit text without any encoded-words, in
+ * which case decoding them is the same as copying them. */
+static gboolean
+is_plain_header_text (const char *text, size_t len)
+{
+	const char *inend = text + len;
+	const char *inptr = text;
+	
+	while ((inptr = g_mime_simd_scan_ascii (inptr, inend, '=')) < inend) {
+		/* Note: @text is nul-terminated, so inptr[1] is safe to read */
+		if (*inptr != '=' || inptr[1] == '?')
+			return FALSE;
+		
+		inptr++;
+	}
+	
+	return TRUE;
+}
+
+static char *
+rfc2047_decode (GMimeParserOptions *options, const char *in, gboolean phrase, const char **charset_out, gint64 offset)
+{
+	rfc2047_decoder decoder;
+	rfc2047_scanner scanner;
+	rfc2047_token token;
+	size_t len;
+	
+	if (charset_out)
+		*charset_out = NULL;
+	
+	len = strlen (in);
+	
+	if (is_plain_header_text (in, len))
+		return g_strndup (in, len);
+	
+	decoder.decoded = g_string_sized_new (len + 1);
+	decoder.charset_out = charset_out;
+	decoder.options = options;
+	decoder.charset_id = 0;
+	decoder.charset = NULL;
+	decoder.encoding = 0;
+	decoder.raw = NULL;
+	decoder.state = 0;
+	decoder.save = 0;
+	
+	rfc2047_scanner_init (&scanner, options, in, phrase, offset);
+	
+	while (rfc2047_scanner_next (&scanner, &token))
+		rfc2047_decoder_add (&decoder, &token);
+	
+	rfc2047_decoder_flush (&decoder);
+	
+	if (decoder.raw != NULL)
+		g_byte_array_free (decoder.raw, TRUE);
+	
+	return g_string_free (decoder.decoded, FALSE);
 }
 
 
@@ -1903,10 +2282,6 @@ rfc2047_decode_tokens (GMimeParserOptions *options, rfc2047_token *tokens, size_
 char *
 _g_mime_utils_header_decode_text (GMimeParserOptions *options, const char *text, const char **charset, gint64 offset)
 {
-	rfc2047_token *tokens;
-	char *decoded;
-	size_t len;
-	
 	if (text == NULL) {
 		if (charset)
 			*charset = NULL;
@@ -1914,11 +2289,7 @@ _g_mime_utils_header_decode_text (GMimeParserOptions *options, const char *text,
 		return g_strdup ("");
 	}
 	
-	tokens = tokenize_rfc2047_text (options, text, &len, offset);
-	decoded = rfc2047_decode_tokens (options, tokens, len, charset);
-	rfc2047_token_list_free (tokens);
-	
-	return decoded;
+	return rfc2047_decode (options, text, FALSE, charset, offset);
 }
 
 
@@ -1954,10 +2325,6 @@ g_mime_utils_header_decode_text (GMimeParserOptions *options, const char *text)
 char *
 _g_mime_utils_header_decode_phrase (GMimeParserOptions *options, const char *phrase, const char **charset, gint64 offset)
 {
-	rfc2047_token *tokens;
-	char *decoded;
-	size_t len;
-	
 	if (phrase == NULL) {
 		if (charset)
 			*charset = NULL;
@@ -1965,11 +2332,7 @@ _g_mime_utils_header_decode_phrase (GMimeParserOptions *options, const char *phr
 		return g_strdup ("");
 	}
 	
-	tokens = tokenize_rfc2047_phrase (options, phrase, &len, offset);
-	decoded = rfc2047_decode_tokens (options, tokens, len, charset);
-	rfc2047_token_list_free (tokens);
-	
-	return decoded;
+	return rfc2047_decode (options, phrase, TRUE, charset, offset);
 }
 
 
@@ -32,6 +32,7 @@
 
 #include "gmime.h"
 #include "gmime-internal.h"
+#include "gmime-simd.h"
 
 #ifdef ENABLE_CRYPTOGRAPHY
 #include "gmime-pkcs7-context.h"
@@ -46,6 +47,25 @@
  * @see_also:
  *
  * Initialization, shutdown, and version-check functions.
+ *
+ * Thread safety: g_mime_init() and g_mime_shutdown() may be called from
+ * any thread and are reference counted, so each library or thread that
+ * uses GMime can pair its own calls. Between the first g_mime_init()
+ * and the last g_mime_shutdown():
+ *
+ * - The global registries (g_mime_object_register_type(),
+ *   g_mime_crypto_context_register()) and the charset and iconv caches
+ *   may be used from any number of threads at once.
+ *
+ * - #GMimeParserOptions and #GMimeFormatOptions, including the
+ *   defaults, may be shared between threads as long as nobody changes
+ *   them while they are shared. Options that have been frozen with
+ *   g_mime_parser_options_freeze() or g_mime_format_options_freeze()
+ *   cannot be changed at all.
+ *
+ * - Everything else (parsers, streams, filters, messages and the
+ *   objects they contain) must only be used by one thread at a time.
+ *   Different threads may freely work on different objects.
  **/
 
 extern void g_mime_crypto_context_shutdown (void);
@@ -61,6 +81,15 @@ const guint gmime_binary_age = GMIME_BINARY_AGE;
 
 static unsigned int initialized = 0;
 
+#ifdef G_THREADS_ENABLED
+static GMutex init_lock;
+#define INIT_UNLOCK() g_mutex_unlock (&init_lock);
+#define INIT_LOCK() g_mutex_lock (&init_lock);
+#else
+#define INIT_UNLOCK()
+#define INIT_LOCK()
+#endif /* G_THREADS_ENABLED */
+
 
 /**
  * g_mime_check_version:
@@ -93,14 +122,19 @@ g_mime_check_version (guint major, guint minor, guint micro)
  * g_mime_init:
  *
  * Initializes GMime.
+ *
+ * This function is thread-safe and may be called more than once, as
+ * long as each call is paired with a call to g_mime_shutdown().
  **/
 void
 g_mime_init (void)
 {
-	initialized = MAX (initialized, 0);
+	INIT_LOCK ();
 	
-	if (initialized++)
+	if (initialized++) {
+		INIT_UNLOCK ();
 		return;
+	}
 	
 	/* seed the random number generator (needed by boundary generator) */
 	srand ((unsigned int) time (NULL));
@@ -114,9 +148,11 @@ g_mime_init (void)
 	g_type_init ();
 #endif
 	
+	g_mime_simd_init ();
 	g_mime_format_options_init ();
 	g_mime_parser_options_init ();
 	g_mime_charset_map_init ();
+	g_mime_iconv_init ();
 	
 #ifdef ENABLE_CRYPTO
 	/* gpgme_check_version() initializes GpgMe */
@@ -211,6 +247,8 @@ g_mime_init (void)
 	g_mime_crypto_context_register ("application/x-pkcs7-mime", g_mime_pkcs7_context_new);
 	g_mime_crypto_context_register ("application/pkcs7-mime", g_mime_pkcs7_context_new);
 	g_mime_crypto_context_register ("application/pkcs7-keys", g_mime_pkcs7_context_new);
+	
+	INIT_UNLOCK ();
 }
 
 
@@ -218,16 +256,28 @@ g_mime_init (void)
  * g_mime_shutdown:
  *
  * Frees internally allocated tables created in g_mime_init().
+ *
+ * Nothing is freed until the last outstanding g_mime_init() has been
+ * paired with a call to this function. No other thread may be using
+ * GMime at that point.
  **/
 void
 g_mime_shutdown (void)
 {
-	if (--initialized)
+	INIT_LOCK ();
+	
+	if (initialized == 0 || --initialized) {
+		INIT_UNLOCK ();
 		return;
+	}
 	
 	g_mime_object_type_registry_shutdown ();
 	g_mime_crypto_context_shutdown ();
 	g_mime_format_options_shutdown ();
 	g_mime_parser_options_shutdown ();
+	g_mime_iconv_shutdown ();
 	g_mime_charset_map_shutdown ();
+	g_mime_utils_shutdown ();
+	
+	INIT_UNLOCK ();
 }
@@ -329,6 +329,43 @@ test_cat_read (GMimeStream *whole, struct _StreamPart *parts, int bounded)
 	}
 }
 
+static void
+test_cat_read_filtered (GMimeStream *whole, struct _StreamPart *parts, int bounded)
+{
+	struct _StreamPart *part = parts;
+	GMimeStream *stream, *filtered, *cat;
+	Exception *ex;
+	int fd;
+	
+	/* filter streams cannot seek, so they can only be read sequentially */
+	cat = g_mime_stream_cat_new ();
+	
+	while (part != NULL) {
+		if ((fd = open (part->filename, O_RDONLY, 0)) == -1) {
+			ex = exception_new ("could not open `%s': %s", part->filename, g_strerror (errno));
+			g_object_unref (cat);
+			throw (ex);
+		}
+		
+		stream = g_mime_stream_fs_new_with_bounds (fd, part->pstart, bounded ? part->pend : -1);
+		filtered = g_mime_stream_filter_new (stream);
+		g_mime_stream_cat_add_source ((GMimeStreamCat *) cat, filtered);
+		g_object_unref (filtered);
+		g_object_unref (stream);
+		
+		part = part->next;
+	}
+	
+	g_mime_stream_reset (whole);
+	if (check_streams_match (whole, cat, "stream.part*", TRUE) == -1) {
+		ex = exception_new ("streams do not match");
+		g_object_unref (cat);
+		throw (ex);
+	}
+	
+	g_object_unref (cat);
+}
+
 static void
 test_cat_seek (GMimeStream *whole, struct _StreamPart *parts, int bounded)
 {
@@ -466,6 +503,7 @@ struct {
 	{ "GMimeStreamCat::write()",            test_cat_write,     FALSE },
 	{ "GMimeStreamCat::read(bound)",        test_cat_read,      TRUE  },
 	{ "GMimeStreamCat::read(unbound)",      test_cat_read,      FALSE },
+	{ "GMimeStreamCat::read(filtered)",     test_cat_read_filtered, TRUE },
 	{ "GMimeStreamCat::seek(bound)",        test_cat_seek,      TRUE  },
 	{ "GMimeStreamCat::seek(unbound)",      test_cat_seek,      FALSE },
 	{ "GMimeStreamCat::substream(bound)",   test_cat_substream, TRUE  },
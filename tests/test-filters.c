@@ -102,6 +102,228 @@ pump_data_through_filter (GMimeFilter *filter, const char *path, GMimeStream *os
 	g_object_unref (stream);
 }
 
+static void
+filter_bytes (GMimeFilter *filter, const GByteArray *input, GByteArray *output)
+{
+	GMimeStream *stream, *filtered, *onebyte;
+	
+	stream = g_mime_stream_mem_new_with_byte_array (output);
+	g_mime_stream_mem_set_owner ((GMimeStreamMem *) stream, FALSE);
+	filtered = g_mime_stream_filter_new (stream);
+	g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
+	g_object_unref (stream);
+	
+	/* feed the filter one byte at a time so that state is carried across every step */
+	onebyte = test_stream_onebyte_new (filtered);
+	g_object_unref (filtered);
+	
+	g_mime_stream_write (onebyte, (const char *) input->data, input->len);
+	g_mime_stream_flush (onebyte);
+	g_object_unref (onebyte);
+}
+
+static void
+test_base64 (void)
+{
+	const char *what = "GMimeFilterBasic::base64";
+	GByteArray *raw, *expected, *actual;
+	GMimeFilter *filter;
+	guint32 save = 0;
+	int state = 0;
+	guint i;
+	
+	testsuite_check ("%s", what);
+	
+	raw = g_byte_array_sized_new (100000);
+	g_byte_array_set_size (raw, 100000);
+	for (i = 0; i < raw->len; i++)
+		raw->data[i] = (guint8) g_random_int_range (0, 256);
+	
+	expected = g_byte_array_sized_new (GMIME_BASE64_ENCODE_LEN (raw->len));
+	g_byte_array_set_size (expected, GMIME_BASE64_ENCODE_LEN (raw->len));
+	g_byte_array_set_size (expected, g_mime_encoding_base64_encode_close (raw->data, raw->len, expected->data, &state, &save));
+	
+	actual = g_byte_array_new ();
+	filter = g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_BASE64, TRUE);
+	filter_bytes (filter, raw, actual);
+	g_object_unref (filter);
+	
+	if (actual->len != expected->len || memcmp (actual->data, expected->data, actual->len) != 0) {
+		testsuite_check_failed ("%s failed: incremental encoding does not match", what);
+		goto error;
+	}
+	
+	g_byte_array_set_size (actual, 0);
+	filter = g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_BASE64, FALSE);
+	filter_bytes (filter, expected, actual);
+	g_object_unref (filter);
+	
+	if (actual->len != raw->len || memcmp (actual->data, raw->data, actual->len) != 0) {
+		testsuite_check_failed ("%s failed: incremental decoding does not match", what);
+		goto error;
+	}
+	
+	testsuite_check_passed ();
+	
+error:
+	g_byte_array_free (expected, TRUE);
+	g_byte_array_free (actual, TRUE);
+	g_byte_array_free (raw, TRUE);
+}
+
+static void
+test_quoted_printable (void)
+{
+	const char *what = "GMimeFilterBasic::quoted-printable";
+	GByteArray *raw, *encoded, *actual;
+	GMimeFilter *filter;
+	guint32 save = 0;
+	int state = -1;
+	guint i, r;
+	
+	testsuite_check ("%s", what);
+	
+	/* mostly literal text with the occasional line break and 8bit character */
+	raw = g_byte_array_sized_new (100000);
+	g_byte_array_set_size (raw, 100000);
+	for (i = 0; i < raw->len; i++) {
+		if ((r = g_random_int_range (0, 100)) < 2)
+			raw->data[i] = '\n';
+		else if (r < 10)
+			raw->data[i] = (guint8) g_random_int_range (128, 256);
+		else
+			raw->data[i] = (guint8) g_random_int_range (' ', 127);
+	}
+	
+	encoded = g_byte_array_sized_new (GMIME_QP_ENCODE_LEN (raw->len));
+	g_byte_array_set_size (encoded, GMIME_QP_ENCODE_LEN (raw->len));
+	g_byte_array_set_size (encoded, g_mime_encoding_quoted_encode_close (raw->data, raw->len, encoded->data, &state, &save));
+	
+	actual = g_byte_array_new ();
+	filter = g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, FALSE);
+	filter_bytes (filter, encoded, actual);
+	g_object_unref (filter);
+	
+	if (actual->len != raw->len || memcmp (actual->data, raw->data, actual->len) != 0) {
+		testsuite_check_failed ("%s failed: incremental decoding does not match", what);
+		goto error;
+	}
+	
+	g_byte_array_set_size (actual, encoded->len);
+	state = 0;
+	save = 0;
+	
+	g_byte_array_set_size (actual, g_mime_encoding_quoted_decode_step (encoded->data, encoded->len, actual->data, &state, &save));
+	
+	if (actual->len != raw->len || memcmp (actual->data, raw->data, actual->len) != 0) {
+		testsuite_check_failed ("%s failed: decoding does not match", what);
+		goto error;
+	}
+	
+	testsuite_check_passed ();
+	
+error:
+	g_byte_array_free (encoded, TRUE);
+	g_byte_array_free (actual, TRUE);
+	g_byte_array_free (raw, TRUE);
+}
+
+static guint32
+crc32_bitwise (const unsigned char *inptr, size_t len)
+{
+	guint32 crc = 0xffffffff;
+	int i;
+	
+	while (len-- > 0) {
+		crc ^= *inptr++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+	
+	return ~crc;
+}
+
+static void
+test_yenc (void)
+{
+	const char *what = "GMimeFilterYenc";
+	GByteArray *raw, *encoded, *article, *actual;
+	guint32 pcrc, crc, expected;
+	GMimeFilter *filter;
+	int state;
+	guint i;
+	
+	testsuite_check ("%s", what);
+	
+	raw = g_byte_array_sized_new (100000);
+	g_byte_array_set_size (raw, 100000);
+	for (i = 0; i < raw->len; i++)
+		raw->data[i] = (guint8) g_random_int_range (0, 256);
+	
+	expected = crc32_bitwise (raw->data, raw->len);
+	
+	encoded = g_byte_array_sized_new ((raw->len + 2) * 2 + 62);
+	g_byte_array_set_size (encoded, (raw->len + 2) * 2 + 62);
+	state = GMIME_YENCODE_STATE_INIT;
+	pcrc = crc = GMIME_YENCODE_CRC_INIT;
+	g_byte_array_set_size (encoded, g_mime_yencode_close (raw->data, raw->len, encoded->data, &state, &pcrc, &crc));
+	
+	if (GMIME_YENCODE_CRC_FINAL (pcrc) != expected || GMIME_YENCODE_CRC_FINAL (crc) != expected) {
+		testsuite_check_failed ("%s failed: encoder crc32 is wrong", what);
+		goto error;
+	}
+	
+	/* wrap it up the way it would arrive over the wire, with CRLF line endings */
+	article = g_byte_array_new ();
+	g_byte_array_append (article, (const guint8 *) "=ybegin line=128 size=100000 name=random.bin\r\n", 46);
+	for (i = 0; i < encoded->len; i++) {
+		if (encoded->data[i] == '\n')
+			g_byte_array_append (article, (const guint8 *) "\r", 1);
+		g_byte_array_append (article, encoded->data + i, 1);
+	}
+	g_byte_array_append (article, (const guint8 *) "=yend size=100000\r\n", 19);
+	
+	actual = g_byte_array_new ();
+	filter = g_mime_filter_yenc_new (FALSE);
+	filter_bytes (filter, article, actual);
+	pcrc = g_mime_filter_yenc_get_pcrc ((GMimeFilterYenc *) filter);
+	g_object_unref (filter);
+	g_byte_array_free (article, TRUE);
+	
+	if (actual->len != raw->len || memcmp (actual->data, raw->data, actual->len) != 0) {
+		testsuite_check_failed ("%s failed: incremental decoding does not match", what);
+		goto decoded;
+	}
+	
+	if (pcrc != expected) {
+		testsuite_check_failed ("%s failed: incremental decoder crc32 is wrong", what);
+		goto decoded;
+	}
+	
+	g_byte_array_set_size (actual, encoded->len);
+	state = GMIME_YDECODE_STATE_INIT;
+	pcrc = crc = GMIME_YENCODE_CRC_INIT;
+	g_byte_array_set_size (actual, g_mime_ydecode_step (encoded->data, encoded->len, actual->data, &state, &pcrc, &crc));
+	
+	if (actual->len != raw->len || memcmp (actual->data, raw->data, actual->len) != 0) {
+		testsuite_check_failed ("%s failed: decoding does not match", what);
+		goto decoded;
+	}
+	
+	if (GMIME_YENCODE_CRC_FINAL (pcrc) != expected || GMIME_YENCODE_CRC_FINAL (crc) != expected) {
+		testsuite_check_failed ("%s failed: decoder crc32 is wrong", what);
+		goto decoded;
+	}
+	
+	testsuite_check_passed ();
+	
+decoded:
+	g_byte_array_free (actual, TRUE);
+error:
+	g_byte_array_free (encoded, TRUE);
+	g_byte_array_free (raw, TRUE);
+}
+
 static void
 test_charset_conversion (const char *datadir, const char *base, const char *from, const char *to)
 {
@@ -153,6 +375,181 @@ error:
 	g_byte_array_free (actual, TRUE);
 }
 
+static void
+test_charset_tables (void)
+{
+	const char *what = "GMimeFilterCharset";
+	static const char *charsets[] = {
+		"iso-8859-1", "iso-8859-2", "iso-8859-5", "iso-8859-7", "iso-8859-15",
+		"windows-1250", "windows-1251", "windows-1252", "koi8-r", "koi8-u"
+	};
+	GByteArray *input, *actual;
+	char expected[1024], *inbuf, *outbuf;
+	size_t inleft, outleft;
+	GMimeFilter *filter;
+	guint i, n;
+	iconv_t cd;
+	
+	/* every printable ASCII character and every byte with the high bit set */
+	input = g_byte_array_sized_new (224);
+	g_byte_array_set_size (input, 224);
+	for (i = 0; i < input->len; i++)
+		input->data[i] = (guint8) (i + 32);
+	
+	for (i = 0; i < G_N_ELEMENTS (charsets); i++) {
+		testsuite_check ("%s (%s -> UTF-8)", what, charsets[i]);
+		
+		if ((cd = g_mime_iconv_open ("UTF-8", charsets[i])) == (iconv_t) -1) {
+			testsuite_check_warn ("%s: %s is not supported by iconv", what, charsets[i]);
+			continue;
+		}
+		
+		/* iconv is the reference: the filter drops invalid bytes */
+		inbuf = (char *) input->data;
+		inleft = input->len;
+		outbuf = expected;
+		outleft = sizeof (expected);
+		
+		while (inleft > 0) {
+			if (iconv (cd, &inbuf, &inleft, &outbuf, &outleft) == (size_t) -1) {
+				inbuf++;
+				inleft--;
+			}
+		}
+		
+		g_mime_iconv_close (cd);
+		n = outbuf - expected;
+		
+		actual = g_byte_array_new ();
+		filter = g_mime_filter_charset_new (charsets[i], "UTF-8");
+		filter_bytes (filter, input, actual);
+		g_object_unref (filter);
+		
+		if (actual->len != n || memcmp (actual->data, expected, n) != 0)
+			testsuite_check_failed ("%s (%s -> UTF-8) failed: output does not match iconv", what, charsets[i]);
+		else
+			testsuite_check_passed ();
+		
+		g_byte_array_free (actual, TRUE);
+	}
+	
+	g_byte_array_free (input, TRUE);
+}
+
+static void
+filter_chain (GMimeFilter *first, GMimeFilter *second, gboolean fused, const GByteArray *input, GByteArray *output)
+{
+	GMimeStream *stream, *filtered;
+	size_t n, nwritten = 0;
+	
+	stream = g_mime_stream_mem_new_with_byte_array (output);
+	g_mime_stream_mem_set_owner ((GMimeStreamMem *) stream, FALSE);
+	
+	if (fused) {
+		/* both filters on the same stream get run as one */
+		filtered = g_mime_stream_filter_new (stream);
+		g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, first);
+		g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, second);
+		g_object_unref (stream);
+	} else {
+		filtered = g_mime_stream_filter_new (stream);
+		g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, second);
+		g_object_unref (stream);
+		
+		stream = filtered;
+		filtered = g_mime_stream_filter_new (stream);
+		g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, first);
+		g_object_unref (stream);
+	}
+	
+	while (nwritten < input->len) {
+		n = MIN (input->len - nwritten, (size_t) g_random_int_range (1, 8192));
+		g_mime_stream_write (filtered, (const char *) input->data + nwritten, n);
+		nwritten += n;
+	}
+	
+	g_mime_stream_flush (filtered);
+	g_object_unref (filtered);
+}
+
+static void
+test_fused_chain (const char *what, GMimeFilter *first, GMimeFilter *second, const GByteArray *input)
+{
+	GMimeFilter *first_copy, *second_copy;
+	GByteArray *expected, *actual;
+	
+	testsuite_check ("%s", what);
+	
+	expected = g_byte_array_new ();
+	actual = g_byte_array_new ();
+	
+	first_copy = g_mime_filter_copy (first);
+	second_copy = g_mime_filter_copy (second);
+	filter_chain (first_copy, second_copy, FALSE, input, expected);
+	g_object_unref (second_copy);
+	g_object_unref (first_copy);
+	
+	filter_chain (first, second, TRUE, input, actual);
+	
+	if (actual->len != expected->len || memcmp (actual->data, expected->data, actual->len) != 0)
+		testsuite_check_failed ("%s failed: fused output does not match", what);
+	else
+		testsuite_check_passed ();
+	
+	g_object_unref (second);
+	g_object_unref (first);
+	
+	g_byte_array_free (expected, TRUE);
+	g_byte_array_free (actual, TRUE);
+}
+
+static void
+test_fused_chains (void)
+{
+	static const char text[] = "abc\xe9\r\n\n\r";
+	GByteArray *raw, *encoded;
+	guint32 save = 0;
+	int state = 0;
+	guint i;
+	
+	/* text with a mix of CRLF, bare CR and bare LF line endings */
+	raw = g_byte_array_sized_new (100000);
+	g_byte_array_set_size (raw, 100000);
+	for (i = 0; i < raw->len; i++)
+		raw->data[i] = text[g_random_int_range (0, sizeof (text) - 1)];
+	
+	test_fused_chain ("GMimeStreamFilter (unix2dos + base64 encode)",
+			  g_mime_filter_unix2dos_new (TRUE),
+			  g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_BASE64, TRUE), raw);
+	
+	encoded = g_byte_array_sized_new (GMIME_BASE64_ENCODE_LEN (raw->len));
+	g_byte_array_set_size (encoded, GMIME_BASE64_ENCODE_LEN (raw->len));
+	g_byte_array_set_size (encoded, g_mime_encoding_base64_encode_close (raw->data, raw->len, encoded->data, &state, &save));
+	
+	test_fused_chain ("GMimeStreamFilter (base64 decode + dos2unix)",
+			  g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_BASE64, FALSE),
+			  g_mime_filter_dos2unix_new (TRUE), encoded);
+	
+	g_byte_array_free (encoded, TRUE);
+	
+	/* every possible byte value so the charset table gets exercised */
+	for (i = 0; i < raw->len; i++)
+		raw->data[i] = (guint8) g_random_int_range (0, 256);
+	
+	encoded = g_byte_array_sized_new (GMIME_QP_ENCODE_LEN (raw->len));
+	g_byte_array_set_size (encoded, GMIME_QP_ENCODE_LEN (raw->len));
+	state = -1;
+	save = 0;
+	g_byte_array_set_size (encoded, g_mime_encoding_quoted_encode_close (raw->data, raw->len, encoded->data, &state, &save));
+	
+	test_fused_chain ("GMimeStreamFilter (quoted-printable decode + charset)",
+			  g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_QUOTEDPRINTABLE, FALSE),
+			  g_mime_filter_charset_new ("iso-8859-1", "UTF-8"), encoded);
+	
+	g_byte_array_free (encoded, TRUE);
+	g_byte_array_free (raw, TRUE);
+}
+
 static void
 test_enriched (const char *datadir, const char *input, const char *output)
 {
@@ -489,6 +886,12 @@ int main (int argc, char **argv)
 	
 	testsuite_start ("GMimeFilter");
 	
+	test_base64 ();
+	test_quoted_printable ();
+	test_yenc ();
+	test_charset_tables ();
+	test_fused_chains ();
+	
 	//test_charset_conversion (datadir, "chinese", "utf-8", "big5"); // Note: utf-8 -> big5 drops characters
 	test_charset_conversion (datadir, "cyrillic", "utf-8", "cp1251");
 	test_charset_conversion (datadir, "cyrillic", "cp1251", "utf-8");
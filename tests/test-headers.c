@@ -26,6 +26,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "testsuite.h"
 
@@ -567,6 +568,153 @@ static struct {
 	  " this is a really, really, reeeeeeaaaaaaalllllllllllllly\n loooooooooooooonnnnnggggggggggg test subject which should get folded into\n multiple lines\n" },
 };
 
+static void
+test_case_insensitive_sync (void)
+{
+	GMimeContentType *content_type;
+	InternetAddressList *list;
+	GMimeHeaderList *headers;
+	GMimeMessage *message;
+	GMimeObject *object;
+	GMimeHeader *header;
+	const char *value;
+	
+	message = g_mime_message_new (TRUE);
+	object = (GMimeObject *) message;
+	headers = object->headers;
+	
+	testsuite_check ("case-insensitive header synchronization");
+	try {
+		g_mime_object_set_header (object, "SUBJECT", "upper-case subject", NULL);
+		if (!(value = g_mime_message_get_subject (message)) || strcmp ("upper-case subject", value) != 0)
+			throw (exception_new ("subject not synchronized"));
+		
+		g_mime_object_append_header (object, "cc", "Tester <tester@localhost.com>", NULL);
+		list = g_mime_message_get_addresses (message, GMIME_ADDRESS_TYPE_CC);
+		if (internet_address_list_length (list) != 1)
+			throw (exception_new ("cc list not synchronized"));
+		
+		g_mime_object_set_header (object, "content-TYPE", "text/html", NULL);
+		content_type = g_mime_object_get_content_type (object);
+		if (!g_mime_content_type_is_type (content_type, "text", "html"))
+			throw (exception_new ("content-type not synchronized"));
+		
+		if (!g_mime_object_remove_header (object, "Subject"))
+			throw (exception_new ("failed to remove subject"));
+		if (g_mime_message_get_subject (message) != NULL)
+			throw (exception_new ("subject not cleared"));
+		
+		if (!g_mime_object_remove_header (object, "CC"))
+			throw (exception_new ("failed to remove cc"));
+		if (internet_address_list_length (list) != 0)
+			throw (exception_new ("cc list not cleared"));
+		
+		g_mime_header_list_append (headers, "X-Custom", "one", NULL);
+		g_mime_header_list_append (headers, "x-custom", "two", NULL);
+		g_mime_header_list_append (headers, "RECEIVED", "one", NULL);
+		g_mime_header_list_append (headers, "received", "two", NULL);
+		g_mime_header_list_set (headers, "x-CUSTOM", "three", NULL);
+		g_mime_header_list_set (headers, "Received", "three", NULL);
+		
+		if (!(header = g_mime_header_list_get_header (headers, "X-Custom")))
+			throw (exception_new ("lookup of X-Custom header failed"));
+		if (!(value = g_mime_header_get_value (header)) || strcmp ("three", value) != 0)
+			throw (exception_new ("unexpected X-Custom value"));
+		
+		if (!g_mime_header_list_remove (headers, "X-CUSTOM") || g_mime_header_list_contains (headers, "x-custom"))
+			throw (exception_new ("duplicate X-Custom header was not replaced"));
+		
+		if (!g_mime_header_list_remove (headers, "RECEIVED") || g_mime_header_list_contains (headers, "received"))
+			throw (exception_new ("duplicate Received header was not replaced"));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("case-insensitive header synchronization: %s", ex->message);
+	} finally;
+	
+	g_object_unref (message);
+}
+
+static void
+test_lazy_sync (void)
+{
+	const char *text = "From: someone@somewhere.com\n"
+		"To: coworker@somewhere.com\n"
+		"Cc: boss@somewhere.com\n"
+		"Cc: hr@somewhere.com\n"
+		"Subject: hey, check this out\n"
+		"Date: Tue, 17 Oct 2017 10:00:00 +0000\n"
+		"Message-Id: <1234@somewhere.com>\n\n"
+		"body\n";
+	InternetAddressList *list;
+	GMimeMessage *message;
+	GMimeParser *parser;
+	GMimeStream *stream;
+	GMimeObject *object;
+	const char *value;
+	GDateTime *date;
+	
+	stream = g_mime_stream_mem_new_with_buffer (text, strlen (text));
+	parser = g_mime_parser_new_with_stream (stream);
+	g_object_unref (stream);
+	
+	message = g_mime_parser_construct_message (parser, NULL);
+	object = (GMimeObject *) message;
+	g_object_unref (parser);
+	
+	testsuite_check ("lazily decoded message headers");
+	try {
+		if (message == NULL)
+			throw (exception_new ("failed to parse message"));
+		
+		/* peek at the deprecated fields to make sure nothing was decoded yet */
+		G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+		if (message->subject != NULL || message->date != NULL || message->message_id != NULL)
+			throw (exception_new ("headers were decoded eagerly"));
+		
+		if (internet_address_list_length (message->addrlists[GMIME_ADDRESS_TYPE_CC]) != 0)
+			throw (exception_new ("addresses were decoded eagerly"));
+		G_GNUC_END_IGNORE_DEPRECATIONS
+		
+		list = g_mime_message_get_cc (message);
+		if (internet_address_list_length (list) != 2)
+			throw (exception_new ("unexpected number of cc addresses"));
+		
+		if (!(value = g_mime_message_get_subject (message)) || strcmp (value, "hey, check this out") != 0)
+			throw (exception_new ("unexpected subject"));
+		
+		if (!(value = g_mime_message_get_message_id (message)) || strcmp (value, "1234@somewhere.com") != 0)
+			throw (exception_new ("unexpected message-id"));
+		
+		if (!(date = g_mime_message_get_date (message)) || g_date_time_get_hour (date) != 10)
+			throw (exception_new ("unexpected date"));
+		
+		/* lists that have been handed out must stay in sync */
+		g_mime_object_append_header (object, "Cc", "intern@somewhere.com", NULL);
+		if (internet_address_list_length (list) != 3)
+			throw (exception_new ("cc list not synchronized"));
+		
+		g_mime_object_set_header (object, "Subject", "never mind", NULL);
+		if (!(value = g_mime_message_get_subject (message)) || strcmp (value, "never mind") != 0)
+			throw (exception_new ("subject not synchronized"));
+		
+		g_mime_object_remove_header (object, "Message-Id");
+		if (g_mime_message_get_message_id (message) != NULL)
+			throw (exception_new ("message-id not cleared"));
+		
+		g_mime_object_set_header (object, "To", "someoneelse@somewhere.com, coworker@somewhere.com", NULL);
+		if (internet_address_list_length (g_mime_message_get_to (message)) != 2)
+			throw (exception_new ("to list not synchronized"));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("lazily decoded message headers: %s", ex->message);
+	} finally;
+	
+	if (message != NULL)
+		g_object_unref (message);
+}
+
 static void
 test_header_formatting (void)
 {
@@ -597,6 +745,76 @@ test_header_formatting (void)
 	g_object_unref (list);
 }
 
+static void
+test_arena (void)
+{
+	const char *text = "From: someone@somewhere.com\n"
+		"To: coworker@somewhere.com\n"
+		"Subject: hey, check this out\n"
+		"MIME-Version: 1.0\n"
+		"Content-Type: multipart/mixed; boundary=\"boundary\"\n\n"
+		"--boundary\n"
+		"Content-Type: text/plain\n"
+		"Content-Description: the body\n\n"
+		"body\n"
+		"--boundary--\n";
+	GMimeHeader *subject, *description;
+	GMimeMessage *message;
+	GMimeParser *parser;
+	GMimeStream *stream;
+	GMimeObject *part;
+	const char *value;
+	
+	stream = g_mime_stream_mem_new_with_buffer (text, strlen (text));
+	parser = g_mime_parser_new_with_stream (stream);
+	g_mime_parser_set_use_arena (parser, TRUE);
+	g_object_unref (stream);
+	
+	message = g_mime_parser_construct_message (parser, NULL);
+	g_object_unref (parser);
+	
+	testsuite_check ("headers allocated from an arena");
+	try {
+		if (message == NULL)
+			throw (exception_new ("failed to parse message"));
+		
+		if (!(subject = g_mime_header_list_get_header (((GMimeObject *) message)->headers, "Subject")))
+			throw (exception_new ("lookup of Subject header failed"));
+		
+		part = g_mime_multipart_get_part ((GMimeMultipart *) message->mime_part, 0);
+		if (!(description = g_mime_header_list_get_header (part->headers, "Content-Description")))
+			throw (exception_new ("lookup of Content-Description header failed"));
+		
+		/* hold on to headers from both the message and the part past the life of the message */
+		g_object_ref (subject);
+		g_object_ref (description);
+		
+		g_mime_object_set_header ((GMimeObject *) message, "To", "someoneelse@somewhere.com", NULL);
+		g_mime_object_remove_header ((GMimeObject *) message, "From");
+		g_object_unref (message);
+		message = NULL;
+		
+		if (strcmp (g_mime_header_get_name (subject), "Subject") != 0)
+			throw (exception_new ("unexpected Subject header name"));
+		if (!(value = g_mime_header_get_value (subject)) || strcmp (value, "hey, check this out") != 0)
+			throw (exception_new ("unexpected Subject header value"));
+		
+		g_mime_header_set_raw_value (description, " a new description\n");
+		if (!(value = g_mime_header_get_value (description)) || strcmp (value, "a new description") != 0)
+			throw (exception_new ("unexpected Content-Description header value"));
+		
+		g_object_unref (description);
+		g_object_unref (subject);
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("headers allocated from an arena: %s", ex->message);
+	} finally;
+	
+	if (message != NULL)
+		g_object_unref (message);
+}
+
 int main (int argc, char **argv)
 {
 	g_mime_init ();
@@ -619,6 +837,12 @@ int main (int argc, char **argv)
 	test_content_type_sync ();
 	test_disposition_sync ();
 	test_address_sync ();
+	test_case_insensitive_sync ();
+	test_lazy_sync ();
+	testsuite_end ();
+	
+	testsuite_start ("header arenas");
+	test_arena ();
 	testsuite_end ();
 	
 	testsuite_start ("header formatting");
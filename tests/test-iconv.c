@@ -132,6 +132,109 @@ test_utils (void)
 	testsuite_end ();
 }
 
+static void
+test_cache (void)
+{
+	char buf[64], *inbuf, *outbuf;
+	size_t inleft, outleft;
+	iconv_t cd;
+	int i;
+	
+	testsuite_start ("iconv descriptor cache");
+	
+	testsuite_check ("reused descriptors are reset");
+	try {
+		for (i = 0; i < 2; i++) {
+			if ((cd = g_mime_iconv_open ("iso-2022-jp", "UTF-8")) == (iconv_t) -1)
+				throw (exception_new ("could not open conversion from UTF-8 to iso-2022-jp"));
+			
+			/* the first time around, leave the descriptor in the shifted state */
+			inbuf = i == 0 ? "\xe6\x97\xa5" : "abc";
+			inleft = strlen (inbuf);
+			outbuf = buf;
+			outleft = sizeof (buf);
+			
+			if (iconv (cd, &inbuf, &inleft, &outbuf, &outleft) == (size_t) -1) {
+				g_mime_iconv_close (cd);
+				throw (exception_new ("conversion failed"));
+			}
+			
+			g_mime_iconv_close (cd);
+		}
+		
+		if ((outbuf - buf) != 3 || strncmp (buf, "abc", 3) != 0)
+			throw (exception_new ("descriptor was not reset to its initial state"));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("reused descriptors are reset: %s", ex->message);
+	} finally;
+	
+	testsuite_end ();
+}
+
+static void
+test_intern (void)
+{
+	static const char *aliases[][2] = {
+		{ "utf-8", "UTF8" },
+		{ "iso-8859-1", "ISO_8859-1" },
+		{ "iso8859-15", "iso_8859_15" },
+		{ "windows-1252", "Windows-CP1252" },
+		{ "gb2312", "euc-cn" },
+		{ "ks_c_5601-1987", "KSC-5601" },
+		{ "x-unknown-charset", "X-Unknown-Charset" },
+	};
+	const char *name;
+	guint id, alias;
+	guint i;
+	
+	testsuite_start ("interned charset ids");
+	
+	for (i = 0; i < G_N_ELEMENTS (aliases); i++) {
+		testsuite_check ("%s and %s", aliases[i][0], aliases[i][1]);
+		try {
+			id = g_mime_charset_intern (aliases[i][0]);
+			alias = g_mime_charset_intern (aliases[i][1]);
+			
+			if (id == 0)
+				throw (exception_new ("%s was interned as 0", aliases[i][0]));
+			
+			if (alias != id)
+				throw (exception_new ("ids do not match: %u vs %u", id, alias));
+			
+			name = g_mime_charset_id_get_iconv_name (id);
+			if (name == NULL || strcmp (name, g_mime_charset_iconv_name (aliases[i][0])) != 0)
+				throw (exception_new ("id %u does not map back to %s", id, g_mime_charset_iconv_name (aliases[i][0])));
+			
+			testsuite_check_passed ();
+		} catch (ex) {
+			testsuite_check_failed ("%s and %s: %s", aliases[i][0], aliases[i][1], ex->message);
+		} finally;
+	}
+	
+	testsuite_check ("distinct charsets");
+	try {
+		if (g_mime_charset_intern ("iso-8859-1") == g_mime_charset_intern ("iso-8859-2"))
+			throw (exception_new ("iso-8859-1 and iso-8859-2 share an id"));
+		
+		if (g_mime_charset_intern (NULL) != 0)
+			throw (exception_new ("NULL was not interned as 0"));
+		
+		if (g_mime_charset_id_get_iconv_name (0) != NULL)
+			throw (exception_new ("id 0 has a name"));
+		
+		if (g_mime_charset_id_get_iconv_name (G_MAXUINT) != NULL)
+			throw (exception_new ("an invalid id has a name"));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("distinct charsets: %s", ex->message);
+	} finally;
+	
+	testsuite_end ();
+}
+
 int main (int argc, char **argv)
 {
 	g_mime_init ();
@@ -139,6 +242,8 @@ int main (int argc, char **argv)
 	testsuite_init (argc, argv);
 	
 	test_utils ();
+	test_cache ();
+	test_intern ();
 	
 	g_mime_shutdown ();
 	
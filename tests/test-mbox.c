@@ -271,6 +271,139 @@ streams_match (GMimeStream *istream, GMimeStream *ostream)
 	return FALSE;
 }
 
+static void
+write_message (GMimeMessage *message, const char *marker, gint64 offset, gpointer user_data)
+{
+	GMimeFormatOptions *format = g_mime_format_options_get_default ();
+	GMimeStream *stream = user_data;
+	
+	g_mime_stream_printf (stream, "%" G_GINT64_FORMAT ": %s\n", offset, marker ? marker : "");
+	
+	if (message != NULL)
+		g_mime_object_write_to_stream ((GMimeObject *) message, format, stream);
+}
+
+static void
+test_parallel (GMimeStream *istream, gboolean respect_content_length)
+{
+	GMimeStream *serial, *parallel;
+	GMimeParser *parser;
+	int i, n[2];
+	
+	serial = g_mime_stream_mem_new ();
+	parallel = g_mime_stream_mem_new ();
+	
+	for (i = 0; i < 2; i++) {
+		g_mime_stream_reset (istream);
+		parser = g_mime_parser_new_with_stream (istream);
+		g_mime_parser_set_format (parser, GMIME_FORMAT_MBOX);
+		g_mime_parser_set_respect_content_length (parser, respect_content_length);
+		n[i] = g_mime_parser_construct_messages (parser, NULL, i == 0 ? 1 : 4, write_message,
+							 i == 0 ? serial : parallel);
+		g_object_unref (parser);
+	}
+	
+	g_mime_stream_reset (serial);
+	g_mime_stream_reset (parallel);
+	
+	if (n[0] != n[1] || !streams_match (serial, parallel)) {
+		g_object_unref (parallel);
+		g_object_unref (serial);
+		
+		throw (exception_new ("parallel parse does not match (%d vs %d messages)", n[1], n[0]));
+	}
+	
+	g_object_unref (parallel);
+	g_object_unref (serial);
+}
+
+static const char from_headers_mbox[] =
+	"From alice@example.com Mon Jan  1 00:00:00 2001\n"
+	"From : Alice <alice@example.com>\n"
+	"Subject: a mangled From header\n"
+	"\n"
+	"The From-line above does not start a new message.\n"
+	"\n"
+	"From bob@example.com Mon Jan  1 00:00:00 2001\n"
+	"From: Bob <bob@example.com>\n"
+	"Subject: a From-line in the content\n"
+	"\n"
+	"From : this one does, though, since it is in the content\n"
+	"\n"
+	"From carol@example.com Mon Jan  1 00:00:00 2001\n"
+	"From: Carol <carol@example.com>\n"
+	"Subject: headers that are not terminated by a blank line\n"
+	"This is the start of the content.\n"
+	"From : is a From-line, since the headers have ended\n"
+	"\n"
+	"content\n";
+
+static void
+test_parallel_from_headers (void)
+{
+	GMimeStream *istream;
+	
+	istream = g_mime_stream_mem_new_with_buffer (from_headers_mbox, strlen (from_headers_mbox));
+	
+	testsuite_check ("parallel split rule");
+	try {
+		test_parallel (istream, FALSE);
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("parallel split rule: %s", ex->message);
+	} finally;
+	
+	g_object_unref (istream);
+}
+
+static void
+test_large_buffer_size (void)
+{
+	GMimeStream *istream, *expected, *actual;
+	GMimeParser *parser;
+	int n[2];
+	
+	istream = g_mime_stream_mem_new_with_buffer (from_headers_mbox, strlen (from_headers_mbox));
+	expected = g_mime_stream_mem_new ();
+	actual = g_mime_stream_mem_new ();
+	
+	parser = g_mime_parser_new_with_stream (istream);
+	g_mime_parser_set_format (parser, GMIME_FORMAT_MBOX);
+	n[0] = g_mime_parser_construct_messages (parser, NULL, 1, write_message, expected);
+	g_object_unref (parser);
+	
+	g_mime_stream_reset (istream);
+	parser = g_mime_parser_new_with_stream (istream);
+	g_mime_parser_set_format (parser, GMIME_FORMAT_MBOX);
+	
+	testsuite_check ("huge buffer sizes");
+	try {
+		/* SCAN_HEAD + size + 4 must not wrap around */
+		g_mime_parser_set_buffer_size (parser, G_MAXSIZE);
+		
+		if (g_mime_parser_get_buffer_size (parser) != 16 * 1024 * 1024)
+			throw (exception_new ("buffer size was not clamped: %" G_GSIZE_FORMAT,
+					      g_mime_parser_get_buffer_size (parser)));
+		
+		n[1] = g_mime_parser_construct_messages (parser, NULL, 1, write_message, actual);
+		
+		g_mime_stream_reset (expected);
+		g_mime_stream_reset (actual);
+		
+		if (n[0] != n[1] || !streams_match (expected, actual))
+			throw (exception_new ("parse does not match (%d vs %d messages)", n[1], n[0]));
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("huge buffer sizes: %s", ex->message);
+	} finally;
+	
+	g_object_unref (parser);
+	g_object_unref (expected);
+	g_object_unref (actual);
+	g_object_unref (istream);
+}
+
 int main (int argc, char **argv)
 {
 	const char *datadir = "data/mbox";
@@ -370,6 +503,11 @@ int main (int argc, char **argv)
 				if (g_mime_parser_get_format (parser) != GMIME_FORMAT_MBOX)
 					throw (exception_new ("format check failed"));
 				
+				g_mime_parser_set_buffer_size (parser, 1024 * 1024);
+				
+				if (g_mime_parser_get_buffer_size (parser) != 1024 * 1024)
+					throw (exception_new ("buffer size check failed"));
+				
 				if (strstr (dent, "content-length") != NULL) {
 					g_mime_parser_set_respect_content_length (parser, TRUE);
 					
@@ -400,6 +538,37 @@ int main (int argc, char **argv)
 				if (!streams_match (ostream, pstream))
 					throw (exception_new ("summaries do not match for `%s'", dent));
 				
+				/* parse it again out of memory so that the content gets scanned in place */
+				g_object_unref (parser);
+				g_object_unref (pstream);
+				
+				pstream = g_mime_stream_mem_new ();
+				g_mime_stream_reset (istream);
+				g_mime_stream_write_to_stream (istream, pstream);
+				g_mime_stream_reset (pstream);
+				
+				parser = g_mime_parser_new_with_stream (pstream);
+				g_mime_parser_set_format (parser, GMIME_FORMAT_MBOX);
+				g_mime_parser_set_respect_content_length (parser, strstr (dent, "content-length") != NULL);
+				g_mime_parser_set_header_regex (parser, "^X-Evolution", xevcb, NULL);
+				g_object_unref (pstream);
+				
+				/* ...and with the headers allocated from per-message arenas */
+				g_mime_parser_set_use_arena (parser, TRUE);
+				
+				if (!g_mime_parser_get_use_arena (parser))
+					throw (exception_new ("use arena check failed"));
+				
+				pstream = g_mime_stream_mem_new ();
+				test_parser (parser, NULL, pstream);
+				
+				g_mime_stream_reset (ostream);
+				g_mime_stream_reset (pstream);
+				if (!streams_match (ostream, pstream))
+					throw (exception_new ("in-memory summaries do not match for `%s'", dent));
+				
+				test_parallel (istream, strstr (dent, "content-length") != NULL);
+				
 				testsuite_check_passed ();
 				
 #ifdef ENABLE_MBOX_MATCH
@@ -431,6 +600,9 @@ int main (int argc, char **argv)
 		}
 		
 		g_dir_close (dir);
+		
+		test_parallel_from_headers ();
+		test_large_buffer_size ();
 	} else if (S_ISREG (st.st_mode)) {
 		/* manually run test on a single file */
 		if (!(istream = g_mime_stream_fs_open (path, O_RDONLY, 0, NULL)))
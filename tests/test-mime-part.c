@@ -477,6 +477,247 @@ error:
 	g_free (path);
 }
 
+static void
+test_lazy_content (const char *datadir, const char *filename)
+{
+	const char *what = "GMimeParser::lazy_content";
+	GMimeFormatOptions *options;
+	GMimeStream *stream;
+	GMimeParser *parser;
+	GMimeObject *object;
+	GByteArray *expected;
+	GByteArray *actual;
+	char *path;
+	
+	testsuite_check ("%s (%s)", what, filename);
+	
+	options = g_mime_format_options_clone (NULL);
+	g_mime_format_options_set_newline_format (options, GMIME_NEWLINE_FORMAT_UNIX);
+	
+	path = g_build_filename (datadir, filename, NULL);
+	expected = read_all_bytes (path, TRUE);
+	actual = g_byte_array_new ();
+	object = NULL;
+	
+	stream = g_mime_stream_mem_new_with_buffer ((const char *) expected->data, expected->len);
+	parser = g_mime_parser_new_with_stream (stream);
+	g_mime_parser_set_lazy_content (parser, TRUE);
+	g_object_unref (stream);
+	
+	if (!g_mime_parser_get_lazy_content (parser)) {
+		testsuite_check_failed ("%s failed: lazy content check failed", what);
+		g_object_unref (parser);
+		goto error;
+	}
+	
+	object = g_mime_parser_construct_part (parser, NULL);
+	g_object_unref (parser);
+	
+	if (!GMIME_IS_PART (object)) {
+		testsuite_check_failed ("%s failed: could not parse a MIME part", what);
+		goto error;
+	}
+	
+	if (!g_mime_part_verify_content_md5 ((GMimePart *) object)) {
+		testsuite_check_failed ("%s failed: Content-Md5 did not match", what);
+		goto error;
+	}
+	
+	stream = g_mime_stream_mem_new ();
+	g_mime_stream_mem_set_byte_array ((GMimeStreamMem *) stream, actual);
+	g_mime_object_write_to_stream (object, options, stream);
+	g_object_unref (stream);
+	
+	if (actual->len != expected->len || memcmp (actual->data, expected->data, actual->len) != 0) {
+		testsuite_check_failed ("%s failed: streams did not match", what);
+		goto error;
+	}
+	
+	testsuite_check_passed ();
+	
+error:
+	if (object != NULL)
+		g_object_unref (object);
+	
+	g_mime_format_options_free (options);
+	g_byte_array_free (expected, TRUE);
+	g_byte_array_free (actual, TRUE);
+	g_free (path);
+}
+
+/* a crypto context whose "verification" just records the content it was given */
+typedef struct {
+	GMimeCryptoContext parent_object;
+	GByteArray *content;
+} CaptureContext;
+
+typedef struct {
+	GMimeCryptoContextClass parent_class;
+} CaptureContextClass;
+
+static const char *
+capture_get_signature_protocol (GMimeCryptoContext *ctx)
+{
+	return "application/x-capture-signature";
+}
+
+static GMimeSignatureList *
+capture_verify (GMimeCryptoContext *ctx, GMimeVerifyFlags flags, GMimeStream *istream,
+		GMimeStream *sigstream, GMimeStream *ostream, GError **err)
+{
+	CaptureContext *capture = (CaptureContext *) ctx;
+	GMimeStream *stream;
+	
+	stream = g_mime_stream_mem_new_with_byte_array (capture->content);
+	g_mime_stream_mem_set_owner ((GMimeStreamMem *) stream, FALSE);
+	g_mime_stream_write_to_stream (istream, stream);
+	g_object_unref (stream);
+	
+	return g_mime_signature_list_new ();
+}
+
+static void
+capture_context_class_init (CaptureContextClass *klass)
+{
+	GMimeCryptoContextClass *crypto_class = GMIME_CRYPTO_CONTEXT_CLASS (klass);
+	
+	crypto_class->get_signature_protocol = capture_get_signature_protocol;
+	crypto_class->verify = capture_verify;
+}
+
+static GType
+capture_context_get_type (void)
+{
+	static GType type = 0;
+	
+	if (!type) {
+		static const GTypeInfo info = {
+			sizeof (CaptureContextClass),
+			NULL, /* base_class_init */
+			NULL, /* base_class_finalize */
+			(GClassInitFunc) capture_context_class_init,
+			NULL, /* class_finalize */
+			NULL, /* class_data */
+			sizeof (CaptureContext),
+			0,    /* n_preallocs */
+			NULL, /* instance_init */
+		};
+		
+		type = g_type_register_static (GMIME_TYPE_CRYPTO_CONTEXT, "CaptureContext", &info, 0);
+	}
+	
+	return type;
+}
+
+static const char signed_head[] =
+	"Content-Type: multipart/signed; boundary=\"signed\";\n"
+	"\tprotocol=\"application/x-capture-signature\"; micalg=sha256\n\n"
+	"--signed\n"
+	"Content-Type: multipart/mixed; boundary=\"mixed\"\n\n"
+	"--mixed\n"
+	"Content-Type: text/plain\n\n"
+	"This is the body of the message.\n\n"
+	"--mixed\n"
+	"Content-Type: text/plain\n"
+	"Content-Transfer-Encoding: quoted-printable\n\n"
+	"This part does not end with a newline=\n"
+	"--mixed\n";
+
+static const char signed_tail[] =
+	"\n--mixed--\n\n"
+	"--signed\n"
+	"Content-Type: application/x-capture-signature\n\n"
+	"signature\n\n"
+	"--signed--\n";
+
+static void
+test_splice_content (const char *datadir, const char *filename)
+{
+	const char *what = "GMimeMultipartSigned::verify() content";
+	GMimeMultipartSigned *mps = NULL;
+	GMimeFormatOptions *options;
+	GMimeSignatureList *list;
+	CaptureContext *capture;
+	GMimeObject *content;
+	GByteArray *expected;
+	GByteArray *message;
+	GByteArray *part;
+	GMimeStream *stream;
+	GMimeParser *parser;
+	GError *err = NULL;
+	char *path;
+	
+	testsuite_check ("%s (%s)", what, filename);
+	
+	path = g_build_filename (datadir, filename, NULL);
+	part = read_all_bytes (path, TRUE);
+	g_free (path);
+	
+	/* the leaf parts are parsed with their encodings intact, so their
+	 * content gets spliced into the stream handed to the crypto context */
+	message = g_byte_array_new ();
+	g_byte_array_append (message, (guint8 *) signed_head, strlen (signed_head));
+	g_byte_array_append (message, part->data, part->len);
+	g_byte_array_append (message, (guint8 *) signed_tail, strlen (signed_tail));
+	g_byte_array_free (part, TRUE);
+	
+	stream = g_mime_stream_mem_new_with_byte_array (message);
+	parser = g_mime_parser_new_with_stream (stream);
+	g_object_unref (stream);
+	
+	mps = (GMimeMultipartSigned *) g_mime_parser_construct_part (parser, NULL);
+	g_object_unref (parser);
+	
+	if (!GMIME_IS_MULTIPART_SIGNED (mps)) {
+		testsuite_check_failed ("%s failed: could not parse a multipart/signed", what);
+		if (mps != NULL)
+			g_object_unref (mps);
+		return;
+	}
+	
+	/* Note: see rfc2015 or rfc3156, section 5.1 */
+	options = g_mime_format_options_clone (NULL);
+	g_mime_format_options_set_newline_format (options, GMIME_NEWLINE_FORMAT_DOS);
+	
+	content = g_mime_multipart_get_part ((GMimeMultipart *) mps, GMIME_MULTIPART_SIGNED_CONTENT);
+	expected = g_byte_array_new ();
+	stream = g_mime_stream_mem_new_with_byte_array (expected);
+	g_mime_stream_mem_set_owner ((GMimeStreamMem *) stream, FALSE);
+	g_mime_object_write_to_stream (content, options, stream);
+	g_mime_format_options_free (options);
+	g_object_unref (stream);
+	
+	capture = g_object_new (capture_context_get_type (), NULL);
+	capture->content = g_byte_array_new ();
+	
+	if (!(list = g_mime_multipart_signed_verify_with_context (mps, (GMimeCryptoContext *) capture, 0, &err))) {
+		testsuite_check_failed ("%s failed: %s", what, err->message);
+		g_error_free (err);
+		goto error;
+	}
+	
+	g_object_unref (list);
+	
+	if (capture->content->len != expected->len) {
+		testsuite_check_failed ("%s failed: lengths did not match (%u vs %u)", what,
+					capture->content->len, expected->len);
+		goto error;
+	}
+	
+	if (memcmp (capture->content->data, expected->data, expected->len) != 0) {
+		testsuite_check_failed ("%s failed: streams did not match", what);
+		goto error;
+	}
+	
+	testsuite_check_passed ();
+	
+error:
+	g_byte_array_free (capture->content, TRUE);
+	g_byte_array_free (expected, TRUE);
+	g_object_unref (capture);
+	g_object_unref (mps);
+}
+
 static char *openpgp_data_types[] = {
 	"GMIME_OPENPGP_DATA_NONE",
 	"GMIME_OPENPGP_DATA_ENCRYPTED",
@@ -589,6 +830,10 @@ int main (int argc, char **argv)
 	test_write_to_stream (datadir, "raptors.b64.txt", GMIME_CONTENT_ENCODING_DEFAULT);
 	test_write_to_stream (datadir, "raptors.uu.txt", GMIME_CONTENT_ENCODING_UUENCODE);
 	
+	test_lazy_content (datadir, "raptors.b64.txt");
+	
+	test_splice_content (datadir, "raptors.b64.txt");
+	
 	test_openpgp_data (datadir, "raptors.png", GMIME_OPENPGP_DATA_NONE);
 	test_openpgp_data (datadir, "signed-body.txt", GMIME_OPENPGP_DATA_SIGNED);
 	test_openpgp_data (datadir, "encrypted-body.txt", GMIME_OPENPGP_DATA_ENCRYPTED);
@@ -339,6 +339,18 @@ static struct {
 	{ "Sat, 28 Oct 2017 19:41:29 -0001",
 	  "Sat, 28 Oct 2017 19:41:29 -0001",
 	  1509219749, -1 },
+	{ "Sat, 28 Oct 2017 19:41:29 +0545",
+	  "Sat, 28 Oct 2017 19:41:29 +0545",
+	  1509198989, 545 },
+	{ "Tue, 12 Nov 2013 14:32:09 +0100 (CET)",
+	  "Tue, 12 Nov 2013 14:32:09 +0100",
+	  1384263129, 100 },
+	{ "1 Jan 2001 00:00:00 GMT",
+	  "Mon, 01 Jan 2001 00:00:00 +0000",
+	  978307200, 0 },
+	{ "Thu, 31 Feb 2019 10:00:00 +0000",
+	  "Thu, 01 Jan 1970 00:00:00 +0000",
+	  0, 0 },
 	{ "nonsense",
 	  "Thu, 01 Jan 1970 00:00:00 +0000",
 	  0, 0 }
@@ -349,6 +361,7 @@ test_date_parser (void)
 {
 	GDateTime *date;
 	Exception *newex;
+	gint64 unix_time;
 	int tz_offset;
 	GTimeSpan tz;
 	time_t time;
@@ -396,6 +409,28 @@ test_date_parser (void)
 			testsuite_check_failed ("Date: '%s': %s", dates[i].in, ex->message);
 		} finally;
 	}
+	
+	for (i = 0; i < G_N_ELEMENTS (dates); i++) {
+		testsuite_check ("Date (unix): '%s'", dates[i].in);
+		try {
+			if (!g_mime_utils_header_decode_date_unix (dates[i].in, &unix_time, &tz_offset)) {
+				if (dates[i].date != 0)
+					throw (exception_new ("failed to parse date: %s", dates[i].in));
+				testsuite_check_passed ();
+				continue;
+			}
+			
+			if (unix_time != (gint64) dates[i].date)
+				throw (exception_new ("time_t's do not match: %" G_GINT64_FORMAT " vs %ld", unix_time, dates[i].date));
+			
+			if (tz_offset != dates[i].tzone)
+				throw (exception_new ("timezones do not match: %d vs %d", tz_offset, dates[i].tzone));
+			
+			testsuite_check_passed ();
+		} catch (ex) {
+			testsuite_check_failed ("Date (unix): '%s': %s", dates[i].in, ex->message);
+		} finally;
+	}
 }
 
 static struct {
@@ -458,6 +493,19 @@ static struct {
 	  "OT - ich =?iso-8859-1?b?d2Vp3yw=?= trotzdem" },
 };
 
+static struct {
+	const char *input;
+	const char *decoded;
+} rfc2047_decode_text[] = {
+	{ "a = b, x=y", "a = b, x=y" },
+	{ "Is 2+2=4? And is 3 = 3? Both questions are answered below", "Is 2+2=4? And is 3 = 3? Both questions are answered below" },
+	{ "trailing whitespace  ", "trailing whitespace  " },
+	{ "=?utf-8?q?a?=  =?utf-8?q?b?= c", "ab c" },
+	{ "=?iso-8859-1?q?caf=?= =?iso-8859-1?q?E9?=", "caf\xc3\xa9" },
+	{ "=?utf-8?b?Y2Fm?= =?utf-8?b?w6k=?= au lait", "caf\xc3\xa9 au lait" },
+	{ "=?utf-8?q?caf=C3?= =?iso-8859-1?q?=E9?=", "caf?\xc3\xa9" },
+};
+
 #if 0
 static struct {
 	const char *input;
@@ -521,6 +569,22 @@ test_rfc2047 (GMimeParserOptions *options, gboolean test_broken)
 		g_free (enc);
 	}
 	
+	for (i = 0; i < G_N_ELEMENTS (rfc2047_decode_text); i++) {
+		dec = NULL;
+		testsuite_check ("rfc2047_decode_text[%u]", i);
+		try {
+			dec = g_mime_utils_header_decode_text (options, rfc2047_decode_text[i].input);
+			if (strcmp (rfc2047_decode_text[i].decoded, dec) != 0)
+				throw (exception_new ("decoded text does not match: %s", dec));
+			
+			testsuite_check_passed ();
+		} catch (ex) {
+			testsuite_check_failed ("rfc2047_decode_text[%u]: %s", i, ex->message);
+		} finally;
+		
+		g_free (dec);
+	}
+	
 #if 0
 	for (i = 0; i < G_N_ELEMENTS (rfc2047_phrase); i++) {
 		dec = enc = NULL;
@@ -221,13 +221,15 @@ then we have ourselves a winner I guess...\n"
 static void
 test_multipart_signed (GMimeCryptoContext *ctx)
 {
+	GPtrArray *parts, *results, *errors;
 	GMimeSignatureList *signatures;
 	GMimeSignatureStatus status;
 	GMimeMultipartSigned *mps;
 	GMimeMessage *message;
 	GMimeTextPart *part;
+	Exception *ex = NULL;
 	GError *err = NULL;
-	Exception *ex;
+	guint i;
 	
 	part = g_mime_text_part_new_with_subtype ("plain");
 	g_mime_text_part_set_text (part, MULTIPART_SIGNED_CONTENT);
@@ -264,10 +266,55 @@ test_multipart_signed (GMimeCryptoContext *ctx)
 	
 	status = get_sig_status (signatures);
 	g_object_unref (signatures);
-	g_object_unref (message);
 	
-	if (status & GMIME_SIGNATURE_STATUS_RED)
+	if (status & GMIME_SIGNATURE_STATUS_RED) {
+		g_object_unref (message);
 		throw (exception_new ("signature status was BAD"));
+	}
+	
+	/* verify again with the caller's context */
+	if (!(signatures = g_mime_multipart_signed_verify_with_context (mps, ctx, 0, &err))) {
+		ex = exception_new ("verify with context: %s", err->message);
+		g_object_unref (message);
+		g_error_free (err);
+		throw (ex);
+	}
+	
+	status = get_sig_status (signatures);
+	g_object_unref (signatures);
+	
+	if (status & GMIME_SIGNATURE_STATUS_RED) {
+		g_object_unref (message);
+		throw (exception_new ("signature status was BAD when verified with context"));
+	}
+	
+	/* and a few more times as a batch */
+	parts = g_ptr_array_new ();
+	for (i = 0; i < 3; i++)
+		g_ptr_array_add (parts, mps);
+	
+	results = g_mime_multipart_signed_verify_batch (parts, 0, &errors);
+	g_ptr_array_free (parts, TRUE);
+	
+	for (i = 0; i < results->len; i++) {
+		if (results->pdata[i] == NULL) {
+			err = errors->pdata[i];
+			ex = exception_new ("batch verify: %s", err ? err->message : "no signatures");
+			break;
+		}
+		
+		if (get_sig_status (results->pdata[i]) & GMIME_SIGNATURE_STATUS_RED) {
+			ex = exception_new ("signature status was BAD when verified as a batch");
+			break;
+		}
+	}
+	
+	g_ptr_array_free (results, TRUE);
+	g_ptr_array_free (errors, TRUE);
+	g_object_unref (message);
+	
+	if (i < 3)
+		throw (ex);
 }
 
 #define MULTIPART_ENCRYPTED_CONTENT "This is a test of multipart/encrypted.\n"
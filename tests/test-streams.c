@@ -526,6 +526,271 @@ cleanup:
 	return TRUE;
 }
 
+static gboolean
+copy_matches (GMimeStream *src, const char *output, const char *filename)
+{
+	GMimeStream *streams[2];
+	gboolean matched;
+	char *tmpname;
+	int fd;
+	
+	if ((fd = g_file_open_tmp ("test-streams.XXXXXX", &tmpname, NULL)) == -1)
+		throw (exception_new ("could not create a temporary file"));
+	
+	streams[1] = g_mime_stream_fs_new (fd);
+	unlink (tmpname);
+	g_free (tmpname);
+	
+	if (g_mime_stream_write_to_stream (src, streams[1]) == -1) {
+		g_object_unref (streams[1]);
+		throw (exception_new ("g_mime_stream_write_to_stream() failed for `%s'", filename));
+	}
+	
+	if ((fd = open (output, O_RDONLY, 0)) == -1) {
+		g_object_unref (streams[1]);
+		throw (exception_new ("could not open `%s'", output));
+	}
+	
+	streams[0] = g_mime_stream_fs_new (fd);
+	g_mime_stream_reset (streams[1]);
+	
+	matched = streams_match (streams, filename);
+	
+	g_object_unref (streams[0]);
+	g_object_unref (streams[1]);
+	
+	return matched;
+}
+
+static gboolean
+check_write_to_stream (const char *input, const char *output, const char *filename, gint64 start, gint64 end)
+{
+	GMimeStream *stream, *substream, *mem;
+	Exception *ex = NULL;
+	int fd;
+	
+	if ((fd = open (input, O_RDONLY, 0)) == -1)
+		return FALSE;
+	
+	stream = g_mime_stream_fs_new (fd);
+	substream = g_mime_stream_substream (stream, start, end);
+	g_object_unref (stream);
+	
+	/* file to file (copied by the kernel where possible) */
+	if (!copy_matches (substream, output, filename)) {
+		ex = exception_new ("file to file copy did not match for `%s'", filename);
+		goto cleanup;
+	}
+	
+	if (!g_mime_stream_eos (substream)) {
+		ex = exception_new ("source is not at the end-of-stream `%s'", filename);
+		goto cleanup;
+	}
+	
+	/* file to memory (buffered) and then memory to file (unbuffered) */
+	mem = g_mime_stream_mem_new ();
+	g_mime_stream_reset (substream);
+	if (g_mime_stream_write_to_stream (substream, mem) == -1) {
+		ex = exception_new ("file to memory copy failed for `%s'", filename);
+		g_object_unref (mem);
+		goto cleanup;
+	}
+	
+	g_mime_stream_reset (mem);
+	if (!copy_matches (mem, output, filename))
+		ex = exception_new ("memory to file copy did not match for `%s'", filename);
+	else if (!g_mime_stream_eos (mem))
+		ex = exception_new ("memory stream is not at the end-of-stream `%s'", filename);
+	
+	g_object_unref (mem);
+	
+cleanup:
+	
+	g_object_unref (substream);
+	
+	if (ex != NULL)
+		throw (ex);
+	
+	return TRUE;
+}
+
+
+static gboolean
+check_borrow (const char *input, const char *output, const char *filename, gint64 start, gint64 end)
+{
+	GMimeStream *stream, *substream, *filtered = NULL;
+	Exception *ex = NULL;
+	GMimeFilter *filter;
+	GByteArray *array;
+	const char *buf;
+	int fd;
+	
+	if ((fd = open (input, O_RDONLY, 0)) == -1)
+		return FALSE;
+	
+	stream = g_mime_stream_fs_new (fd);
+	substream = g_mime_stream_substream (stream, start, end);
+	g_object_unref (stream);
+	
+	/* no filters: the source's data is passed straight through */
+	filtered = g_mime_stream_filter_new (substream);
+	if (!copy_matches (filtered, output, filename)) {
+		ex = exception_new ("unfiltered copy did not match for `%s'", filename);
+		goto cleanup;
+	}
+	
+	g_object_unref (filtered);
+	
+	/* the output of the last filter is lent out */
+	g_mime_stream_reset (substream);
+	filtered = g_mime_stream_filter_new (substream);
+	filter = g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_8BIT, FALSE);
+	g_mime_stream_filter_add ((GMimeStreamFilter *) filtered, filter);
+	g_object_unref (filter);
+	
+	if (!copy_matches (filtered, output, filename)) {
+		ex = exception_new ("filtered copy did not match for `%s'", filename);
+		goto cleanup;
+	}
+	
+	g_object_unref (filtered);
+	
+	/* memory streams lend out their own buffer */
+	filtered = g_mime_stream_mem_new ();
+	g_mime_stream_reset (substream);
+	g_mime_stream_write_to_stream (substream, filtered);
+	g_mime_stream_reset (filtered);
+	
+	array = g_mime_stream_mem_get_byte_array ((GMimeStreamMem *) filtered);
+	if (array->len > 0 && (g_mime_stream_borrow (filtered, &buf, array->len) != (ssize_t) array->len ||
+			       buf != (const char *) array->data)) {
+		ex = exception_new ("memory stream did not lend out its buffer for `%s'", filename);
+		goto cleanup;
+	}
+	
+	if (g_mime_stream_borrow (filtered, &buf, 1) != 0)
+		ex = exception_new ("memory stream is not at the end-of-stream `%s'", filename);
+	
+cleanup:
+	
+	g_object_unref (filtered);
+	g_object_unref (substream);
+	
+	if (ex != NULL)
+		throw (ex);
+	
+	return TRUE;
+}
+
+static GMimeStream *
+writev_target (int which, GMimeStream *mem)
+{
+	GMimeStream *stream;
+	GMimeFilter *filter;
+	
+	switch (which) {
+	case 0:
+		return g_object_ref (mem);
+	case 1:
+		return g_mime_stream_buffer_new (mem, GMIME_STREAM_BUFFER_BLOCK_WRITE);
+	case 2:
+		return g_mime_stream_filter_new (mem);
+	default:
+		stream = g_mime_stream_filter_new (mem);
+		filter = g_mime_filter_basic_new (GMIME_CONTENT_ENCODING_8BIT, TRUE);
+		g_mime_stream_filter_add ((GMimeStreamFilter *) stream, filter);
+		g_object_unref (filter);
+		return stream;
+	}
+}
+
+static gboolean
+check_writev (const char *input, const char *output, const char *filename, gint64 start, gint64 end)
+{
+	GMimeStream *stream, *substream, *mem, *target;
+	GMimeStreamIOVector *vector;
+	Exception *ex = NULL;
+	GByteArray *content;
+	size_t count, n;
+	char *tmpname;
+	int fd, which;
+	guint i;
+	
+	if ((fd = open (input, O_RDONLY, 0)) == -1)
+		return FALSE;
+	
+	stream = g_mime_stream_fs_new (fd);
+	substream = g_mime_stream_substream (stream, start, end);
+	g_object_unref (stream);
+	
+	mem = g_mime_stream_mem_new ();
+	g_mime_stream_write_to_stream (substream, mem);
+	g_object_unref (substream);
+	
+	content = g_byte_array_new ();
+	g_byte_array_append (content, g_mime_stream_mem_get_byte_array ((GMimeStreamMem *) mem)->data,
+			     g_mime_stream_mem_get_byte_array ((GMimeStreamMem *) mem)->len);
+	g_object_unref (mem);
+	
+	/* chop the content up into lots of little (and some empty) vectors */
+	vector = g_new (GMimeStreamIOVector, content->len * 2 + 1);
+	for (i = 0, count = 0; i < content->len; i += n) {
+		n = MIN (content->len - i, (size_t) g_random_int_range (1, 100));
+		vector[count].data = content->data + i;
+		vector[count++].len = n;
+		
+		if ((count % 8) == 0) {
+			vector[count].data = content->data + i;
+			vector[count++].len = 0;
+		}
+	}
+	
+	/* memory-backed targets */
+	for (which = 0; which < 4 && ex == NULL; which++) {
+		mem = g_mime_stream_mem_new ();
+		target = writev_target (which, mem);
+		
+		if (g_mime_stream_writev (target, vector, count) != (gint64) content->len)
+			ex = exception_new ("writev to target %d returned the wrong length for `%s'", which, filename);
+		
+		g_mime_stream_flush (target);
+		g_object_unref (target);
+		
+		g_mime_stream_reset (mem);
+		if (ex == NULL && !copy_matches (mem, output, filename))
+			ex = exception_new ("writev to target %d did not match for `%s'", which, filename);
+		
+		g_object_unref (mem);
+	}
+	
+	/* file-backed target */
+	if (ex == NULL) {
+		if ((fd = g_file_open_tmp ("test-streams.XXXXXX", &tmpname, NULL)) == -1) {
+			ex = exception_new ("could not create a temporary file");
+		} else {
+			stream = g_mime_stream_fs_new (fd);
+			unlink (tmpname);
+			g_free (tmpname);
+			
+			if (g_mime_stream_writev (stream, vector, count) != (gint64) content->len)
+				ex = exception_new ("writev to a file returned the wrong length for `%s'", filename);
+			
+			g_mime_stream_reset (stream);
+			if (ex == NULL && !copy_matches (stream, output, filename))
+				ex = exception_new ("writev to a file did not match for `%s'", filename);
+			
+			g_object_unref (stream);
+		}
+	}
+	
+	g_byte_array_free (content, TRUE);
+	g_free (vector);
+	
+	if (ex != NULL)
+		throw (ex);
+	
+	return TRUE;
+}
 
 typedef gboolean (* checkFunc) (const char *, const char *, const char *, gint64, gint64);
 
@@ -540,6 +805,9 @@ static struct {
 #endif /* HAVE_MMAP */
 	{ "GMimeStreamBuffer", check_stream_buffer },
 	{ "GMimeStreamGIO",    check_stream_gio    },
+	{ "write_to_stream",   check_write_to_stream },
+	{ "borrow",            check_borrow        },
+	{ "writev",            check_writev        },
 };
 
 static void
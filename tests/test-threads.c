@@ -0,0 +1,301 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*  GMime
+ *  Copyright (C) 2000-2017 Jeffrey Stedfast
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gmime/gmime.h>
+
+#include "testsuite.h"
+
+/* Parses and serializes the same messages on several threads at once
+ * while other threads register MIME types and intern new charsets.
+ * This is most useful when GMime was configured with --enable-tsan,
+ * in which case ThreadSanitizer reports any data races. */
+
+#define NTHREADS    8
+#define ITERATIONS  50
+
+static const char *messages[] = {
+	"From: =?iso-8859-1?q?Jo=E3o?= <joao@example.com>\n"
+	"To: \"Doe, John\" <john@example.com>, =?utf-8?b?0JjQstCw0L0=?= <ivan@example.ru>\n"
+	"Cc: undisclosed-recipients:;\n"
+	"Subject: =?windows-1252?q?caf=E9?= =?windows-1252?q?_au_lait?= and =?koi8-r?b?8NLJ18XU?=\n"
+	"Date: Tue, 12 Nov 2013 14:32:09 +0100\n"
+	"Message-Id: <1234@example.com>\n"
+	"MIME-Version: 1.0\n"
+	"Content-Type: text/plain; charset=iso-8859-1\n"
+	"Content-Transfer-Encoding: quoted-printable\n"
+	"\n"
+	"Ol=E1, mundo!\n",
+
+	"From: sender@example.com\n"
+	"To: recipient@example.com\n"
+	"Subject: =?iso-2022-jp?b?GyRCRnxLXDhsGyhC?= attachment\n"
+	"Date: 1 Jan 2001 00:00:00 GMT\n"
+	"MIME-Version: 1.0\n"
+	"Content-Type: multipart/mixed; boundary=\"outer\"\n"
+	"\n"
+	"--outer\n"
+	"Content-Type: multipart/alternative; boundary=\"inner\"\n"
+	"\n"
+	"--inner\n"
+	"Content-Type: text/plain; charset=utf-8\n"
+	"\n"
+	"plain text\n"
+	"--inner\n"
+	"Content-Type: text/html; charset=utf-8\n"
+	"\n"
+	"<p>html text</p>\n"
+	"--inner--\n"
+	"--outer\n"
+	"Content-Type: application/octet-stream; name*=utf-8''%E2%82%AC.bin\n"
+	"Content-Disposition: attachment; filename=\"data.bin\"\n"
+	"Content-Transfer-Encoding: base64\n"
+	"\n"
+	"AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8=\n"
+	"--outer\n"
+	"Content-Type: message/rfc822\n"
+	"\n"
+	"From: nested@example.com\n"
+	"Subject: nested\n"
+	"\n"
+	"nested body\n"
+	"--outer--\n",
+};
+
+typedef struct {
+	GMimeFormatOptions *format;
+	GPtrArray *expected;
+	char *error;
+	int id;
+} Worker;
+
+/* parses @text and returns its decoded summary followed by its serialized form */
+static char *
+parse_and_write (GMimeParserOptions *options, GMimeFormatOptions *format, const char *text)
+{
+	InternetAddressList *list;
+	GMimeMessage *message;
+	GMimeParser *parser;
+	GMimeStream *stream;
+	GByteArray *array;
+	GDateTime *date;
+	GString *output;
+	const char *subject;
+	char *str;
+	
+	stream = g_mime_stream_mem_new_with_buffer (text, strlen (text));
+	parser = g_mime_parser_new_with_stream (stream);
+	g_object_unref (stream);
+	
+	message = g_mime_parser_construct_message (parser, options);
+	g_object_unref (parser);
+	
+	if (message == NULL)
+		return NULL;
+	
+	output = g_string_new ("");
+	
+	/* decode the message-level headers too, not just the raw text */
+	subject = g_mime_message_get_subject (message);
+	g_string_append_printf (output, "%s|", subject ? subject : "");
+	
+	if ((list = g_mime_message_get_from (message))) {
+		str = internet_address_list_to_string (list, NULL, TRUE);
+		g_string_append_printf (output, "%s|", str);
+		g_free (str);
+	}
+	
+	if ((date = g_mime_message_get_date (message))) {
+		str = g_date_time_format (date, "%Y-%m-%dT%H:%M:%S%z");
+		g_string_append_printf (output, "%s|", str);
+		g_free (str);
+	}
+	
+	array = g_byte_array_new ();
+	stream = g_mime_stream_mem_new_with_byte_array (array);
+	g_mime_stream_mem_set_owner ((GMimeStreamMem *) stream, FALSE);
+	g_mime_object_write_to_stream ((GMimeObject *) message, format, stream);
+	g_object_unref (stream);
+	g_object_unref (message);
+	
+	g_string_append_len (output, (char *) array->data, array->len);
+	g_byte_array_free (array, TRUE);
+	
+	return g_string_free (output, FALSE);
+}
+
+static gpointer
+parse_worker (gpointer user_data)
+{
+	Worker *worker = user_data;
+	GMimeParserOptions *options;
+	char *actual;
+	guint i, j;
+	
+	/* every thread pairs its own init/shutdown */
+	g_mime_init ();
+	
+	/* a private copy of the defaults that only this thread modifies */
+	options = g_mime_parser_options_clone (NULL);
+	g_mime_parser_options_set_rfc2047_compliance_mode (options, GMIME_RFC_COMPLIANCE_LOOSE);
+	
+	for (i = 0; i < ITERATIONS && worker->error == NULL; i++) {
+		for (j = 0; j < G_N_ELEMENTS (messages); j++) {
+			actual = parse_and_write (worker->id & 1 ? options : NULL, worker->format, messages[j]);
+			
+			if (actual == NULL || strcmp (actual, worker->expected->pdata[j]) != 0) {
+				worker->error = g_strdup_printf ("thread %d: message %u differs on iteration %u", worker->id, j, i);
+				g_free (actual);
+				break;
+			}
+			
+			g_free (actual);
+		}
+	}
+	
+	g_mime_parser_options_free (options);
+	g_mime_shutdown ();
+	
+	return NULL;
+}
+
+static gpointer
+registry_worker (gpointer user_data)
+{
+	Worker *worker = user_data;
+	char *subtype, *charset, *word, *decoded;
+	guint i;
+	
+	for (i = 0; i < ITERATIONS; i++) {
+		subtype = g_strdup_printf ("x-thread-%d-%u", worker->id, i);
+		g_mime_object_register_type ("application", subtype, GMIME_TYPE_PART);
+		g_free (subtype);
+		
+		/* each of these is a charset that nobody has seen before */
+		charset = g_strdup_printf ("x-charset-%d-%u", worker->id, i);
+		if (g_mime_charset_intern (charset) == 0 ||
+		    strcmp (g_mime_charset_id_get_iconv_name (g_mime_charset_intern (charset)), charset) != 0) {
+			worker->error = g_strdup_printf ("thread %d: could not intern %s", worker->id, charset);
+			g_free (charset);
+			break;
+		}
+		
+		word = g_strdup_printf ("=?%s?q?abc?=", charset);
+		decoded = g_mime_utils_header_decode_text (NULL, word);
+		g_free (decoded);
+		g_free (charset);
+		g_free (word);
+	}
+	
+	return NULL;
+}
+
+static void
+test_threads (void)
+{
+	Worker workers[NTHREADS];
+	GThread *threads[NTHREADS];
+	GMimeFormatOptions *format, *clone;
+	GPtrArray *expected;
+	guint i;
+	
+	testsuite_start ("concurrent parsing and serializing");
+	
+	testsuite_check ("default options are not frozen");
+	try {
+		if (g_mime_parser_options_is_frozen (g_mime_parser_options_get_default ()))
+			throw (exception_new ("default parser options are frozen"));
+		
+		if (g_mime_format_options_is_frozen (g_mime_format_options_get_default ()))
+			throw (exception_new ("default format options are frozen"));
+		
+		format = g_mime_format_options_clone (NULL);
+		g_mime_format_options_freeze (format);
+		clone = g_mime_format_options_clone (format);
+		g_mime_format_options_free (format);
+		
+		if (g_mime_format_options_is_frozen (clone)) {
+			g_mime_format_options_free (clone);
+			throw (exception_new ("clones of frozen format options are frozen"));
+		}
+		
+		g_mime_format_options_free (clone);
+		
+		testsuite_check_passed ();
+	} catch (ex) {
+		testsuite_check_failed ("default options are not frozen: %s", ex->message);
+	} finally;
+	
+	/* all of the parser threads share a single frozen set of format options */
+	format = g_mime_format_options_clone (NULL);
+	g_mime_format_options_set_newline_format (format, GMIME_NEWLINE_FORMAT_DOS);
+	g_mime_format_options_freeze (format);
+	
+	expected = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; i < G_N_ELEMENTS (messages); i++)
+		g_ptr_array_add (expected, parse_and_write (NULL, format, messages[i]));
+	
+	for (i = 0; i < NTHREADS; i++) {
+		workers[i].format = format;
+		workers[i].expected = expected;
+		workers[i].error = NULL;
+		workers[i].id = i;
+		
+		threads[i] = g_thread_new ("test-threads", i < NTHREADS / 4 ? registry_worker : parse_worker, &workers[i]);
+	}
+	
+	for (i = 0; i < NTHREADS; i++)
+		g_thread_join (threads[i]);
+	
+	for (i = 0; i < NTHREADS; i++) {
+		testsuite_check ("thread %u (%s)", i, i < NTHREADS / 4 ? "registries" : "parser");
+		if (workers[i].error != NULL) {
+			testsuite_check_failed ("%s", workers[i].error);
+			g_free (workers[i].error);
+		} else {
+			testsuite_check_passed ();
+		}
+	}
+	
+	g_ptr_array_free (expected, TRUE);
+	g_mime_format_options_free (format);
+	
+	testsuite_end ();
+}
+
+int main (int argc, char **argv)
+{
+	g_mime_init ();
+	
+	testsuite_init (argc, argv);
+	
+	test_threads ();
+	
+	g_mime_shutdown ();
+	
+	return testsuite_exit ();
+}